@@ -8,6 +8,9 @@ include(CMakeDependentOption)
 #--------------------------------------------------------------------
 option(USE_CCACHE       "Enable compiler cache that can improve build times" ${IS_MAIN})
 option(ENABLE_LOG       "Enable log support"                                 ON)
+option(ENABLE_BENCHMARK "Build the RayTracingBenchmark executable"             OFF)
+option(ENABLE_STATS     "Enable render statistics and the cost heatmap"        OFF)
+option(USE_FLOAT        "Build the math core in single precision"              OFF)
 
 #--------------------------------------------------------------------
 # Sanitize Options
@@ -0,0 +1,109 @@
+#include "benchmark.h"
+#include <math.h>   /* fabs */
+#include <stdlib.h> /* malloc, free */
+
+#define IMAGE_WIDTH      200
+#define MAX_DEPTH        20
+#define REFERENCE_SPP    1024
+#define ADAPTIVE_MAX_SPP 256
+
+typedef struct
+{
+    double seconds;
+    double samples; // Average samples per pixel
+    double rmse;
+} render_result;
+
+// Renders `cam` on one thread and measures it against `reference`
+static render_result
+measure( const camera * cam, const hittable * world, const unsigned char * reference, unsigned char * image,
+         int * counts )
+{
+    const size_t pixels = (size_t)cam->image_width * cam->image_height;
+
+    double start        = bench_now();
+    camera_render_counted( cam, (const struct hittable *)world, image, counts );
+    double seconds      = bench_now() - start;
+
+    double samples      = 0.0;
+    for( size_t k = 0; k < pixels; ++k )
+        {
+            samples += counts[k];
+        }
+    return (render_result) { seconds, samples / pixels, bench_image_rmse( image, reference, pixels * 3 ) };
+}
+
+void
+bench_adaptive( void )
+{
+    static const int    fixed_spp[]  = { 8, 16, 32, 64, 128 };
+    static const double thresholds[] = { 0.04, 0.02, 0.01 };
+    enum
+    {
+        FIXED_COUNT = sizeof( fixed_spp ) / sizeof( fixed_spp[0] )
+    };
+
+    bench_scene scene;
+    bench_world world;
+    camera      cam;
+    const bool  built = bench_scene_init( &scene, 0 );
+    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, REFERENCE_SPP, MAX_DEPTH );
+    bvh_flat * bvh = bench_world_build( &world, &scene.world );
+
+    const size_t    pixels    = (size_t)cam.image_width * cam.image_height;
+    unsigned char * reference = (unsigned char *)malloc( pixels * 3 );
+    unsigned char * image     = (unsigned char *)malloc( pixels * 3 );
+    int *           counts    = (int *)malloc( pixels * sizeof( int ) );
+    if( built && NULL != bvh && NULL != reference && NULL != image && NULL != counts )
+        {
+            // Converged image, from samples independent of the measured renders
+            camera reference_cam       = cam;
+            reference_cam.seed         = cam.seed + 1;
+            reference_cam.thread_count = 0;
+            camera_render( &reference_cam, (const struct hittable *)bvh, reference );
+
+            cam.thread_count = 1;
+            render_result fixed[FIXED_COUNT];
+            for( int i = 0; i < FIXED_COUNT; ++i )
+                {
+                    cam.samples_per_pixel = fixed_spp[i];
+                    fixed[i]              = measure( &cam, &bvh->base, reference, image, counts );
+
+                    bench_reportf( "adaptive", fixed[i].seconds * 1e3, "ms", "book: fixed %d spp, render time",
+                                   fixed_spp[i] );
+                    bench_reportf( "adaptive", fixed[i].rmse, "levels", "book: fixed %d spp, RMSE", fixed_spp[i] );
+                }
+
+            cam.samples_per_pixel = ADAPTIVE_MAX_SPP;
+            for( size_t i = 0; i < sizeof( thresholds ) / sizeof( thresholds[0] ); ++i )
+                {
+                    cam.adaptive_threshold = thresholds[i];
+                    render_result adaptive = measure( &cam, &bvh->base, reference, image, counts );
+
+                    // Fixed-count time to reach the same error, scaled from the fixed render closest in error:
+                    // error falls with the square root of the sample count, time grows linearly with it
+                    int closest = 0;
+                    for( int f = 1; f < FIXED_COUNT; ++f )
+                        {
+                            if( fabs( fixed[f].rmse - adaptive.rmse ) < fabs( fixed[closest].rmse - adaptive.rmse ) )
+                                closest = f;
+                        }
+                    const double ratio = fixed[closest].rmse / adaptive.rmse;
+
+                    const double threshold = thresholds[i];
+                    bench_reportf( "adaptive", adaptive.seconds * 1e3, "ms", "book: adaptive %.2f, render time",
+                                   threshold );
+                    bench_reportf( "adaptive", adaptive.samples, "spp", "book: adaptive %.2f, samples/pixel",
+                                   threshold );
+                    bench_reportf( "adaptive", adaptive.rmse, "levels", "book: adaptive %.2f, RMSE", threshold );
+                    bench_reportf( "adaptive", fixed[closest].seconds * ratio * ratio * 1e3, "ms",
+                                   "book: adaptive %.2f, fixed time, same RMSE", threshold );
+                }
+        }
+
+    free( counts );
+    free( image );
+    free( reference );
+    bench_world_free( &world );
+    bench_scene_free( &scene );
+}
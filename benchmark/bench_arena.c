@@ -0,0 +1,158 @@
+#include "benchmark.h"
+#include "bvh.h"
+#include "bvh_flat.h"
+#include "dielectric.h"
+#include "hittable_list.h"
+#include "lambertian.h"
+#include "material_table.h"
+#include "metal.h"
+#include "scene.h"
+#include "sphere.h"
+#include <math.h>   /* cbrt */
+#include <stdlib.h> /* malloc, free */
+
+#define SPHERE_COUNT       1000000
+#define RAY_BUDGET_SECONDS 1.0
+#define IMAGE_WIDTH        400
+
+//----------------------------------------------------------------------------------------------------------------------
+// The sphere cloud as it was built before the scene arena: one malloc per sphere and per material, every sphere
+// with a material of its own, and every object freed on its own. The materials are registered with the table as
+// custom materials, which keeps one pointer each. Draws the same numbers as scene_sphere_cloud, so both build the
+// same scene.
+//----------------------------------------------------------------------------------------------------------------------
+static material *
+legacy_random_material( rng * gen, double choose_mat )
+{
+    if( 0.8 > choose_mat )
+        {
+            lambertian * mat = malloc( sizeof( lambertian ) );
+            if( !mat ) return NULL;
+            color albedo = vec3_mul_vec( vec3_new( random_double( gen ), random_double( gen ), random_double( gen ) ),
+                                         vec3_new( random_double( gen ), random_double( gen ), random_double( gen ) ) );
+            lambertian_init( mat, albedo );
+            return (material *)mat;
+        }
+
+    if( 0.95 > choose_mat )
+        {
+            metal * mat = malloc( sizeof( metal ) );
+            if( !mat ) return NULL;
+            color  albedo = vec3_new( random_double_range( gen, 0.5, 1 ), random_double_range( gen, 0.5, 1 ),
+                                      random_double_range( gen, 0.5, 1 ) );
+            double fuzz   = random_double_range( gen, 0, 0.5 );
+            metal_init( mat, albedo, fuzz );
+            return (material *)mat;
+        }
+
+    dielectric * mat = malloc( sizeof( dielectric ) );
+    if( !mat ) return NULL;
+    dielectric_init( mat, 1.5 );
+    return (material *)mat;
+}
+
+static bool
+legacy_sphere_cloud( hittable_list * world, material_table * materials, rng * gen, int count )
+{
+    const double half = 0.5 * cbrt( (double)count );
+
+    for( int i = 0; i < count; ++i )
+        {
+            point3 center = vec3_new( random_double_range( gen, -half, half ), random_double_range( gen, -half, half ),
+                                      random_double_range( gen, -half, half ) );
+            double radius = random_double_range( gen, 0.1, 0.3 );
+
+            material *  mat = legacy_random_material( gen, random_double( gen ) );
+            sphere *    s   = malloc( sizeof( sphere ) );
+            material_id id  = ( mat && s ) ? material_table_add_custom( materials, mat ) : MATERIAL_ID_NONE;
+            if( MATERIAL_ID_NONE == id )
+                {
+                    free( mat );
+                    free( s );
+                    return false;
+                }
+
+            sphere_init( s, center, radius, id );
+            if( !hittable_list_add( world, (hittable *)s ) ) return false;
+        }
+    return true;
+}
+
+static void
+legacy_free( hittable_list * world, material_table * materials )
+{
+    for( size_t i = 0; i < world->count; ++i )
+        {
+            free( world->objects[i] );
+        }
+    for( size_t m = 0; m < materials->count[MATERIAL_CUSTOM]; ++m )
+        {
+            free( materials->customs[m] );
+        }
+    hittable_list_clear( world );
+    material_table_free( materials );
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Suite
+//----------------------------------------------------------------------------------------------------------------------
+// Times the traversal of `world`, first as a linear list and then under a flat BVH over the individual spheres
+static void
+measure_traversal( const char * case_name, hittable_list * world, const camera * cam )
+{
+    bench_reportf( "arena", bench_primary_ray_rate( cam, &world->base, RAY_BUDGET_SECONDS ), "rays/s",
+                   "cloud %dk: %s, linear list", SPHERE_COUNT / 1000, case_name );
+
+    hittable * tree = bvh_node_build( world );
+    bvh_flat * bvh  = bvh_flat_build( tree );
+    bvh_node_free( tree );
+    if( NULL == bvh ) return;
+
+    bench_reportf( "arena", bench_primary_ray_rate( cam, &bvh->base, RAY_BUDGET_SECONDS ) * 1e-3, "krays/s",
+                   "cloud %dk: %s, flat bvh", SPHERE_COUNT / 1000, case_name );
+    bvh_flat_free( bvh );
+}
+
+void
+bench_arena( void )
+{
+    rng            gen;
+    hittable_list  world;
+    arena          memory;
+    material_table materials;
+    camera         cam;
+
+    scene_sphere_cloud_camera( &cam, SPHERE_COUNT, 16.0 / 9.0, IMAGE_WIDTH, 1, 1 );
+
+    // One allocation per object
+    rng_seed( &gen, 1, 0 );
+    double start = bench_now();
+    hittable_list_init( &world, SPHERE_COUNT );
+    material_table_init( &materials );
+    bool ok = legacy_sphere_cloud( &world, &materials, &gen, SPHERE_COUNT );
+    bench_reportf( "arena", ( bench_now() - start ) * 1e3, "ms",
+                   "cloud %dk: malloc, scene build", SPHERE_COUNT / 1000 );
+    if( ok ) measure_traversal( "malloc", &world, &cam );
+
+    start = bench_now();
+    legacy_free( &world, &materials );
+    bench_reportf( "arena", ( bench_now() - start ) * 1e3, "ms", "cloud %dk: malloc, scene free", SPHERE_COUNT / 1000 );
+
+    // Scene arena
+    rng_seed( &gen, 1, 0 );
+    start = bench_now();
+    hittable_list_init( &world, SPHERE_COUNT );
+    arena_init( &memory, 0 );
+    material_table_init( &materials );
+    ok = scene_sphere_cloud( &world, &memory, &materials, &gen, SPHERE_COUNT );
+    bench_reportf( "arena", ( bench_now() - start ) * 1e3, "ms", "cloud %dk: arena, scene build", SPHERE_COUNT / 1000 );
+    bench_reportf( "arena", (double)memory.reserved / ( 1 << 20 ), "MiB",
+                   "cloud %dk: arena, memory", SPHERE_COUNT / 1000 );
+    if( ok ) measure_traversal( "arena", &world, &cam );
+
+    start = bench_now();
+    hittable_list_clear( &world );
+    arena_free( &memory );
+    material_table_free( &materials );
+    bench_reportf( "arena", ( bench_now() - start ) * 1e3, "ms", "cloud %dk: arena, scene free", SPHERE_COUNT / 1000 );
+}
@@ -0,0 +1,59 @@
+#include "benchmark.h"
+#include "bvh.h"
+#include "bvh_flat.h"
+
+#define RAY_BUDGET_SECONDS 1.0
+#define IMAGE_WIDTH        400
+
+static void
+measure_scene( const bench_scene * scene, const camera * cam )
+{
+    const char *          name       = scene->name;
+    const hittable_list * world      = &scene->world;
+    const double          primitives = (double)world->count;
+
+    bench_reportf( "bvh", scene->build_seconds * 1e3, "ms", "%s: scene build", name );
+    bench_reportf( "bvh", bench_primary_ray_rate( cam, &world->base, RAY_BUDGET_SECONDS ) * 1e-3, "krays/s",
+                   "%s: linear list", name );
+
+    // Pointer tree
+    double     start = bench_now();
+    hittable * tree  = bvh_node_build( world );
+    bench_reportf( "bvh", ( bench_now() - start ) * 1e3, "ms", "%s: bvh build", name );
+    if( NULL == tree ) return;
+
+    bench_reportf( "bvh", bvh_node_count( tree ) * sizeof( bvh_node ) / primitives, "B/prim", "%s: bvh memory", name );
+    bench_reportf( "bvh", bench_primary_ray_rate( cam, tree, RAY_BUDGET_SECONDS ) * 1e-3, "krays/s", "%s: bvh", name );
+
+    // Flattened copy
+    start          = bench_now();
+    bvh_flat * bvh = bvh_flat_build( tree );
+    bench_reportf( "bvh", ( bench_now() - start ) * 1e3, "ms", "%s: flat bvh build", name );
+    bvh_node_free( tree );
+    if( NULL == bvh ) return;
+
+    bench_reportf( "bvh", bvh_flat_memory( bvh ) / primitives, "B/prim", "%s: flat bvh memory", name );
+    bench_reportf( "bvh", bench_primary_ray_rate( cam, &bvh->base, RAY_BUDGET_SECONDS ) * 1e-3, "krays/s",
+                   "%s: flat bvh", name );
+
+    bvh_flat_free( bvh );
+}
+
+void
+bench_bvh( void )
+{
+    // The book scene, then synthetic sphere clouds
+    static const int cloud_sizes[] = { 0, 10000, 100000, 1000000 };
+
+    for( size_t i = 0; i < sizeof( cloud_sizes ) / sizeof( cloud_sizes[0] ); ++i )
+        {
+            bench_scene scene;
+            camera      cam;
+            if( bench_scene_init( &scene, cloud_sizes[i] ) )
+                {
+                    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, 1, 1 );
+                    measure_scene( &scene, &cam );
+                }
+            bench_scene_free( &scene );
+        }
+}
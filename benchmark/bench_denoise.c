@@ -0,0 +1,122 @@
+#include "aov_image.h"
+#include "benchmark.h"
+#include "denoise.h"
+#include "hdr_image.h"
+#include "postprocess.h"
+#include <math.h>   /* fabs */
+#include <stdlib.h> /* malloc, free */
+
+#define IMAGE_WIDTH   320
+#define MAX_DEPTH     20
+#define REFERENCE_SPP 1024
+
+// Renders the linear radiance of `cam` into `radiance` and grades it into `image`
+static double
+render( const camera * cam, const hittable * world, const postprocess_settings * post, hdr_image * radiance,
+        unsigned char * image )
+{
+    double start   = bench_now();
+    bool   ok      = camera_render_rows_hdr( cam, (const struct hittable *)world, radiance->pixels, 0,
+                                             cam->image_height );
+    double seconds = bench_now() - start;
+    hdr_image_tonemap( radiance, post, image );
+    return ok ? seconds : 0.0;
+}
+
+void
+bench_denoise( void )
+{
+    static const int spp[] = { 4, 16, 64, 256 };
+    enum
+    {
+        CASE_COUNT = sizeof( spp ) / sizeof( spp[0] )
+    };
+
+    bench_scene scene;
+    bench_world world;
+    camera      cam;
+    const bool  built = bench_scene_init( &scene, 0 );
+    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, REFERENCE_SPP, MAX_DEPTH );
+    bvh_flat * bvh = bench_world_build( &world, &scene.world );
+
+    // Graded without dithering, so the error measured is the render's alone
+    postprocess_settings post;
+    postprocess_settings_init( &post );
+    post.dither = false;
+
+    const size_t    pixels    = (size_t)cam.image_width * cam.image_height;
+    unsigned char * reference = (unsigned char *)malloc( pixels * 3 );
+    unsigned char * image     = (unsigned char *)malloc( pixels * 3 );
+    hdr_image       radiance;
+    hdr_image       denoised;
+    aov_image       aov;
+    bool            ok = hdr_image_init( &radiance, cam.image_width, cam.image_height );
+    ok                 = hdr_image_init( &denoised, cam.image_width, cam.image_height ) && ok;
+    ok                 = aov_image_init( &aov, cam.image_width, cam.image_height ) && ok;
+    if( ok && built && NULL != bvh && NULL != reference && NULL != image )
+        {
+            // Converged image, from samples independent of the measured renders
+            camera reference_cam       = cam;
+            reference_cam.seed         = cam.seed + 1;
+            reference_cam.thread_count = 0;
+            render( &reference_cam, &bvh->base, &post, &radiance, reference );
+
+            denoise_settings settings;
+            denoise_settings_init( &settings );
+            settings.thread_count = 1;
+            cam.thread_count      = 1;
+
+            double raw_seconds[CASE_COUNT];
+            double raw_rmse[CASE_COUNT];
+            for( int i = 0; i < CASE_COUNT; ++i )
+                {
+                    cam.samples_per_pixel = spp[i];
+                    raw_seconds[i]        = render( &cam, &bvh->base, &post, &radiance, image );
+                    raw_rmse[i]           = bench_image_rmse( image, reference, pixels * 3 );
+
+                    bench_reportf( "denoise", raw_seconds[i] * 1e3, "ms", "book: %d spp, render time", spp[i] );
+                    bench_reportf( "denoise", raw_rmse[i], "levels", "book: %d spp, RMSE", spp[i] );
+                }
+
+            for( int i = 0; i < CASE_COUNT; ++i )
+                {
+                    cam.samples_per_pixel = spp[i];
+                    render( &cam, &bvh->base, &post, &radiance, image );
+
+                    double start       = bench_now();
+                    camera_render_aov( &cam, (const struct hittable *)&bvh->base, &aov );
+                    double aov_seconds = bench_now() - start;
+                    start              = bench_now();
+                    denoise_image( &settings, &radiance, &aov, &denoised );
+                    double denoise_seconds = bench_now() - start;
+                    hdr_image_tonemap( &denoised, &post, image );
+                    const double rmse = bench_image_rmse( image, reference, pixels * 3 );
+
+                    // Undenoised time to reach the same error, scaled from the render closest in error: error falls
+                    // with the square root of the sample count, time grows linearly with it
+                    int closest = 0;
+                    for( int r = 1; r < CASE_COUNT; ++r )
+                        {
+                            if( fabs( raw_rmse[r] - rmse ) < fabs( raw_rmse[closest] - rmse ) ) closest = r;
+                        }
+                    const double ratio = raw_rmse[closest] / rmse;
+
+                    bench_reportf( "denoise", aov_seconds * 1e3, "ms", "book: %d spp denoised, feature time", spp[i] );
+                    bench_reportf( "denoise", denoise_seconds * 1e3, "ms", "book: %d spp denoised, denoise time",
+                                   spp[i] );
+                    bench_reportf( "denoise", ( raw_seconds[i] + aov_seconds + denoise_seconds ) * 1e3, "ms",
+                                   "book: %d spp denoised, total time", spp[i] );
+                    bench_reportf( "denoise", rmse, "levels", "book: %d spp denoised, RMSE", spp[i] );
+                    bench_reportf( "denoise", raw_seconds[closest] * ratio * ratio * 1e3, "ms",
+                                   "book: %d spp denoised, raw time, same RMSE", spp[i] );
+                }
+        }
+
+    aov_image_free( &aov );
+    hdr_image_free( &denoised );
+    hdr_image_free( &radiance );
+    free( image );
+    free( reference );
+    bench_world_free( &world );
+    bench_scene_free( &scene );
+}
@@ -0,0 +1,142 @@
+#include "stb_image_write.h"
+
+#include "benchmark.h"
+#include "film.h"
+#include "hdr_image.h"
+#include "progressive.h"
+#include <stdio.h>  /* fprintf, remove */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcmp */
+
+#define IMAGE_WIDTH       1280
+#define SAMPLES_PER_PIXEL 16
+#define PASS_SAMPLES      4
+#define MAX_DEPTH         20
+#define GRADE_EXPOSURE    1.0 // Stops the regraded image is brightened by
+#define PFM_PATH          "bench_hdr.pfm"
+#define PNG_PATH          "bench_hdr.png"
+
+static bool
+write_png( const unsigned char * image_data, int width, int height )
+{
+    return 0 != stbi_write_png( PNG_PATH, width, height, RT_IMAGE_DATA_CHANNELS, image_data,
+                                width * RT_IMAGE_DATA_CHANNELS );
+}
+
+static long
+count_differing_pixels( const unsigned char * a, const unsigned char * b, size_t pixels )
+{
+    long diff = 0;
+    for( size_t p = 0; p < pixels; ++p )
+        {
+            diff += 0 != memcmp( a + p * RT_IMAGE_DATA_CHANNELS, b + p * RT_IMAGE_DATA_CHANNELS,
+                                 RT_IMAGE_DATA_CHANNELS );
+        }
+    return diff;
+}
+
+// Grading a new exposure from a PFM (read, tonemap, encode) against rendering the frame again to get it, and the
+// exactness of the float path: the PFM round trip and exposure 0 against the renderer's own 8-bit output
+static void
+run( const camera * cam, const hittable * world )
+{
+    const size_t    pixels   = (size_t)cam->image_width * cam->image_height;
+    unsigned char * resolved = (unsigned char *)malloc( pixels * RT_IMAGE_DATA_CHANNELS );
+    unsigned char * graded   = (unsigned char *)malloc( pixels * RT_IMAGE_DATA_CHANNELS );
+    film            frame;
+    hdr_image       hdr      = { 0 };
+    hdr_image       loaded   = { 0 };
+    bool            ok       = NULL != resolved && NULL != graded && film_init( &frame, cam->image_width,
+                                                                                 cam->image_height );
+    if( !ok )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate the images.\n" );
+            free( resolved );
+            free( graded );
+            return;
+        }
+
+    // Render and write the LDR image, as a re-render for a new exposure would
+    progressive_settings settings = { 0 };
+    settings.pass_samples         = PASS_SAMPLES;
+    double start                  = bench_now();
+    ok                            = progressive_render( cam, world, &frame, &settings, NULL );
+    const double render           = bench_now() - start;
+    start                         = bench_now();
+    film_resolve( &frame, NULL, resolved );
+    ok                            = ok && write_png( resolved, cam->image_width, cam->image_height );
+    const double encode           = bench_now() - start;
+
+    // Resolve and write the linear radiance once
+    start = bench_now();
+    ok    = ok && hdr_image_init( &hdr, cam->image_width, cam->image_height );
+    if( ok ) film_resolve_hdr( &frame, &hdr );
+    ok                     = ok && hdr_image_write_pfm( &hdr, PFM_PATH );
+    const double write_pfm = bench_now() - start;
+
+    // Grade another exposure from the file alone
+    postprocess_settings brighter;
+    postprocess_settings_init( &brighter );
+    brighter.exposure = GRADE_EXPOSURE;
+    start             = bench_now();
+    ok                = ok && hdr_image_read_pfm( &loaded, PFM_PATH );
+    if( ok ) hdr_image_tonemap( &loaded, &brighter, graded );
+    ok                 = ok && write_png( graded, cam->image_width, cam->image_height );
+    const double grade = bench_now() - start;
+
+    if( ok )
+        {
+            bench_reportf( "hdr", render * 1e3, "ms", "%dp book: render", IMAGE_WIDTH * 9 / 16 );
+            bench_reportf( "hdr", encode * 1e3, "ms", "%dp book: resolve + png encode", IMAGE_WIDTH * 9 / 16 );
+            bench_reportf( "hdr", write_pfm * 1e3, "ms", "%dp book: resolve + pfm write", IMAGE_WIDTH * 9 / 16 );
+            bench_reportf( "hdr", bench_file_size_mib( PFM_PATH ), "MiB", "%dp book: pfm size", IMAGE_WIDTH * 9 / 16 );
+            bench_reportf( "hdr", grade * 1e3, "ms", "%dp book: regrade from pfm", IMAGE_WIDTH * 9 / 16 );
+            bench_reportf( "hdr", ( render + encode ) / grade, "x", "%dp book: regrade speedup", IMAGE_WIDTH * 9 / 16 );
+
+            long changed = 0;
+            for( size_t k = 0; k < pixels * 3; ++k )
+                {
+                    changed += 0 != memcmp( hdr.pixels + k, loaded.pixels + k, sizeof( float ) );
+                }
+            bench_reportf( "hdr", (double)changed, "floats", "%dp book: pfm round trip changes", IMAGE_WIDTH * 9 / 16 );
+
+            hdr_image_tonemap( &loaded, NULL, graded );
+            bench_reportf( "hdr", (double)count_differing_pixels( graded, resolved, pixels ), "pixels",
+                           "%dp book: exposure 0 vs film", IMAGE_WIDTH * 9 / 16 );
+        }
+    else
+        {
+            fprintf( stderr, "ERROR: The HDR round trip failed.\n" );
+        }
+
+    remove( PFM_PATH );
+    remove( PNG_PATH );
+    hdr_image_free( &loaded );
+    hdr_image_free( &hdr );
+    film_free( &frame );
+    free( graded );
+    free( resolved );
+}
+
+void
+bench_hdr( void )
+{
+    bench_scene scene;
+    bench_world world;
+    camera      cam;
+    const bool  built = bench_scene_init( &scene, 0 );
+    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+    bvh_flat * bvh = bench_world_build( &world, &scene.world );
+
+    if( built && NULL != bvh )
+        {
+            run( &cam, &bvh->base );
+        }
+    else
+        {
+            fprintf( stderr, "ERROR: Failed to build the book scene.\n" );
+        }
+
+    bench_world_free( &world );
+    bench_scene_free( &scene );
+}
@@ -0,0 +1,149 @@
+#include "benchmark.h"
+#include "hittable_list.h"
+#include "instance.h"
+#include "material_table.h"
+#include "scene.h"
+#include <stdio.h>  /* fprintf */
+#include <stdlib.h> /* malloc, free */
+
+#define INSTANCE_COUNT     10000
+#define TORUS_MAJOR        32 // Segments of the shared torus: 2 * 32 * 16 triangles
+#define TORUS_MINOR        16
+#define IMAGE_WIDTH        200
+#define SAMPLES_PER_PIXEL  4
+#define MAX_DEPTH          8
+#define RAY_BUDGET_SECONDS 1.0
+
+// Replaces every instance of `world` with a copy of its mesh baked into world space, allocated from `memory`: the
+// scene as it has to be built without instancing.
+//
+// Returns:
+//   The bytes of geometry in `copies`, or 0 if memory ran out
+static size_t
+bake_instances( const hittable_list * world, hittable_list * copies, arena * memory )
+{
+    size_t bytes = 0;
+    for( size_t i = 0; i < world->count; ++i )
+        {
+            const hittable * object = world->objects[i];
+            if( instance_hit != object->hit )
+                {
+                    if( !hittable_list_add( copies, (hittable *)object ) ) return 0;
+                    continue;
+                }
+
+            const instance *      inst = (const instance *)object;
+            const triangle_mesh * mesh = (const triangle_mesh *)inst->object;
+            transform             to_world;
+            point3 *              positions = (point3 *)malloc( mesh->position_count * sizeof( point3 ) );
+            vec3 *                normals   = (vec3 *)malloc( mesh->normal_count * sizeof( vec3 ) );
+            triangle_mesh *       copy      = ARENA_NEW( memory, triangle_mesh );
+            bool ok = NULL != positions && NULL != normals && NULL != copy && transform_invert( &inst->to_object,
+                                                                                                 &to_world );
+            for( size_t v = 0; ok && v < mesh->position_count; ++v )
+                {
+                    positions[v] = transform_point( &to_world, mesh->positions[v] );
+                }
+            for( size_t n = 0; ok && n < mesh->normal_count; ++n )
+                {
+                    normals[n] = vec3_normalize( transform_vector_transposed( &inst->to_object, mesh->normals[n] ) );
+                }
+            ok = ok
+              && triangle_mesh_init( copy, memory, positions, mesh->position_count, mesh->indices, mesh->triangle_count,
+                                     normals, mesh->normal_count, mesh->normal_indices, inst->base.material_id )
+              && hittable_list_add( copies, &copy->base );
+            free( positions );
+            free( normals );
+            if( !ok ) return 0;
+            bytes += triangle_mesh_memory( copy );
+        }
+    return bytes;
+}
+
+// Builds the top level over `world` as the renderer does, then measures its memory, ray throughput and render time.
+// The image is kept in `image`.
+static void
+measure_world( const char * case_name, const hittable_list * world, size_t geometry_bytes, camera * cam,
+               unsigned char * image )
+{
+    bench_world  top_level;
+    const double start = bench_now();
+    bvh_flat *   bvh   = bench_world_build( &top_level, world );
+    if( NULL != bvh )
+        {
+            bench_reportf( "instance", ( bench_now() - start ) * 1e3, "ms",
+                           "%dk tori: %s, top-level build", INSTANCE_COUNT / 1000, case_name );
+            bench_reportf( "instance", (double)( geometry_bytes + bvh_flat_memory( bvh ) ) / ( 1 << 20 ), "MiB",
+                           "%dk tori: %s, memory", INSTANCE_COUNT / 1000, case_name );
+            bench_reportf( "instance", bench_primary_ray_rate( cam, &bvh->base, RAY_BUDGET_SECONDS ) * 1e-3, "krays/s",
+                           "%dk tori: %s, primary rays", INSTANCE_COUNT / 1000, case_name );
+
+            // Single thread, so the time does not depend on the machine's core count
+            cam->thread_count = 1;
+            double begin      = bench_now();
+            camera_render( cam, (const struct hittable *)&bvh->base, image );
+            bench_reportf( "instance", ( bench_now() - begin ) * 1e3, "ms",
+                           "%dk tori: %s, render", INSTANCE_COUNT / 1000, case_name );
+        }
+
+    bench_world_free( &top_level );
+}
+
+void
+bench_instance( void )
+{
+    rng            gen;
+    hittable_list  world;
+    arena          memory;
+    material_table materials;
+    camera         cam;
+
+    rng_seed( &gen, 1, 0 );
+    scene_instance_field_camera( &cam, INSTANCE_COUNT, 16.0 / 9.0, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+    arena_init( &memory, 0 );
+    material_table_init( &materials );
+    hittable_list_init( &world, INSTANCE_COUNT + 1 );
+    cam.materials = &materials;
+
+    const size_t          image_size = (size_t)cam.image_width * cam.image_height * RT_IMAGE_DATA_CHANNELS;
+    unsigned char *       instanced  = (unsigned char *)malloc( image_size );
+    unsigned char *       baked      = (unsigned char *)malloc( image_size );
+    const triangle_mesh * torus      = scene_torus_mesh( &memory, TORUS_MAJOR, TORUS_MINOR, MATERIAL_ID_NONE );
+    bool                  ok         = NULL != instanced && NULL != baked && NULL != torus
+                  && scene_instance_field( &world, &memory, &materials, &gen, &torus->base, INSTANCE_COUNT );
+
+    if( ok )
+        {
+            const size_t bytes = triangle_mesh_memory( torus ) + INSTANCE_COUNT * sizeof( instance );
+            bench_reportf( "instance", (double)torus->triangle_count * INSTANCE_COUNT * 1e-6, "M",
+                           "%dk tori: instanced, triangles placed", INSTANCE_COUNT / 1000 );
+            measure_world( "instanced", &world, bytes, &cam, instanced );
+
+            // The same scene with a world-space copy of the mesh per placement
+            hittable_list copies;
+            arena         copy_memory;
+            hittable_list_init( &copies, INSTANCE_COUNT + 1 );
+            arena_init( &copy_memory, 0 );
+
+            const double start       = bench_now();
+            const size_t copy_bytes  = bake_instances( &world, &copies, &copy_memory );
+            const double bake_time   = bench_now() - start;
+            if( copy_bytes > 0 )
+                {
+                    bench_reportf( "instance", bake_time * 1e3, "ms",
+                                   "%dk tori: copies, bake and build", INSTANCE_COUNT / 1000 );
+                    measure_world( "copies", &copies, copy_bytes, &cam, baked );
+                    bench_reportf( "instance", bench_image_rmse( instanced, baked, image_size ), "levels",
+                                   "%dk tori: copies, image RMSE vs instanced", INSTANCE_COUNT / 1000 );
+                }
+            hittable_list_clear( &copies );
+            arena_free( &copy_memory );
+        }
+    if( !ok ) fprintf( stderr, "ERROR: Failed to build the instance field.\n" );
+
+    free( instanced );
+    free( baked );
+    hittable_list_clear( &world );
+    arena_free( &memory );
+    material_table_free( &materials );
+}
@@ -0,0 +1,80 @@
+#include "benchmark.h"
+#include <stdlib.h> /* malloc, free */
+
+#define IMAGE_WIDTH       300
+#define SAMPLES_PER_PIXEL 8
+#define MAX_DEPTH         20
+#define REPEATS           3
+
+// Best wall time of REPEATS renders
+static double
+render_seconds( const hittable * world, const camera * cam, unsigned char * image )
+{
+    double best = 0.0;
+    for( int r = 0; r < REPEATS; ++r )
+        {
+            double start   = bench_now();
+            camera_render( cam, (const struct hittable *)world, image );
+            double elapsed = bench_now() - start;
+            if( 0 == r || elapsed < best ) best = elapsed;
+        }
+    return best;
+}
+
+static void
+measure_scene( const bench_scene * scene, camera cam )
+{
+    static const struct
+    {
+        const char *      name;
+        camera_integrator integrator;
+    } integrators[] = {
+        { "recursive", CAMERA_INTEGRATOR_RECURSIVE },
+        { "wavefront", CAMERA_INTEGRATOR_WAVEFRONT },
+    };
+
+    bench_world     world;
+    bvh_flat *      bvh   = bench_world_build( &world, &scene->world );
+    unsigned char * image = (unsigned char *)malloc( (size_t)cam.image_width * cam.image_height * 3 );
+    if( NULL != bvh && NULL != image )
+        {
+            const double paths = (double)cam.image_width * cam.image_height * cam.samples_per_pixel;
+
+            for( size_t i = 0; i < sizeof( integrators ) / sizeof( integrators[0] ); ++i )
+                {
+                    cam.integrator = integrators[i].integrator;
+
+                    cam.thread_count = 1;
+                    double seconds   = render_seconds( &bvh->base, &cam, image );
+                    bench_reportf( "integrator", paths / seconds * 1e-3, "kpaths/s", "%s: %s, 1 thread", scene->name,
+                                   integrators[i].name );
+
+                    cam.thread_count = 0;
+                    seconds          = render_seconds( &bvh->base, &cam, image );
+                    bench_reportf( "integrator", paths / seconds * 1e-3, "kpaths/s", "%s: %s, all threads",
+                                   scene->name, integrators[i].name );
+                }
+        }
+
+    free( image );
+    bench_world_free( &world );
+}
+
+void
+bench_integrator( void )
+{
+    // The book scene, then a synthetic sphere cloud
+    static const int cloud_sizes[] = { 0, 100000 };
+
+    for( size_t i = 0; i < sizeof( cloud_sizes ) / sizeof( cloud_sizes[0] ); ++i )
+        {
+            bench_scene scene;
+            camera      cam;
+            if( bench_scene_init( &scene, cloud_sizes[i] ) )
+                {
+                    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+                    measure_scene( &scene, cam );
+                }
+            bench_scene_free( &scene );
+        }
+}
@@ -0,0 +1,390 @@
+#include "benchmark.h"
+#include "bvh.h"
+#include "bvh_flat.h"
+#include "hittable_list.h"
+#include "ray_packet.h"
+#include "triangle_mesh.h"
+#include <math.h>   /* atan2, cos, fabs, sin, INFINITY */
+#include <stdio.h>  /* FILE, fopen, fprintf, remove */
+#include <stdlib.h> /* malloc, free */
+
+#define OBJ_PATH      "bench_mesh.obj"
+#define MAJOR_STEPS   1024 // Segments around the torus of the throughput cases: 2 * 1024 * 1024 triangles
+#define MINOR_STEPS   1024
+#define LEAK_MAJOR    64 // Segments around the torus of the watertightness case
+#define LEAK_MINOR    32
+#define CUBE_GRID     32 // Quads along an edge of the cube of the packet watertightness case
+#define CUBE_TILE     4  // Quads along an edge of one of its tile meshes
+#define CUBE_TILES    ( CUBE_GRID / CUBE_TILE )
+#define HIT_TOLERANCE 1e-5 // Relative difference of hit distances put down to rounding, in single precision too
+#define MAJOR_R       1.0
+#define MINOR_R       0.4
+
+// Indexed torus around the y axis, a quad per segment split into two triangles, with its exact normals
+typedef struct
+{
+    point3 *   positions;
+    vec3 *     normals;
+    uint32_t * indices; // Indexes positions and normals alike
+    size_t     vertex_count;
+    size_t     triangle_count;
+    int        major;
+    int        minor;
+} torus;
+
+static point3
+torus_point( double u, double v, double radius )
+{
+    const double ring = MAJOR_R + radius * cos( v );
+    return vec3_new( ring * cos( u ), radius * sin( v ), ring * sin( u ) );
+}
+
+static bool
+torus_init( torus * t, int major, int minor )
+{
+    t->major          = major;
+    t->minor          = minor;
+    t->vertex_count   = (size_t)major * minor;
+    t->triangle_count = 2 * t->vertex_count;
+    t->positions      = (point3 *)malloc( t->vertex_count * sizeof( point3 ) );
+    t->normals        = (vec3 *)malloc( t->vertex_count * sizeof( vec3 ) );
+    t->indices        = (uint32_t *)malloc( 3 * t->triangle_count * sizeof( uint32_t ) );
+    if( NULL == t->positions || NULL == t->normals || NULL == t->indices ) return false;
+
+    const double pi = 3.14159265358979323846;
+    for( int i = 0; i < major; ++i )
+        {
+            for( int j = 0; j < minor; ++j )
+                {
+                    const double u = 2.0 * pi * i / major;
+                    const double v = 2.0 * pi * j / minor;
+                    const size_t k = (size_t)i * minor + j;
+                    t->positions[k] = torus_point( u, v, MINOR_R );
+                    t->normals[k]   = vec3_new( cos( v ) * cos( u ), sin( v ), cos( v ) * sin( u ) );
+                }
+        }
+
+    uint32_t * out = t->indices;
+    for( int i = 0; i < major; ++i )
+        {
+            for( int j = 0; j < minor; ++j )
+                {
+                    const uint32_t a = (uint32_t)( i * minor + j );
+                    const uint32_t b = (uint32_t)( ( ( i + 1 ) % major ) * minor + j );
+                    const uint32_t c = (uint32_t)( ( ( i + 1 ) % major ) * minor + ( j + 1 ) % minor );
+                    const uint32_t d = (uint32_t)( i * minor + ( j + 1 ) % minor );
+                    *out++           = a;
+                    *out++           = d;
+                    *out++           = c;
+                    *out++           = a;
+                    *out++           = c;
+                    *out++           = b;
+                }
+        }
+    return true;
+}
+
+static void
+torus_free( torus * t )
+{
+    free( t->positions );
+    free( t->normals );
+    free( t->indices );
+}
+
+// Writes the torus as an OBJ file with one quad face per segment, as exporters do
+static bool
+torus_write_obj( const torus * t, const char * path )
+{
+    FILE * file = fopen( path, "w" );
+    if( NULL == file ) return false;
+
+    for( size_t k = 0; k < t->vertex_count; ++k )
+        {
+            fprintf( file, "v %.6f %.6f %.6f\n", (double)t->positions[k].x, (double)t->positions[k].y,
+                     (double)t->positions[k].z );
+        }
+    for( size_t k = 0; k < t->vertex_count; ++k )
+        {
+            fprintf( file, "vn %.6f %.6f %.6f\n", (double)t->normals[k].x, (double)t->normals[k].y,
+                     (double)t->normals[k].z );
+        }
+    for( size_t q = 0; q < t->triangle_count / 2; ++q )
+        {
+            const uint32_t * v = &t->indices[6 * q];
+            fprintf( file, "f %u//%u %u//%u %u//%u %u//%u\n", v[0] + 1, v[0] + 1, v[1] + 1, v[1] + 1, v[2] + 1,
+                     v[2] + 1, v[5] + 1, v[5] + 1 );
+        }
+    return 0 == fclose( file );
+}
+
+// Möller-Trumbore test without tolerance, the usual non-watertight baseline
+static bool
+moller_trumbore( const ray * r, point3 p0, point3 p1, point3 p2 )
+{
+    const vec3    e1  = vec3_sub( p1, p0 );
+    const vec3    e2  = vec3_sub( p2, p0 );
+    const vec3    p   = vec3_cross( r->dir, e2 );
+    const rt_real det = vec3_dot( e1, p );
+    if( RT_REAL( 0 ) == det ) return false;
+
+    const rt_real inv = RT_REAL( 1 ) / det;
+    const vec3    s   = vec3_sub( r->orig, p0 );
+    const rt_real u   = vec3_dot( s, p ) * inv;
+    if( u < RT_REAL( 0 ) || u > RT_REAL( 1 ) ) return false;
+
+    const vec3    q = vec3_cross( s, e1 );
+    const rt_real v = vec3_dot( r->dir, q ) * inv;
+    if( v < RT_REAL( 0 ) || u + v > RT_REAL( 1 ) ) return false;
+
+    return vec3_dot( e2, q ) * inv > RT_REAL( 0 );
+}
+
+static bool
+moller_trumbore_any( const torus * t, const ray * r )
+{
+    for( size_t i = 0; i < t->triangle_count; ++i )
+        {
+            const uint32_t * v = &t->indices[3 * i];
+            if( moller_trumbore( r, t->positions[v[0]], t->positions[v[1]], t->positions[v[2]] ) ) return true;
+        }
+    return false;
+}
+
+// Ray from inside the tube towards corner `c` of triangle `i` (k == 0) or the middle of the edge it starts (k == 1),
+// where the ray grazes two or more triangles
+static ray
+leak_ray( const torus * t, size_t i, int c, int k )
+{
+    const uint32_t * v      = &t->indices[3 * i];
+    const point3     a      = t->positions[v[c]];
+    const point3     b      = t->positions[v[( c + 1 ) % 3]];
+    const point3     target = ( 0 == k ) ? a : vec3_mul( vec3_add( a, b ), 0.5 );
+
+    // From off the core circle, so rays are not symmetric about the tube
+    const double major  = atan2( (double)a.z, (double)a.x ) + 0.3 / LEAK_MAJOR;
+    const point3 origin = torus_point( major, 0.7, 0.5 * MINOR_R );
+    return ray_create( origin, vec3_sub( target, origin ) );
+}
+
+// Fires rays from inside the tube of a closed torus at every vertex and at the middle of every edge and counts the
+// rays that escape through the surface
+static void
+measure_leaks( void )
+{
+    torus         t;
+    arena         memory;
+    triangle_mesh mesh;
+    bool          ok = torus_init( &t, LEAK_MAJOR, LEAK_MINOR );
+    arena_init( &memory, 0 );
+    ok = ok && triangle_mesh_init( &mesh, &memory, t.positions, t.vertex_count, t.indices, t.triangle_count, NULL, 0,
+                                   NULL, MATERIAL_ID_NONE );
+
+    size_t rays = 0, mesh_leaks = 0, mt_leaks = 0;
+    for( size_t i = 0; ok && i < t.triangle_count; ++i )
+        {
+            for( int c = 0; c < 3; ++c )
+                {
+                    for( int k = 0; k < 2; ++k )
+                        {
+                            const ray  r = leak_ray( &t, i, c, k );
+                            hit_record rec;
+                            mesh_leaks += !triangle_mesh_hit( &mesh.base, &r, RT_REAL( 0 ), INFINITY, &rec );
+                            mt_leaks   += !moller_trumbore_any( &t, &r );
+                            ++rays;
+                        }
+                }
+        }
+    if( !ok ) fprintf( stderr, "ERROR: Failed to build the watertightness mesh.\n" );
+
+    bench_reportf( "mesh", (double)rays, "rays", "torus %zu tris: rays at vertices and edges", t.triangle_count );
+    bench_reportf( "mesh", (double)mesh_leaks, "rays", "torus %zu tris: watertight leaks", t.triangle_count );
+    bench_reportf( "mesh", (double)mt_leaks, "rays", "torus %zu tris: Moller-Trumbore leaks", t.triangle_count );
+
+    arena_free( &memory );
+    torus_free( &t );
+}
+
+// Adds tile (ti, tj) of face `face` of the cube [-1,1]^3, CUBE_TILE x CUBE_TILE quads of a CUBE_GRID x CUBE_GRID
+// grid, as one mesh. The tile lies flat in its face, so its bounding box has no thickness.
+static bool
+cube_tile_add( arena * memory, hittable_list * meshes, int face, int ti, int tj )
+{
+    enum
+    {
+        SIDE = CUBE_TILE + 1
+    };
+    const int axis = face / 2, u = ( axis + 1 ) % 3, v = ( axis + 2 ) % 3;
+    point3    positions[SIDE * SIDE];
+    uint32_t  indices[6 * CUBE_TILE * CUBE_TILE];
+    for( int i = 0; i < SIDE; ++i )
+        {
+            for( int j = 0; j < SIDE; ++j )
+                {
+                    rt_real * p = &positions[i * SIDE + j].x;
+                    p[axis]     = ( face & 1 ) ? RT_REAL( 1 ) : RT_REAL( -1 );
+                    p[u]        = (rt_real)( -1.0 + 2.0 * ( ti * CUBE_TILE + i ) / CUBE_GRID );
+                    p[v]        = (rt_real)( -1.0 + 2.0 * ( tj * CUBE_TILE + j ) / CUBE_GRID );
+                }
+        }
+    uint32_t * out = indices;
+    for( int i = 0; i < CUBE_TILE; ++i )
+        {
+            for( int j = 0; j < CUBE_TILE; ++j )
+                {
+                    const uint32_t a = (uint32_t)( i * SIDE + j ), b = a + SIDE, c = b + 1, d = a + 1;
+                    *out++           = a;
+                    *out++           = b;
+                    *out++           = c;
+                    *out++           = a;
+                    *out++           = c;
+                    *out++           = d;
+                }
+        }
+
+    triangle_mesh * mesh = ARENA_NEW( memory, triangle_mesh );
+    return NULL != mesh
+           && triangle_mesh_init( mesh, memory, positions, SIDE * SIDE, indices, 2 * CUBE_TILE * CUBE_TILE, NULL, 0,
+                                  NULL, MATERIAL_ID_NONE )
+           && hittable_list_add( meshes, &mesh->base );
+}
+
+// Builds a closed cube out of flat tile meshes under a flat BVH, so the boxes of the scene's hierarchy lie in the
+// faces and pass through the shared edges and vertices, and traces rays from inside it at every grid vertex and at
+// the middle of every grid edge one at a time and in packets. Counts the rays that escape either way and the rays
+// whose packet result differs from their single ray result.
+static void
+measure_packet_leaks( void )
+{
+    arena         memory;
+    hittable_list meshes;
+    bvh_flat *    bvh = NULL;
+    bool          ok  = true;
+    arena_init( &memory, 0 );
+    hittable_list_init( &meshes, 6 * CUBE_TILES * CUBE_TILES );
+    for( int face = 0; ok && face < 6; ++face )
+        {
+            for( int t = 0; ok && t < CUBE_TILES * CUBE_TILES; ++t )
+                {
+                    ok = cube_tile_add( &memory, &meshes, face, t / CUBE_TILES, t % CUBE_TILES );
+                }
+        }
+    if( ok )
+        {
+            hittable * tree = bvh_node_build( &meshes );
+            bvh             = bvh_flat_build( tree );
+            bvh_node_free( tree );
+            ok = NULL != bvh;
+        }
+
+    // Targets on a grid of half the spacing: vertices, edge middles and quad centres, in packets along the rows of a
+    // face. Where tiles meet, the two traversals may take their hit from different tiles, which round the distance
+    // differently; only differences beyond rounding count.
+    const int    steps  = 2 * CUBE_GRID + 1;
+    const point3 origin = vec3_new( 0.13, -0.21, 0.37 );
+    size_t       rays = 0, single_leaks = 0, packet_leaks = 0, mismatches = 0;
+    ray_packet   packet;
+    for( int face = 0; ok && face < 6; ++face )
+        {
+            const int axis = face / 2, u = ( axis + 1 ) % 3, v = ( axis + 2 ) % 3;
+            for( int k = 0; k < steps * steps; k += packet.count )
+                {
+                    packet.count = 0;
+                    for( int j = k % steps; j < steps && packet.count < RAY_PACKET_MAX; ++j )
+                        {
+                            const int i = k / steps;
+                            point3    target;
+                            rt_real * p = &target.x;
+                            p[axis]     = ( face & 1 ) ? RT_REAL( 1 ) : RT_REAL( -1 );
+                            p[u]        = (rt_real)( -1.0 + (double)i / CUBE_GRID );
+                            p[v]        = (rt_real)( -1.0 + (double)j / CUBE_GRID );
+                            packet.rays[packet.count++] = ray_create( origin, vec3_sub( target, origin ) );
+                        }
+                    ray_packet_reset( &packet, INFINITY );
+                    bvh_flat_hit_packet( bvh, &packet, RT_REAL( 0 ) );
+
+                    for( int r = 0; r < packet.count; ++r )
+                        {
+                            hit_record rec;
+                            const bool hit = bvh_flat_hit( &bvh->base, &packet.rays[r], RT_REAL( 0 ), INFINITY, &rec );
+                            single_leaks  += !hit;
+                            packet_leaks  += !packet.hit[r];
+                            mismatches    += ( hit != packet.hit[r] )
+                                          || ( hit && fabs( rec.t - packet.rec[r].t ) > HIT_TOLERANCE * rec.t );
+                            ++rays;
+                        }
+                }
+        }
+    if( !ok ) fprintf( stderr, "ERROR: Failed to build the tiled cube.\n" );
+
+    bench_reportf( "mesh", (double)rays, "rays",
+                   "cube in %d tiles: rays at vertices and edges", 6 * CUBE_TILES * CUBE_TILES );
+    bench_reportf( "mesh", (double)single_leaks, "rays",
+                   "cube in %d tiles: single ray leaks", 6 * CUBE_TILES * CUBE_TILES );
+    bench_reportf( "mesh", (double)packet_leaks, "rays",
+                   "cube in %d tiles: packet leaks", 6 * CUBE_TILES * CUBE_TILES );
+    bench_reportf( "mesh", (double)mismatches, "rays",
+                   "cube in %d tiles: packet/single diffs", 6 * CUBE_TILES * CUBE_TILES );
+
+    bvh_flat_free( bvh );
+    hittable_list_clear( &meshes );
+    arena_free( &memory );
+}
+
+void
+bench_mesh( void )
+{
+    torus t;
+    if( !torus_init( &t, MAJOR_STEPS, MINOR_STEPS ) || !torus_write_obj( &t, OBJ_PATH ) )
+        {
+            fprintf( stderr, "ERROR: Failed to generate %s.\n", OBJ_PATH );
+            torus_free( &t );
+            remove( OBJ_PATH );
+            return;
+        }
+
+    const size_t thousands = t.triangle_count / 1000;
+    const double obj_size  = bench_file_size_mib( OBJ_PATH );
+
+    // Build from arrays already in memory
+    arena         memory;
+    triangle_mesh mesh;
+    arena_init( &memory, 0 );
+    double start = bench_now();
+    bool   ok    = triangle_mesh_init( &mesh, &memory, t.positions, t.vertex_count, t.indices, t.triangle_count,
+                                       t.normals, t.vertex_count, t.indices, MATERIAL_ID_NONE );
+    double build = bench_now() - start;
+    arena_free( &memory );
+    if( ok )
+        {
+            bench_reportf( "mesh", build * 1e3, "ms", "torus %zuk tris: BVH build", thousands );
+        }
+
+    // Load, which parses the file and then builds the BVH the same way
+    arena_init( &memory, 0 );
+    start                      = bench_now();
+    const triangle_mesh * obj  = triangle_mesh_load_obj( OBJ_PATH, &memory, MATERIAL_ID_NONE );
+    const double          load = bench_now() - start;
+    if( NULL != obj )
+        {
+            bench_reportf( "mesh", obj_size, "MiB", "torus %zuk tris: OBJ size", thousands );
+            bench_reportf( "mesh", load * 1e3, "ms", "torus %zuk tris: OBJ load", thousands );
+            bench_reportf( "mesh", obj->triangle_count / load / 1e6, "Mtris/s",
+                           "torus %zuk tris: OBJ load rate", thousands );
+            bench_reportf( "mesh", (double)triangle_mesh_memory( obj ) / obj->triangle_count, "B",
+                           "torus %zuk tris: memory per triangle", thousands );
+
+            camera       cam;
+            const point3 position = vec3_new( 0.0, 2.0, 2.6 );
+            camera_init( &cam, 16.0 / 9.0, 40.0, position, vec3_new( 0, 0, 0 ), vec3_new( 0, 1, 0 ), 0.0,
+                         vec3_length( position ), 400, 1, 1 );
+            bench_reportf( "mesh", bench_primary_ray_rate( &cam, &obj->base, 1.0 ) / 1e6, "Mrays/s",
+                           "torus %zuk tris: primary rays", thousands );
+        }
+    arena_free( &memory );
+    torus_free( &t );
+    remove( OBJ_PATH );
+
+    measure_leaks();
+    measure_packet_leaks();
+}
@@ -0,0 +1,169 @@
+#include "benchmark.h"
+#include "bvh_flat.h"
+#include "ray_packet.h"
+#include "rtweekend.h"
+#include <stdlib.h> /* malloc, free */
+
+#define RAY_BUDGET_SECONDS 1.0
+#define IMAGE_WIDTH        400
+#define RENDER_WIDTH       200
+#define RENDER_SAMPLES     4
+#define RENDER_DEPTH       10
+
+// One primary ray per pixel, ordered block by block so consecutive groups of size*size rays form a packet
+static ray *
+make_block_rays( const camera * cam, int size, int * ray_count )
+{
+    ray * rays = (ray *)malloc( (size_t)cam->image_width * cam->image_height * sizeof( ray ) );
+    if( NULL == rays ) return NULL;
+
+    rng gen;
+    rng_seed( &gen, 0xB0B, 0 );
+    int n = 0;
+    for( int by = 0; by < cam->image_height; by += size )
+        {
+            for( int bx = 0; bx < cam->image_width; bx += size )
+                {
+                    for( int j = by; j < by + size && j < cam->image_height; ++j )
+                        {
+                            for( int i = bx; i < bx + size && i < cam->image_width; ++i )
+                                {
+                                    double u  = ( i + random_double( &gen ) ) / ( cam->image_width - 1 );
+                                    double v  = ( j + random_double( &gen ) ) / ( cam->image_height - 1 );
+                                    rays[n++] = camera_get_ray( cam, u, v, &gen );
+                                }
+                        }
+                }
+        }
+
+    *ray_count = n;
+    return rays;
+}
+
+// Rays/second tracing the image one ray at a time, in block order
+static double
+single_rate( const bvh_flat * bvh, const camera * cam )
+{
+    int   count;
+    ray * rays = make_block_rays( cam, 8, &count );
+    if( NULL == rays ) return 0.0;
+
+    hit_record rec;
+    long long  traced = 0;
+    int        hits   = 0;
+    double     start  = bench_now();
+    double     elapsed;
+    do
+        {
+            for( int i = 0; i < count; ++i )
+                {
+                    hits += bvh_flat_hit( &bvh->base, &rays[i], 0.001, RT_INFINITY, &rec );
+                }
+            traced  += count;
+            elapsed  = bench_now() - start;
+        }
+    while( elapsed < RAY_BUDGET_SECONDS );
+
+    bench_sink( hits );
+    free( rays );
+    return traced / elapsed;
+}
+
+// Rays/second tracing the image in packets of size x size rays. Edge blocks give smaller packets,
+// exactly as in the renderer.
+static double
+packet_rate( const bvh_flat * bvh, const camera * cam, int size )
+{
+    int   count;
+    ray * rays = make_block_rays( cam, size, &count );
+    if( NULL == rays ) return 0.0;
+
+    ray_packet packet;
+    long long  traced = 0;
+    int        hits   = 0;
+    double     start  = bench_now();
+    double     elapsed;
+    do
+        {
+            int next = 0;
+            for( int by = 0; by < cam->image_height; by += size )
+                {
+                    for( int bx = 0; bx < cam->image_width; bx += size )
+                        {
+                            int w        = RT_MIN( size, cam->image_width - bx );
+                            int h        = RT_MIN( size, cam->image_height - by );
+                            packet.count = w * h;
+                            for( int k = 0; k < packet.count; ++k )
+                                {
+                                    packet.rays[k] = rays[next++];
+                                }
+                            ray_packet_reset( &packet, RT_INFINITY );
+                            hits += bvh_flat_hit_packet( bvh, &packet, 0.001 );
+                        }
+                }
+            traced  += count;
+            elapsed  = bench_now() - start;
+        }
+    while( elapsed < RAY_BUDGET_SECONDS );
+
+    bench_sink( hits );
+    free( rays );
+    return traced / elapsed;
+}
+
+// Wall time of a full single-threaded render with the given packet size
+static double
+render_ms( const bvh_flat * bvh, camera cam, int packet_size )
+{
+    unsigned char * image = (unsigned char *)malloc( (size_t)cam.image_width * cam.image_height * 3 );
+    if( NULL == image ) return 0.0;
+
+    cam.thread_count = 1;
+    cam.packet_size  = packet_size;
+    double start     = bench_now();
+    camera_render( &cam, (const struct hittable *)bvh, image );
+    double elapsed   = bench_now() - start;
+
+    free( image );
+    return elapsed * 1e3;
+}
+
+static void
+measure_scene( const bench_scene * scene, const camera * cam, const camera * render_cam )
+{
+    const char * name = scene->name;
+    bench_world  world;
+    bvh_flat *   bvh  = bench_world_build( &world, &scene->world );
+    if( NULL != bvh )
+        {
+            bench_reportf( "packet", single_rate( bvh, cam ) * 1e-3, "krays/s", "%s: primary, single rays", name );
+            bench_reportf( "packet", packet_rate( bvh, cam, 4 ) * 1e-3, "krays/s", "%s: primary, 4x4 packets", name );
+            bench_reportf( "packet", packet_rate( bvh, cam, 8 ) * 1e-3, "krays/s", "%s: primary, 8x8 packets", name );
+
+            bench_reportf( "packet", render_ms( bvh, *render_cam, 0 ), "ms", "%s: render, single rays", name );
+            bench_reportf( "packet", render_ms( bvh, *render_cam, 4 ), "ms", "%s: render, 4x4 packets", name );
+            bench_reportf( "packet", render_ms( bvh, *render_cam, 8 ), "ms", "%s: render, 8x8 packets", name );
+        }
+    bench_world_free( &world );
+}
+
+void
+bench_packet( void )
+{
+    // The book scene, then synthetic sphere clouds
+    static const int cloud_sizes[] = { 0, 10000, 1000000 };
+
+    for( size_t i = 0; i < sizeof( cloud_sizes ) / sizeof( cloud_sizes[0] ); ++i )
+        {
+            bench_scene scene;
+            camera      cam;
+            camera      render_cam;
+            if( bench_scene_init( &scene, cloud_sizes[i] ) )
+                {
+                    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, 1, 1 );
+                    bench_scene_camera( &scene, &render_cam, RENDER_WIDTH, RENDER_SAMPLES, RENDER_DEPTH );
+                    measure_scene( &scene, &cam, &render_cam );
+                }
+            bench_scene_free( &scene );
+        }
+}
@@ -0,0 +1,170 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#include "benchmark.h"
+#include <stdlib.h> /* malloc, free */
+
+#define IMAGE_WIDTH        200
+#define SAMPLES_PER_PIXEL  8
+#define MAX_DEPTH          50
+#define RAY_BUDGET_SECONDS 0.5
+#define SCATTER_BATCH      4096 // Hit records kept per material type
+#define SCATTER_SECONDS    0.25 // Time spent scattering per material type
+
+// Wraps a world and counts the rays cast into it.
+// Only used by single-threaded renders, so the counter needs no synchronization.
+typedef struct
+{
+    hittable         base;
+    const hittable * world;
+    uint64_t         rays;
+} counting_world;
+
+static bool
+counting_world_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
+{
+    counting_world * counter = (counting_world *)object;
+    counter->rays++;
+    return counter->world->hit( counter->world, r, ray_tmin, ray_tmax, rec );
+}
+
+// Counts the bytes of an encoded image without keeping them
+static void
+count_bytes( void * context, void * data, int size )
+{
+    RT_UNUSED( data );
+    *(size_t *)context += (size_t)size;
+}
+
+// Hit records of primary rays, grouped by the type of the material they hit
+typedef struct
+{
+    ray        rays[SCATTER_BATCH];
+    hit_record recs[SCATTER_BATCH];
+    int        count;
+} scatter_batch;
+
+// Times material_scatter for every built-in material type the scene's primary rays hit, replaying recorded hits
+static void
+measure_scatter( const char * scene_name, const camera * cam, const hittable * world )
+{
+    static const char * type_names[MATERIAL_TYPE_COUNT] = { "custom", "lambertian", "metal", "dielectric" };
+
+    scatter_batch * batches = (scatter_batch *)calloc( MATERIAL_TYPE_COUNT, sizeof( scatter_batch ) );
+    if( NULL == batches ) return;
+
+    rng gen;
+    rng_seed( &gen, 0x5CA7, 0 );
+    for( int attempt = 0; attempt < 64 * SCATTER_BATCH; ++attempt )
+        {
+            const ray  r = camera_get_ray( cam, random_double( &gen ), random_double( &gen ), &gen );
+            hit_record rec;
+            if( !world->hit( world, &r, 0.001, RT_INFINITY, &rec ) || MATERIAL_ID_NONE == rec.material_id ) continue;
+
+            scatter_batch * batch = &batches[material_id_type( rec.material_id )];
+            if( batch->count < SCATTER_BATCH )
+                {
+                    batch->rays[batch->count]  = r;
+                    batch->recs[batch->count]  = rec;
+                    batch->count              += 1;
+                }
+        }
+
+    for( int type = MATERIAL_LAMBERTIAN; type < MATERIAL_TYPE_COUNT; ++type )
+        {
+            const scatter_batch * batch = &batches[type];
+            if( 0 == batch->count ) continue;
+
+            color     attenuation;
+            ray       scattered;
+            long long calls     = 0;
+            int       scatters  = 0;
+            double    start     = bench_now();
+            double    elapsed;
+            do
+                {
+                    for( int i = 0; i < batch->count; ++i )
+                        {
+                            const hit_record * rec  = &batch->recs[i];
+                            scatters               += material_scatter( cam->materials, rec->material_id,
+                                                                        &batch->rays[i], rec, &attenuation,
+                                                                        &scattered, &gen );
+                        }
+                    calls   += batch->count;
+                    elapsed  = bench_now() - start;
+                }
+            while( elapsed < SCATTER_SECONDS );
+            bench_sink( scatters + scattered.dir.x + attenuation.x );
+
+            bench_reportf( "pipeline", elapsed * 1e9 / (double)calls, "ns/ray", "%s: scatter %s", scene_name,
+                           type_names[type] );
+        }
+
+    free( batches );
+}
+
+// Builds the render world of `scene` as the renderer does, timing it with the scene's generation, then renders,
+// encodes and traces it
+static void
+measure_pipeline( const bench_scene * scene, camera * cam )
+{
+    const char * scene_name = scene->name;
+    bench_world  world;
+    const double start      = bench_now();
+    bvh_flat *   bvh        = bench_world_build( &world, &scene->world );
+    bench_reportf( "pipeline", ( scene->build_seconds + bench_now() - start ) * 1e3, "ms", "%s: scene build",
+                   scene_name );
+
+    const size_t    image_size = (size_t)cam->image_width * cam->image_height * RT_IMAGE_DATA_CHANNELS;
+    unsigned char * image      = (unsigned char *)malloc( image_size );
+    if( NULL != bvh && NULL != image )
+        {
+            // Single thread, so the rates do not depend on the machine's core count
+            counting_world counter = { .world = &bvh->base };
+            counter.base.hit       = counting_world_hit;
+            cam->thread_count      = 1;
+
+            const double samples = (double)cam->image_width * cam->image_height * cam->samples_per_pixel;
+            double       begin   = bench_now();
+            camera_render( cam, (const struct hittable *)&counter, image );
+            double seconds = bench_now() - begin;
+
+            bench_reportf( "pipeline", seconds * 1e3, "ms", "%s: render", scene_name );
+            bench_reportf( "pipeline", (double)counter.rays / seconds * 1e-3, "krays/s",
+                           "%s: render rays", scene_name );
+            bench_reportf( "pipeline", samples / seconds * 1e-3, "ksamples/s", "%s: render samples", scene_name );
+
+            size_t encoded = 0;
+            begin          = bench_now();
+            stbi_write_png_to_func( count_bytes, &encoded, cam->image_width, cam->image_height,
+                                    RT_IMAGE_DATA_CHANNELS, image, cam->image_width * RT_IMAGE_DATA_CHANNELS );
+            bench_reportf( "pipeline", ( bench_now() - begin ) * 1e3, "ms", "%s: png encode", scene_name );
+            bench_reportf( "pipeline", (double)encoded / 1024.0, "KiB", "%s: png size", scene_name );
+
+            bench_reportf( "pipeline", 1e9 / bench_primary_ray_rate( cam, &bvh->base, RAY_BUDGET_SECONDS ), "ns/ray",
+                           "%s: intersect", scene_name );
+            measure_scatter( scene_name, cam, &bvh->base );
+        }
+
+    free( image );
+    bench_world_free( &world );
+}
+
+void
+bench_pipeline( void )
+{
+    // The book scene, then synthetic sphere clouds
+    static const int cloud_sizes[] = { 0, 10000, 100000 };
+
+    for( size_t i = 0; i < sizeof( cloud_sizes ) / sizeof( cloud_sizes[0] ); ++i )
+        {
+            bench_scene scene;
+            camera      cam;
+            if( bench_scene_init( &scene, cloud_sizes[i] ) )
+                {
+                    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+                    measure_pipeline( &scene, &cam );
+                }
+            bench_scene_free( &scene );
+        }
+}
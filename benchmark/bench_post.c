@@ -0,0 +1,170 @@
+#include "benchmark.h"
+#include "color.h"
+#include "postprocess.h"
+#include "rng.h"
+#include <math.h>   /* log */
+#include <stdio.h>  /* snprintf */
+#include <stdlib.h> /* malloc, free */
+
+#define IMAGE_WIDTH       7680 // 8K UHD
+#define IMAGE_HEIGHT      4320
+#define SAMPLES_PER_PIXEL 16
+#define MEAN_RADIANCE     0.5 // Mean of the exponentially distributed pixel values: about one in seven is above 1
+#define REPEATS           3   // Runs per case; the fastest is reported
+
+// The 8-bit conversion as the film did it before the post-process stage: write_color_to_buffer, pixel by pixel
+static void
+resolve_per_pixel( const float * radiance, const uint32_t * samples, size_t pixels, unsigned char * image_data )
+{
+    for( size_t p = 0; p < pixels; ++p )
+        {
+            unsigned char * pixel = image_data + p * RT_IMAGE_DATA_CHANNELS;
+            if( 0 == samples[p] )
+                {
+                    pixel[0] = pixel[1] = pixel[2] = 0;
+                    continue;
+                }
+
+            const color sum = vec3_new( radiance[3 * p], radiance[3 * p + 1], radiance[3 * p + 2] );
+            write_color_to_buffer( pixel, sum, (int)samples[p] );
+        }
+}
+
+// Times `settings` on the film, or the per-pixel path when it is NULL
+//
+// Returns:
+//   The fastest of REPEATS runs, in seconds
+static double
+time_case( const postprocess_settings * settings, const float * radiance, const uint32_t * samples,
+           unsigned char * image_data )
+{
+    double best = 0.0;
+    for( int r = 0; r < REPEATS; ++r )
+        {
+            const double start = bench_now();
+            if( settings )
+                {
+                    postprocess_image( settings, radiance, samples, IMAGE_WIDTH, 0, IMAGE_HEIGHT, image_data );
+                }
+            else
+                {
+                    resolve_per_pixel( radiance, samples, (size_t)IMAGE_WIDTH * IMAGE_HEIGHT, image_data );
+                }
+            const double seconds = bench_now() - start;
+            best                 = ( 0 == r || seconds < best ) ? seconds : best;
+        }
+    bench_sink( image_data[( (size_t)IMAGE_HEIGHT / 2 * IMAGE_WIDTH + IMAGE_WIDTH / 2 ) * RT_IMAGE_DATA_CHANNELS] );
+    return best;
+}
+
+static void
+report_time( const char * case_name, double seconds, double baseline )
+{
+    const double pixels = (double)IMAGE_WIDTH * IMAGE_HEIGHT;
+    bench_reportf( "post", seconds * 1e3, "ms", "8K: %s, time", case_name );
+    bench_reportf( "post", pixels / seconds * 1e-6, "Mpixel/s", "8K: %s, throughput", case_name );
+    if( baseline > 0.0 ) bench_reportf( "post", baseline / seconds, "x", "8K: %s, speedup", case_name );
+}
+
+// Counts the output values where `kernel` differs from the scalar kernel under every tone curve. The kernels share
+// one arithmetic, so any difference is a bug.
+static void
+report_accuracy( postprocess_kernel kernel, const float * radiance, const uint32_t * samples,
+                 unsigned char * reference, unsigned char * image_data )
+{
+    const size_t         values = (size_t)IMAGE_WIDTH * IMAGE_HEIGHT * RT_IMAGE_DATA_CHANNELS;
+    postprocess_settings settings;
+    postprocess_settings_init( &settings );
+
+    size_t differing = 0;
+    int    max_diff  = 0;
+    for( int t = 0; t < POSTPROCESS_TONEMAP_COUNT; ++t )
+        {
+            settings.tonemap = (postprocess_tonemap)t;
+            settings.kernel  = POSTPROCESS_KERNEL_SCALAR;
+            postprocess_image( &settings, radiance, samples, IMAGE_WIDTH, 0, IMAGE_HEIGHT, reference );
+            settings.kernel = kernel;
+            postprocess_image( &settings, radiance, samples, IMAGE_WIDTH, 0, IMAGE_HEIGHT, image_data );
+
+            for( size_t k = 0; k < values; ++k )
+                {
+                    const int diff = abs( (int)image_data[k] - (int)reference[k] );
+                    differing     += diff > 0;
+                    max_diff       = RT_MAX( max_diff, diff );
+                }
+        }
+
+    const char * name = postprocess_kernel_name( kernel );
+    bench_reportf( "post", (double)differing, "values", "8K: %s vs scalar, values differing", name );
+    bench_reportf( "post", (double)max_diff, "levels", "8K: %s vs scalar, largest difference", name );
+}
+
+void
+bench_post( void )
+{
+    const size_t    pixels    = (size_t)IMAGE_WIDTH * IMAGE_HEIGHT;
+    float *         radiance  = (float *)malloc( pixels * 3 * sizeof( float ) );
+    uint32_t *      samples   = (uint32_t *)malloc( pixels * sizeof( uint32_t ) );
+    unsigned char * image     = (unsigned char *)malloc( pixels * RT_IMAGE_DATA_CHANNELS );
+    unsigned char * reference = (unsigned char *)malloc( pixels * RT_IMAGE_DATA_CHANNELS );
+    if( NULL == radiance || NULL == samples || NULL == image || NULL == reference )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate the 8K film.\n" );
+            free( radiance );
+            free( samples );
+            free( image );
+            free( reference );
+            return;
+        }
+
+    // A film of SAMPLES_PER_PIXEL samples per pixel with exponentially distributed means, highlights included
+    rng gen;
+    rng_seed( &gen, 1, 0 );
+    for( size_t k = 0; k < pixels * 3; ++k )
+        {
+            radiance[k] = (float)( -log( 1.0 - rng_next_double( &gen ) ) * MEAN_RADIANCE * SAMPLES_PER_PIXEL );
+        }
+    for( size_t p = 0; p < pixels; ++p )
+        {
+            samples[p] = SAMPLES_PER_PIXEL;
+        }
+
+    const double baseline = time_case( NULL, radiance, samples, image );
+    report_time( "per-pixel (before)", baseline, 0.0 );
+
+    postprocess_settings settings;
+    postprocess_settings_init( &settings );
+    settings.thread_count = 1;
+    for( int k = 0; k < POSTPROCESS_KERNEL_COUNT; ++k )
+        {
+            if( !postprocess_kernel_supported( (postprocess_kernel)k ) ) continue;
+
+            char name[32];
+            settings.kernel = (postprocess_kernel)k;
+            snprintf( name, sizeof( name ), "%s, 1 thread", postprocess_kernel_name( settings.kernel ) );
+            report_time( name, time_case( &settings, radiance, samples, image ), baseline );
+        }
+
+    postprocess_settings_init( &settings );
+    for( int t = 0; t < POSTPROCESS_TONEMAP_COUNT; ++t )
+        {
+            char name[48];
+            settings.tonemap = (postprocess_tonemap)t;
+            snprintf( name, sizeof( name ), "%s, all threads, %s", postprocess_kernel_name( settings.kernel ),
+                      postprocess_tonemap_name( settings.tonemap ) );
+            report_time( name, time_case( &settings, radiance, samples, image ), baseline );
+        }
+
+    for( int k = POSTPROCESS_KERNEL_SSE2; k < POSTPROCESS_KERNEL_COUNT; ++k )
+        {
+            if( postprocess_kernel_supported( (postprocess_kernel)k ) )
+                {
+                    report_accuracy( (postprocess_kernel)k, radiance, samples, reference, image );
+                }
+        }
+
+    free( radiance );
+    free( samples );
+    free( image );
+    free( reference );
+}
@@ -0,0 +1,126 @@
+// The PNG-only decoder leaves helpers unused, and GCC cannot prove stb_image's transparency key initialized
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include "stb_image.h"
+#pragma GCC diagnostic pop
+#include "stb_image_write.h"
+
+#include "benchmark.h"
+#include "sphere.h"
+#include "sphere_soa.h"
+#include <math.h>   /* log10 */
+#include <stdio.h>  /* snprintf */
+#include <stdlib.h> /* malloc, free, abs */
+
+#define IMAGE_WIDTH        400
+#define SAMPLES_PER_PIXEL  16
+#define MAX_DEPTH          50
+#define RAY_BUDGET_SECONDS 0.5
+#define VISIBLE_LEVELS     8 // Channel difference, in output levels, counted as visible
+
+// Every case is labelled with the scene and the precision of the build
+#define LABEL "book, " RT_REAL_NAME ": "
+
+// Image of the other build mode, left in the working directory by a run of the suite in that mode
+#ifdef RT_USE_FLOAT
+#    define OTHER_REAL_NAME "double"
+#    define OTHER_USE_FLOAT "OFF"
+#else
+#    define OTHER_REAL_NAME "float"
+#    define OTHER_USE_FLOAT "ON"
+#endif
+
+// Reports how far `image` is from `other`: RMSE, PSNR, the largest channel difference and the share of pixels that
+// differ at all and visibly
+static void
+report_difference( const char * name, const unsigned char * image, const unsigned char * other, size_t pixels )
+{
+    size_t differing = 0;
+    size_t visible   = 0;
+    int    max_diff  = 0;
+    for( size_t p = 0; p < pixels; ++p )
+        {
+            int pixel_diff = 0;
+            for( int c = 0; c < RT_IMAGE_DATA_CHANNELS; ++c )
+                {
+                    const size_t k = p * RT_IMAGE_DATA_CHANNELS + c;
+                    pixel_diff     = RT_MAX( pixel_diff, abs( (int)image[k] - (int)other[k] ) );
+                }
+            differing += ( pixel_diff > 0 );
+            visible   += ( pixel_diff > VISIBLE_LEVELS );
+            max_diff   = RT_MAX( max_diff, pixel_diff );
+        }
+
+    const double rmse = bench_image_rmse( image, other, pixels * RT_IMAGE_DATA_CHANNELS );
+    bench_reportf( "precision", rmse, "levels", LABEL "%s RMSE", name );
+    bench_reportf( "precision", rmse > 0.0 ? 20.0 * log10( 255.0 / rmse ) : INFINITY, "dB", LABEL "%s PSNR", name );
+    bench_reportf( "precision", max_diff, "levels", LABEL "%s max difference", name );
+    bench_reportf( "precision", 100.0 * differing / pixels, "%", LABEL "%s differing pixels", name );
+    bench_reportf( "precision", 100.0 * visible / pixels, "%", LABEL "%s pixels off > %d", name, VISIBLE_LEVELS );
+}
+
+void
+bench_precision( void )
+{
+    bench_scene scene;
+    bench_world world;
+    camera      cam;
+    const bool  built = bench_scene_init( &scene, 0 );
+    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+
+    bench_reportf( "precision", sizeof( ray ), "bytes", LABEL "ray size" );
+    bench_reportf( "precision", sizeof( hit_record ), "bytes", LABEL "hit record size" );
+    bench_reportf( "precision", sizeof( sphere ), "bytes", LABEL "sphere size" );
+    bench_reportf( "precision", SPHERE_SOA_BLOCK, "spheres", LABEL "sphere_soa lanes" );
+
+    bvh_flat * bvh = bench_world_build( &world, &scene.world );
+
+    const size_t    pixels = (size_t)cam.image_width * cam.image_height;
+    unsigned char * image  = (unsigned char *)malloc( pixels * RT_IMAGE_DATA_CHANNELS );
+    unsigned char * noise  = (unsigned char *)malloc( pixels * RT_IMAGE_DATA_CHANNELS );
+    if( built && NULL != bvh && NULL != image && NULL != noise )
+        {
+            bench_reportf( "precision", bench_primary_ray_rate( &cam, &bvh->base, RAY_BUDGET_SECONDS ) * 1e-3,
+                           "krays/s", LABEL "intersect" );
+
+            // Single thread, so the time does not depend on the machine's core count
+            cam.thread_count = 1;
+            double start     = bench_now();
+            camera_render( &cam, (const struct hittable *)bvh, image );
+            bench_reportf( "precision", ( bench_now() - start ) * 1e3, "ms", LABEL "render" );
+
+            // The same render from other samples: the Monte Carlo noise the precision difference compares against
+            camera noise_cam       = cam;
+            noise_cam.seed         = cam.seed + 1;
+            noise_cam.thread_count = 0;
+            camera_render( &noise_cam, (const struct hittable *)bvh, noise );
+            report_difference( "other seed", image, noise, pixels );
+
+            char path[32];
+            snprintf( path, sizeof( path ), "precision_%s.png", RT_REAL_NAME );
+            stbi_write_png( path, cam.image_width, cam.image_height, RT_IMAGE_DATA_CHANNELS, image,
+                            cam.image_width * RT_IMAGE_DATA_CHANNELS );
+
+            int             width, height, channels;
+            unsigned char * other = stbi_load( "precision_" OTHER_REAL_NAME ".png", &width, &height, &channels,
+                                               RT_IMAGE_DATA_CHANNELS );
+            if( NULL != other && width == cam.image_width && height == cam.image_height )
+                {
+                    report_difference( OTHER_REAL_NAME " build", image, other, pixels );
+                }
+            else
+                {
+                    printf( "precision    no precision_" OTHER_REAL_NAME ".png to compare with, run this suite from a "
+                            "USE_FLOAT=" OTHER_USE_FLOAT " build in the same directory\n" );
+                }
+            stbi_image_free( other );
+        }
+
+    free( noise );
+    free( image );
+    bench_world_free( &world );
+    bench_scene_free( &scene );
+}
@@ -0,0 +1,98 @@
+#include "benchmark.h"
+#include "rtweekend.h"
+#include "tile_scheduler.h"
+#include <stdlib.h> /* rand, RAND_MAX */
+
+#define DRAWS_PER_CASE ( 1 << 24 )
+#define CHUNKS         64
+
+//----------------------------------------------------------------------------------------------------------------------
+// Legacy samplers, as they were before the RNG context: every draw goes through libc rand()
+//----------------------------------------------------------------------------------------------------------------------
+static inline double
+legacy_random_double( void )
+{
+    return rand() / ( RAND_MAX + 1.0 );
+}
+
+static inline vec3
+legacy_random_unit_vector( void )
+{
+    double z = -1.0 + 2.0 * legacy_random_double();
+    vec3   p;
+    do
+        {
+            p = vec3_new( -1.0 + 2.0 * legacy_random_double(), -1.0 + 2.0 * legacy_random_double(), z );
+        }
+    while( vec3_length_squared( p ) >= 1 );
+    return vec3_normalize( p );
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Cases
+//----------------------------------------------------------------------------------------------------------------------
+typedef enum
+{
+    CASE_RAND_DOUBLE,
+    CASE_RAND_UNIT_VECTOR,
+    CASE_PCG_DOUBLE,
+    CASE_PCG_UNIT_VECTOR,
+} rng_case;
+
+static double
+run_case( rng_case which, int draws, uint64_t stream )
+{
+    rng    gen;
+    double acc = 0.0;
+    rng_seed( &gen, 0x5EED, stream );
+
+    switch( which )
+        {
+        case CASE_RAND_DOUBLE:
+            for( int i = 0; i < draws; ++i ) acc += legacy_random_double();
+            break;
+        case CASE_RAND_UNIT_VECTOR:
+            for( int i = 0; i < draws; ++i ) acc += legacy_random_unit_vector().x;
+            break;
+        case CASE_PCG_DOUBLE:
+            for( int i = 0; i < draws; ++i ) acc += random_double( &gen );
+            break;
+        case CASE_PCG_UNIT_VECTOR:
+            for( int i = 0; i < draws; ++i ) acc += random_unit_vector( &gen ).x;
+            break;
+        }
+
+    return acc;
+}
+
+static void
+run_chunk( void * user, int chunk_index, int thread_index )
+{
+    RT_UNUSED( thread_index );
+    bench_sink( run_case( *(const rng_case *)user, DRAWS_PER_CASE / CHUNKS, (uint64_t)chunk_index ) );
+}
+
+static void
+measure( rng_case which, const char * name )
+{
+    double start = bench_now();
+    bench_sink( run_case( which, DRAWS_PER_CASE, 0 ) );
+    double elapsed = bench_now() - start;
+    bench_reportf( "rng", DRAWS_PER_CASE / elapsed * 1e-6, "Msamples/s", "%s (1 thread)", name );
+
+    // Same number of draws, spread over every hardware thread
+    int threads = tile_scheduler_hardware_threads();
+    start       = bench_now();
+    tile_scheduler_run( threads, CHUNKS, run_chunk, NULL, &which );
+    elapsed = bench_now() - start;
+    bench_reportf( "rng", DRAWS_PER_CASE / elapsed * 1e-6, "Msamples/s", "%s (%d threads)", name, threads );
+}
+
+void
+bench_rng( void )
+{
+    measure( CASE_RAND_DOUBLE, "rand() double" );
+    measure( CASE_PCG_DOUBLE, "pcg32 double" );
+    measure( CASE_RAND_UNIT_VECTOR, "rand() unit vector" );
+    measure( CASE_PCG_UNIT_VECTOR, "pcg32 unit vector" );
+}
@@ -0,0 +1,82 @@
+#include "benchmark.h"
+#include <stdio.h>  /* snprintf */
+#include <stdlib.h> /* malloc, free */
+
+#define IMAGE_WIDTH       200
+#define SAMPLES_PER_PIXEL 16
+#define REFERENCE_SPP     1024
+#define MAX_DEPTH         50
+
+// Wraps a world and counts the rays cast into it.
+// Only used by single-threaded renders, so the counter needs no synchronization.
+typedef struct
+{
+    hittable         base;
+    const hittable * world;
+    uint64_t         rays;
+} counting_world;
+
+static bool
+counting_world_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
+{
+    counting_world * counter = (counting_world *)object;
+    counter->rays++;
+    return counter->world->hit( counter->world, r, ray_tmin, ray_tmax, rec );
+}
+
+void
+bench_roulette( void )
+{
+    // Disabled first, then earlier and earlier termination
+    static const int min_depths[] = { 0, 5, 3, 1 };
+
+    bench_scene scene;
+    bench_world world;
+    camera      cam;
+    const bool  built = bench_scene_init( &scene, 0 );
+    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+    bvh_flat * bvh = bench_world_build( &world, &scene.world );
+
+    const size_t    image_size = (size_t)cam.image_width * cam.image_height * 3;
+    unsigned char * reference  = (unsigned char *)malloc( image_size );
+    unsigned char * image      = (unsigned char *)malloc( image_size );
+    if( built && NULL != bvh && NULL != reference && NULL != image )
+        {
+            // Converged image without roulette, from samples independent of the measured renders
+            camera reference_cam            = cam;
+            reference_cam.samples_per_pixel = REFERENCE_SPP;
+            reference_cam.seed              = cam.seed + 1;
+            reference_cam.thread_count      = 0;
+            camera_render( &reference_cam, (const struct hittable *)bvh, reference );
+
+            counting_world counter = { .world = &bvh->base };
+            counter.base.hit       = counting_world_hit;
+
+            const double paths = (double)cam.image_width * cam.image_height * cam.samples_per_pixel;
+            char         name[32];
+
+            cam.thread_count = 1;
+            for( size_t i = 0; i < sizeof( min_depths ) / sizeof( min_depths[0] ); ++i )
+                {
+                    cam.roulette_min_depth = min_depths[i];
+                    counter.rays           = 0;
+
+                    double start   = bench_now();
+                    camera_render( &cam, (const struct hittable *)&counter, image );
+                    double seconds = bench_now() - start;
+                    double rmse    = bench_image_rmse( image, reference, image_size );
+
+                    snprintf( name, sizeof( name ), min_depths[i] > 0 ? "min depth %d" : "off", min_depths[i] );
+
+                    bench_reportf( "roulette", seconds * 1e3, "ms", "book: %s, render time", name );
+                    bench_reportf( "roulette", (double)counter.rays / paths, "rays/path",
+                                   "book: %s, path length", name );
+                    bench_reportf( "roulette", rmse, "levels", "book: %s, RMSE", name );
+                }
+        }
+
+    free( image );
+    free( reference );
+    bench_world_free( &world );
+    bench_scene_free( &scene );
+}
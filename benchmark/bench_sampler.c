@@ -0,0 +1,95 @@
+#include "benchmark.h"
+#include "hdr_image.h"
+#include "postprocess.h"
+#include "sampler.h"
+#include <stdio.h>  /* snprintf */
+#include <stdlib.h> /* malloc, free */
+
+#define IMAGE_WIDTH   200
+#define MAX_DEPTH     20
+#define REFERENCE_SPP 1024
+
+// Renders the linear radiance of `cam` into `radiance` and grades it into `image`
+//
+// Returns:
+//   The render time in seconds
+static double
+render( const camera * cam, const hittable * world, const postprocess_settings * post, hdr_image * radiance,
+        unsigned char * image )
+{
+    double start   = bench_now();
+    bool   ok      = camera_render_rows_hdr( cam, (const struct hittable *)world, radiance->pixels, 0,
+                                             cam->image_height );
+    double seconds = bench_now() - start;
+    hdr_image_tonemap( radiance, post, image );
+    return ok ? seconds : 0.0;
+}
+
+void
+bench_sampler( void )
+{
+    static const int spp[] = { 1, 4, 16, 64, 256 };
+    enum
+    {
+        SPP_COUNT = sizeof( spp ) / sizeof( spp[0] )
+    };
+
+    bench_scene scene;
+    bench_world world;
+    camera      cam;
+    const bool  built = bench_scene_init( &scene, 0 );
+    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, REFERENCE_SPP, MAX_DEPTH );
+    bvh_flat * bvh = bench_world_build( &world, &scene.world );
+
+    // Graded without dithering, so the error measured is the render's alone
+    postprocess_settings post;
+    postprocess_settings_init( &post );
+    post.dither = false;
+
+    const size_t    pixels    = (size_t)cam.image_width * cam.image_height;
+    unsigned char * reference = (unsigned char *)malloc( pixels * 3 );
+    unsigned char * image     = (unsigned char *)malloc( pixels * 3 );
+    hdr_image       radiance;
+    if( hdr_image_init( &radiance, cam.image_width, cam.image_height ) && built && NULL != bvh && NULL != reference
+        && NULL != image )
+        {
+            // Converged image, from independent random samples
+            camera reference_cam       = cam;
+            reference_cam.seed         = cam.seed + 1;
+            reference_cam.thread_count = 0;
+            render( &reference_cam, &bvh->base, &post, &radiance, reference );
+
+            cam.thread_count = 1;
+            char   name[32];
+            double random_rmse[SPP_COUNT];
+            for( int s = 0; s < SAMPLER_TYPE_COUNT; ++s )
+                {
+                    cam.sampler = (sampler_type)s;
+                    for( int i = 0; i < SPP_COUNT; ++i )
+                        {
+                            cam.samples_per_pixel = spp[i];
+                            const double seconds  = render( &cam, &bvh->base, &post, &radiance, image );
+                            const double rmse     = bench_image_rmse( image, reference, pixels * 3 );
+                            if( SAMPLER_RANDOM == cam.sampler ) random_rmse[i] = rmse;
+
+                            // Random sample count reaching the same error, which falls with its square root
+                            const double ratio = random_rmse[i] / rmse;
+
+                            snprintf( name, sizeof( name ), "%s %d spp", sampler_name( cam.sampler ), spp[i] );
+                            bench_reportf( "sampler", seconds * 1e3, "ms", "%s, render time", name );
+                            bench_reportf( "sampler", rmse, "levels", "%s, RMSE", name );
+                            if( SAMPLER_RANDOM != cam.sampler )
+                                {
+                                    bench_reportf( "sampler", spp[i] * ratio * ratio, "spp",
+                                                   "%s, random equivalent", name );
+                                }
+                        }
+                }
+        }
+
+    hdr_image_free( &radiance );
+    free( image );
+    free( reference );
+    bench_world_free( &world );
+    bench_scene_free( &scene );
+}
@@ -0,0 +1,110 @@
+#include "benchmark.h"
+#include "hittable_list.h"
+#include "material_table.h"
+#include "scene.h"
+#include "scene_file.h"
+#include <stdio.h> /* fprintf, remove */
+
+#define SPHERE_COUNT 1000000
+#define TEXT_PATH    "bench_scene_file.scene"
+#define BINARY_PATH  "bench_scene_file.scene" SCENE_FILE_CACHE_EXTENSION
+
+typedef bool ( *scene_loader )( const char * path, hittable_list * world, arena * memory, material_table * materials,
+                                camera * cam );
+
+// Loads the scene at `path` into an empty scene and checks it against the hashes of the scene that was saved
+//
+// Returns:
+//   Load time in seconds, or a negative value if the load failed or loaded another scene
+static double
+measure_load( scene_loader load, const char * path, uint64_t expected_scene, uint64_t expected_camera )
+{
+    hittable_list  world;
+    arena          memory;
+    material_table materials;
+    camera         cam;
+
+    scene_sphere_cloud_camera( &cam, 1, 1.0, 1, 1, 1 ); // Overwritten by the file
+    arena_init( &memory, 0 );
+    material_table_init( &materials );
+    hittable_list_init( &world, 64 );
+
+    const double start   = bench_now();
+    bool         ok      = load( path, &world, &memory, &materials, &cam );
+    const double elapsed = bench_now() - start;
+
+    ok = ok && expected_scene == scene_hash( &world, &materials ) && expected_camera == camera_hash( &cam );
+    if( !ok ) fprintf( stderr, "ERROR: %s did not load the saved scene.\n", path );
+
+    hittable_list_clear( &world );
+    arena_free( &memory );
+    material_table_free( &materials );
+    return ok ? elapsed : -1.0;
+}
+
+void
+bench_scene_file( void )
+{
+    rng            gen;
+    hittable_list  world;
+    arena          memory;
+    material_table materials;
+    camera         cam;
+
+    rng_seed( &gen, 1, 0 );
+    scene_sphere_cloud_camera( &cam, SPHERE_COUNT, 16.0 / 9.0, 400, 1, 1 );
+    arena_init( &memory, 0 );
+    material_table_init( &materials );
+    hittable_list_init( &world, SPHERE_COUNT );
+
+    double start = bench_now();
+    bool   ok    = scene_sphere_cloud( &world, &memory, &materials, &gen, SPHERE_COUNT );
+    bench_reportf( "scene_file", ( bench_now() - start ) * 1e3, "ms",
+                   "cloud %dk: procedural build", SPHERE_COUNT / 1000 );
+
+    const uint64_t expected_scene  = scene_hash( &world, &materials );
+    const uint64_t expected_camera = camera_hash( &cam );
+
+    start = bench_now();
+    ok    = ok && scene_file_save_text( TEXT_PATH, &world, &materials, &cam );
+    bench_reportf( "scene_file", ( bench_now() - start ) * 1e3, "ms", "cloud %dk: text save", SPHERE_COUNT / 1000 );
+
+    start = bench_now();
+    ok    = ok && scene_file_save_binary( BINARY_PATH, &world, &materials, &cam, TEXT_PATH );
+    bench_reportf( "scene_file", ( bench_now() - start ) * 1e3, "ms", "cloud %dk: binary save", SPHERE_COUNT / 1000 );
+
+    hittable_list_clear( &world );
+    arena_free( &memory );
+    material_table_free( &materials );
+
+    if( ok )
+        {
+            bench_reportf( "scene_file", bench_file_size_mib( TEXT_PATH ), "MiB",
+                           "cloud %dk: text size", SPHERE_COUNT / 1000 );
+            bench_reportf( "scene_file", bench_file_size_mib( BINARY_PATH ), "MiB",
+                           "cloud %dk: binary size", SPHERE_COUNT / 1000 );
+
+            const double text   = measure_load( scene_file_load_text, TEXT_PATH, expected_scene, expected_camera );
+            const double binary = measure_load( scene_file_load_binary, BINARY_PATH, expected_scene, expected_camera );
+            const double cached = measure_load( scene_file_load, TEXT_PATH, expected_scene, expected_camera );
+            if( text >= 0.0 )
+                {
+                    bench_reportf( "scene_file", text * 1e3, "ms", "cloud %dk: text load", SPHERE_COUNT / 1000 );
+                }
+            if( binary >= 0.0 )
+                {
+                    bench_reportf( "scene_file", binary * 1e3, "ms", "cloud %dk: binary load", SPHERE_COUNT / 1000 );
+                }
+            if( cached >= 0.0 )
+                {
+                    bench_reportf( "scene_file", cached * 1e3, "ms", "cloud %dk: cached load", SPHERE_COUNT / 1000 );
+                }
+            if( text > 0.0 && binary > 0.0 )
+                {
+                    bench_reportf( "scene_file", text / binary, "x", "cloud %dk: binary speedup", SPHERE_COUNT / 1000 );
+                }
+        }
+
+    remove( TEXT_PATH );
+    remove( BINARY_PATH );
+}
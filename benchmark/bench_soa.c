@@ -0,0 +1,88 @@
+#include "benchmark.h"
+#include "bvh.h"
+#include "bvh_flat.h"
+#include "sphere_soa.h"
+
+#define RAY_BUDGET_SECONDS 1.0
+#define IMAGE_WIDTH        400
+
+// Flat BVH throughput over `list`, which holds either spheres or sphere_soa groups
+static double
+flat_bvh_rate( const hittable_list * list, const camera * cam )
+{
+    hittable * tree = bvh_node_build( list );
+    if( NULL == tree ) return 0.0;
+    bvh_flat * bvh = bvh_flat_build( tree );
+    bvh_node_free( tree );
+    if( NULL == bvh ) return 0.0;
+
+    double rate = bench_primary_ray_rate( cam, &bvh->base, RAY_BUDGET_SECONDS );
+    bvh_flat_free( bvh );
+    return rate;
+}
+
+static void
+measure_scene( const bench_scene * scene, const camera * cam, bool brute_force )
+{
+    static const size_t   group_sizes[] = { 4, 8, 16 };
+    const char *          name          = scene->name;
+    const hittable_list * world         = &scene->world;
+
+    // Brute force: every sphere against the ray, one at a time or packed
+    if( brute_force )
+        {
+            bench_reportf( "soa", bench_primary_ray_rate( cam, &world->base, RAY_BUDGET_SECONDS ) * 1e-3, "krays/s",
+                           "%s: linear list", name );
+
+            hittable_list packed;
+            hittable_list_init( &packed, 1 );
+            if( sphere_soa_cluster( world, world->count, &packed ) && 1 == packed.count )
+                {
+                    sphere_soa * set = (sphere_soa *)packed.objects[0];
+                    for( int k = 0; k < SPHERE_SOA_KERNEL_COUNT; ++k )
+                        {
+                            if( !sphere_soa_kernel_supported( (sphere_soa_kernel)k ) ) continue;
+                            set->kernel = (sphere_soa_kernel)k;
+                            double rate = bench_primary_ray_rate( cam, &set->base, RAY_BUDGET_SECONDS );
+                            bench_reportf( "soa", rate * 1e-3, "krays/s", "%s: packed %s", name,
+                                           sphere_soa_kernel_name( set->kernel ) );
+                        }
+                }
+            sphere_soa_cluster_free( &packed );
+        }
+
+    // Flat BVH with one sphere per primitive against BVH leaves that are packed groups
+    bench_reportf( "soa", flat_bvh_rate( world, cam ) * 1e-3, "krays/s", "%s: flat bvh", name );
+
+    for( size_t i = 0; i < sizeof( group_sizes ) / sizeof( group_sizes[0] ); ++i )
+        {
+            hittable_list groups;
+            hittable_list_init( &groups, 16 );
+            if( sphere_soa_cluster( world, group_sizes[i], &groups ) )
+                {
+                    bench_reportf( "soa", flat_bvh_rate( &groups, cam ) * 1e-3, "krays/s",
+                                   "%s: flat bvh, groups of %zu (%s)", name, group_sizes[i],
+                                   sphere_soa_kernel_name( sphere_soa_best_kernel() ) );
+                }
+            sphere_soa_cluster_free( &groups );
+        }
+}
+
+void
+bench_soa( void )
+{
+    // The book scene, then synthetic sphere clouds; brute force is only meaningful on the small ones
+    static const int cloud_sizes[] = { 0, 10000, 1000000 };
+
+    for( size_t i = 0; i < sizeof( cloud_sizes ) / sizeof( cloud_sizes[0] ); ++i )
+        {
+            bench_scene scene;
+            camera      cam;
+            if( bench_scene_init( &scene, cloud_sizes[i] ) )
+                {
+                    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, 1, 1 );
+                    measure_scene( &scene, &cam, cloud_sizes[i] <= 10000 );
+                }
+            bench_scene_free( &scene );
+        }
+}
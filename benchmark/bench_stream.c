@@ -0,0 +1,207 @@
+#define _POSIX_C_SOURCE 200809L /* fork, getrusage */
+
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#include "band_writer.h"
+#include "benchmark.h"
+#include "image_encoder.h"
+#include "postprocess.h"
+#include <stdio.h>        /* fprintf, remove */
+#include <stdlib.h>       /* malloc, free */
+#include <string.h>       /* memcmp */
+#include <sys/resource.h> /* getrusage */
+#include <sys/wait.h>     /* waitpid */
+#include <unistd.h>       /* fork, pipe, read, write, _exit */
+
+#define IMAGE_WIDTH       3840 // 4K UHD
+#define SAMPLES_PER_PIXEL 1
+#define MAX_DEPTH         8
+#define BAND_ROWS         32
+#define BAND_COUNT        3
+#define FULL_PATH         "bench_stream_full.png"
+#define BANDED_PATH       "bench_stream_banded.png"
+
+// Measurements of one case, passed back from the process that ran it
+typedef struct
+{
+    bool   ok;
+    double render;   // Seconds spent rendering
+    double total;    // Seconds from the start of the render until the file is closed
+    double peak_rss; // Peak resident memory of the process, in MiB
+} stream_result;
+
+typedef bool ( *stream_case_fn )( const camera * cam, const hittable * world, stream_result * result );
+
+// Renders nothing; its peak memory is what every case starts from
+static bool
+run_baseline( const camera * cam, const hittable * world, stream_result * result )
+{
+    RT_UNUSED( cam );
+    RT_UNUSED( world );
+    RT_UNUSED( result );
+    return true;
+}
+
+// Renders the whole frame, post-processes it, then encodes it with stb_image_write, as the renderer did before
+// streaming
+static bool
+run_full_frame( const camera * cam, const hittable * world, stream_result * result )
+{
+    const size_t    pixels   = (size_t)cam->image_width * cam->image_height;
+    float *         radiance = (float *)malloc( pixels * 3 * sizeof( float ) );
+    unsigned char * image    = (unsigned char *)malloc( pixels * RT_IMAGE_DATA_CHANNELS );
+    bool            ok       = NULL != radiance && NULL != image;
+
+    const double start = bench_now();
+    ok             = ok && camera_render_rows_hdr( cam, (const struct hittable *)world, radiance, 0,
+                                                   cam->image_height );
+    result->render = bench_now() - start;
+    if( ok ) postprocess_image( NULL, radiance, NULL, cam->image_width, 0, cam->image_height, image );
+    ok            = ok && 0 != stbi_write_png( FULL_PATH, cam->image_width, cam->image_height, RT_IMAGE_DATA_CHANNELS,
+                                               image, cam->image_width * RT_IMAGE_DATA_CHANNELS );
+    result->total = bench_now() - start;
+    free( radiance );
+    free( image );
+    return ok;
+}
+
+// Renders band by band, each band post-processed and then encoded on the writer thread while the next renders
+static bool
+run_banded( const camera * cam, const hittable * world, stream_result * result )
+{
+    const double    start    = bench_now();
+    float *         radiance = (float *)malloc( (size_t)cam->image_width * BAND_ROWS * 3 * sizeof( float ) );
+    image_encoder * encoder  = radiance ? image_encoder_open( BANDED_PATH, IMAGE_ENCODER_PNG, cam->image_width,
+                                                              cam->image_height )
+                                        : NULL;
+    band_writer *   writer   = encoder ? band_writer_start( encoder, cam->image_width, BAND_ROWS, BAND_COUNT ) : NULL;
+    bool            ok       = NULL != writer;
+    for( int y = 0; ok && y < cam->image_height; y += BAND_ROWS )
+        {
+            const int       rows  = RT_MIN( BAND_ROWS, cam->image_height - y );
+            unsigned char * band  = band_writer_acquire( writer );
+            const double    begin = bench_now();
+            ok = camera_render_rows_hdr( cam, (const struct hittable *)world, radiance, y, y + rows );
+            result->render       += bench_now() - begin;
+            if( ok ) postprocess_image( NULL, radiance, NULL, cam->image_width, y, y + rows, band );
+            band_writer_submit( writer, band, ok ? rows : 0 );
+        }
+    ok            = band_writer_finish( writer ) && ok;
+    ok            = image_encoder_close( encoder ) && ok;
+    result->total = bench_now() - start;
+    free( radiance );
+    return ok;
+}
+
+// Runs `run` in a child process, so the peak memory measured is that of the case alone on top of the scene
+static stream_result
+measure( stream_case_fn run, const camera * cam, const hittable * world )
+{
+    stream_result result = { 0 };
+    int           fds[2];
+    if( 0 != pipe( fds ) ) return result;
+
+    fflush( NULL );
+    const pid_t pid = fork();
+    if( 0 == pid )
+        {
+            struct rusage usage;
+            close( fds[0] );
+            result.ok = run( cam, world, &result );
+            getrusage( RUSAGE_SELF, &usage );
+            result.peak_rss = (double)usage.ru_maxrss / 1024.0; // KiB on Linux
+            result.ok       = result.ok && sizeof( result ) == (size_t)write( fds[1], &result, sizeof( result ) );
+            _exit( result.ok ? 0 : 1 );
+        }
+
+    close( fds[1] );
+    if( pid > 0 )
+        {
+            if( sizeof( result ) != (size_t)read( fds[0], &result, sizeof( result ) ) ) result.ok = false;
+            waitpid( pid, NULL, 0 );
+        }
+    close( fds[0] );
+    return result;
+}
+
+// Decodes both images and counts the pixels that differ
+//
+// Returns:
+//   The number of differing pixels, or -1 if the images could not be decoded or differ in size
+static long
+compare_images( void )
+{
+    int             w0, h0, w1, h1, channels;
+    unsigned char * a    = stbi_load( FULL_PATH, &w0, &h0, &channels, RT_IMAGE_DATA_CHANNELS );
+    unsigned char * b    = stbi_load( BANDED_PATH, &w1, &h1, &channels, RT_IMAGE_DATA_CHANNELS );
+    long            diff = -1;
+    if( NULL != a && NULL != b && w0 == w1 && h0 == h1 )
+        {
+            diff = 0;
+            for( size_t p = 0; p < (size_t)w0 * h0; ++p )
+                {
+                    diff += 0 != memcmp( a + p * RT_IMAGE_DATA_CHANNELS, b + p * RT_IMAGE_DATA_CHANNELS,
+                                         RT_IMAGE_DATA_CHANNELS );
+                }
+        }
+    stbi_image_free( a );
+    stbi_image_free( b );
+    return diff;
+}
+
+void
+bench_stream( void )
+{
+    bench_scene scene;
+    bench_world world;
+    camera      cam;
+    const bool  built = bench_scene_init( &scene, 0 );
+    bench_scene_camera( &scene, &cam, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+    bvh_flat * bvh = bench_world_build( &world, &scene.world );
+
+    if( built && NULL != bvh )
+        {
+            const stream_result baseline = measure( run_baseline, &cam, &bvh->base );
+            const stream_result full     = measure( run_full_frame, &cam, &bvh->base );
+            const stream_result banded   = measure( run_banded, &cam, &bvh->base );
+
+            const stream_result * results[2] = { &full, &banded };
+            const char *          names[2]   = { "full frame", "banded" };
+            const char *          paths[2]   = { FULL_PATH, BANDED_PATH };
+            for( int c = 0; c < 2; ++c )
+                {
+                    if( !results[c]->ok || !baseline.ok )
+                        {
+                            fprintf( stderr, "ERROR: The %s case failed.\n", names[c] );
+                            continue;
+                        }
+                    bench_reportf( "stream", results[c]->peak_rss - baseline.peak_rss, "MiB",
+                                   "%dp: %s, peak memory over scene", IMAGE_WIDTH * 9 / 16, names[c] );
+                    bench_reportf( "stream", results[c]->render * 1e3, "ms",
+                                   "%dp: %s, render", IMAGE_WIDTH * 9 / 16, names[c] );
+                    bench_reportf( "stream", ( results[c]->total - results[c]->render ) * 1e3, "ms",
+                                   "%dp: %s, time not rendering", IMAGE_WIDTH * 9 / 16, names[c] );
+                    bench_reportf( "stream", results[c]->total * 1e3, "ms",
+                                   "%dp: %s, total", IMAGE_WIDTH * 9 / 16, names[c] );
+                    bench_reportf( "stream", bench_file_size_mib( paths[c] ), "MiB",
+                                   "%dp: %s, file size", IMAGE_WIDTH * 9 / 16, names[c] );
+                }
+
+            const long diff = ( full.ok && banded.ok ) ? compare_images() : -1;
+            if( diff >= 0 )
+                {
+                    bench_reportf( "stream", (double)diff, "pixels",
+                                   "%dp: banded, pixels differing from full frame", IMAGE_WIDTH * 9 / 16 );
+                }
+        }
+    else
+        {
+            fprintf( stderr, "ERROR: Failed to build the book scene.\n" );
+        }
+
+    remove( FULL_PATH );
+    remove( BANDED_PATH );
+    bench_world_free( &world );
+    bench_scene_free( &scene );
+}
@@ -0,0 +1,311 @@
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+#include "benchmark.h"
+#include "bvh.h"
+#include "rtweekend.h"
+#include "scene.h"
+#include "sphere_soa.h"
+#include <math.h> /* sqrt */
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>    /* printf, fprintf, vsnprintf */
+#include <stdlib.h>   /* EXIT_SUCCESS */
+#include <string.h>   /* strcmp */
+#include <sys/stat.h> /* stat */
+#include <time.h>     /* clock_gettime */
+
+// Objects per SIMD group, as the renderer packs them
+#define SPHERE_GROUP_SIZE 16
+
+typedef struct
+{
+    const char * name;
+    void ( *run )( void );
+} bench_suite;
+
+static const bench_suite suites[] = {
+    { "rng", bench_rng },
+    { "bvh", bench_bvh },
+    { "soa", bench_soa },
+    { "packet", bench_packet },
+    { "integrator", bench_integrator },
+    { "roulette", bench_roulette },
+    { "adaptive", bench_adaptive },
+    { "pipeline", bench_pipeline },
+    { "arena", bench_arena },
+    { "precision", bench_precision },
+    { "scene_file", bench_scene_file },
+    { "mesh", bench_mesh },
+    { "instance", bench_instance },
+    { "stream", bench_stream },
+    { "hdr", bench_hdr },
+    { "post", bench_post },
+    { "denoise", bench_denoise },
+    { "sampler", bench_sampler },
+};
+
+static volatile double sink;
+static FILE *          json;         // Results file given with --json, NULL if none
+static int             json_results; // Results written to `json` so far
+
+double
+bench_now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Writes `text` as a JSON string literal
+static void
+json_write_string( FILE * file, const char * text )
+{
+    fputc( '"', file );
+    for( const char * c = text; '\0' != *c; ++c )
+        {
+            if( '"' == *c || '\\' == *c )
+                {
+                    fprintf( file, "\\%c", *c );
+                }
+            else if( (unsigned char)*c < 0x20 )
+                {
+                    fprintf( file, "\\u%04x", (unsigned char)*c );
+                }
+            else
+                {
+                    fputc( *c, file );
+                }
+        }
+    fputc( '"', file );
+}
+
+void
+bench_report( const char * suite, const char * name, double value, const char * unit )
+{
+    printf( "%-12s %-40s %16.2f %s\n", suite, name, value, unit );
+    fflush( stdout );
+
+    if( NULL == json ) return;
+    fprintf( json, "%s\n    { \"suite\": ", json_results > 0 ? "," : "" );
+    json_write_string( json, suite );
+    fprintf( json, ", \"name\": " );
+    json_write_string( json, name );
+    fprintf( json, ", \"value\": %.17g, \"unit\": ", value );
+    json_write_string( json, unit );
+    fprintf( json, " }" );
+    json_results += 1;
+}
+
+void
+bench_reportf( const char * suite, double value, const char * unit, const char * format, ... )
+{
+    char    name[128];
+    va_list args;
+    va_start( args, format );
+    vsnprintf( name, sizeof( name ), format, args );
+    va_end( args );
+    bench_report( suite, name, value, unit );
+}
+
+double
+bench_file_size_mib( const char * path )
+{
+    struct stat info;
+    return ( 0 == stat( path, &info ) ) ? (double)info.st_size / ( 1 << 20 ) : 0.0;
+}
+
+void
+bench_sink( double value )
+{
+    sink += value;
+}
+
+double
+bench_primary_ray_rate( const camera * cam, const hittable * world, double budget_seconds )
+{
+    ray * rays = (ray *)malloc( BENCH_RAY_BATCH * sizeof( ray ) );
+    if( NULL == rays ) return 0.0;
+
+    rng gen;
+    rng_seed( &gen, 0xB0B, 0 );
+    for( int i = 0; i < BENCH_RAY_BATCH; ++i )
+        {
+            double u = random_double( &gen );
+            double v = random_double( &gen );
+            rays[i]  = camera_get_ray( cam, u, v, &gen );
+        }
+
+    hit_record rec;
+    long long  traced = 0;
+    int        hits   = 0;
+    double     start  = bench_now();
+    double     elapsed;
+    do
+        {
+            // Check the clock every 64 rays: cheap enough for the linear list on huge scenes
+            for( int i = 0; i < 64; ++i )
+                {
+                    const ray * r  = &rays[traced++ % BENCH_RAY_BATCH];
+                    hits          += world->hit( world, r, CAMERA_RAY_T_MIN, RT_INFINITY, &rec );
+                }
+            elapsed = bench_now() - start;
+        }
+    while( elapsed < budget_seconds );
+
+    bench_sink( hits );
+    free( rays );
+    return traced / elapsed;
+}
+
+double
+bench_image_rmse( const unsigned char * a, const unsigned char * b, size_t size )
+{
+    double sum = 0.0;
+    for( size_t k = 0; k < size; ++k )
+        {
+            const double d  = (double)a[k] - (double)b[k];
+            sum            += d * d;
+        }
+    return sqrt( sum / (double)size );
+}
+
+bool
+bench_scene_init( bench_scene * scene, int cloud_size )
+{
+    rng gen;
+    rng_seed( &gen, 1, 0 );
+    scene->cloud_size = RT_MAX( cloud_size, 0 );
+    arena_init( &scene->memory, 0 );
+    material_table_init( &scene->materials );
+
+    const double start = bench_now();
+    bool         ok;
+    if( scene->cloud_size > 0 )
+        {
+            snprintf( scene->name, sizeof( scene->name ), "cloud %dk", scene->cloud_size / 1000 );
+            hittable_list_init( &scene->world, scene->cloud_size );
+            ok = scene_sphere_cloud( &scene->world, &scene->memory, &scene->materials, &gen, scene->cloud_size );
+        }
+    else
+        {
+            snprintf( scene->name, sizeof( scene->name ), "book" );
+            hittable_list_init( &scene->world, 500 );
+            ok = scene_book( &scene->world, &scene->memory, &scene->materials, &gen );
+        }
+    scene->build_seconds = bench_now() - start;
+    return ok;
+}
+
+void
+bench_scene_camera( const bench_scene * scene, camera * cam, int image_width, int samples_per_pixel, int max_depth )
+{
+    if( scene->cloud_size > 0 )
+        {
+            scene_sphere_cloud_camera( cam, scene->cloud_size, 16.0 / 9.0, image_width, samples_per_pixel, max_depth );
+        }
+    else
+        {
+            scene_book_camera( cam, 16.0 / 9.0, image_width, samples_per_pixel, max_depth );
+        }
+    cam->materials = &scene->materials;
+}
+
+void
+bench_scene_free( bench_scene * scene )
+{
+    hittable_list_clear( &scene->world );
+    arena_free( &scene->memory );
+    material_table_free( &scene->materials );
+}
+
+bvh_flat *
+bench_world_build( bench_world * world, const hittable_list * objects )
+{
+    hittable_list_init( &world->groups, 64 );
+    world->bvh = NULL;
+    if( sphere_soa_cluster( objects, SPHERE_GROUP_SIZE, &world->groups ) )
+        {
+            hittable * tree = bvh_node_build( &world->groups );
+            world->bvh      = bvh_flat_build( tree );
+            bvh_node_free( tree );
+        }
+    return world->bvh;
+}
+
+void
+bench_world_free( bench_world * world )
+{
+    bvh_flat_free( world->bvh );
+    sphere_soa_cluster_free( &world->groups );
+    world->bvh = NULL;
+}
+
+// Usage: RayTracingBenchmark [--json <path>] [suite...]
+// Runs every suite when no name is given. With --json, the results are also written to <path> as
+// { "results": [ { "suite", "name", "value", "unit" }, ... ] } for tracking them across commits.
+int
+main( int argc, char ** argv )
+{
+    const int    suite_count = (int)( sizeof( suites ) / sizeof( suites[0] ) );
+    const char * json_path   = NULL;
+
+    // Options come first; the remaining arguments name suites
+    int first = 1;
+    if( argc > 2 && 0 == strcmp( argv[1], "--json" ) )
+        {
+            json_path  = argv[2];
+            first     += 2;
+        }
+
+    for( int i = first; i < argc; ++i )
+        {
+            bool known = false;
+            for( int s = 0; s < suite_count; ++s )
+                {
+                    known = known || ( 0 == strcmp( argv[i], suites[s].name ) );
+                }
+            if( !known )
+                {
+                    fprintf( stderr, "Unknown suite '%s'. Available:", argv[i] );
+                    for( int s = 0; s < suite_count; ++s )
+                        {
+                            fprintf( stderr, " %s", suites[s].name );
+                        }
+                    fprintf( stderr, "\n" );
+                    return EXIT_FAILURE;
+                }
+        }
+
+    if( NULL != json_path )
+        {
+            json = fopen( json_path, "w" );
+            if( NULL == json )
+                {
+                    fprintf( stderr, "ERROR: Failed to open '%s' for writing.\n", json_path );
+                    return EXIT_FAILURE;
+                }
+            fprintf( json, "{\n  \"results\": [" );
+        }
+
+    for( int s = 0; s < suite_count; ++s )
+        {
+            bool selected = ( argc <= first );
+            for( int i = first; i < argc; ++i )
+                {
+                    selected = selected || ( 0 == strcmp( argv[i], suites[s].name ) );
+                }
+            if( selected ) suites[s].run();
+        }
+
+    if( NULL != json )
+        {
+            fprintf( json, "\n  ]\n}\n" );
+            if( 0 != fclose( json ) )
+                {
+                    fprintf( stderr, "ERROR: Failed to write '%s'.\n", json_path );
+                    return EXIT_FAILURE;
+                }
+        }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "arena.h"          /* arena */
+#include "bvh_flat.h"       /* bvh_flat */
+#include "camera.h"         /* camera */
+#include "hittable.h"       /* hittable */
+#include "hittable_list.h"  /* hittable_list */
+#include "material_table.h" /* material_table */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns a monotonic timestamp in seconds
+double bench_now( void );
+
+// Prints one result row: the suite, the measured case and its value. The row is also written to the JSON results
+// file when one was requested on the command line.
+void bench_report( const char * suite, const char * name, double value, const char * unit );
+
+// Same as bench_report, with the case named by `format` and the arguments after it, as printf takes them
+void bench_reportf( const char * suite, double value, const char * unit, const char * format, ... );
+
+// Keeps `value` alive so the compiler cannot drop the loop that produced it
+void bench_sink( double value );
+
+// Root mean square difference of two 8-bit images of `size` bytes, in output levels
+double bench_image_rmse( const unsigned char * a, const unsigned char * b, size_t size );
+
+// Returns the size of the file at `path` in MiB, or 0 if it cannot be read
+double bench_file_size_mib( const char * path );
+
+// Number of distinct primary rays cycled through by bench_primary_ray_rate
+#define BENCH_RAY_BATCH 65536
+
+// Measures closest-hit throughput of `world` for jittered primary rays of `cam`.
+// The rays are generated up front so only the intersection is timed; they are traced
+// repeatedly until `budget_seconds` has elapsed.
+//
+// Returns:
+//   Rays per second
+double bench_primary_ray_rate( const camera * cam, const hittable * world, double budget_seconds );
+
+//----------------------------------------------------------------------------------------------------------------------
+// Scenes
+//----------------------------------------------------------------------------------------------------------------------
+// A scene generated with seed 1, as most suites measure: the book scene or a sphere cloud
+typedef struct
+{
+    char           name[32];      // "book" or "cloud <n>k", the prefix of the suites' case names
+    int            cloud_size;    // Spheres of the cloud; 0 for the book scene
+    hittable_list  world;         // The scene's objects, allocated from `memory`
+    arena          memory;        // Scene arena
+    material_table materials;     // Materials the objects refer to
+    double         build_seconds; // Time taken to generate the scene
+} bench_scene;
+
+// Generates the book scene, or a sphere cloud of `cloud_size` spheres when it is > 0.
+//
+// Returns:
+//   false if the scene could not be generated; it must be freed either way
+bool bench_scene_init( bench_scene * scene, int cloud_size );
+
+// Sets `cam` to the scene's camera at a 16:9 aspect ratio, rendering with the scene's materials
+void bench_scene_camera( const bench_scene * scene, camera * cam, int image_width, int samples_per_pixel,
+                         int max_depth );
+
+// Frees the objects, arena and materials of a scene
+void bench_scene_free( bench_scene * scene );
+
+// The world as the renderer traces it: spheres packed into SIMD groups under a flat BVH
+typedef struct
+{
+    hittable_list groups; // The sphere_soa groups and other objects that are the leaves of the BVH
+    bvh_flat *    bvh;    // NULL if the world could not be built
+} bench_world;
+
+// Builds the renderer's world over `objects`, which keep their owner.
+//
+// Returns:
+//   The world's flat BVH, or NULL if it could not be built; `world` must be freed either way
+bvh_flat * bench_world_build( bench_world * world, const hittable_list * objects );
+
+// Frees the BVH and the groups of a world, but not the objects
+void bench_world_free( bench_world * world );
+
+//----------------------------------------------------------------------------------------------------------------------
+// Suites
+//----------------------------------------------------------------------------------------------------------------------
+// RNG throughput: libc rand() against the per-worker PCG32 context
+void bench_rng( void );
+
+// Ray throughput and memory of the linear hittable_list, the pointer BVH and the flat BVH,
+// for the book scene and large sphere clouds
+void bench_bvh( void );
+
+// Ray throughput of scalar spheres against packed sphere_soa groups for every supported SIMD kernel,
+// brute force and as leaves of the flat BVH
+void bench_soa( void );
+
+// Primary-ray throughput and single-threaded render time, tracing rays one at a time against 4x4 and 8x8 packets
+void bench_packet( void );
+
+// Path throughput of the recursive and the wavefront integrator, on one thread and on every hardware thread
+void bench_integrator( void );
+
+// Render time, average path length and error against a high-sample reference of the book scene, with Russian
+// roulette disabled and starting after several minimum depths
+void bench_roulette( void );
+
+// Render time, samples taken and error against a high-sample reference of the book scene, for fixed sample counts
+// and adaptive sampling at several noise thresholds
+void bench_adaptive( void );
+
+// Scene build, single-threaded render and PNG encode times, render rays/second and samples/second, and ns/ray of
+// closest-hit intersection and of every material's scatter, for the fixed-seed book scene and sphere clouds
+void bench_pipeline( void );
+
+// Build time, free time and ray throughput of a 1M sphere cloud allocated one object at a time against one
+// allocated from a scene arena
+void bench_arena( void );
+
+// Type sizes, ray throughput and single-threaded render time of the book scene in the build's precision (double, or
+// float with USE_FLOAT). The image is saved as precision_<type>.png and compared with the other mode's image when a
+// build of that mode left one in the working directory.
+void bench_precision( void );
+
+// Save time, file size and load time of a 1M sphere cloud as a text scene and as its binary cache, and the load
+// time of scene_file_load once the cache is fresh
+void bench_scene_file( void );
+
+// Load time, BVH build time, memory per triangle and ray throughput of a 2M triangle mesh read from an OBJ file, and
+// the rays that leak through the edges and vertices of a closed mesh with the watertight test and with Möller-Trumbore
+void bench_mesh( void );
+
+// Memory, top-level build time, ray throughput and single-threaded render time of 10k instances of one triangle
+// mesh, against the same scene with a world-space copy of the mesh per placement
+void bench_instance( void );
+
+// Peak memory, render time and total time of a 4K render that keeps the whole 8-bit frame and encodes it after the
+// render, against one rendered band by band with each band encoded and written while the next renders
+void bench_stream( void );
+
+// Time to grade a new exposure from a PFM of the linear radiance against rendering the frame again, and the
+// exactness of the PFM round trip and of tone mapping at exposure 0 against the renderer's own output
+void bench_hdr( void );
+
+// Time of the 8-bit conversion of an 8K film: the per-pixel write_color_to_buffer path against the post-process
+// stage per kernel, on one thread and on all of them, per tone curve; and how far the SIMD kernels are from scalar
+void bench_post( void );
+
+// Render time and RMSE against a 1024 spp reference of the book scene at 4 to 256 spp, raw and denoised: the time
+// of the feature buffers and of the denoiser, and the raw render time that reaches the same RMSE
+void bench_denoise( void );
+
+// Render time and RMSE against a 1024 spp reference of the book scene at 1 to 256 spp for every sampler, and the
+// random sampler's sample count that reaches the same RMSE
+void bench_sampler( void );
+
+#endif // BENCHMARK_H
@@ -0,0 +1,102 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "ray.h"
+#include "vec3.h"
+#include <math.h>
+#include <stdbool.h>
+
+// Axis-aligned bounding box
+typedef struct
+{
+    point3 min, max;
+} aabb;
+
+// Returns a box that contains nothing; the identity of aabb_union
+static inline aabb
+aabb_empty( void )
+{
+    return (aabb) { { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+}
+
+// Returns the smallest box containing both points, given in any order
+static inline aabb
+aabb_from_points( point3 a, point3 b )
+{
+    return (aabb) { vec3_min( a, b ), vec3_max( a, b ) };
+}
+
+// Returns the smallest box containing both boxes
+static inline aabb
+aabb_union( aabb a, aabb b )
+{
+    return (aabb) { vec3_min( a.min, b.min ), vec3_max( a.max, b.max ) };
+}
+
+// Returns the smallest box containing the box and the point
+static inline aabb
+aabb_union_point( aabb a, point3 p )
+{
+    return (aabb) { vec3_min( a.min, p ), vec3_max( a.max, p ) };
+}
+
+static inline bool
+aabb_is_empty( aabb box )
+{
+    return box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+}
+
+static inline point3
+aabb_centroid( aabb box )
+{
+    return vec3_mul( vec3_add( box.min, box.max ), 0.5 );
+}
+
+static inline vec3
+aabb_extent( aabb box )
+{
+    return vec3_sub( box.max, box.min );
+}
+
+// Surface area of the box, the cost measure of the surface area heuristic
+static inline double
+aabb_surface_area( aabb box )
+{
+    if( aabb_is_empty( box ) ) return 0.0;
+    vec3 e = aabb_extent( box );
+    return 2.0 * ( e.x * e.y + e.y * e.z + e.z * e.x );
+}
+
+// Returns the index (0=x, 1=y, 2=z) of the longest side of the box
+static inline int
+aabb_longest_axis( aabb box )
+{
+    vec3 e = aabb_extent( box );
+    if( e.x > e.y ) return ( e.x > e.z ) ? 0 : 2;
+    return ( e.y > e.z ) ? 1 : 2;
+}
+
+// Slab test: true if the ray overlaps the box anywhere inside (ray_tmin, ray_tmax)
+static inline bool
+aabb_hit( const aabb * box, const ray * r, rt_real ray_tmin, rt_real ray_tmax )
+{
+    for( int axis = 0; axis < 3; ++axis )
+        {
+            rt_real inv_d = RT_REAL( 1 ) / vec3_get( r->dir, axis );
+            rt_real t0    = ( vec3_get( box->min, axis ) - vec3_get( r->orig, axis ) ) * inv_d;
+            rt_real t1    = ( vec3_get( box->max, axis ) - vec3_get( r->orig, axis ) ) * inv_d;
+            if( inv_d < RT_REAL( 0 ) )
+                {
+                    rt_real tmp = t0;
+                    t0          = t1;
+                    t1          = tmp;
+                }
+
+            ray_tmin = ( t0 > ray_tmin ) ? t0 : ray_tmin;
+            ray_tmax = ( t1 < ray_tmax ) ? t1 : ray_tmax;
+            if( ray_tmax <= ray_tmin ) return false;
+        }
+    return true;
+}
+
+#endif // AABB_H
@@ -0,0 +1,27 @@
+#ifndef AOV_IMAGE_H
+#define AOV_IMAGE_H
+
+#include <stdbool.h>
+
+// Feature buffers ("arbitrary output variables") of an image: what the primary rays of every pixel first hit,
+// averaged over the pixel's samples. They are nearly noise-free at any sample count and mark the edges a denoiser
+// must keep (see denoise.h). Filled by camera_render_aov.
+typedef struct aov_image
+{
+    int     width;
+    int     height;
+    float * albedo; // 3 floats per pixel: reflectance of the surface hit; white where the ray escapes
+    float * normal; // 3 floats per pixel: world-space normal of the surface hit, facing the ray; zero where it escapes
+    float * depth;  // 1 float per pixel: distance from the ray's origin to the surface hit; zero where it escapes
+} aov_image;
+
+// Allocates cleared buffers for width x height pixels.
+//
+// Returns:
+//   true on success, false if memory ran out (reported; the buffers are then left empty)
+bool aov_image_init( aov_image * aov, int width, int height );
+
+// Frees the buffers
+void aov_image_free( aov_image * aov );
+
+#endif // AOV_IMAGE_H
@@ -0,0 +1,45 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Alignment of every allocation, enough for any scalar type and SSE vectors
+#define ARENA_ALIGNMENT 16
+
+// Default size of the blocks an arena carves allocations from
+#define ARENA_DEFAULT_BLOCK_SIZE ( (size_t)1 << 20 )
+
+struct arena_block;
+
+// Bump allocator for objects that live and die together, such as the primitives of a scene.
+// Allocations are placed back to back in large blocks, so objects created in sequence sit next to each other in
+// memory, and the whole arena is released at once by arena_free. Objects are never freed individually, which also
+// makes it safe for several objects to point to the same one.
+typedef struct
+{
+    struct arena_block * blocks;     // Most recently allocated block first
+    size_t               block_size; // Size of new blocks
+    size_t               used;       // Bytes handed out, padding included
+    size_t               reserved;   // Bytes of all blocks
+} arena;
+
+// Initializes an empty arena. No memory is reserved until the first allocation.
+//
+// Parameters:
+//   block_size: Size of the blocks to allocate; 0 selects ARENA_DEFAULT_BLOCK_SIZE
+void arena_init( arena * a, size_t block_size );
+
+// Returns `size` bytes aligned to ARENA_ALIGNMENT, valid until arena_free. Requests larger than the block size get a
+// block of their own.
+//
+// Returns:
+//   The memory, uninitialized, or NULL if it could not be allocated
+void * arena_alloc( arena * a, size_t size );
+
+// Releases every allocation of the arena at once and leaves it empty, ready for reuse
+void arena_free( arena * a );
+
+// Allocates an uninitialized object of the given type from arena `a`
+#define ARENA_NEW( a, type ) ( (type *)arena_alloc( ( a ), sizeof( type ) ) )
+
+#endif // ARENA_H
@@ -0,0 +1,32 @@
+#ifndef BAND_WRITER_H
+#define BAND_WRITER_H
+
+#include "image_encoder.h" /* image_encoder */
+#include <stdbool.h>
+
+// Encodes bands of finished image rows on a background thread, so a band is compressed and written to disk while
+// the next one renders. Bands live in a fixed pool: memory stays at `band_count` bands whatever the image height,
+// and a renderer that gets ahead of the disk waits in band_writer_acquire for a band to come free.
+typedef struct band_writer band_writer;
+
+// Starts the writer thread for `encoder`, with a pool of `band_count` bands of `band_rows` rows of `width` pixels.
+// Without a thread, bands are encoded as they are submitted instead (reported as a warning).
+//
+// Returns:
+//   The writer, or NULL if memory ran out (reported)
+band_writer * band_writer_start( image_encoder * encoder, int width, int band_rows, int band_count );
+
+// Returns a band to render into, waiting for the writer to finish one if none is free
+unsigned char * band_writer_acquire( band_writer * writer );
+
+// Queues the first `rows` rows of `band`, from band_writer_acquire, as the next rows of the image. The band returns
+// to the pool once written.
+void band_writer_submit( band_writer * writer, unsigned char * band, int rows );
+
+// Waits for every queued band to be written, stops the thread and frees the writer. The encoder stays open.
+//
+// Returns:
+//   true if every band was encoded and written
+bool band_writer_finish( band_writer * writer );
+
+#endif // BAND_WRITER_H
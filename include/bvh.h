@@ -0,0 +1,33 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "hittable.h"      /* hittable, hit_record */
+#include "hittable_list.h" /* hittable_list */
+
+// Interior node of a bounding volume hierarchy.
+// Children are either further bvh_node instances or the primitives themselves.
+typedef struct
+{
+    hittable   base;  // base.hit points to bvh_node_hit, base.bbox encloses both children
+    hittable * left;  // Never NULL
+    hittable * right; // NULL only for a single-object tree
+} bvh_node;
+
+// Builds a BVH over the objects of `list`, splitting each node with the binned surface area heuristic. Deep nodes
+// are halved by count instead, so the tree never outgrows the stack of bvh_flat_build's traversal.
+// The tree only references the objects: the list keeps ownership and must outlive the tree.
+//
+// Returns:
+//   The root node, or NULL if the list is empty or memory ran out
+hittable * bvh_node_build( const hittable_list * list );
+
+// Frees every interior node of the tree rooted at `root`. Primitives are left untouched.
+void bvh_node_free( hittable * root );
+
+// Returns the number of interior nodes of the tree rooted at `root`
+size_t bvh_node_count( const hittable * root );
+
+// Tests the node's bounds first, then descends into both children
+bool bvh_node_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec );
+
+#endif // BVH_H
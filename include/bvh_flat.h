@@ -0,0 +1,118 @@
+#ifndef BVH_FLAT_H
+#define BVH_FLAT_H
+
+#include "hittable.h"   /* hittable, hit_record */
+#include "ray_packet.h" /* ray_packet */
+#include <stddef.h>
+#include <stdint.h>
+
+// Maximum depth of a flattened tree, i.e. the size of the fixed traversal stack
+#define BVH_FLAT_STACK_SIZE 64
+
+// A node of the flattened hierarchy: 32 bytes, two per cache line.
+// Bounds are stored in single precision, rounded outwards so they still enclose the geometry when rt_real is double.
+typedef struct
+{
+    float    min[3];
+    float    max[3];
+    uint32_t offset; // Interior: index of the second child (the first one follows the node). Leaf: first primitive
+    uint32_t count;  // Number of primitives in a leaf; 0 marks an interior node
+} bvh_flat_node;
+
+// Factor applied to the exit distance of a slab test: 1 + 2 gamma(3) of Ize's "Robust BVH Ray Traversal" (JCGT
+// 2013), which covers the rounding of the distance computation, so a ray that touches a box is never rejected. The
+// watertight triangle test of triangle_mesh depends on it for rays through shared edges and vertices.
+#ifdef RT_USE_FLOAT
+#    define BVH_FLAT_EXIT_SCALE 1.0000004f
+#else
+#    define BVH_FLAT_EXIT_SCALE 1.0000000000000009
+#endif
+
+// Ray data reused by every slab test of a traversal
+typedef struct
+{
+    rt_real origin[3];
+    rt_real inv_dir[3];
+} bvh_flat_ray;
+
+static inline void
+bvh_flat_ray_init( bvh_flat_ray * fr, const ray * r )
+{
+    fr->origin[0]  = r->orig.x;
+    fr->origin[1]  = r->orig.y;
+    fr->origin[2]  = r->orig.z;
+    fr->inv_dir[0] = RT_REAL( 1 ) / r->dir.x;
+    fr->inv_dir[1] = RT_REAL( 1 ) / r->dir.y;
+    fr->inv_dir[2] = RT_REAL( 1 ) / r->dir.z;
+}
+
+// Slab test against a node. On a hit, `t_entry` receives the distance at which the ray enters the box.
+static inline bool
+bvh_flat_node_hit( const bvh_flat_node * node, const bvh_flat_ray * fr, rt_real ray_tmin, rt_real ray_tmax,
+                   rt_real * t_entry )
+{
+    for( int axis = 0; axis < 3; ++axis )
+        {
+            rt_real t0 = ( node->min[axis] - fr->origin[axis] ) * fr->inv_dir[axis];
+            rt_real t1 = ( node->max[axis] - fr->origin[axis] ) * fr->inv_dir[axis];
+            if( fr->inv_dir[axis] < RT_REAL( 0 ) )
+                {
+                    rt_real tmp = t0;
+                    t0          = t1;
+                    t1          = tmp;
+                }
+            t1 *= BVH_FLAT_EXIT_SCALE;
+
+            ray_tmin = ( t0 > ray_tmin ) ? t0 : ray_tmin;
+            ray_tmax = ( t1 < ray_tmax ) ? t1 : ray_tmax;
+            if( ray_tmax <= ray_tmin ) return false;
+        }
+
+    *t_entry = ray_tmin;
+    return true;
+}
+
+// Sets the bounds of `node` to `box`, rounded outwards to single precision
+void bvh_flat_node_set_bounds( bvh_flat_node * node, aabb box );
+
+// Compact, read-only BVH: nodes stored contiguously in depth-first order, leaves referencing ranges of a
+// primitive array. Traversal walks the array with a small fixed stack instead of chasing node pointers.
+typedef struct
+{
+    hittable        base;            // base.hit points to bvh_flat_hit
+    bvh_flat_node * nodes;           // Depth-first node array, 32-byte aligned
+    size_t          node_count;      // Number of entries in `nodes`
+    hittable **     primitives;      // Primitives in leaf order
+    size_t          primitive_count; // Number of entries in `primitives`
+} bvh_flat;
+
+// Flattens the tree rooted at `root` (as returned by bvh_node_build). Interior nodes whose children are both
+// primitives become single leaves. The flat copy only references the primitives and does not need the source
+// tree afterwards, which may be freed with bvh_node_free. A NULL `root`, the tree of an empty list, gives an empty
+// hierarchy that no ray hits.
+//
+// Returns:
+//   The flattened hierarchy, or NULL if memory ran out or the tree is deeper than BVH_FLAT_STACK_SIZE
+bvh_flat * bvh_flat_build( const hittable * root );
+
+// Frees the node and primitive arrays. Primitives are left untouched.
+void bvh_flat_free( bvh_flat * bvh );
+
+// Returns the number of bytes held by the flattened hierarchy
+size_t bvh_flat_memory( const bvh_flat * bvh );
+
+// Closest-hit traversal, visiting the nearer child first and skipping stacked subtrees beyond the closest hit
+bool bvh_flat_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec );
+
+// Closest-hit traversal of a whole packet. The packet walks the tree together: a node is skipped when interval
+// arithmetic over every ray's origin and direction proves no ray can enter it, and otherwise only the rays from
+// the first one that does enter it are tested further. Each ray is searched in (ray_tmin, packet->tmax[i]) and its
+// result lands in packet->hit[i] / packet->rec[i], identical to what bvh_flat_hit returns for it, except where
+// primitives meet: the two traversals visit them in different orders and may keep different ones of the primitives
+// the ray hits within rounding of the same distance.
+//
+// Returns:
+//   The number of rays of the packet that hit something
+int bvh_flat_hit_packet( const bvh_flat * bvh, ray_packet * packet, rt_real ray_tmin );
+
+#endif // BVH_FLAT_H
@@ -1,10 +1,51 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
-#include "ray.h" /* ray struct, ray_create, ray_origin, ray_direction, ray_at */
+#include "color.h"     /* color */
+#include "ray.h"       /* ray struct, ray_create, ray_origin, ray_direction, ray_at */
+#include "rng.h"       /* rng, rng_seed */
+#include "rtweekend.h" /* random_double */
+#include "sampler.h"   /* sampler_type, sampler_start */
+#include <stdbool.h>
+#include <stdint.h>
 
-// Forward declaration
+// Forward declarations
+struct aov_image;
 struct hittable;
+struct film;
+struct material_table;
+
+// Closest distance at which a ray may hit a surface, to avoid shadow acne. Single precision needs a wider margin: with
+// 0.001, rays leaving the book scene's radius 1000 ground sphere re-hit it often enough to double the difference
+// from the double-precision image (see the `precision` benchmark).
+#ifdef RT_USE_FLOAT
+#    define CAMERA_RAY_T_MIN 0.01f
+#else
+#    define CAMERA_RAY_T_MIN 0.001
+#endif
+
+// Largest packet edge that fits a ray_packet
+#define CAMERA_MAX_PACKET_SIZE 8
+
+// Most samples per pixel camera_render_aov traces: the features of a pixel hardly change past a few samples
+#define CAMERA_AOV_SAMPLES 16
+
+// Path integrators camera_render can use
+typedef enum
+{
+    CAMERA_INTEGRATOR_RECURSIVE, // One path at a time, recursing once per bounce
+    CAMERA_INTEGRATOR_WAVEFRONT, // Batches of paths advanced stage by stage, see wavefront.h
+    CAMERA_INTEGRATOR_COUNT
+} camera_integrator;
+
+// Returns the name of an integrator as the command line and scene files take it, or "unknown"
+const char * camera_integrator_name( camera_integrator integrator );
+
+// Parses `text` as an integrator name.
+//
+// Returns:
+//   true if `text` names an integrator, stored in `*integrator`
+bool camera_integrator_parse( const char * text, camera_integrator * integrator );
 
 typedef struct
 {
@@ -14,6 +55,7 @@ typedef struct
     vec3   world_up; // Camera-relative "up" direction
 
     // --- Camera optics ---
+    // Kept as passed to camera_init, in double precision in every build, so the view can be set up again unchanged
     double vertical_fov_deg; // Vertical field-of-view in degrees
     double aspect_ratio;     // Ratio of image width to height
     double aperture;         // Lens aperture diameter for depth of field
@@ -23,14 +65,32 @@ typedef struct
     int image_width;
     int samples_per_pixel;
     int max_depth;
+    int roulette_min_depth; // Bounces every path takes before Russian roulette may end it; <= 0 disables roulette
+
+    // --- Parallelism ---
+    int      thread_count; // Render worker threads; <= 0 uses every hardware thread
+    int      tile_size;    // Edge length in pixels of the square tiles handed to the workers
+    uint64_t seed;         // Base seed of the per-sample generators. Output is identical for a seed at any thread count
+    int      packet_size;  // Edge length of the primary-ray packets (up to 8); <= 1, the default, traces single rays
+
+    // --- Integrator ---
+    camera_integrator integrator; // Path integrator used by camera_render and camera_render_pass
+    sampler_type      sampler;    // Sequence the samples of a pixel draw their numbers from, see sampler.h
+
+    // --- Scene ---
+    const struct material_table * materials; // Materials the world's objects refer to; must be set before rendering
+
+    // --- Adaptive sampling ---
+    double adaptive_threshold;   // Target 95% confidence half-width of a pixel's displayed value; <= 0 disables
+    int    adaptive_min_samples; // Samples per adaptive pass, taken before every convergence test
 
     // --- Calculated ---
-    vec3   right, up, forward; // Orthonormal basis for camera orientation (right, up, -direction)
-    vec3   viewport_width;     // Horizontal extent of viewport in world space
-    vec3   viewport_height;    // Vertical extent of viewport in world space
-    point3 viewport_origin;    // Top-left corner of viewport in world space
-    double lens_radius;        // Half of aperture (for sampling)
-    int    image_height;       // Calculated image height
+    vec3    right, up, forward; // Orthonormal basis for camera orientation (right, up, -direction)
+    vec3    viewport_width;     // Horizontal extent of viewport in world space
+    vec3    viewport_height;    // Vertical extent of viewport in world space
+    point3  viewport_origin;    // Top-left corner of viewport in world space
+    rt_real lens_radius;        // Half of aperture (for sampling)
+    int     image_height;       // Calculated image height
 
 } camera;
 
@@ -51,11 +111,123 @@ void camera_init( camera * cam, double aspect_ratio, double vertical_fov_deg, po
                   // Rendering
                   int image_width, int samples_per_pixel, int max_depth );
 
-// Renders the entire scene to the provided image data buffer
+// Renders the entire scene to the provided image data buffer.
+// The image is split into tiles of `tile_size` pixels that are rendered by `thread_count` work-stealing workers.
+// With the recursive integrator, when `packet_size` > 1 and `world` is a bvh_flat, primary rays are traced in square
+// packets; bounces are always traced one ray at a time. Every integrator and packet size produces the same image.
+// Samples accumulate into a film that is converted through the post-process stage at its default settings, so the
+// image is the one camera_render_pass and film_resolve produce from the same samples.
+//
+// When `adaptive_threshold` > 0, every pixel is sampled in passes of `adaptive_min_samples` and stops once the 95%
+// confidence interval of its displayed (sRGB-encoded) luminance is within +-`adaptive_threshold`, or after
+// `samples_per_pixel` samples.
 void camera_render( const camera * cam, const struct hittable * world, unsigned char * image_data );
 
+// Same as camera_render, and stores the number of samples taken by each pixel in `sample_counts`
+// (image_width * image_height entries, row by row), unless it is NULL.
+void camera_render_counted( const camera * cam, const struct hittable * world, unsigned char * image_data,
+                            int * sample_counts );
+
+// Takes every remaining sample of every pixel into `f`, a film of the camera's image size, reporting progress on
+// stderr. Into a cleared film, this takes the samples camera_render takes, for film_resolve to convert at any
+// post-process settings.
+//
+// Returns:
+//   false if the film does not match the image or the render could not run (reported)
+bool camera_render_film( const camera * cam, const struct hittable * world, struct film * f );
+
+// Renders only the image rows [first_row, end_row), as camera_render does, into `image_data`, which holds just those
+// rows. Tiles are cut at the band's edges, and the band accumulates into a film of just its rows; every pixel still
+// comes out as in a full render. Rendering an image a band at a time lets each band be written out while the next
+// renders (see band_writer.h).
+//
+// Returns:
+//   false if the rows are out of the image or the render could not start (reported)
+bool camera_render_rows( const camera * cam, const struct hittable * world, unsigned char * image_data, int first_row,
+                         int end_row );
+
+// Same as camera_render_rows, but stores the mean linear radiance of every pixel into `radiance`, 3 floats per pixel,
+// for the post-process stage to convert (see postprocess.h) instead of writing 8-bit pixels.
+bool camera_render_rows_hdr( const camera * cam, const struct hittable * world, float * radiance, int first_row,
+                             int end_row );
+
+// Renders one progressive pass into `f`, a film of the camera's image size. Every pixel takes up to `pass_samples`
+// more samples, continuing from the samples it already holds, until it holds `samples_per_pixel`. With
+// `adaptive_threshold` > 0, a pass stops each pixel at the next multiple of `adaptive_min_samples`, where it is
+// tested as camera_render tests it, and pixels that have converged are skipped. Sample s of a pixel is the same
+// sample camera_render takes, so any sequence of passes accumulates the same samples.
+//
+// Returns:
+//   The number of samples taken: 0 once every pixel is done, or on failure
+uint64_t camera_render_pass( const camera * cam, const struct hittable * world, struct film * f, int pass_samples );
+
+// Fills `aov`, feature buffers of the camera's image size, from the primary rays of the first
+// min(samples_per_pixel, CAMERA_AOV_SAMPLES) samples of every pixel, the rays camera_render and camera_render_pass
+// start their paths with. Rays are followed through mirrors and glass, up to a few bounces, to the first surface
+// that scatters diffusely, whose features are recorded tinted by the specular bounces on the way. No light is
+// gathered, so this costs a fraction of a sample per pixel, works with any integrator and, for a progressive render,
+// at any point. Tiles are split over `thread_count` workers as in camera_render.
+//
+// Returns:
+//   false if the buffers do not match the image or the workers could not be started (reported)
+bool camera_render_aov( const camera * cam, const struct hittable * world, struct aov_image * aov );
+
+// Fingerprints every camera setting that decides which sample values a pixel gets: view, optics, image size,
+// depth, Russian roulette, adaptive threshold, sampler and seed. `samples_per_pixel` is left out so a render can be
+// continued to more samples, and so are the settings that only change how the same samples are computed (threads,
+// tiles, packets, integrator). The strata of SAMPLER_STRATIFIED follow `samples_per_pixel`, so a stratified render
+// continued to more samples stays unbiased but is no longer stratified across the two runs. The materials belong to
+// the scene, which scene_hash covers.
+uint64_t camera_hash( const camera * cam );
+
 // Generates a ray from the camera through a point (s, t) on the image plane.
 // s and t are normalized pixel coordinates (0 to 1, where (0,0) is top-left).
-ray camera_get_ray( const camera * cam, double s, double t );
+// The lens sample is drawn from `gen`.
+ray camera_get_ray( const camera * cam, rt_real s, rt_real t, rng * gen );
+
+// Seeds `gen` for sample `sample` of pixel (i, j).
+// Every pixel owns its own stream and every sample its own starting state, both derived from the camera seed only,
+// so a sample draws the same numbers whatever the tiling, thread count or order samples are taken in. With a sampler
+// other than SAMPLER_RANDOM the sample then draws from point `sample` of the pixel's sequence.
+static inline void
+camera_seed_sample( const camera * cam, rng * gen, int i, int j, int sample )
+{
+    uint64_t pixel = (uint64_t)j * (uint64_t)cam->image_width + (uint64_t)i;
+    rng_seed( gen, rng_mix64( cam->seed ) + (uint64_t)sample, pixel );
+    sampler_start( gen, cam->sampler, cam->seed, i, j, pixel, sample, cam->samples_per_pixel );
+}
+
+// Seeds `gen` for sample `sample` of pixel (i, j) and generates the sample's primary ray.
+// `gen` then continues with the random numbers of the rest of the path.
+static inline ray
+camera_sample_ray( const camera * cam, rng * gen, int i, int j, int sample )
+{
+    camera_seed_sample( cam, gen, i, j, sample );
+
+    rt_real u = (rt_real)( ( i + random_double( gen ) ) / ( cam->image_width - 1 ) );
+    rt_real v = (rt_real)( ( j + random_double( gen ) ) / ( cam->image_height - 1 ) );
+    return camera_get_ray( cam, u, v, gen );
+}
+
+// Returns the radiance of the sky seen along `r`
+color camera_background( const ray * r );
+
+// Russian roulette after a path's `bounces`-th scatter, given the path's `throughput` (the product of every
+// attenuation so far). Past `roulette_min_depth` bounces, the path survives with probability equal to its largest
+// throughput component, capped at 1; a survivor's contribution must then be divided by that probability, which
+// keeps the estimate unbiased while paths that can no longer contribute much stop early.
+//
+// Returns:
+//   0 if the path is terminated, otherwise the survival probability to divide by (1 when roulette did not apply)
+static inline double
+camera_roulette( const camera * cam, int bounces, color throughput, rng * gen )
+{
+    if( cam->roulette_min_depth <= 0 || bounces < cam->roulette_min_depth ) return 1.0;
+
+    double survival = ( throughput.x > throughput.y ) ? throughput.x : throughput.y;
+    survival        = ( throughput.z > survival ) ? throughput.z : survival;
+    if( survival >= 1.0 ) return 1.0;
+    return ( random_double( gen ) < survival ) ? survival : 0.0;
+}
 
 #endif // CAMERA_H
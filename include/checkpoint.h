@@ -0,0 +1,41 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "film.h" /* film */
+#include <stdbool.h>
+#include <stdint.h>
+
+// Identity of the render a checkpoint belongs to
+typedef struct
+{
+    uint64_t seed;        // Camera seed, needed to rebuild a scene generated from it before resuming
+    uint64_t camera_hash; // camera_hash of the render's camera
+    uint64_t scene_hash;  // scene_hash of the render's world
+} checkpoint_info;
+
+// Saves the state of a progressive render: `info` and the film's radiance sums, squared luminance sums and
+// per-pixel sample counts. Samples are seeded from the camera seed, pixel and sample index only, so the sample
+// counts are all the generator state there is: resumed passes draw exactly the samples the interrupted render
+// would have drawn next, and converge to the same film.
+//
+// The file is written next to `path` first and then renamed over it, so a render killed mid-save keeps its
+// previous checkpoint. Data is stored in host byte order.
+//
+// Returns:
+//   true on success, false if the file could not be written
+bool checkpoint_save( const char * path, const film * f, const checkpoint_info * info );
+
+// Reads the header of the checkpoint at `path` into `info`, without its film.
+//
+// Returns:
+//   true if a valid checkpoint was found; false if there is none (silently) or it is not a checkpoint (with an error)
+bool checkpoint_peek( const char * path, checkpoint_info * info );
+
+// Loads the checkpoint at `path` into `f`, which must already have the checkpoint's image size, after checking that
+// it belongs to the render described by `expected`.
+//
+// Returns:
+//   true on success; false if the file cannot be read or belongs to another render (`f` is then left cleared)
+bool checkpoint_load( const char * path, film * f, const checkpoint_info * expected );
+
+#endif // CHECKPOINT_H
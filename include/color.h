@@ -42,6 +42,13 @@ linear_to_gamma( double linear_component )
     return 0;
 }
 
+// Relative luminance of a linear color (Rec. 709 weights)
+static inline double
+color_luminance( const color c )
+{
+    return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+}
+
 static inline void
 write_color_to_buffer( unsigned char * pBuffer, const color pixel_c, int samples_per_pixel )
 {
@@ -0,0 +1,39 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "aov_image.h" /* aov_image */
+#include "hdr_image.h" /* hdr_image */
+#include <stdbool.h>
+
+// Settings of the denoiser: a joint bilateral filter guided by the feature buffers that, instead of averaging the
+// neighbours it weighs, fits them a local linear model of the radiance against the features (weighted first-order
+// regression, as in NFOR by Bitterli et al. 2016)
+typedef struct
+{
+    int    radius;       // Half the edge of the window a pixel's model is fitted over, up to 8: 3 fits 7x7 pixels
+    double sigma_albedo; // Albedo difference at which a neighbour's weight has fallen to 1 / sqrt(e)
+    double sigma_normal; // The same for the difference of the normals
+    double sigma_depth;  // The same for the difference of the depths, relative to the pixel's depth
+    int    thread_count; // Worker threads; <= 0 uses every hardware thread
+} denoise_settings;
+
+// Sets the defaults: radius 3, sigma_albedo 0.5, sigma_normal 1, sigma_depth 0.1, every hardware thread
+void denoise_settings_init( denoise_settings * settings );
+
+// Denoises `input`, the mean linear radiance of a render, into `output`, another image of its size, guided by `aov`,
+// the render camera's feature buffers (see camera_render_aov).
+//
+// Every pixel weighs the neighbours in its window by distance and by how far their albedo, normal and depth are from
+// its own; neighbours across an object's silhouette get no weight. It then fits the weighted neighbours' radiance
+// as a linear function of the features and of the position, and that model predicts the radiance of every
+// neighbour. Each output pixel averages the predictions of all windows covering it. Shading that follows the
+// normal, texture that follows the albedo and pixels that mix two surfaces are kept by the fit, while the noise
+// averages out. Windows are fitted in bands of rows by `thread_count` workers; if they cannot start, the calling
+// thread fits them. `settings` may be NULL for the defaults.
+//
+// Returns:
+//   false if the sizes differ or memory ran out (reported)
+bool denoise_image( const denoise_settings * settings, const hdr_image * input, const aov_image * aov,
+                    hdr_image * output );
+
+#endif // DENOISE_H
@@ -6,11 +6,11 @@
 typedef struct
 {
     material base;
-    double   ir; // Index of Refraction
+    rt_real  ir; // Index of Refraction
 } dielectric;
 
-void dielectric_init( dielectric * mat, double index_of_refraction );
+void dielectric_init( dielectric * mat, rt_real index_of_refraction );
 bool dielectric_scatter( const material * material, const ray * r_in, const struct hit_record_s * rec,
-                         color * attenuation, ray * scattered );
+                         color * attenuation, ray * scattered, rng * gen );
 
 #endif // DIELECTRIC_H
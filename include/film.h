@@ -0,0 +1,59 @@
+#ifndef FILM_H
+#define FILM_H
+
+#include "color.h"       /* color */
+#include "hdr_image.h"   /* hdr_image */
+#include "postprocess.h" /* postprocess_settings */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Accumulation buffer of a progressive render.
+// Every pixel keeps the sum of the linear radiance of its samples, so rendering can stop and continue at any sample
+// count and the image can be resolved at any time.
+typedef struct film
+{
+    int        width;
+    int        height;
+    float *    radiance; // Linear RGB radiance sums, 3 floats per pixel, row by row
+    float *    lum_sq;   // Sums of the squared luminance of every sample, used by adaptive sampling
+    uint32_t * samples;  // Samples accumulated into each pixel
+} film;
+
+// Allocates a cleared film of width x height pixels.
+//
+// Returns:
+//   true on success, false if memory ran out (the film is then left empty)
+bool film_init( film * f, int width, int height );
+
+// Frees the buffers of a film
+void film_free( film * f );
+
+// Discards every sample
+void film_clear( film * f );
+
+// Returns the total number of samples accumulated into the film
+uint64_t film_sample_count( const film * f );
+
+// Converts the film to 8-bit sRGB through the post-process stage (`settings`, NULL for the defaults), each pixel
+// averaged over its own sample count. Pixels without samples come out black.
+void film_resolve( const film * f, const postprocess_settings * settings, unsigned char * image_data );
+
+// Converts the film to the mean linear radiance of every pixel, without exposure, tone curve or transfer function,
+// into `image` of the film's size. Pixels without samples come out black. The means are those film_resolve converts,
+// so an image graded from them at the same settings comes out identical.
+void film_resolve_hdr( const film * f, hdr_image * image );
+
+// Adds the `count` samples summed in `sum` (with squared luminances summed in `lum_sq`) to pixel (i, j)
+static inline void
+film_add( film * f, int i, int j, color sum, double lum_sq, int count )
+{
+    const size_t p          = (size_t)j * f->width + i;
+    f->radiance[3 * p]     += (float)sum.x;
+    f->radiance[3 * p + 1] += (float)sum.y;
+    f->radiance[3 * p + 2] += (float)sum.z;
+    f->lum_sq[p]           += (float)lum_sq;
+    f->samples[p]          += (uint32_t)count;
+}
+
+#endif // FILM_H
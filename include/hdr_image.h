@@ -0,0 +1,42 @@
+#ifndef HDR_IMAGE_H
+#define HDR_IMAGE_H
+
+#include "postprocess.h" /* postprocess_settings */
+#include <stdbool.h>
+
+// Linear RGB image in floating point: the mean radiance of every pixel, before exposure, clamping or gamma. Kept on
+// disk as a PFM, it can be graded into any number of 8-bit images without rendering again.
+typedef struct
+{
+    int     width;
+    int     height;
+    float * pixels; // 3 floats per pixel, row by row from the top
+} hdr_image;
+
+// Allocates an image of width x height black pixels.
+//
+// Returns:
+//   true on success, false if memory ran out (reported; the image is then left empty)
+bool hdr_image_init( hdr_image * image, int width, int height );
+
+// Frees the pixels of an image
+void hdr_image_free( hdr_image * image );
+
+// Writes the image as a color PFM (Portable Float Map): a short text header, then 32-bit floats in host byte order,
+// which the sign of the header's scale records, rows from the bottom up.
+//
+// Returns:
+//   true on success, false if the file could not be written (reported)
+bool hdr_image_write_pfm( const hdr_image * image, const char * path );
+
+// Reads a color PFM in either byte order into `image`, which is allocated to the file's size.
+//
+// Returns:
+//   true on success, false if the file cannot be read or is not a color PFM (reported)
+bool hdr_image_read_pfm( hdr_image * image, const char * path );
+
+// Grades the image into 8-bit sRGB through the post-process stage (`settings`, NULL for the defaults). At the
+// settings of a render, this reproduces the render's own output.
+void hdr_image_tonemap( const hdr_image * image, const postprocess_settings * settings, unsigned char * image_data );
+
+#endif // HDR_IMAGE_H
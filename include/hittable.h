@@ -1,6 +1,7 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
+#include "aabb.h"
 #include "material.h"
 
 // Forward declaration
@@ -9,22 +10,23 @@ struct hittable_s;
 // Store intersection information of a ray-object
 typedef struct hit_record_s
 {
-    point3     p;          // Intersection point
-    vec3       normal;     // Surface normal, oriented against the incident ray
-    double     t;          // Ray parameter t at intersection
-    material * mat_ptr;    // Pointer to the material of the hit object
-    bool       front_face; // True if ray hits the front face, false if it hits the back face
+    point3      p;           // Intersection point
+    vec3        normal;      // Surface normal, oriented against the incident ray
+    rt_real     t;           // Ray parameter t at intersection
+    material_id material_id; // Material of the hit object, in the scene's material_table
+    bool        front_face;  // True if ray hits the front face, false if it hits the back face
 } hit_record;
 
 // Hit function pointer
-typedef bool ( *hit_fn )( const struct hittable_s * object, const ray * r, double ray_tmin, double ray_tmax,
+typedef bool ( *hit_fn )( const struct hittable_s * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax,
                           hit_record * rec );
 
 // The "hittable" interface struct
 typedef struct hittable_s
 {
-    hit_fn     hit;
-    material * mat_ptr; // Pointer to the material of the hit object
+    hit_fn      hit;
+    material_id material_id; // Material of the object, in the scene's material_table
+    aabb        bbox;        // World-space bounds of the object, filled in by its init function
 } hittable;
 
 // Set the hit record's normal vector and front_face flag
@@ -32,7 +34,7 @@ static inline void
 hit_record_set_face_normal( hit_record * rec, const ray * r, const vec3 * outward_normal )
 {
     // Determine if the ray is outside (hitting the front face) or inside (hitting a back face)
-    rec->front_face = ( 0.0 > vec3_dot( ray_direction( r ), *outward_normal ) );
+    rec->front_face = ( RT_REAL( 0 ) > vec3_dot( ray_direction( r ), *outward_normal ) );
     rec->normal     = *outward_normal;
     if( false == rec->front_face )
         {
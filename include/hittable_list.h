@@ -22,11 +22,11 @@ void hittable_list_init( hittable_list * list, int initial_capacity );
 bool hittable_list_add( hittable_list * list, hittable * object );
 
 // Clears the list: frees the internal array of pointers.
-// WARN: Objects must be freed independently
+// WARN: Objects and their materials are not freed; they belong to whoever allocated them (see arena.h)
 void hittable_list_clear( hittable_list * list );
 
 // Iterates through all objects in the list and checks for the closest hit
-bool hittable_list_hit( const hittable * list_hittable, const ray * r, double ray_tmin, double ray_tmax,
+bool hittable_list_hit( const hittable * list_hittable, const ray * r, rt_real ray_tmin, rt_real ray_tmax,
                         hit_record * rec );
 
 #endif // !HITTABLE_LIST_H
@@ -0,0 +1,38 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include "rtweekend.h" /* RT_IMAGE_DATA_CHANNELS */
+#include <stdbool.h>
+
+// Formats image_encoder writes
+typedef enum
+{
+    IMAGE_ENCODER_PNG, // 8-bit RGB, deflate-compressed with fixed Huffman codes
+    IMAGE_ENCODER_PPM  // Binary 8-bit RGB (P6), uncompressed
+} image_encoder_format;
+
+// An image file written top to bottom, a few rows at a time. Rows are encoded and written to disk as they arrive,
+// so the encoder holds only a fixed amount of state, whatever the image size: the previous row for the PNG
+// filters, the 32 KiB deflate window and one IDAT chunk of output.
+typedef struct image_encoder image_encoder;
+
+// Creates the file at `path` and writes the header of a `width` x `height` RGB image.
+//
+// Returns:
+//   The encoder, or NULL if the file could not be created or memory ran out (reported)
+image_encoder * image_encoder_open( const char * path, image_encoder_format format, int width, int height );
+
+// Encodes the next `count` rows of the image: `rows` holds them top to bottom, RT_IMAGE_DATA_CHANNELS bytes per
+// pixel with no padding between rows.
+//
+// Returns:
+//   false if writing failed (reported) or more rows were given than the image has
+bool image_encoder_write_rows( image_encoder * encoder, const unsigned char * rows, int count );
+
+// Finishes the file and frees the encoder.
+//
+// Returns:
+//   true if every row of the image was written and the file closed cleanly; false otherwise (reported)
+bool image_encoder_close( image_encoder * encoder );
+
+#endif // IMAGE_ENCODER_H
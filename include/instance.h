@@ -0,0 +1,30 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "hittable.h"  /* hittable, hit_record */
+#include "transform.h" /* transform */
+#include <stdbool.h>
+
+// A placement of shared geometry. The object an instance refers to (the bottom level: a triangle_mesh, or a BVH
+// over several objects) is stored once, in its own object space, however often it is placed; an instance only adds
+// its transform. The scene BVH built over the instances is the top level, so memory grows with the number of
+// distinct objects plus a small, fixed size per placement.
+typedef struct
+{
+    hittable         base;      // base.hit is instance_hit; base.bbox bounds the transformed object
+    const hittable * object;    // Shared geometry, which must outlive the instance
+    transform        to_object; // World to object space, the inverse of the placement
+} instance;
+
+// Places `object` in the world through `to_world`. Unless `mat` is MATERIAL_ID_NONE, hits take that material instead
+// of the object's, so one mesh can be placed with many materials.
+//
+// Returns:
+//   true on success, false if `to_world` is singular (reported)
+bool instance_init( instance * inst, const hittable * object, const transform * to_world, material_id mat );
+
+// Transforms the ray into object space and intersects the shared object. The direction is not renormalized, so hit
+// distances carry over unchanged; the normal is carried back with the inverse transpose.
+bool instance_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec );
+
+#endif // INSTANCE_H
@@ -11,6 +11,6 @@ typedef struct
 
 void lambertian_init( lambertian * mat, color albedo );
 bool lambertian_scatter( const material * material, const ray * r_in, const struct hit_record_s * rec,
-                         color * attenuation, ray * scattered );
+                         color * attenuation, ray * scattered, rng * gen );
 
 #endif // LAMBERTIAN_H
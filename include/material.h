@@ -3,11 +3,49 @@
 
 #include "color.h"
 #include "ray.h"
+#include "rng.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 // Forward declarations
 struct hit_record_s;
 
+// Concrete type of a material, so integrators can batch work per type instead of calling through `scatter`
+typedef enum
+{
+    MATERIAL_CUSTOM, // Only reachable through `scatter`
+    MATERIAL_LAMBERTIAN,
+    MATERIAL_METAL,
+    MATERIAL_DIELECTRIC,
+    MATERIAL_TYPE_COUNT
+} material_type;
+
+// 32-bit reference to a material of a material_table: the type in the top bits, the index into the table's array
+// of that type below
+typedef uint32_t material_id;
+
+#define MATERIAL_ID_TYPE_SHIFT 30
+#define MATERIAL_ID_INDEX_MASK ( ( (uint32_t)1 << MATERIAL_ID_TYPE_SHIFT ) - 1 )
+#define MATERIAL_ID_NONE       UINT32_MAX // No material: rays hitting the object are absorbed
+
+static inline material_id
+material_id_make( material_type type, uint32_t index )
+{
+    return ( (uint32_t)type << MATERIAL_ID_TYPE_SHIFT ) | index;
+}
+
+static inline material_type
+material_id_type( material_id id )
+{
+    return (material_type)( id >> MATERIAL_ID_TYPE_SHIFT );
+}
+
+static inline uint32_t
+material_id_index( material_id id )
+{
+    return id & MATERIAL_ID_INDEX_MASK;
+}
+
 // The "material" interface struct
 typedef struct material_s
 {
@@ -19,11 +57,14 @@ typedef struct material_s
     //   rec        : The hit_record containing details of the intersection
     //   attenuation: Output parameter for the color attenuation of the material
     //   scattered  : Output parameter for the new, scattered ray
+    //   gen        : Random number generator of the calling render worker
     //
     // Returns:
     //   true if the ray is scattered, false if it is absorbed
     bool ( *scatter )( const struct material_s * material, const ray * r_in, const struct hit_record_s * rec,
-                       color * attenuation, ray * scattered );
+                       color * attenuation, ray * scattered, rng * gen );
+
+    material_type type; // Set by the init function of the concrete material
 } material;
 
 #endif // !MATERIAL_H
@@ -0,0 +1,114 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include "dielectric.h" /* dielectric */
+#include "hittable.h"   /* hit_record */
+#include "lambertian.h" /* lambertian */
+#include "material.h"   /* material, material_id */
+#include "metal.h"      /* metal */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Materials of a scene, packed into one array per type and referenced from primitives and hit records by
+// material_id. Built-in materials with identical parameters are stored once, so adding the same material twice
+// returns the same id. Custom materials are kept as pointers and reached through their `scatter`.
+//
+// The arrays move while materials are added, so pointers into the table are only stable once the scene is built.
+typedef struct material_table
+{
+    lambertian * lambertians;
+    metal *      metals;
+    dielectric * dielectrics;
+    material **  customs; // Not owned
+    size_t       count[MATERIAL_TYPE_COUNT];
+    size_t       capacity[MATERIAL_TYPE_COUNT];
+
+    // Open-addressing hash set of the built-in materials, for deduplication
+    material_id * slots;
+    size_t        slot_count; // Power of two, or 0 before the first material
+    size_t        slot_used;
+} material_table;
+
+// Initializes an empty table
+void material_table_init( material_table * table );
+
+// Frees the arrays of the table; custom materials are left untouched
+void material_table_free( material_table * table );
+
+// Adds a material, or finds an identical one already in the table.
+//
+// Returns:
+//   Its id, or MATERIAL_ID_NONE on allocation failure
+material_id material_table_add_lambertian( material_table * table, color albedo );
+material_id material_table_add_metal( material_table * table, color albedo, rt_real fuzz );
+material_id material_table_add_dielectric( material_table * table, rt_real index_of_refraction );
+
+// Adds a material of another type. Custom materials are not deduplicated and must outlive the table.
+//
+// Returns:
+//   Its id, or MATERIAL_ID_NONE on allocation failure
+material_id material_table_add_custom( material_table * table, material * mat );
+
+// Returns the number of distinct materials in the table
+size_t material_table_count( const material_table * table );
+
+// Returns the material `id` refers to, or NULL for MATERIAL_ID_NONE
+static inline const material *
+material_table_get( const material_table * table, material_id id )
+{
+    const uint32_t index = material_id_index( id );
+    if( MATERIAL_ID_NONE == id ) return NULL;
+
+    switch( material_id_type( id ) )
+        {
+        case MATERIAL_LAMBERTIAN: return &table->lambertians[index].base;
+        case MATERIAL_METAL: return &table->metals[index].base;
+        case MATERIAL_DIELECTRIC: return &table->dielectrics[index].base;
+        default: return table->customs[index];
+        }
+}
+
+// Scatters `r_in` off the material `id`, switching on its type so the built-in materials are called directly.
+// Same contract as material->scatter; MATERIAL_ID_NONE absorbs the ray.
+static inline bool
+material_scatter( const material_table * table, material_id id, const ray * r_in, const hit_record * rec,
+                  color * attenuation, ray * scattered, rng * gen )
+{
+    const uint32_t index = material_id_index( id );
+    if( MATERIAL_ID_NONE == id ) return false;
+
+    switch( material_id_type( id ) )
+        {
+        case MATERIAL_LAMBERTIAN:
+            return lambertian_scatter( &table->lambertians[index].base, r_in, rec, attenuation, scattered, gen );
+        case MATERIAL_METAL:
+            return metal_scatter( &table->metals[index].base, r_in, rec, attenuation, scattered, gen );
+        case MATERIAL_DIELECTRIC:
+            return dielectric_scatter( &table->dielectrics[index].base, r_in, rec, attenuation, scattered, gen );
+        default:
+            {
+                const material * mat = table->customs[index];
+                return mat->scatter( mat, r_in, rec, attenuation, scattered, gen );
+            }
+        }
+}
+
+// Returns the reflectance of the material `id` as seen by feature buffers (see aov_image.h): the albedo of lambertian
+// and metal surfaces, white for dielectrics and for custom materials, whose color is unknown, and black for
+// MATERIAL_ID_NONE, which absorbs everything.
+static inline color
+material_albedo( const material_table * table, material_id id )
+{
+    const uint32_t index = material_id_index( id );
+    if( MATERIAL_ID_NONE == id ) return vec3_new( 0, 0, 0 );
+
+    switch( material_id_type( id ) )
+        {
+        case MATERIAL_LAMBERTIAN: return table->lambertians[index].albedo;
+        case MATERIAL_METAL: return table->metals[index].albedo;
+        default: return vec3_new( 1, 1, 1 );
+        }
+}
+
+#endif // MATERIAL_TABLE_H
@@ -7,11 +7,11 @@ typedef struct
 {
     material base;
     color    albedo;
-    double   fuzz;
+    rt_real  fuzz;
 } metal;
 
-void metal_init( metal * mat, color albedo, double fuzz );
+void metal_init( metal * mat, color albedo, rt_real fuzz );
 bool metal_scatter( const material * material, const ray * r_in, const struct hit_record_s * rec, color * attenuation,
-                    ray * scattered );
+                    ray * scattered, rng * gen );
 
 #endif // METAL_H
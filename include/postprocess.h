@@ -0,0 +1,64 @@
+#ifndef POSTPROCESS_H
+#define POSTPROCESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tone curves that bring linear radiance into [0, 1] for display
+typedef enum
+{
+    POSTPROCESS_TONEMAP_CLAMP,    // Clips every channel at 1
+    POSTPROCESS_TONEMAP_REINHARD, // x / (1 + x) per channel: never clips, compresses highlights
+    POSTPROCESS_TONEMAP_ACES,     // Narkowicz's fit of the ACES filmic curve, per channel
+    POSTPROCESS_TONEMAP_COUNT
+} postprocess_tonemap;
+
+// Conversion kernels. SIMD variants are only available on x86 and are picked at runtime through CPUID. Every kernel
+// takes sRGB from the same polynomial log2 and exp2 in the same order of operations, so all produce the same bytes.
+typedef enum
+{
+    POSTPROCESS_KERNEL_SCALAR, // Portable C, one value at a time
+    POSTPROCESS_KERNEL_SSE2,   // Four values per instruction
+    POSTPROCESS_KERNEL_AVX2,   // Eight values per instruction, the same arithmetic as SSE2
+    POSTPROCESS_KERNEL_COUNT
+} postprocess_kernel;
+
+// How linear radiance becomes the 8-bit output image
+typedef struct
+{
+    double              exposure;     // Stops every pixel is scaled by before the tone curve
+    postprocess_tonemap tonemap;      // Tone curve
+    bool                dither;       // Ordered (8x8 Bayer) dithering to 8 bits; false rounds to the nearest level
+    postprocess_kernel  kernel;       // Kernel converting the rows; one the CPU lacks falls back to scalar
+    int                 thread_count; // Worker threads; <= 0 uses every hardware thread
+} postprocess_settings;
+
+// Sets the defaults: exposure 0, clamp, dithering, the fastest kernel and every hardware thread
+void postprocess_settings_init( postprocess_settings * settings );
+
+// Returns the fastest kernel supported by the running CPU
+postprocess_kernel postprocess_best_kernel( void );
+
+// Returns true if `kernel` was compiled in and is supported by the running CPU
+bool postprocess_kernel_supported( postprocess_kernel kernel );
+
+// Returns a printable name for `kernel`
+const char * postprocess_kernel_name( postprocess_kernel kernel );
+
+// Returns the name of `tonemap`, as the --tonemapper option takes it
+const char * postprocess_tonemap_name( postprocess_tonemap tonemap );
+
+// Converts the rows [first_row, end_row) of an image `width` pixels wide from linear radiance to 8-bit sRGB:
+// exposure, tone curve, the sRGB transfer function, then dithering or rounding to 8 bits. `radiance` and
+// `image_data` hold just those rows, 3 values per pixel; the dither pattern follows the rows' place in the image, so
+// an image converted band by band comes out as if converted whole.
+//
+// `samples` holds the sample count of every pixel when `radiance` holds sums, as a film does; each pixel is then
+// divided by its own count, and pixels without samples come out black. NULL when `radiance` already holds means.
+// `settings` may be NULL for the defaults.
+//
+// Bands of rows are converted by `thread_count` workers; if they cannot start, the calling thread converts them.
+void postprocess_image( const postprocess_settings * settings, const float * radiance, const uint32_t * samples,
+                        int width, int first_row, int end_row, unsigned char * image_data );
+
+#endif // POSTPROCESS_H
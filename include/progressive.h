@@ -0,0 +1,63 @@
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#include "camera.h"   /* camera */
+#include "film.h"     /* film */
+#include "hittable.h" /* hittable */
+#include <stdbool.h>
+#include <stdint.h>
+
+// Receives a snapshot of a progressive render: the film resolved to 8-bit RGB after pass `pass`.
+// Called on the snapshot thread, so the render goes on while the snapshot is being written out.
+//
+// Returns:
+//   false to report a failed write (the render continues)
+typedef bool ( *progressive_snapshot_fn )( void * user, const unsigned char * image_data, int width, int height,
+                                           int pass );
+
+// Saves the state of a progressive render between passes, on the render thread (see checkpoint.h).
+//
+// Returns:
+//   false to report a failed save (the render continues)
+typedef bool ( *progressive_checkpoint_fn )( void * user, const film * f );
+
+typedef struct
+{
+    int                          pass_samples;       // Samples every pixel adds per pass
+    int                          snapshot_passes;    // Snapshot after every this many passes; <= 0 disables
+    double                       snapshot_seconds;   // Snapshot after this many seconds since the last; <= 0 disables
+    double                       time_budget;        // Seconds to stop within, between passes; <= 0 takes every sample
+    double                       checkpoint_seconds; // Checkpoint after this many seconds since the last; <= 0 disables
+    progressive_snapshot_fn      snapshot;           // Snapshot callback; NULL disables snapshots
+    progressive_checkpoint_fn    checkpoint;         // Checkpoint callback; NULL disables checkpoints
+    const postprocess_settings * post;               // How snapshots are converted to 8 bits; NULL for the defaults
+    void *                       user;               // Forwarded to `snapshot` and `checkpoint`
+} progressive_settings;
+
+typedef struct
+{
+    int      passes;   // Passes rendered
+    uint64_t samples;  // Samples taken by those passes
+    double   seconds;  // Wall time of the render, snapshots included
+    bool     complete; // True if every pixel reached its sample count, false if the time budget ran out
+} progressive_result;
+
+// Renders `cam` into `f` in passes of `pass_samples` samples per pixel until every pixel holds `samples_per_pixel`
+// samples or the time budget runs out. A pass is only started if it is expected to end within the budget, judging by
+// the previous pass, so the render stops close to the deadline with a uniformly sampled image. `f` may already hold
+// samples, in which case the render continues from them.
+//
+// Snapshots are due every `snapshot_passes` passes or `snapshot_seconds` seconds, whichever comes first, checked
+// between passes. The render thread only resolves the film into a staging image; a background thread hands the
+// newest one to the callback, and snapshots that pile up while it is busy are replaced by newer ones. Every pending
+// snapshot is written before the function returns.
+//
+// Checkpoints are saved every `checkpoint_seconds`, and once more when the time budget stops an unfinished render, so
+// it can be resumed later by loading the checkpoint into `f` and calling progressive_render again.
+//
+// Returns:
+//   true on success, false if the render could not run; `result` (may be NULL) receives the statistics
+bool progressive_render( const camera * cam, const hittable * world, film * f, const progressive_settings * settings,
+                         progressive_result * result );
+
+#endif // PROGRESSIVE_H
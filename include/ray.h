@@ -34,7 +34,7 @@ ray_direction( const ray * r )
 }
 
 static inline point3
-ray_at( const ray * r, double t )
+ray_at( const ray * r, rt_real t )
 {
     return vec3_add( r->orig, vec3_mul( r->dir, t ) );
 }
@@ -0,0 +1,34 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include "hittable.h" /* hit_record */
+#include "ray.h"      /* ray */
+#include <stdbool.h>
+
+// Largest packet: 8x8 primary rays
+#define RAY_PACKET_MAX 64
+
+// A bundle of coherent rays traced through the scene together.
+// Every ray keeps its own closest-hit distance and hit record, so a packet trace yields exactly the hits the
+// rays would get one at a time.
+typedef struct
+{
+    int        count;                // Number of rays in use, at most RAY_PACKET_MAX
+    ray        rays[RAY_PACKET_MAX]; // Rays, in the caller's order
+    rt_real    tmax[RAY_PACKET_MAX]; // Closest hit so far per ray; the far end of the ray's search interval
+    bool       hit[RAY_PACKET_MAX];  // True once the ray hit something
+    hit_record rec[RAY_PACKET_MAX];  // Closest hit of the ray, valid when `hit` is set
+} ray_packet;
+
+// Clears the hits of the first `count` rays and opens their search intervals up to `ray_tmax`
+static inline void
+ray_packet_reset( ray_packet * packet, rt_real ray_tmax )
+{
+    for( int i = 0; i < packet->count; ++i )
+        {
+            packet->tmax[i] = ray_tmax;
+            packet->hit[i]  = false;
+        }
+}
+
+#endif // RAY_PACKET_H
@@ -0,0 +1,36 @@
+#ifndef REAL_H
+#define REAL_H
+
+#include <float.h>
+#include <math.h>
+
+// Floating-point type of the math core: vectors, rays, hit distances, primitives, materials and the camera's
+// geometry. Double precision by default; configuring with -DUSE_FLOAT=ON defines RT_USE_FLOAT and builds the core in
+// single precision, which halves the size of rays, hit records and primitives and doubles the SIMD lane count.
+// Accumulated pixel values, statistics and the random number generator stay in double precision in both modes.
+#ifdef RT_USE_FLOAT
+typedef float rt_real;
+
+#    define RT_REAL_NAME         "float"
+#    define RT_REAL_ZERO_EPSILON 1e-6f // Components below this are rounding noise of unit-length sums
+#    define rt_sqrt              sqrtf
+#    define rt_fabs              fabsf
+#    define rt_fmin              fminf
+#    define rt_fmax              fmaxf
+#    define rt_pow               powf
+#else
+typedef double rt_real;
+
+#    define RT_REAL_NAME         "double"
+#    define RT_REAL_ZERO_EPSILON 1e-8
+#    define rt_sqrt              sqrt
+#    define rt_fabs              fabs
+#    define rt_fmin              fmin
+#    define rt_fmax              fmax
+#    define rt_pow               pow
+#endif
+
+// Converts a constant to rt_real, so single-precision expressions are not promoted to double
+#define RT_REAL( x ) ( (rt_real)( x ) )
+
+#endif // REAL_H
@@ -0,0 +1,83 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include <string.h> /* memcpy */
+
+// Random number generator context (PCG32, XSH-RR variant).
+// Every render worker owns its own instance, so sampling needs no shared state or locking.
+//
+// The generator of a render sample can also draw from a low-discrepancy sequence instead (see sampler.h); the
+// fields past `inc` track where it is in that sequence and are cleared by rng_seed.
+typedef struct
+{
+    uint64_t state; // Internal LCG state
+    uint64_t inc;   // Stream selector, always odd
+
+    uint32_t sequence;   // sampler_type the dimensions are drawn from; 0 (SAMPLER_RANDOM) draws from PCG32 only
+    uint32_t dimension;  // Next dimension of the sample
+    uint32_t index;      // Point of the sequence: the sample's number within its pixel
+    uint32_t count;      // Samples the pixel takes
+    uint32_t scramble;   // Seed of the sequence's scrambling
+    uint32_t mask_pixel; // Position of the pixel in the blue-noise mask
+    uint32_t tuple_seed; // Scramble of the current 4D tuple of Sobol dimensions
+    uint32_t shuffled;   // Shuffled Sobol index of the current tuple
+} rng;
+
+// SplitMix64 finalizer, used to turn structured inputs (seed, pixel, sample) into well-spread 64-bit values
+static inline uint64_t
+rng_mix64( uint64_t z )
+{
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+    return z ^ ( z >> 31 );
+}
+
+// Folds `value` into the running hash `h`. Used to fingerprint render settings and scenes.
+static inline uint64_t
+rng_hash_u64( uint64_t h, uint64_t value )
+{
+    return rng_mix64( h ^ rng_mix64( value ) );
+}
+
+// Folds the bit pattern of `value` into the running hash `h`
+static inline uint64_t
+rng_hash_double( uint64_t h, double value )
+{
+    uint64_t bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+    return rng_hash_u64( h, bits );
+}
+
+// Returns the next 32 random bits
+static inline uint32_t
+rng_next_u32( rng * gen )
+{
+    uint64_t old   = gen->state;
+    gen->state     = old * 6364136223846793005ULL + gen->inc;
+    uint32_t xsh   = (uint32_t)( ( ( old >> 18 ) ^ old ) >> 27 );
+    uint32_t rot   = (uint32_t)( old >> 59 );
+    return ( xsh >> rot ) | ( xsh << ( ( -rot ) & 31 ) );
+}
+
+// Seeds the generator with an initial state and a stream.
+// Distinct streams produce distinct sequences even from the same seed.
+static inline void
+rng_seed( rng * gen, uint64_t seed, uint64_t stream )
+{
+    gen->state    = 0;
+    gen->inc      = ( stream << 1 ) | 1u;
+    gen->sequence = 0;
+    rng_next_u32( gen );
+    gen->state += rng_mix64( seed );
+    rng_next_u32( gen );
+}
+
+// Returns a random real in [0,1), with 32 bits of resolution
+static inline double
+rng_next_double( rng * gen )
+{
+    return rng_next_u32( gen ) * 0x1.0p-32;
+}
+
+#endif // RNG_H
@@ -1,8 +1,11 @@
 #ifndef RTWEEKEND_H
 #define RTWEEKEND_H
 
+#include "rng.h"
+#include "sampler.h"
 #include "vec3.h"
 #include <float.h>
+#include <math.h> /* sqrt, fabs, cos, sin */
 #include <stdlib.h>
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -48,28 +51,42 @@
 //----------------------------------------------------------------------------------------------------------------------
 // Utility Functions
 //----------------------------------------------------------------------------------------------------------------------
-// Returns a random real in [0,1)
+// Returns a random real in [0,1): the next dimension of the sample when `gen` draws from a sampler's sequence
 static inline double
-random_double()
+random_double( rng * gen )
 {
-    return rand() / ( RAND_MAX + 1.0 );
+    return ( SAMPLER_RANDOM == gen->sequence ) ? rng_next_double( gen ) : sampler_next( gen );
 }
 
 // Returns a random real in [min,max)
 static inline double
-random_double_range( double min, double max )
+random_double_range( rng * gen, double min, double max )
 {
-    return min + ( max - min ) * random_double();
+    return min + ( max - min ) * random_double( gen );
 }
 
-// Generate a random vec3 inside a unit shape
+// Generate a random vec3 inside a unit shape: (x, y) uniform over the disk of radius sqrt(1 - z^2) around the Z axis,
+// at height `z_value`. PCG32 numbers are drawn until a point in the square falls inside it; from a sampler's
+// sequence, which is only stratified if every sample draws the same dimensions, the square is instead mapped onto
+// the disk from exactly two numbers (concentric mapping, Shirley and Chiu 1997).
 static inline vec3
-random_in_unit( double z_value )
+random_in_unit( rng * gen, double z_value )
 {
     vec3 p;
+    if( SAMPLER_RANDOM != gen->sequence )
+        {
+            const double a       = random_double_range( gen, -1, 1 );
+            const double b       = random_double_range( gen, -1, 1 );
+            const double radius  = sqrt( RT_MAX( 0.0, 1.0 - z_value * z_value ) );
+            const double quarter = RT_TAU / 8.0;
+            if( 0.0 == a && 0.0 == b ) return vec3_new( 0, 0, z_value );
+            if( fabs( a ) > fabs( b ) )
+                return vec3_new( radius * a * cos( quarter * b / a ), radius * a * sin( quarter * b / a ), z_value );
+            return vec3_new( radius * b * sin( quarter * a / b ), radius * b * cos( quarter * a / b ), z_value );
+        }
     do
         {
-            p = vec3_new( random_double_range( -1, 1 ), random_double_range( -1, 1 ), z_value );
+            p = vec3_new( random_double_range( gen, -1, 1 ), random_double_range( gen, -1, 1 ), z_value );
         }
     while( vec3_length_squared( p ) >= 1 );
     return p;
@@ -77,23 +94,23 @@ random_in_unit( double z_value )
 
 // Returns a random point inside a unit sphere
 static inline vec3
-random_in_unit_sphere()
+random_in_unit_sphere( rng * gen )
 {
-    return random_in_unit( random_double_range( -1, 1 ) );
+    return random_in_unit( gen, random_double_range( gen, -1, 1 ) );
 }
 
 // Returns a random point inside a unit disk on the XY plane
 static inline vec3
-random_in_unit_disk()
+random_in_unit_disk( rng * gen )
 {
-    return random_in_unit( 0.0 );
+    return random_in_unit( gen, 0.0 );
 }
 
 // Returns a random unit vector
 static inline vec3
-random_unit_vector()
+random_unit_vector( rng * gen )
 {
-    return vec3_normalize( random_in_unit_sphere() );
+    return vec3_normalize( random_in_unit_sphere( gen ) );
 }
 
 #endif // RTWEEKEND_H
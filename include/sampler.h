@@ -0,0 +1,70 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "rng.h" /* rng */
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sequences the sample dimensions of a pixel can be drawn from. A sample's dimensions are the numbers its path
+// draws in order: the position in the pixel, the point on the lens, then a few per bounce for the scatter direction
+// and Russian roulette (see sampler_begin_bounce).
+typedef enum
+{
+    SAMPLER_RANDOM,     // Independent PCG32 numbers
+    SAMPLER_STRATIFIED, // Each pair of dimensions correlated multi-jittered over the pixel's samples (Kensler 2013)
+    SAMPLER_SOBOL,      // Sobol points, Owen scrambled per pixel and padded in 4D tuples (Burley 2020)
+    SAMPLER_BLUE_NOISE, // One Owen scrambled Sobol sequence for every pixel, shifted per pixel by a blue-noise mask
+    SAMPLER_TYPE_COUNT
+} sampler_type;
+
+// Dimensions given to every bounce: a bounce starts on a multiple of this, so the same bounce of every sample of a
+// pixel draws from the same dimensions whatever the materials met before. The primary ray takes the first four:
+// two for the position in the pixel, two for the lens.
+#define SAMPLER_BOUNCE_DIMENSIONS 4
+
+// Edge length of the tiled blue-noise mask SAMPLER_BLUE_NOISE shifts its pixels by
+#define SAMPLER_MASK_SIZE 64
+
+// Returns the name of a sampler as the command line takes it, or "unknown"
+const char * sampler_name( sampler_type type );
+
+// Parses `text` as a sampler name.
+//
+// Returns:
+//   true if `text` names a sampler, stored in `*type`
+bool sampler_parse( const char * text, sampler_type * type );
+
+// Draws the next dimension of the sample `gen` was started on (see sampler_start). random_double calls it for every
+// sampler but SAMPLER_RANDOM.
+//
+// Returns:
+//   A real in [0,1)
+double sampler_next( rng * gen );
+
+// Makes `gen`, freshly seeded for sample `sample` of pixel (x, y), draw its dimensions from the sequence `type`.
+// `count` is the number of samples the pixel takes, which SAMPLER_STRATIFIED divides its strata into; samples past
+// it, and every number of SAMPLER_RANDOM, come from the PCG32 stream as before. `seed` scrambles the sequences.
+static inline void
+sampler_start( rng * gen, sampler_type type, uint64_t seed, int x, int y, uint64_t pixel, int sample, int count )
+{
+    gen->sequence = (uint32_t)type;
+    if( SAMPLER_RANDOM == type ) return;
+
+    gen->dimension = 0;
+    gen->index     = (uint32_t)sample;
+    gen->count     = (uint32_t)count;
+
+    // Blue noise spreads one sequence over every pixel; the others scramble a sequence per pixel
+    gen->scramble   = (uint32_t)rng_mix64( rng_mix64( seed ) ^ ( SAMPLER_BLUE_NOISE == type ? 0 : pixel + 1 ) );
+    const int mask  = SAMPLER_MASK_SIZE - 1;
+    gen->mask_pixel = (uint32_t)( ( y & mask ) * SAMPLER_MASK_SIZE + ( x & mask ) );
+}
+
+// Moves `gen` on to the dimensions of the next bounce; called by the integrators before every scatter
+static inline void
+sampler_begin_bounce( rng * gen )
+{
+    gen->dimension = ( gen->dimension + SAMPLER_BOUNCE_DIMENSIONS - 1 ) & ~(uint32_t)( SAMPLER_BOUNCE_DIMENSIONS - 1 );
+}
+
+#endif // SAMPLER_H
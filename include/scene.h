@@ -0,0 +1,58 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "arena.h"          /* arena */
+#include "camera.h"         /* camera */
+#include "hittable_list.h"  /* hittable_list */
+#include "material_table.h" /* material_table */
+#include "rng.h"            /* rng */
+#include "triangle_mesh.h"  /* triangle_mesh */
+
+// Builds the final scene of the book: a large ground sphere, a grid of small random spheres and three large ones.
+// Objects are allocated from `memory`, which owns them: release it with arena_free once `world` and everything built
+// from it are gone. Materials are added to `materials`, which stores identical ones once.
+//
+// Returns:
+//   true on success, false if memory ran out (`world` then holds the objects added so far)
+bool scene_book( hittable_list * world, arena * memory, material_table * materials, rng * gen );
+
+// Positions `cam` to frame scene_book
+void scene_book_camera( camera * cam, double aspect_ratio, int image_width, int samples_per_pixel, int max_depth );
+
+// Builds `count` small spheres with random materials scattered through a cube. The cube grows with the count so the
+// sphere density stays constant, which makes scenes of different sizes comparable for acceleration benchmarks.
+// Objects are allocated from `memory` and materials added to `materials`, like scene_book.
+//
+// Returns:
+//   true on success, false if memory ran out
+bool scene_sphere_cloud( hittable_list * world, arena * memory, material_table * materials, rng * gen, int count );
+
+// Positions `cam` to frame a scene_sphere_cloud of `count` spheres
+void scene_sphere_cloud_camera( camera * cam, int count, double aspect_ratio, int image_width, int samples_per_pixel,
+                                int max_depth );
+
+// Builds a torus around the y axis, of radius 1 with a tube of radius 0.4, as a mesh of `major` segments around the
+// axis and `minor` around the tube: 2 * major * minor triangles with smooth normals, allocated from `memory`.
+//
+// Returns:
+//   The mesh, or NULL if memory ran out
+triangle_mesh * scene_torus_mesh( arena * memory, int major, int minor, material_id mat );
+
+// Builds a ground sphere and `count` instances of `object` on a square grid, each scaled, tilted and turned at
+// random and given a random material. `object` is shared by every instance and must outlive `world`. Instances are
+// allocated from `memory` and materials added to `materials`, like scene_book.
+//
+// Returns:
+//   true on success, false if memory ran out or `object` is empty
+bool scene_instance_field( hittable_list * world, arena * memory, material_table * materials, rng * gen,
+                           const hittable * object, int count );
+
+// Positions `cam` to frame a scene_instance_field of `count` instances
+void scene_instance_field_camera( camera * cam, int count, double aspect_ratio, int image_width, int samples_per_pixel,
+                                  int max_depth );
+
+// Fingerprints the objects of `world`: their bounds, material types and the parameters of the built-in materials,
+// looked up in `materials`. Two worlds with the same hash render the same image.
+uint64_t scene_hash( const hittable_list * world, const material_table * materials );
+
+#endif // SCENE_H
@@ -0,0 +1,85 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "arena.h"          /* arena */
+#include "camera.h"         /* camera */
+#include "hittable_list.h"  /* hittable_list */
+#include "material_table.h" /* material_table */
+#include <stdbool.h>
+
+// Extension appended to a text scene's path to name its binary cache
+#define SCENE_FILE_CACHE_EXTENSION ".bin"
+
+// Scene files describe the render settings, the camera, the materials and the objects of a scene, one statement per
+// line. `#` starts a comment; blank lines are ignored. Statements:
+//
+//   image_width          <int>
+//   aspect_ratio         <real>
+//   samples_per_pixel    <int>
+//   max_depth            <int>
+//   packet_size          <int>   Edge length of the primary-ray packets, 1 to 8; 1 traces single rays
+//   integrator           recursive | wavefront
+//   roulette_min_depth   <int>   Bounces before Russian roulette may end a path; 0, the default, disables it
+//   adaptive_threshold   <real>  Pixels stop sampling once within it, see camera_render; 0, the default, disables it
+//   adaptive_min_samples <int>   Samples per adaptive pass, taken before every convergence test (default: 16)
+//   sampler              random | stratified | sobol | bluenoise
+//   camera   <position x y z> <target x y z> <up x y z> <vertical fov deg> <aperture> <focus distance>
+//   material <name> lambertian <r> <g> <b>
+//   material <name> metal      <r> <g> <b> <fuzz>
+//   material <name> dielectric <index of refraction>
+//   sphere   <center x y z> <radius> <material>
+//   mesh     <obj path> <material>
+//   instance <obj path> <position x y z> <rotation axis x y z> <rotation angle deg> <scale> <material>
+//
+// An object's <material> is the name of a material defined above it, `none`, or an unnamed one written in place,
+// such as `sphere 0 1 0 1 dielectric 1.5`. A mesh is loaded with triangle_mesh_load_obj from a path without spaces,
+// relative to the scene file's directory unless absolute. An instance places a mesh scaled, rotated, then moved to
+// its position (see instance.h); every instance of the same file shares one mesh, loaded once, without material of
+// its own. Settings may appear anywhere and the last one wins; settings missing from the file keep the camera's
+// current values.
+//
+// The binary form holds the same scene as fixed-size records in host byte order, ready to be memory-mapped, so
+// loading it does no parsing: it is a cache compiled from a text file, not an interchange format.
+
+// Loads the text scene at `path`: objects are allocated from `memory` and added to `world`, materials are added to
+// `materials`, and `cam` is reinitialized with camera_init from its current view and settings overridden by the
+// file's.
+//
+// Returns:
+//   true on success; false if the file cannot be read or has an error (reported with its line), in which case
+//   `world` holds the objects added so far
+bool scene_file_load_text( const char * path, hittable_list * world, arena * memory, material_table * materials,
+                           camera * cam );
+
+// Loads a binary scene written by scene_file_save_binary, like scene_file_load_text
+bool scene_file_load_binary( const char * path, hittable_list * world, arena * memory, material_table * materials,
+                             camera * cam );
+
+// Loads the text scene at `path` through its binary cache, `path` followed by SCENE_FILE_CACHE_EXTENSION. A cache
+// compiled from the file as it is now is loaded instead of the text; otherwise the text is parsed and the cache
+// rewritten, with a warning if that fails. The binary form holds spheres only, so a scene with meshes or instances is
+// parsed, and its meshes loaded, every time.
+//
+// Returns:
+//   true on success, false if the scene could not be loaded
+bool scene_file_load( const char * path, hittable_list * world, arena * memory, material_table * materials,
+                      camera * cam );
+
+// Writes `world`, its materials and the view and settings of `cam` as a text scene. Every object must be a sphere
+// with a built-in material or none.
+//
+// Returns:
+//   true on success, false if the scene cannot be represented or the file cannot be written
+bool scene_file_save_text( const char * path, const hittable_list * world, const material_table * materials,
+                           const camera * cam );
+
+// Writes the scene like scene_file_save_text, in the binary form. `source_path` names the text file the scene was
+// loaded from, which scene_file_load compares the cache against; NULL marks a cache of no text file.
+// The file is written next to `path` first and then renamed over it.
+//
+// Returns:
+//   true on success, false if the scene cannot be represented or the file cannot be written
+bool scene_file_save_binary( const char * path, const hittable_list * world, const material_table * materials,
+                             const camera * cam, const char * source_path );
+
+#endif // SCENE_FILE_H
@@ -9,13 +9,14 @@ typedef struct
 {
     hittable base;
     point3   center;
-    double   radius;
+    rt_real  radius;
 } sphere;
 
-// Initializes a sphere object
-void sphere_init( sphere * s, point3 center_val, double radius_val, material * mat );
+// Initializes a sphere object; `mat` refers to the scene's material_table
+void sphere_init( sphere * s, point3 center_val, rt_real radius_val, material_id mat );
 
 // The hit detection function for spheres
-bool sphere_hit_function( const hittable * object, const ray * r, double ray_tmin, double ray_tmax, hit_record * rec );
+bool sphere_hit_function( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax,
+                          hit_record * rec );
 
 #endif // SPHERE_H
@@ -0,0 +1,76 @@
+#ifndef SPHERE_SOA_H
+#define SPHERE_SOA_H
+
+#include "hittable.h"      /* hittable, hit_record */
+#include "hittable_list.h" /* hittable_list */
+#include "material.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Spheres are stored in blocks of one 32-byte AVX register (4 doubles or 8 floats); the tail of the last block is
+// padded with NaN spheres
+#define SPHERE_SOA_BLOCK ( 32 / sizeof( rt_real ) )
+
+// Intersection kernels. SIMD variants are only available on x86 and are picked at runtime through CPUID.
+typedef enum
+{
+    SPHERE_SOA_KERNEL_SCALAR, // Portable C, one sphere at a time
+    SPHERE_SOA_KERNEL_SSE2,   // Two spheres per instruction, four in single precision
+    SPHERE_SOA_KERNEL_AVX2,   // Four spheres per instruction, eight in single precision
+    SPHERE_SOA_KERNEL_COUNT
+} sphere_soa_kernel;
+
+// A packed group of spheres in structure-of-arrays layout.
+// Centers and radii live in contiguous 32-byte aligned arrays so one ray is tested against several spheres
+// per instruction. Materials are referenced through their 32-bit material_id in the scene's material_table.
+typedef struct
+{
+    hittable base; // base.hit points to sphere_soa_hit, base.bbox encloses every sphere
+
+    rt_real *     center_x; // Aligned arrays of `capacity` entries
+    rt_real *     center_y;
+    rt_real *     center_z;
+    rt_real *     radius;
+    material_id * material_id; // Material of every sphere
+    size_t        count;       // Number of spheres
+    size_t        capacity;    // Allocated entries, always a multiple of SPHERE_SOA_BLOCK
+
+    sphere_soa_kernel kernel; // Kernel used by sphere_soa_hit
+} sphere_soa;
+
+// Initializes an empty group using the fastest kernel the CPU supports
+void sphere_soa_init( sphere_soa * set, size_t initial_capacity );
+
+// Frees the arrays of the group
+void sphere_soa_clear( sphere_soa * set );
+
+// Appends a sphere made of the material `mat` of the scene's material_table.
+// Returns true on success, false on allocation failure.
+bool sphere_soa_add( sphere_soa * set, point3 center, rt_real radius, material_id mat );
+
+// Returns the fastest kernel supported by the running CPU
+sphere_soa_kernel sphere_soa_best_kernel( void );
+
+// Returns true if `kernel` was compiled in and is supported by the running CPU
+bool sphere_soa_kernel_supported( sphere_soa_kernel kernel );
+
+// Returns a printable name for `kernel`
+const char * sphere_soa_kernel_name( sphere_soa_kernel kernel );
+
+// Closest-hit test of the ray against every sphere of the group
+bool sphere_soa_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec );
+
+// Packs the spheres of `spheres` into spatially coherent sphere_soa groups of at most `group_size` spheres,
+// following the subtrees of a BVH built over them, and appends the groups to `groups`. Objects that are not
+// spheres are appended to `groups` as they are. Groups copy the material ids of the source spheres, so they do
+// not reference the spheres themselves.
+//
+// Returns:
+//   true on success, false on allocation failure
+bool sphere_soa_cluster( const hittable_list * spheres, size_t group_size, hittable_list * groups );
+
+// Frees every group created by sphere_soa_cluster and empties `groups`. Objects that were appended
+// as they are remain owned by the source list.
+void sphere_soa_cluster_free( hittable_list * groups );
+
+#endif // SPHERE_SOA_H
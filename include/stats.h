@@ -0,0 +1,119 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Render statistics, compiled in with ENABLE_STATS (CMake option of the same name).
+//
+// Hot paths bump counters of the calling thread through the STATS_* macros, which expand to nothing when the
+// option is off. Render workers merge their counters into the process totals after every tile, so reading the
+// totals needs no synchronization with the render itself.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of bins of the path length histogram; longer paths are counted in the last bin
+#define STATS_DEPTH_BINS 64
+
+typedef enum
+{
+    STATS_RAYS,               // Rays traced into the world
+    STATS_LIST_CALLS,         // hittable_list_hit calls
+    STATS_OBJECT_CALLS,       // Object hit calls made by lists and BVH leaves
+    STATS_BVH_NODES,          // Flat BVH nodes visited
+    STATS_SPHERE_TESTS,       // Ray-sphere tests, one per sphere of a SIMD group
+    STATS_TRIANGLE_TESTS,     // Ray-triangle tests of mesh BVH leaves
+    STATS_SCATTER_LAMBERTIAN, // lambertian_scatter calls
+    STATS_SCATTER_METAL,      // metal_scatter calls
+    STATS_SCATTER_DIELECTRIC, // dielectric_scatter calls
+    STATS_ESCAPED,            // Paths that left the scene
+    STATS_ABSORBED,           // Paths absorbed by a surface
+    STATS_ROULETTE,           // Paths ended by Russian roulette
+    STATS_BOUNCE_LIMIT,       // Paths that reached the camera's max_depth
+    STATS_COUNTER_COUNT
+} stats_counter;
+
+typedef struct
+{
+    uint64_t counters[STATS_COUNTER_COUNT];
+    uint64_t depth[STATS_DEPTH_BINS]; // Paths ended after this many bounces
+} render_stats;
+
+#ifdef ENABLE_STATS
+
+#if defined( _MSC_VER )
+#define STATS_THREAD_LOCAL __declspec( thread )
+#else
+#define STATS_THREAD_LOCAL __thread
+#endif
+
+// Counters of the calling thread, not yet merged into the totals
+extern STATS_THREAD_LOCAL render_stats stats_local;
+
+// Pixel the calling thread is tracing rays for, as an index into the heatmap
+extern STATS_THREAD_LOCAL uint32_t stats_pixel;
+
+// Rays traced per pixel while a heatmap is active; NULL otherwise
+extern uint32_t * stats_heatmap;
+extern uint32_t   stats_heatmap_size;
+
+#define STATS_ADD( counter, n ) ( stats_local.counters[counter] += (uint64_t)( n ) )
+#define STATS_INC( counter )    STATS_ADD( counter, 1 )
+
+// Counts a path ending with `counter` after `bounces` scattering events
+#define STATS_PATH_END( counter, bounces )                                                                            \
+    do                                                                                                                 \
+        {                                                                                                              \
+            const int stats_bounces_  = ( bounces );                                                                   \
+            STATS_INC( counter );                                                                                      \
+            stats_local.depth[stats_bounces_ < STATS_DEPTH_BINS ? stats_bounces_ : STATS_DEPTH_BINS - 1] += 1;        \
+        }                                                                                                              \
+    while( 0 )
+
+// Attributes the following rays of the calling thread to pixel (i, j) of an image `width` pixels wide
+#define STATS_PIXEL( i, j, width ) ( stats_pixel = (uint32_t)( (size_t)( j ) * ( width ) + ( i ) ) )
+
+// Counts `n` rays traced for the current pixel
+#define STATS_RAYS_TRACED( n )                                                                                         \
+    do                                                                                                                 \
+        {                                                                                                              \
+            STATS_ADD( STATS_RAYS, n );                                                                                \
+            if( stats_heatmap && stats_pixel < stats_heatmap_size ) stats_heatmap[stats_pixel] += (uint32_t)( n );    \
+        }                                                                                                              \
+    while( 0 )
+
+// Merges the counters of the calling thread into the totals and clears them
+void stats_flush( void );
+
+// Clears the totals and the counters of the calling thread
+void stats_reset( void );
+
+// Copies the totals into `out`, after merging the counters of the calling thread
+void stats_get( render_stats * out );
+
+// Prints the totals to stdout
+void stats_print( void );
+
+// Starts counting the rays traced per pixel of a `width` x `height` render, until stats_heatmap_end.
+//
+// Returns:
+//   true on success, false if the heatmap could not be allocated
+bool stats_heatmap_begin( int width, int height );
+
+// Resolves the heatmap to 8-bit RGB in `image_data`, from black through red and yellow to white for the most
+// expensive pixel
+void stats_heatmap_resolve( unsigned char * image_data );
+
+// Stops counting rays per pixel and frees the heatmap
+void stats_heatmap_end( void );
+
+#else
+
+#define STATS_ADD( counter, n )            ( (void)0 )
+#define STATS_INC( counter )               ( (void)0 )
+#define STATS_PATH_END( counter, bounces ) ( (void)0 )
+#define STATS_PIXEL( i, j, width )         ( (void)0 )
+#define STATS_RAYS_TRACED( n )             ( (void)0 )
+#define stats_flush()                      ( (void)0 )
+
+#endif // ENABLE_STATS
+
+#endif // STATS_H
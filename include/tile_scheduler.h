@@ -0,0 +1,38 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <stdbool.h>
+
+// A unit of work: renders (or otherwise processes) the tile with the given index.
+//
+// Parameters:
+//   user        : Opaque pointer handed to tile_scheduler_run
+//   tile_index  : Index of the tile to process, in [0, tile_count)
+//   thread_index: Index of the worker executing the job, in [0, thread_count)
+typedef void ( *tile_job_fn )( void * user, int tile_index, int thread_index );
+
+// Optional progress callback, invoked after every finished tile.
+// Calls are serialized, so the callback may write to shared streams without locking.
+typedef void ( *tile_progress_fn )( void * user, int tiles_done, int tile_count );
+
+// Returns the number of hardware threads available to the process (at least 1)
+int tile_scheduler_hardware_threads( void );
+
+// Runs `job` once for every tile in [0, tile_count) on a pool of worker threads.
+//
+// Tiles are dealt out in contiguous blocks to per-worker deques. A worker pops its own
+// deque from the bottom and, once empty, steals from the top of the other workers' deques,
+// so expensive regions of the image do not leave the remaining cores idle.
+//
+// Parameters:
+//   thread_count: Number of workers; <= 0 selects tile_scheduler_hardware_threads()
+//   tile_count  : Number of tiles to process
+//   job         : Job function, must be safe to call concurrently for distinct tiles
+//   progress    : Optional progress callback (may be NULL)
+//   user        : Opaque pointer forwarded to `job` and `progress`
+//
+// Returns:
+//   true once every tile has been processed, false if the pool could not be created
+bool tile_scheduler_run( int thread_count, int tile_count, tile_job_fn job, tile_progress_fn progress, void * user );
+
+#endif // TILE_SCHEDULER_H
@@ -0,0 +1,154 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "aabb.h"      /* aabb */
+#include "rtweekend.h" /* RT_TAU */
+#include "vec3.h"
+#include <math.h>
+#include <stdbool.h>
+
+// Affine transform of column vectors: p' = m p + t
+typedef struct
+{
+    rt_real m[3][3]; // Linear part, row-major
+    vec3    t;       // Translation
+} transform;
+
+static inline transform
+transform_identity( void )
+{
+    return (transform) { { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }, { 0, 0, 0 } };
+}
+
+static inline transform
+transform_translate( vec3 offset )
+{
+    transform x = transform_identity();
+    x.t         = offset;
+    return x;
+}
+
+static inline transform
+transform_scale( vec3 factors )
+{
+    return (transform) { { { factors.x, 0, 0 }, { 0, factors.y, 0 }, { 0, 0, factors.z } }, { 0, 0, 0 } };
+}
+
+// Rotation by `degrees` counter-clockwise around `axis`, seen looking down the axis
+static inline transform
+transform_rotate( vec3 axis, double degrees )
+{
+    const vec3   a = vec3_normalize( axis );
+    const double s = sin( degrees * ( RT_TAU / 360.0 ) );
+    const double c = cos( degrees * ( RT_TAU / 360.0 ) );
+    const double k = 1.0 - c;
+
+    transform x = transform_identity();
+    x.m[0][0]   = (rt_real)( a.x * a.x * k + c );
+    x.m[0][1]   = (rt_real)( a.x * a.y * k - a.z * s );
+    x.m[0][2]   = (rt_real)( a.x * a.z * k + a.y * s );
+    x.m[1][0]   = (rt_real)( a.y * a.x * k + a.z * s );
+    x.m[1][1]   = (rt_real)( a.y * a.y * k + c );
+    x.m[1][2]   = (rt_real)( a.y * a.z * k - a.x * s );
+    x.m[2][0]   = (rt_real)( a.z * a.x * k - a.y * s );
+    x.m[2][1]   = (rt_real)( a.z * a.y * k + a.x * s );
+    x.m[2][2]   = (rt_real)( a.z * a.z * k + c );
+    return x;
+}
+
+// Applies the linear part only, to a direction
+static inline vec3
+transform_vector( const transform * x, vec3 v )
+{
+    return vec3_new( x->m[0][0] * v.x + x->m[0][1] * v.y + x->m[0][2] * v.z,
+                     x->m[1][0] * v.x + x->m[1][1] * v.y + x->m[1][2] * v.z,
+                     x->m[2][0] * v.x + x->m[2][1] * v.y + x->m[2][2] * v.z );
+}
+
+// Applies the transpose of the linear part. Given the inverse of a transform, this carries normals through the
+// transform itself, keeping them perpendicular to transformed surfaces.
+static inline vec3
+transform_vector_transposed( const transform * x, vec3 v )
+{
+    return vec3_new( x->m[0][0] * v.x + x->m[1][0] * v.y + x->m[2][0] * v.z,
+                     x->m[0][1] * v.x + x->m[1][1] * v.y + x->m[2][1] * v.z,
+                     x->m[0][2] * v.x + x->m[1][2] * v.y + x->m[2][2] * v.z );
+}
+
+static inline point3
+transform_point( const transform * x, point3 p )
+{
+    return vec3_add( transform_vector( x, p ), x->t );
+}
+
+// Returns the transform that applies `b`, then `a`
+static inline transform
+transform_compose( const transform * a, const transform * b )
+{
+    transform x;
+    for( int i = 0; i < 3; ++i )
+        {
+            for( int j = 0; j < 3; ++j )
+                {
+                    x.m[i][j] = a->m[i][0] * b->m[0][j] + a->m[i][1] * b->m[1][j] + a->m[i][2] * b->m[2][j];
+                }
+        }
+    x.t = transform_point( a, b->t );
+    return x;
+}
+
+// Inverts `x` into `inverse`, computing in double precision.
+//
+// Returns:
+//   false if `x` is singular, leaving `inverse` unchanged
+static inline bool
+transform_invert( const transform * x, transform * inverse )
+{
+    const double a = x->m[0][0], b = x->m[0][1], c = x->m[0][2];
+    const double d = x->m[1][0], e = x->m[1][1], f = x->m[1][2];
+    const double g = x->m[2][0], h = x->m[2][1], i = x->m[2][2];
+
+    // Cofactors of the first row, which the determinant expands along
+    const double c00 = e * i - f * h, c01 = f * g - d * i, c02 = d * h - e * g;
+    const double det = a * c00 + b * c01 + c * c02;
+    if( 0.0 == det || !isfinite( det ) ) return false;
+
+    const double s = 1.0 / det;
+    transform    r;
+    r.m[0][0] = (rt_real)( c00 * s );
+    r.m[0][1] = (rt_real)( ( c * h - b * i ) * s );
+    r.m[0][2] = (rt_real)( ( b * f - c * e ) * s );
+    r.m[1][0] = (rt_real)( c01 * s );
+    r.m[1][1] = (rt_real)( ( a * i - c * g ) * s );
+    r.m[1][2] = (rt_real)( ( c * d - a * f ) * s );
+    r.m[2][0] = (rt_real)( c02 * s );
+    r.m[2][1] = (rt_real)( ( b * g - a * h ) * s );
+    r.m[2][2] = (rt_real)( ( a * e - b * d ) * s );
+    r.t       = vec3_negate( transform_vector( &r, x->t ) );
+    *inverse  = r;
+    return true;
+}
+
+// Returns the bounds of `box` once transformed: each output axis takes the smaller and larger product of every
+// matrix entry with the box's extent on that axis (Arvo, Graphics Gems 1990)
+static inline aabb
+transform_aabb( const transform * x, aabb box )
+{
+    const rt_real lo[3] = { box.min.x, box.min.y, box.min.z };
+    const rt_real hi[3] = { box.max.x, box.max.y, box.max.z };
+    rt_real       out_min[3], out_max[3];
+    for( int i = 0; i < 3; ++i )
+        {
+            out_min[i] = out_max[i] = vec3_get( x->t, i );
+            for( int j = 0; j < 3; ++j )
+                {
+                    const rt_real a = x->m[i][j] * lo[j];
+                    const rt_real b = x->m[i][j] * hi[j];
+                    out_min[i]     += ( a < b ) ? a : b;
+                    out_max[i]     += ( a < b ) ? b : a;
+                }
+        }
+    return (aabb) { vec3_new( out_min[0], out_min[1], out_min[2] ), vec3_new( out_max[0], out_max[1], out_max[2] ) };
+}
+
+#endif // TRANSFORM_H
@@ -0,0 +1,61 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include "arena.h"    /* arena */
+#include "bvh_flat.h" /* bvh_flat_node */
+#include "hittable.h" /* hittable, hit_record */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest number of triangles in a leaf of a mesh's BVH
+#define TRIANGLE_MESH_LEAF_SIZE 4
+
+// Normal index of a triangle corner without a shading normal
+#define TRIANGLE_MESH_NO_NORMAL UINT32_MAX
+
+// Indexed triangle mesh. Vertex positions and shading normals are stored once in shared arrays that the triangles
+// reference by index, and a BVH over the triangles, in the flat BVH's node layout, lets the whole mesh act as one
+// primitive of the scene. Every array lives in the scene arena.
+typedef struct
+{
+    hittable              base;           // base.hit is triangle_mesh_hit; all triangles share its material
+    const point3 *        positions;      // Vertex positions
+    const vec3 *          normals;        // Shading normals, or NULL to shade every triangle flat
+    const uint32_t *      indices;        // Three position indices per triangle, in BVH leaf order
+    const uint32_t *      normal_indices; // Three normal indices per triangle, or NULL
+    const bvh_flat_node * nodes;          // Depth-first BVH over ranges of `indices`
+    size_t                position_count;
+    size_t                normal_count;
+    size_t                triangle_count;
+    size_t                node_count;
+} triangle_mesh;
+
+// Initializes `mesh` with `triangle_count` triangles, each given by three indices into `positions` and, when
+// `normal_indices` is not NULL, three indices into `normals` (TRIANGLE_MESH_NO_NORMAL shades that triangle flat).
+// Triangles wind counter-clockwise around their outward normal. The arrays are copied into `memory`, reordered
+// for the BVH, which is built with the binned surface area heuristic.
+//
+// Returns:
+//   true on success; false if an index is out of range or memory ran out (reported)
+bool triangle_mesh_init( triangle_mesh * mesh, arena * memory, const point3 * positions, size_t position_count,
+                         const uint32_t * indices, size_t triangle_count, const vec3 * normals, size_t normal_count,
+                         const uint32_t * normal_indices, material_id mat );
+
+// Loads the Wavefront OBJ file at `path` as one mesh with material `mat`. Reads vertex positions (`v`), normals
+// (`vn`) and faces (`f`) with any of the `v`, `v/vt`, `v//vn` and `v/vt/vn` forms and negative, relative indices;
+// polygons are split into triangle fans. Every other statement is skipped. The file is streamed through a fixed
+// buffer, so the text is never held in memory as a whole.
+//
+// Returns:
+//   The mesh, allocated from `memory`, or NULL if the file cannot be read or has an error (reported with its line)
+triangle_mesh * triangle_mesh_load_obj( const char * path, arena * memory, material_id mat );
+
+// Returns the number of bytes held by the mesh: its arrays and its BVH
+size_t triangle_mesh_memory( const triangle_mesh * mesh );
+
+// Closest-hit traversal of the mesh's BVH with a watertight ray-triangle test: rays through a shared edge or vertex
+// hit at least one of the triangles that share it, so closed meshes have no cracks
+bool triangle_mesh_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec );
+
+#endif // TRIANGLE_MESH_H
@@ -1,6 +1,7 @@
 #ifndef VEC3_H
 #define VEC3_H
 
+#include "real.h"
 #include <math.h>
 #include <stdbool.h>
 
@@ -17,7 +18,7 @@
 // 3D Vector structure
 typedef struct
 {
-    double x, y, z;
+    rt_real x, y, z;
 } vec3;
 
 // Alias for vec3. Eseful for geometric.
@@ -25,7 +26,7 @@ typedef vec3 point3;
 
 // Constructor functions
 static inline vec3
-vec3_new( double x, double y, double z )
+vec3_new( rt_real x, rt_real y, rt_real z )
 {
     return (vec3) { x, y, z };
 }
@@ -42,6 +43,13 @@ vec3_one( void )
     return (vec3) { 1.0, 1.0, 1.0 };
 }
 
+// Component access by axis index (0=x, 1=y, 2=z)
+static inline rt_real
+vec3_get( vec3 v, int axis )
+{
+    return ( 0 == axis ) ? v.x : ( ( 1 == axis ) ? v.y : v.z );
+}
+
 // Basic arithmetic operations
 static inline vec3
 vec3_add( vec3 a, vec3 b )
@@ -56,15 +64,15 @@ vec3_sub( vec3 a, vec3 b )
 }
 
 static inline vec3
-vec3_mul( vec3 v, double s )
+vec3_mul( vec3 v, rt_real s )
 {
     return (vec3) { v.x * s, v.y * s, v.z * s };
 }
 
 static inline vec3
-vec3_div( vec3 v, double s )
+vec3_div( vec3 v, rt_real s )
 {
-    double inv_s = 1.0 / s;
+    rt_real inv_s = RT_REAL( 1 ) / s;
     return (vec3) { v.x * inv_s, v.y * inv_s, v.z * inv_s };
 }
 
@@ -88,7 +96,7 @@ vec3_div_vec( vec3 a, vec3 b )
 }
 
 // Vector products
-static inline double
+static inline rt_real
 vec3_dot( vec3 a, vec3 b )
 {
     return a.x * b.x + a.y * b.y + a.z * b.z;
@@ -101,36 +109,36 @@ vec3_cross( vec3 a, vec3 b )
 }
 
 // Magnitude and normalization
-static inline double
+static inline rt_real
 vec3_length_squared( vec3 v )
 {
     return v.x * v.x + v.y * v.y + v.z * v.z;
 }
 
-static inline double
+static inline rt_real
 vec3_length( vec3 v )
 {
-    return sqrt( vec3_length_squared( v ) );
+    return rt_sqrt( vec3_length_squared( v ) );
 }
 
 static inline vec3
 vec3_normalize( vec3 v )
 {
-    double len = vec3_length( v );
-    if( len > 0.0 )
+    rt_real len = vec3_length( v );
+    if( len > RT_REAL( 0 ) )
         {
             return vec3_div( v, len );
         }
     return vec3_zero();
 }
 
-static inline double
+static inline rt_real
 vec3_distance( vec3 a, vec3 b )
 {
     return vec3_length( vec3_sub( a, b ) );
 }
 
-static inline double
+static inline rt_real
 vec3_distance_squared( vec3 a, vec3 b )
 {
     return vec3_length_squared( vec3_sub( a, b ) );
@@ -138,20 +146,20 @@ vec3_distance_squared( vec3 a, vec3 b )
 
 // Interpolation
 static inline vec3
-vec3_lerp( vec3 a, vec3 b, double t )
+vec3_lerp( vec3 a, vec3 b, rt_real t )
 {
     return vec3_add( a, vec3_mul( vec3_sub( b, a ), t ) );
 }
 
 // Comparison functions
 static inline bool
-vec3_equals( vec3 a, vec3 b, double epsilon )
+vec3_equals( vec3 a, vec3 b, rt_real epsilon )
 {
-    return fabs( a.x - b.x ) < epsilon && fabs( a.y - b.y ) < epsilon && fabs( a.z - b.z ) < epsilon;
+    return rt_fabs( a.x - b.x ) < epsilon && rt_fabs( a.y - b.y ) < epsilon && rt_fabs( a.z - b.z ) < epsilon;
 }
 
 static inline bool
-vec3_is_zero( vec3 v, double epsilon )
+vec3_is_zero( vec3 v, rt_real epsilon )
 {
     return vec3_length_squared( v ) < epsilon * epsilon;
 }
@@ -160,13 +168,13 @@ vec3_is_zero( vec3 v, double epsilon )
 static inline vec3
 vec3_min( vec3 a, vec3 b )
 {
-    return (vec3) { fmin( a.x, b.x ), fmin( a.y, b.y ), fmin( a.z, b.z ) };
+    return (vec3) { rt_fmin( a.x, b.x ), rt_fmin( a.y, b.y ), rt_fmin( a.z, b.z ) };
 }
 
 static inline vec3
 vec3_max( vec3 a, vec3 b )
 {
-    return (vec3) { fmax( a.x, b.x ), fmax( a.y, b.y ), fmax( a.z, b.z ) };
+    return (vec3) { rt_fmax( a.x, b.x ), rt_fmax( a.y, b.y ), rt_fmax( a.z, b.z ) };
 }
 
 static inline vec3
@@ -178,32 +186,32 @@ vec3_clamp( vec3 v, vec3 min_v, vec3 max_v )
 static inline vec3
 vec3_abs( vec3 v )
 {
-    return (vec3) { fabs( v.x ), fabs( v.y ), fabs( v.z ) };
+    return (vec3) { rt_fabs( v.x ), rt_fabs( v.y ), rt_fabs( v.z ) };
 }
 
 // Reflection and projection
 static inline vec3
 vec3_reflect( vec3 v, vec3 n )
 {
-    return vec3_sub( v, vec3_mul( n, 2.0 * vec3_dot( v, n ) ) );
+    return vec3_sub( v, vec3_mul( n, RT_REAL( 2 ) * vec3_dot( v, n ) ) );
 }
 
 static inline vec3
-vec3_refract( const vec3 uv, const vec3 n, double etai_over_etat )
+vec3_refract( const vec3 uv, const vec3 n, rt_real etai_over_etat )
 {
-    vec3   neg_uv         = vec3_negate( uv );
-    double cos_theta      = fmin( vec3_dot( neg_uv, n ), 1.0 );
-    vec3   r_out_perp     = vec3_mul( vec3_add( uv, vec3_mul( n, cos_theta ) ), etai_over_etat );
-    vec3   r_out_parallel = vec3_mul( n, -sqrt( fabs( 1.0 - vec3_length_squared( r_out_perp ) ) ) );
+    vec3    neg_uv         = vec3_negate( uv );
+    rt_real cos_theta      = rt_fmin( vec3_dot( neg_uv, n ), RT_REAL( 1 ) );
+    vec3    r_out_perp     = vec3_mul( vec3_add( uv, vec3_mul( n, cos_theta ) ), etai_over_etat );
+    vec3    r_out_parallel = vec3_mul( n, -rt_sqrt( rt_fabs( RT_REAL( 1 ) - vec3_length_squared( r_out_perp ) ) ) );
     return vec3_add( r_out_perp, r_out_parallel );
 }
 
 static inline vec3
 vec3_project( vec3 v, vec3 onto )
 {
-    double dot_product = vec3_dot( v, onto );
-    double length_sq   = vec3_length_squared( onto );
-    if( length_sq > 0.0 )
+    rt_real dot_product = vec3_dot( v, onto );
+    rt_real length_sq   = vec3_length_squared( onto );
+    if( length_sq > RT_REAL( 0 ) )
         {
             return vec3_mul( onto, dot_product / length_sq );
         }
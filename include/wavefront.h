@@ -0,0 +1,53 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "camera.h"   /* camera */
+#include "hittable.h" /* hittable, hit_record */
+#include <stdbool.h>
+#include <stddef.h>
+
+// Number of paths a wavefront state keeps in flight
+#define WAVEFRONT_BATCH 4096
+
+// Iterative path integrator working on batches of paths instead of one recursive path at a time.
+// Path state lives in structure-of-arrays form, and every bounce runs as separate stages over queues of path
+// indices: intersect every active path, shade the hits grouped by material type (one tight loop per type, calling
+// the concrete scatter function directly), then compact the surviving paths into the next active queue.
+//
+// A state is not shared between threads: every render worker owns one.
+typedef struct wavefront_state wavefront_state;
+
+// Allocates a state for batches of WAVEFRONT_BATCH paths.
+//
+// Returns:
+//   The state, or NULL if memory ran out
+wavefront_state * wavefront_create( void );
+
+// Frees a state created by wavefront_create
+void wavefront_destroy( wavefront_state * state );
+
+// Renders the pixels [x0, x1) x [y0, y1) of the image with every sample of every pixel traced as a wavefront path.
+// Each path draws the same random numbers as with the recursive integrator and samples are summed in the same
+// order, so both integrators converge to the same image. The sums are left in the state (see wavefront_tile_sums).
+//
+// Returns:
+//   true on success, false if memory ran out
+bool wavefront_render_tile( wavefront_state * state, const camera * cam, const hittable * world, int x0, int y0,
+                            int x1, int y1 );
+
+// Renders samples [first_sample[k], end_sample[k]) of every pixel k of the tile [x0, x1) x [y0, y1), pixels numbered
+// row by row, like wavefront_render_tile; a pixel may take none. A NULL `first_sample` starts every pixel at sample 0,
+// a NULL `end_sample` ends it at samples_per_pixel. Progressive passes use it to continue each pixel of a film.
+//
+// Returns:
+//   true on success, false if memory ran out
+bool wavefront_render_samples( wavefront_state * state, const camera * cam, const hittable * world, int x0, int y0,
+                               int x1, int y1, const int * first_sample, const int * end_sample );
+
+// Returns the radiance sums of the pixels of the last tile rendered, row by row, each over the samples it took
+const color * wavefront_tile_sums( const wavefront_state * state );
+
+// Returns the sums of the squared luminance of the samples of the same pixels, as adaptive sampling uses them
+const double * wavefront_tile_lum_sq( const wavefront_state * state );
+
+#endif // WAVEFRONT_H
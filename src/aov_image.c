@@ -0,0 +1,36 @@
+#include "aov_image.h"
+#include "rtweekend.h"
+#include <stdio.h>
+#include <stdlib.h> /* calloc, free */
+
+bool
+aov_image_init( aov_image * aov, int width, int height )
+{
+    const size_t pixels = (size_t)RT_MAX( width, 0 ) * (size_t)RT_MAX( height, 0 );
+
+    aov->width  = width;
+    aov->height = height;
+    aov->albedo = (float *)calloc( pixels * 3, sizeof( float ) );
+    aov->normal = (float *)calloc( pixels * 3, sizeof( float ) );
+    aov->depth  = (float *)calloc( pixels, sizeof( float ) );
+    if( NULL == aov->albedo || NULL == aov->normal || NULL == aov->depth )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the %dx%d feature buffers.\n", width, height );
+            aov_image_free( aov );
+            return false;
+        }
+    return true;
+}
+
+void
+aov_image_free( aov_image * aov )
+{
+    free( aov->albedo );
+    free( aov->normal );
+    free( aov->depth );
+    aov->albedo = NULL;
+    aov->normal = NULL;
+    aov->depth  = NULL;
+    aov->width  = 0;
+    aov->height = 0;
+}
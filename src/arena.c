@@ -0,0 +1,84 @@
+#include "arena.h"
+#include <stdint.h> /* uintptr_t */
+#include <stdio.h>
+#include <stdlib.h> /* malloc, free */
+
+typedef struct arena_block
+{
+    struct arena_block * next;
+    size_t               size; // Usable bytes after the header
+    size_t               top;  // Offset of the next free byte
+} arena_block;
+
+// The data of a block starts after its header, rounded up so it keeps the alignment of malloc
+#define BLOCK_HEADER_SIZE ( ( sizeof( arena_block ) + ARENA_ALIGNMENT - 1 ) & ~(size_t)( ARENA_ALIGNMENT - 1 ) )
+
+static inline unsigned char *
+block_data( arena_block * block )
+{
+    return (unsigned char *)block + BLOCK_HEADER_SIZE;
+}
+
+void
+arena_init( arena * a, size_t block_size )
+{
+    a->blocks     = NULL;
+    a->block_size = ( block_size > 0 ) ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    a->used       = 0;
+    a->reserved   = 0;
+}
+
+void *
+arena_alloc( arena * a, size_t size )
+{
+    arena_block * block = a->blocks;
+    size_t        start = 0;
+
+    if( NULL != block )
+        {
+            // Align the address, not just the offset, in case malloc aligns less than ARENA_ALIGNMENT
+            const uintptr_t top = (uintptr_t)( block_data( block ) + block->top );
+            start               = block->top + ( ( ARENA_ALIGNMENT - top % ARENA_ALIGNMENT ) % ARENA_ALIGNMENT );
+        }
+
+    if( NULL == block || start + size > block->size )
+        {
+            // Room for the request plus worst-case alignment padding
+            const size_t needed = size + ARENA_ALIGNMENT;
+            const size_t bytes  = ( needed > a->block_size ) ? needed : a->block_size;
+
+            block               = (arena_block *)malloc( BLOCK_HEADER_SIZE + bytes );
+            if( NULL == block )
+                {
+                    fprintf( stderr, "ERROR: Failed to allocate a %zu byte arena block.\n", bytes );
+                    return NULL;
+                }
+            block->next  = a->blocks;
+            block->size  = bytes;
+            block->top   = 0;
+            a->blocks    = block;
+            a->reserved += bytes;
+
+            const uintptr_t base = (uintptr_t)block_data( block );
+            start                = ( ARENA_ALIGNMENT - base % ARENA_ALIGNMENT ) % ARENA_ALIGNMENT;
+        }
+
+    a->used    += start - block->top + size;
+    block->top  = start + size;
+    return block_data( block ) + start;
+}
+
+void
+arena_free( arena * a )
+{
+    arena_block * block = a->blocks;
+    while( NULL != block )
+        {
+            arena_block * next = block->next;
+            free( block );
+            block = next;
+        }
+    a->blocks   = NULL;
+    a->used     = 0;
+    a->reserved = 0;
+}
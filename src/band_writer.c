@@ -0,0 +1,179 @@
+#include "band_writer.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h> /* malloc, free */
+
+struct band_writer
+{
+    image_encoder * encoder;
+    unsigned char * bands;      // band_count bands of band_bytes each
+    size_t          band_bytes;
+    int             band_count;
+    bool            threaded;   // false when the thread could not start and bands are encoded on submission
+    pthread_t       thread;
+
+    // Shared with the thread, under `lock`
+    pthread_mutex_t lock;
+    pthread_cond_t  band_freed;  // Signalled when a written band returns to the pool
+    pthread_cond_t  band_queued; // Signalled when a band is queued, or the writer is finishing
+    int *           free_bands;  // Stack of the bands not in use
+    int             free_count;
+    int *           queue;       // Ring of queued bands, in image order
+    int *           queue_rows;  // Rows of each queued band
+    int             queue_head;
+    int             queue_count;
+    bool            finishing;
+    bool            failed;
+};
+
+// Encodes band `index`, unless an earlier band failed, and returns it to the pool. Called with the lock released.
+static void
+write_band( band_writer * writer, int index, int rows, bool skip )
+{
+    const bool ok = skip
+                 || image_encoder_write_rows( writer->encoder, writer->bands + (size_t)index * writer->band_bytes,
+                                              rows );
+
+    pthread_mutex_lock( &writer->lock );
+    writer->failed                           = writer->failed || !ok;
+    writer->free_bands[writer->free_count++] = index;
+    pthread_cond_signal( &writer->band_freed );
+    pthread_mutex_unlock( &writer->lock );
+}
+
+static void *
+writer_main( void * arg )
+{
+    band_writer * writer = (band_writer *)arg;
+
+    pthread_mutex_lock( &writer->lock );
+    for( ;; )
+        {
+            while( 0 == writer->queue_count && !writer->finishing )
+                {
+                    pthread_cond_wait( &writer->band_queued, &writer->lock );
+                }
+            if( 0 == writer->queue_count ) break;
+
+            const int  index   = writer->queue[writer->queue_head];
+            const int  rows    = writer->queue_rows[writer->queue_head];
+            const bool skip    = writer->failed;
+            writer->queue_head = ( writer->queue_head + 1 ) % writer->band_count;
+            --writer->queue_count;
+            pthread_mutex_unlock( &writer->lock );
+
+            write_band( writer, index, rows, skip );
+            pthread_mutex_lock( &writer->lock );
+        }
+    pthread_mutex_unlock( &writer->lock );
+    return NULL;
+}
+
+static void
+band_writer_free( band_writer * writer )
+{
+    free( writer->bands );
+    free( writer->free_bands );
+    free( writer->queue );
+    free( writer->queue_rows );
+    free( writer );
+}
+
+band_writer *
+band_writer_start( image_encoder * encoder, int width, int band_rows, int band_count )
+{
+    if( NULL == encoder || width <= 0 || band_rows <= 0 || band_count <= 0 )
+        {
+            fprintf( stderr, "ERROR: Cannot write bands of %d rows of %d pixels, %d at a time.\n", band_rows, width,
+                     band_count );
+            return NULL;
+        }
+
+    band_writer * writer = (band_writer *)calloc( 1, sizeof( band_writer ) );
+    if( NULL == writer )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the band writer.\n" );
+            return NULL;
+        }
+
+    writer->encoder    = encoder;
+    writer->band_bytes = (size_t)width * band_rows * RT_IMAGE_DATA_CHANNELS;
+    writer->band_count = band_count;
+    writer->bands      = (unsigned char *)malloc( writer->band_bytes * band_count );
+    writer->free_bands = (int *)malloc( band_count * sizeof( int ) );
+    writer->queue      = (int *)malloc( band_count * sizeof( int ) );
+    writer->queue_rows = (int *)malloc( band_count * sizeof( int ) );
+    if( NULL == writer->bands || NULL == writer->free_bands || NULL == writer->queue || NULL == writer->queue_rows )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the band writer.\n" );
+            band_writer_free( writer );
+            return NULL;
+        }
+    for( int b = 0; b < band_count; ++b )
+        {
+            writer->free_bands[b] = band_count - 1 - b;
+        }
+    writer->free_count = band_count;
+
+    pthread_mutex_init( &writer->lock, NULL );
+    pthread_cond_init( &writer->band_freed, NULL );
+    pthread_cond_init( &writer->band_queued, NULL );
+    writer->threaded = 0 == pthread_create( &writer->thread, NULL, writer_main, writer );
+    if( !writer->threaded ) fprintf( stderr, "WARN: Failed to start the image writer, writing while rendering.\n" );
+    return writer;
+}
+
+unsigned char *
+band_writer_acquire( band_writer * writer )
+{
+    pthread_mutex_lock( &writer->lock );
+    while( 0 == writer->free_count )
+        {
+            pthread_cond_wait( &writer->band_freed, &writer->lock );
+        }
+    const int index = writer->free_bands[--writer->free_count];
+    pthread_mutex_unlock( &writer->lock );
+    return writer->bands + (size_t)index * writer->band_bytes;
+}
+
+void
+band_writer_submit( band_writer * writer, unsigned char * band, int rows )
+{
+    const int index = (int)( ( band - writer->bands ) / writer->band_bytes );
+    if( !writer->threaded )
+        {
+            write_band( writer, index, rows, writer->failed );
+            return;
+        }
+
+    // A band is only queued after it was acquired, so the ring, as large as the pool, always has room
+    pthread_mutex_lock( &writer->lock );
+    const int tail           = ( writer->queue_head + writer->queue_count ) % writer->band_count;
+    writer->queue[tail]      = index;
+    writer->queue_rows[tail] = rows;
+    ++writer->queue_count;
+    pthread_cond_signal( &writer->band_queued );
+    pthread_mutex_unlock( &writer->lock );
+}
+
+bool
+band_writer_finish( band_writer * writer )
+{
+    if( NULL == writer ) return false;
+
+    if( writer->threaded )
+        {
+            pthread_mutex_lock( &writer->lock );
+            writer->finishing = true;
+            pthread_cond_signal( &writer->band_queued );
+            pthread_mutex_unlock( &writer->lock );
+            pthread_join( writer->thread, NULL );
+        }
+
+    const bool ok = !writer->failed;
+    pthread_cond_destroy( &writer->band_queued );
+    pthread_cond_destroy( &writer->band_freed );
+    pthread_mutex_destroy( &writer->lock );
+    band_writer_free( writer );
+    return ok;
+}
@@ -0,0 +1,223 @@
+#include "bvh.h"
+#include "bvh_flat.h" /* BVH_FLAT_STACK_SIZE */
+#include <stdio.h>
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
+
+// Number of centroid bins evaluated per axis by the surface area heuristic
+#define BVH_BIN_COUNT 16
+
+// Below this depth nodes are split by the surface area heuristic; deeper nodes are halved by object count, which
+// bounds the depth of any tree of up to 2^32 objects by BVH_FLAT_STACK_SIZE, so bvh_flat_build always accepts it
+#define BVH_MEDIAN_SPLIT_DEPTH ( BVH_FLAT_STACK_SIZE - 32 )
+
+typedef struct
+{
+    aabb   bounds;
+    size_t count;
+} bvh_bin;
+
+// Maps a centroid coordinate to its bin along the current axis
+static inline int
+bvh_bin_index( double centroid, double axis_min, double bin_scale )
+{
+    int b = (int)( ( centroid - axis_min ) * bin_scale );
+    if( b < 0 ) return 0;
+    if( b >= BVH_BIN_COUNT ) return BVH_BIN_COUNT - 1;
+    return b;
+}
+
+// Picks the bin boundary with the lowest SAH cost over all three axes and partitions `objects` around it.
+// Falls back to an even split by count when every centroid coincides.
+//
+// Returns:
+//   The number of objects that go to the left child, in [1, count)
+static size_t
+bvh_partition_sah( hittable ** objects, size_t count )
+{
+    aabb centroid_bounds = aabb_empty();
+    for( size_t i = 0; i < count; ++i )
+        {
+            centroid_bounds = aabb_union_point( centroid_bounds, aabb_centroid( objects[i]->bbox ) );
+        }
+
+    double best_cost  = INFINITY;
+    int    best_axis  = -1;
+    int    best_split = 0; // Last bin of the left side
+
+    for( int axis = 0; axis < 3; ++axis )
+        {
+            double axis_min = vec3_get( centroid_bounds.min, axis );
+            double extent   = vec3_get( centroid_bounds.max, axis ) - axis_min;
+            if( extent <= 0.0 ) continue;
+
+            double  scale = BVH_BIN_COUNT / extent;
+            bvh_bin bins[BVH_BIN_COUNT];
+            for( int b = 0; b < BVH_BIN_COUNT; ++b )
+                {
+                    bins[b].bounds = aabb_empty();
+                    bins[b].count  = 0;
+                }
+
+            for( size_t i = 0; i < count; ++i )
+                {
+                    int b = bvh_bin_index( vec3_get( aabb_centroid( objects[i]->bbox ), axis ), axis_min, scale );
+                    bins[b].bounds = aabb_union( bins[b].bounds, objects[i]->bbox );
+                    bins[b].count++;
+                }
+
+            // Sweep from the right to collect the cost terms of every right-hand side...
+            double right_area[BVH_BIN_COUNT];
+            size_t right_count[BVH_BIN_COUNT];
+            aabb   acc = aabb_empty();
+            size_t n   = 0;
+            for( int b = BVH_BIN_COUNT - 1; b > 0; --b )
+                {
+                    acc            = aabb_union( acc, bins[b].bounds );
+                    n             += bins[b].count;
+                    right_area[b]  = aabb_surface_area( acc );
+                    right_count[b] = n;
+                }
+
+            // ...then from the left, evaluating the split after each bin
+            acc = aabb_empty();
+            n   = 0;
+            for( int b = 0; b < BVH_BIN_COUNT - 1; ++b )
+                {
+                    acc  = aabb_union( acc, bins[b].bounds );
+                    n   += bins[b].count;
+                    if( 0 == n || 0 == right_count[b + 1] ) continue;
+
+                    double cost = n * aabb_surface_area( acc ) + right_count[b + 1] * right_area[b + 1];
+                    if( cost < best_cost )
+                        {
+                            best_cost  = cost;
+                            best_axis  = axis;
+                            best_split = b;
+                        }
+                }
+        }
+
+    if( best_axis < 0 ) return count / 2;
+
+    double axis_min = vec3_get( centroid_bounds.min, best_axis );
+    double scale    = BVH_BIN_COUNT / ( vec3_get( centroid_bounds.max, best_axis ) - axis_min );
+    size_t mid      = 0;
+    for( size_t i = 0; i < count; ++i )
+        {
+            double c = vec3_get( aabb_centroid( objects[i]->bbox ), best_axis );
+            if( bvh_bin_index( c, axis_min, scale ) <= best_split )
+                {
+                    hittable * tmp = objects[i];
+                    objects[i]     = objects[mid];
+                    objects[mid++] = tmp;
+                }
+        }
+
+    return mid;
+}
+
+// Recursively builds the subtree over objects[0..count), at `depth` below the root, reordering the array in place
+static hittable *
+bvh_build_range( hittable ** objects, size_t count, int depth )
+{
+    if( 1 == count ) return objects[0];
+
+    bvh_node * node = (bvh_node *)malloc( sizeof( bvh_node ) );
+    if( NULL == node ) return NULL;
+
+    size_t left_count = ( 2 == count || depth >= BVH_MEDIAN_SPLIT_DEPTH ) ? count / 2
+                                                                          : bvh_partition_sah( objects, count );
+
+    node->left        = bvh_build_range( objects, left_count, depth + 1 );
+    node->right       = bvh_build_range( objects + left_count, count - left_count, depth + 1 );
+    if( NULL == node->left || NULL == node->right )
+        {
+            bvh_node_free( node->left );
+            bvh_node_free( node->right );
+            free( node );
+            return NULL;
+        }
+
+    node->base.hit         = bvh_node_hit;
+    node->base.material_id = MATERIAL_ID_NONE;
+    node->base.bbox        = aabb_union( node->left->bbox, node->right->bbox );
+    return (hittable *)node;
+}
+
+hittable *
+bvh_node_build( const hittable_list * list )
+{
+    if( NULL == list || 0 == list->count ) return NULL;
+
+    // Work on a copy: the build reorders the pointers and the list must stay as the caller left it
+    hittable ** objects = (hittable **)malloc( list->count * sizeof( hittable * ) );
+    if( NULL == objects )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the BVH build.\n" );
+            return NULL;
+        }
+    memcpy( objects, list->objects, list->count * sizeof( hittable * ) );
+
+    hittable * root = NULL;
+    if( 1 == list->count )
+        {
+            bvh_node * node = (bvh_node *)malloc( sizeof( bvh_node ) );
+            if( NULL != node )
+                {
+                    node->base.hit         = bvh_node_hit;
+                    node->base.material_id = MATERIAL_ID_NONE;
+                    node->base.bbox        = objects[0]->bbox;
+                    node->left             = objects[0];
+                    node->right            = NULL;
+                    root                   = (hittable *)node;
+                }
+        }
+    else
+        {
+            root = bvh_build_range( objects, list->count, 0 );
+        }
+
+    if( NULL == root )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for BVH nodes.\n" );
+        }
+
+    free( objects );
+    return root;
+}
+
+void
+bvh_node_free( hittable * root )
+{
+    // Children that are not interior nodes are primitives owned by someone else
+    if( NULL == root || bvh_node_hit != root->hit ) return;
+
+    bvh_node * node = (bvh_node *)root;
+    bvh_node_free( node->left );
+    bvh_node_free( node->right );
+    free( node );
+}
+
+size_t
+bvh_node_count( const hittable * root )
+{
+    if( NULL == root || bvh_node_hit != root->hit ) return 0;
+
+    const bvh_node * node = (const bvh_node *)root;
+    return 1 + bvh_node_count( node->left ) + bvh_node_count( node->right );
+}
+
+bool
+bvh_node_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
+{
+    const bvh_node * node = (const bvh_node *)object;
+
+    if( !aabb_hit( &node->base.bbox, r, ray_tmin, ray_tmax ) ) return false;
+
+    bool hit_left  = node->left->hit( node->left, r, ray_tmin, ray_tmax, rec );
+    bool hit_right = ( NULL != node->right )
+                  && node->right->hit( node->right, r, ray_tmin, hit_left ? rec->t : ray_tmax, rec );
+
+    return hit_left || hit_right;
+}
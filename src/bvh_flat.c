@@ -0,0 +1,572 @@
+#define _POSIX_C_SOURCE 200809L /* posix_memalign */
+
+#include "bvh_flat.h"
+#include "bvh.h"
+#include "rtweekend.h"
+#include "stats.h"
+#include <math.h>    /* nextafterf, isfinite */
+#include <pthread.h> /* pthread_once */
+#include <stdio.h>
+#include <stdlib.h>  /* posix_memalign, malloc, free */
+
+// Compile-time check that a node is exactly 32 bytes
+typedef char bvh_flat_node_size_check[( sizeof( bvh_flat_node ) == 32 ) ? 1 : -1];
+
+// State of a flatten pass
+typedef struct
+{
+    bvh_flat * bvh;
+    size_t     next_node;
+    size_t     next_primitive;
+} bvh_flatten;
+
+static inline bool
+is_interior( const hittable * object )
+{
+    return NULL != object && bvh_node_hit == object->hit;
+}
+
+// A bvh_node whose children are all primitives is emitted as one leaf
+static inline bool
+is_leaf_pair( const bvh_node * node )
+{
+    return !is_interior( node->left ) && !is_interior( node->right );
+}
+
+// Rounds towards -infinity / +infinity so the float box always encloses the double box
+static inline float
+round_down( double x )
+{
+    float f = (float)x;
+    return ( (double)f > x ) ? nextafterf( f, -INFINITY ) : f;
+}
+
+static inline float
+round_up( double x )
+{
+    float f = (float)x;
+    return ( (double)f < x ) ? nextafterf( f, INFINITY ) : f;
+}
+
+void
+bvh_flat_node_set_bounds( bvh_flat_node * node, aabb box )
+{
+    node->min[0] = round_down( box.min.x );
+    node->min[1] = round_down( box.min.y );
+    node->min[2] = round_down( box.min.z );
+    node->max[0] = round_up( box.max.x );
+    node->max[1] = round_up( box.max.y );
+    node->max[2] = round_up( box.max.z );
+}
+
+// Counts the nodes and primitives the flattened copy of `object` needs
+static void
+count_subtree( const hittable * object, size_t * nodes, size_t * primitives, int depth, int * max_depth )
+{
+    if( NULL == object ) return;
+
+    if( depth > *max_depth ) *max_depth = depth;
+    ++*nodes;
+
+    if( !is_interior( object ) )
+        {
+            ++*primitives;
+            return;
+        }
+
+    const bvh_node * node = (const bvh_node *)object;
+    if( is_leaf_pair( node ) )
+        {
+            *primitives += ( NULL != node->right ) ? 2 : 1;
+            return;
+        }
+
+    count_subtree( node->left, nodes, primitives, depth + 1, max_depth );
+    count_subtree( node->right, nodes, primitives, depth + 1, max_depth );
+}
+
+// Emits `object` and its subtree in depth-first order
+static void
+flatten_subtree( bvh_flatten * state, const hittable * object )
+{
+    bvh_flat *      bvh  = state->bvh;
+    bvh_flat_node * node = &bvh->nodes[state->next_node++];
+    bvh_flat_node_set_bounds( node, object->bbox );
+
+    if( !is_interior( object ) )
+        {
+            node->offset                             = (uint32_t)state->next_primitive;
+            node->count                              = 1;
+            bvh->primitives[state->next_primitive++] = (hittable *)object;
+            return;
+        }
+
+    const bvh_node * tree = (const bvh_node *)object;
+    if( is_leaf_pair( tree ) )
+        {
+            node->offset                             = (uint32_t)state->next_primitive;
+            node->count                              = ( NULL != tree->right ) ? 2 : 1;
+            bvh->primitives[state->next_primitive++] = tree->left;
+            if( NULL != tree->right ) bvh->primitives[state->next_primitive++] = tree->right;
+            return;
+        }
+
+    // Interior: the first child follows immediately, the second child's index is patched in once known
+    node->count = 0;
+    flatten_subtree( state, tree->left );
+    node->offset = (uint32_t)state->next_node;
+    flatten_subtree( state, tree->right );
+}
+
+bvh_flat *
+bvh_flat_build( const hittable * root )
+{
+    // An empty tree still gets a root node, with empty bounds no ray enters
+    size_t node_count      = 1;
+    size_t primitive_count = 0;
+    int    max_depth       = 0;
+    if( NULL != root )
+        {
+            node_count = 0;
+            count_subtree( root, &node_count, &primitive_count, 1, &max_depth );
+        }
+
+    if( max_depth > BVH_FLAT_STACK_SIZE )
+        {
+            fprintf( stderr, "ERROR: BVH depth %d exceeds the flat traversal stack (%d).\n", max_depth,
+                     BVH_FLAT_STACK_SIZE );
+            return NULL;
+        }
+
+    bvh_flat * bvh = (bvh_flat *)malloc( sizeof( bvh_flat ) );
+    void *     mem = NULL;
+    if( NULL == bvh || 0 != posix_memalign( &mem, 32, node_count * sizeof( bvh_flat_node ) ) )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the flat BVH.\n" );
+            free( bvh );
+            return NULL;
+        }
+
+    bvh->nodes           = (bvh_flat_node *)mem;
+    bvh->node_count      = node_count;
+    bvh->primitive_count = primitive_count;
+    bvh->primitives      = (hittable **)malloc( RT_MAX( primitive_count, (size_t)1 ) * sizeof( hittable * ) );
+    if( NULL == bvh->primitives )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the flat BVH.\n" );
+            bvh_flat_free( bvh );
+            return NULL;
+        }
+
+    bvh->base.hit         = bvh_flat_hit;
+    bvh->base.material_id = MATERIAL_ID_NONE;
+    bvh->base.bbox        = aabb_empty();
+    if( NULL == root )
+        {
+            bvh_flat_node_set_bounds( &bvh->nodes[0], bvh->base.bbox );
+            bvh->nodes[0].offset = 0;
+            bvh->nodes[0].count  = 0;
+            return bvh;
+        }
+
+    bvh_flatten state = { bvh, 0, 0 };
+    flatten_subtree( &state, root );
+    bvh->base.bbox = root->bbox;
+    return bvh;
+}
+
+void
+bvh_flat_free( bvh_flat * bvh )
+{
+    if( NULL == bvh ) return;
+    free( bvh->nodes );
+    free( bvh->primitives );
+    free( bvh );
+}
+
+size_t
+bvh_flat_memory( const bvh_flat * bvh )
+{
+    if( NULL == bvh ) return 0;
+    return sizeof( bvh_flat ) + bvh->node_count * sizeof( bvh_flat_node )
+         + bvh->primitive_count * sizeof( hittable * );
+}
+
+bool
+bvh_flat_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
+{
+    const bvh_flat *      bvh   = (const bvh_flat *)object;
+    const bvh_flat_node * nodes = bvh->nodes;
+    if( 0 == bvh->primitive_count ) return false;
+
+    bvh_flat_ray fr;
+    bvh_flat_ray_init( &fr, r );
+
+    rt_real t_entry;
+    if( !bvh_flat_node_hit( &nodes[0], &fr, ray_tmin, ray_tmax, &t_entry ) ) return false;
+
+    // Deferred far children, with the distance at which the ray enters them
+    uint32_t stack_node[BVH_FLAT_STACK_SIZE];
+    rt_real  stack_t[BVH_FLAT_STACK_SIZE];
+    int      sp             = 0;
+
+    bool     hit_anything   = false;
+    rt_real  closest_so_far = ray_tmax;
+    uint32_t index          = 0;
+
+    for( ;; )
+        {
+            const bvh_flat_node * node = &nodes[index];
+            STATS_INC( STATS_BVH_NODES );
+
+            if( node->count > 0 )
+                {
+                    STATS_ADD( STATS_OBJECT_CALLS, node->count );
+                    for( uint32_t i = 0; i < node->count; ++i )
+                        {
+                            const hittable * prim = bvh->primitives[node->offset + i];
+                            if( prim->hit( prim, r, ray_tmin, closest_so_far, rec ) )
+                                {
+                                    hit_anything   = true;
+                                    closest_so_far = rec->t;
+                                }
+                        }
+                }
+            else
+                {
+                    uint32_t first  = index + 1;
+                    uint32_t second = node->offset;
+                    rt_real  t_first, t_second;
+                    bool     hit_first  = bvh_flat_node_hit( &nodes[first], &fr, ray_tmin, closest_so_far, &t_first );
+                    bool     hit_second = bvh_flat_node_hit( &nodes[second], &fr, ray_tmin, closest_so_far,
+                                                             &t_second );
+
+                    if( hit_first && hit_second )
+                        {
+                            // Continue with the nearer child, defer the farther one
+                            bool first_is_near = ( t_first <= t_second );
+                            stack_node[sp]     = first_is_near ? second : first;
+                            stack_t[sp]        = first_is_near ? t_second : t_first;
+                            ++sp;
+                            index = first_is_near ? first : second;
+                            continue;
+                        }
+                    if( hit_first || hit_second )
+                        {
+                            index = hit_first ? first : second;
+                            continue;
+                        }
+                }
+
+            // Pop the next deferred subtree that can still contain a closer hit
+            do
+                {
+                    if( 0 == sp ) return hit_anything;
+                    --sp;
+                }
+            while( stack_t[sp] >= closest_so_far );
+            index = stack_node[sp];
+        }
+}
+
+// Ray data of a packet in structure-of-arrays layout, so the per-ray slab tests of a node vectorize
+typedef struct
+{
+    rt_real origin[3][RAY_PACKET_MAX];
+    rt_real inv_dir[3][RAY_PACKET_MAX];
+} bvh_flat_packet_rays;
+
+// Bounds over every ray of a packet: origins and reciprocal directions, per axis
+typedef struct
+{
+    rt_real origin_min[3], origin_max[3];
+    rt_real inv_min[3], inv_max[3];
+} bvh_flat_interval;
+
+static inline rt_real
+min_real( rt_real a, rt_real b )
+{
+    return ( a < b ) ? a : b;
+}
+
+static inline rt_real
+max_real( rt_real a, rt_real b )
+{
+    return ( a > b ) ? a : b;
+}
+
+// Fills `ia` from the per-ray data. Interval arithmetic needs the reciprocal directions of an axis to share
+// one sign; a packet where they do not (or one is zero) is incoherent and gets no interval culling.
+//
+// Returns:
+//   true if the packet is coherent
+static bool
+interval_init( bvh_flat_interval * ia, const bvh_flat_packet_rays * pr, int count )
+{
+    for( int axis = 0; axis < 3; ++axis )
+        {
+            const rt_real * origin = pr->origin[axis];
+            const rt_real * inv    = pr->inv_dir[axis];
+            ia->origin_min[axis]  = ia->origin_max[axis] = origin[0];
+            ia->inv_min[axis]     = ia->inv_max[axis] = inv[0];
+            for( int i = 1; i < count; ++i )
+                {
+                    ia->origin_min[axis] = min_real( ia->origin_min[axis], origin[i] );
+                    ia->origin_max[axis] = max_real( ia->origin_max[axis], origin[i] );
+                    ia->inv_min[axis]    = min_real( ia->inv_min[axis], inv[i] );
+                    ia->inv_max[axis]    = max_real( ia->inv_max[axis], inv[i] );
+                }
+
+            bool same_sign = ( ia->inv_min[axis] > RT_REAL( 0 ) ) || ( ia->inv_max[axis] < RT_REAL( 0 ) );
+            if( !same_sign || !isfinite( ia->inv_min[axis] ) || !isfinite( ia->inv_max[axis] ) ) return false;
+        }
+    return true;
+}
+
+// Smallest and largest product of the intervals [a0, a1] and [i0, i1]
+static inline void
+interval_mul( rt_real a0, rt_real a1, rt_real i0, rt_real i1, rt_real * lo, rt_real * hi )
+{
+    rt_real p0 = a0 * i0, p1 = a0 * i1, p2 = a1 * i0, p3 = a1 * i1;
+    *lo       = min_real( min_real( p0, p1 ), min_real( p2, p3 ) );
+    *hi       = max_real( max_real( p0, p1 ), max_real( p2, p3 ) );
+}
+
+// Conservative slab test of the whole packet: false only if no ray can hit the node within its interval.
+// Rounded arithmetic is monotonic, so the bounds hold for the exact per-ray slab distances as well; the exit bound
+// is widened by BVH_FLAT_EXIT_SCALE like the per-ray test, so no ray that test accepts is culled here.
+static inline bool
+interval_hit( const bvh_flat_node * node, const bvh_flat_interval * ia, rt_real ray_tmin, rt_real packet_tmax )
+{
+    rt_real entry = ray_tmin;
+    rt_real exit  = packet_tmax;
+    for( int axis = 0; axis < 3; ++axis )
+        {
+            // Every ray of a coherent packet enters through the same slab plane of this axis
+            bool    positive = ia->inv_min[axis] > RT_REAL( 0 );
+            rt_real near     = positive ? node->min[axis] : node->max[axis];
+            rt_real far      = positive ? node->max[axis] : node->min[axis];
+            rt_real near_lo, near_hi, far_lo, far_hi;
+            interval_mul( near - ia->origin_max[axis], near - ia->origin_min[axis], ia->inv_min[axis],
+                          ia->inv_max[axis], &near_lo, &near_hi );
+            interval_mul( far - ia->origin_max[axis], far - ia->origin_min[axis], ia->inv_min[axis], ia->inv_max[axis],
+                          &far_lo, &far_hi );
+
+            entry = max_real( entry, near_lo );
+            exit  = min_real( exit, far_hi * BVH_FLAT_EXIT_SCALE );
+            if( exit <= entry ) return false;
+        }
+    return true;
+}
+
+// Slab test of the rays [first, last) against a node, storing in enter[i] whether ray i enters it.
+// Branch-free form of bvh_flat_node_hit with the same result for every ray, exit scale included.
+//
+// Returns:
+//   The number of rays entering the node
+static inline int
+packet_node_hit( const bvh_flat_node * node, const bvh_flat_packet_rays * pr, const rt_real * ray_tmax,
+                 rt_real ray_tmin, int first, int last, unsigned char * enter )
+{
+    const rt_real min_x = node->min[0], min_y = node->min[1], min_z = node->min[2];
+    const rt_real max_x = node->max[0], max_y = node->max[1], max_z = node->max[2];
+    const rt_real * ox = pr->origin[0], * oy = pr->origin[1], * oz = pr->origin[2];
+    const rt_real * ix = pr->inv_dir[0], * iy = pr->inv_dir[1], * iz = pr->inv_dir[2];
+
+    int entering = 0;
+    for( int i = first; i < last; ++i )
+        {
+            rt_real x0     = ( min_x - ox[i] ) * ix[i];
+            rt_real x1     = ( max_x - ox[i] ) * ix[i];
+            rt_real y0     = ( min_y - oy[i] ) * iy[i];
+            rt_real y1     = ( max_y - oy[i] ) * iy[i];
+            rt_real z0     = ( min_z - oz[i] ) * iz[i];
+            rt_real z1     = ( max_z - oz[i] ) * iz[i];
+
+            rt_real t_near = ray_tmin;
+            rt_real t_far  = ray_tmax[i];
+            rt_real xn = ( ix[i] < RT_REAL( 0 ) ) ? x1 : x0, xf = ( ix[i] < RT_REAL( 0 ) ) ? x0 : x1;
+            rt_real yn = ( iy[i] < RT_REAL( 0 ) ) ? y1 : y0, yf = ( iy[i] < RT_REAL( 0 ) ) ? y0 : y1;
+            rt_real zn = ( iz[i] < RT_REAL( 0 ) ) ? z1 : z0, zf = ( iz[i] < RT_REAL( 0 ) ) ? z0 : z1;
+            xf            *= BVH_FLAT_EXIT_SCALE;
+            yf            *= BVH_FLAT_EXIT_SCALE;
+            zf            *= BVH_FLAT_EXIT_SCALE;
+            t_near         = ( xn > t_near ) ? xn : t_near;
+            t_far          = ( xf < t_far ) ? xf : t_far;
+            t_near         = ( yn > t_near ) ? yn : t_near;
+            t_far          = ( yf < t_far ) ? yf : t_far;
+            t_near         = ( zn > t_near ) ? zn : t_near;
+            t_far          = ( zf < t_far ) ? zf : t_far;
+
+            int in         = ( t_far > t_near );
+            enter[i]       = (unsigned char)in;
+            entering      += in;
+        }
+    return entering;
+}
+
+typedef int ( *packet_node_hit_fn )( const bvh_flat_node * node, const bvh_flat_packet_rays * pr,
+                                     const rt_real * ray_tmax, rt_real ray_tmin, int first, int last,
+                                     unsigned char * enter );
+
+static int
+packet_node_hit_default( const bvh_flat_node * node, const bvh_flat_packet_rays * pr, const rt_real * ray_tmax,
+                         rt_real ray_tmin, int first, int last, unsigned char * enter )
+{
+    return packet_node_hit( node, pr, ray_tmax, ray_tmin, first, last, enter );
+}
+
+static pthread_once_t     packet_node_hit_once = PTHREAD_ONCE_INIT;
+static packet_node_hit_fn packet_node_hit_selected;
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+// The same loop compiled for AVX2, where the compiler vectorizes it four rays (eight in single precision) at a time
+__attribute__( ( target( "avx2" ) ) ) static int
+packet_node_hit_avx2( const bvh_flat_node * node, const bvh_flat_packet_rays * pr, const rt_real * ray_tmax,
+                      rt_real ray_tmin, int first, int last, unsigned char * enter )
+{
+    return packet_node_hit( node, pr, ray_tmax, ray_tmin, first, last, enter );
+}
+
+static void
+init_packet_node_hit( void )
+{
+    __builtin_cpu_init();
+    packet_node_hit_selected = __builtin_cpu_supports( "avx2" ) ? packet_node_hit_avx2 : packet_node_hit_default;
+}
+#else
+static void
+init_packet_node_hit( void )
+{
+    packet_node_hit_selected = packet_node_hit_default;
+}
+#endif
+
+// Returns the slab kernel for this CPU, chosen by the first packet traced
+static packet_node_hit_fn
+select_packet_node_hit( void )
+{
+    pthread_once( &packet_node_hit_once, init_packet_node_hit );
+    return packet_node_hit_selected;
+}
+
+int
+bvh_flat_hit_packet( const bvh_flat * bvh, ray_packet * packet, rt_real ray_tmin )
+{
+    const bvh_flat_node * nodes = bvh->nodes;
+    const int             count = packet->count;
+    if( count <= 0 || 0 == bvh->primitive_count ) return 0;
+
+    bvh_flat_packet_rays pr;
+    rt_real              packet_tmax = packet->tmax[0];
+    for( int i = 0; i < count; ++i )
+        {
+            const ray * r       = &packet->rays[i];
+            pr.origin[0][i]     = r->orig.x;
+            pr.origin[1][i]     = r->orig.y;
+            pr.origin[2][i]     = r->orig.z;
+            pr.inv_dir[0][i]    = RT_REAL( 1 ) / r->dir.x;
+            pr.inv_dir[1][i]    = RT_REAL( 1 ) / r->dir.y;
+            pr.inv_dir[2][i]    = RT_REAL( 1 ) / r->dir.z;
+            packet_tmax         = max_real( packet_tmax, packet->tmax[i] );
+        }
+
+    bvh_flat_interval        ia;
+    const bool               coherent  = interval_init( &ia, &pr, count );
+    const packet_node_hit_fn node_test = select_packet_node_hit();
+
+    // Pending subtrees, with the range of rays [first, last) that may still be active in them. Both children are
+    // pushed at once, so the stack can be one entry per level deeper than the single-ray one.
+    uint32_t      stack_node[BVH_FLAT_STACK_SIZE + 1];
+    int           stack_first[BVH_FLAT_STACK_SIZE + 1];
+    int           stack_last[BVH_FLAT_STACK_SIZE + 1];
+    int           sp = 1;
+    unsigned char enter[RAY_PACKET_MAX];
+
+    stack_node[0]    = 0;
+    stack_first[0]   = 0;
+    stack_last[0]    = count;
+
+    while( sp > 0 )
+        {
+            --sp;
+            const uint32_t        index = stack_node[sp];
+            const bvh_flat_node * node  = &nodes[index];
+            int                   first = stack_first[sp];
+            int                   last  = stack_last[sp];
+
+            STATS_INC( STATS_BVH_NODES );
+            if( coherent && !interval_hit( node, &ia, ray_tmin, packet_tmax ) ) continue;
+            if( 0 == node_test( node, &pr, packet->tmax, ray_tmin, first, last, enter ) ) continue;
+
+            // Narrow the range to the rays that actually enter the node
+            while( !enter[first] )
+                {
+                    ++first;
+                }
+            while( !enter[last - 1] )
+                {
+                    --last;
+                }
+
+            if( node->count > 0 )
+                {
+                    for( int i = first; i < last; ++i )
+                        {
+                            if( !enter[i] ) continue;
+
+                            STATS_ADD( STATS_OBJECT_CALLS, node->count );
+                            for( uint32_t p = 0; p < node->count; ++p )
+                                {
+                                    const hittable * prim = bvh->primitives[node->offset + p];
+                                    const ray *      r    = &packet->rays[i];
+                                    if( prim->hit( prim, r, ray_tmin, packet->tmax[i], &packet->rec[i] ) )
+                                        {
+                                            packet->hit[i]  = true;
+                                            packet->tmax[i] = packet->rec[i].t;
+                                        }
+                                }
+                        }
+
+                    // Hits only ever shrink the intervals, so the packet bound can only tighten
+                    if( coherent )
+                        {
+                            packet_tmax = packet->tmax[0];
+                            for( int i = 1; i < count; ++i )
+                                {
+                                    packet_tmax = max_real( packet_tmax, packet->tmax[i] );
+                                }
+                        }
+                    continue;
+                }
+
+            // Visit first the child nearer to the first active ray
+            bvh_flat_ray fr;
+            for( int axis = 0; axis < 3; ++axis )
+                {
+                    fr.origin[axis]  = pr.origin[axis][first];
+                    fr.inv_dir[axis] = pr.inv_dir[axis][first];
+                }
+
+            uint32_t child_a    = index + 1;
+            uint32_t child_b    = node->offset;
+            rt_real  t_a        = INFINITY;
+            rt_real  t_b        = INFINITY;
+            bvh_flat_node_hit( &nodes[child_a], &fr, ray_tmin, packet->tmax[first], &t_a );
+            bvh_flat_node_hit( &nodes[child_b], &fr, ray_tmin, packet->tmax[first], &t_b );
+
+            bool a_is_near      = ( t_a <= t_b );
+            stack_node[sp]      = a_is_near ? child_b : child_a;
+            stack_node[sp + 1]  = a_is_near ? child_a : child_b;
+            stack_first[sp]     = stack_first[sp + 1] = first;
+            stack_last[sp]      = stack_last[sp + 1] = last;
+            sp                 += 2;
+        }
+
+    int hits = 0;
+    for( int i = 0; i < count; ++i )
+        {
+            hits += packet->hit[i];
+        }
+    return hits;
+}
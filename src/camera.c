@@ -1,43 +1,115 @@
 #include "camera.h"
+#include "aov_image.h"
+#include "bvh_flat.h"
 #include "color.h"
+#include "film.h"
 #include "hittable.h"
-#include "material.h"
+#include "material_table.h"
+#include "postprocess.h"
+#include "ray_packet.h"
 #include "rtweekend.h"
+#include "stats.h"
+#include "tile_scheduler.h"
+#include "wavefront.h"
 #include <float.h>
 #include <math.h> /* tan, M_PI */
 #include <stdio.h>
+#include <stdlib.h> /* calloc, free */
+#include <string.h> /* strcmp */
 
-// Computes the color for a given ray
-static color
-ray_color( const ray * r, const hittable * world, int depth )
+// Default edge length of a render tile, in pixels
+#define DEFAULT_TILE_SIZE 32
+
+// Mirror and glass scatters camera_render_aov follows before taking the features of whatever surface it is on
+#define CAMERA_AOV_BOUNCES 4
+
+// Names of the integrators, as the command line and scene files take them
+static const char * const integrator_names[CAMERA_INTEGRATOR_COUNT] = { "recursive", "wavefront" };
+
+// Shared, read-only state of a single render call
+typedef struct
 {
-    hit_record rec;
+    const camera *     cam;
+    const hittable *   world;
+    int                first_row; // First image row to render
+    int                end_row;   // One past the last image row to render
+    int                tile_size; // Edge length of a tile in pixels
+    int                tiles_x;   // Number of tile columns
+    int                packet;    // Edge length of the primary-ray packets; 0 when tracing single rays
+    wavefront_state ** wavefront; // Per-worker wavefront states, created on first use; NULL for the recursive path
 
-    if( depth <= 0 )
-        {
-            return vec3_new( 0, 0, 0 ); // Ray bounce limit reached
-        }
+    // Passes
+    film *     film;         // Film accumulating the pass, holding just the rows [first_row, end_row)
+    int        pass_samples; // Samples every pixel adds in this pass
+    uint64_t * tile_samples; // Samples taken by each tile in this pass
+
+    // Feature buffers
+    aov_image * aov; // Buffers to fill instead of rendering; NULL for every other kind of render
+} render_job;
+
+static color ray_color( const camera * cam, const ray * r, const hittable * world, int depth, color throughput,
+                        rng * gen );
 
-    // Check for hits
-    // t_min = 0.001 to avoid shadow acne
-    if( world->hit( world, r, 0.001, RT_INFINITY, &rec ) )
+// Computes the color carried by `r` given its closest hit `rec`, or NULL when it escaped the scene.
+// `throughput` is the product of the attenuations met before `r`, used by Russian roulette.
+static color
+shade( const camera * cam, const ray * r, const hit_record * rec, const hittable * world, int depth, color throughput,
+       rng * gen )
+{
+    if( rec )
         {
             ray   scattered;
             color attenuation;
-            if( rec.mat_ptr && rec.mat_ptr->scatter( rec.mat_ptr, r, &rec, &attenuation, &scattered ) )
+            sampler_begin_bounce( gen );
+            if( material_scatter( cam->materials, rec->material_id, r, rec, &attenuation, &scattered, gen ) )
                 {
-                    return vec3_mul_vec( attenuation, ray_color( &scattered, world, depth - 1 ) );
+                    throughput      = vec3_mul_vec( throughput, attenuation );
+                    double survival = camera_roulette( cam, cam->max_depth - depth + 1, throughput, gen );
+                    if( survival <= 0.0 )
+                        {
+                            STATS_PATH_END( STATS_ROULETTE, cam->max_depth - depth + 1 );
+                            return vec3_new( 0, 0, 0 ); // Ended by Russian roulette
+                        }
+
+                    attenuation = vec3_div( attenuation, survival );
+                    throughput  = vec3_div( throughput, survival );
+                    return vec3_mul_vec( attenuation, ray_color( cam, &scattered, world, depth - 1, throughput, gen ) );
                 }
+            STATS_PATH_END( STATS_ABSORBED, cam->max_depth - depth );
             return vec3_new( 0, 0, 0 ); // Ray was absorbed
         }
 
+    STATS_PATH_END( STATS_ESCAPED, cam->max_depth - depth );
+    return camera_background( r );
+}
+
+// Computes the color for a given ray
+static color
+ray_color( const camera * cam, const ray * r, const hittable * world, int depth, color throughput, rng * gen )
+{
+    hit_record rec;
+
+    if( depth <= 0 )
+        {
+            STATS_PATH_END( STATS_BOUNCE_LIMIT, cam->max_depth );
+            return vec3_new( 0, 0, 0 ); // Ray bounce limit reached
+        }
+
+    STATS_RAYS_TRACED( 1 );
+    bool hit = world->hit( world, r, CAMERA_RAY_T_MIN, RT_INFINITY, &rec );
+    return shade( cam, r, hit ? &rec : NULL, world, depth, throughput, gen );
+}
+
+color
+camera_background( const ray * r )
+{
     // Background gradient
-    vec3   unit_direction = vec3_normalize( ray_direction( r ) );
-    double a              = 0.5 * ( unit_direction.y + 1.0 );
+    vec3    unit_direction = vec3_normalize( ray_direction( r ) );
+    rt_real a              = RT_REAL( 0.5 ) * ( unit_direction.y + RT_REAL( 1 ) );
 
-    color white           = vec3_new( 1.0, 1.0, 1.0 );
-    color sky_blue        = vec3_new( 0.5, 0.7, 1.0 );
-    return vec3_add( vec3_mul( white, 1.0 - a ), vec3_mul( sky_blue, a ) );
+    color white            = vec3_new( 1.0, 1.0, 1.0 );
+    color sky_blue         = vec3_new( 0.5, 0.7, 1.0 );
+    return vec3_add( vec3_mul( white, RT_REAL( 1 ) - a ), vec3_mul( sky_blue, a ) );
 }
 
 // Initializes the camera with given parameters.
@@ -56,14 +128,28 @@ camera_init( camera * cam, double aspect_ratio, double vertical_fov_deg, point3
     cam->world_up          = world_up_dir;
     cam->aperture          = aperture_diameter;
     cam->focal_distance    = focus_distance;
-    cam->lens_radius       = cam->aperture / 2.0;
+    cam->lens_radius       = cam->aperture / RT_REAL( 2 );
 
     cam->image_width       = image_width;
     cam->samples_per_pixel = samples_per_pixel;
     cam->max_depth         = max_depth;
+    cam->thread_count      = 0;
+    cam->tile_size         = DEFAULT_TILE_SIZE;
+    cam->seed              = 0;
+    cam->packet_size       = 0;
+    cam->integrator        = CAMERA_INTEGRATOR_RECURSIVE;
+    cam->sampler           = SAMPLER_RANDOM;
+    cam->materials         = NULL;
     cam->image_height      = (int)( image_width / aspect_ratio );
     cam->image_height      = RT_MAX( cam->image_height, 1 );
 
+    // Paths run to max_depth unless Russian roulette is requested
+    cam->roulette_min_depth = 0;
+
+    // Every pixel takes samples_per_pixel samples unless adaptive sampling is requested
+    cam->adaptive_threshold   = 0.0;
+    cam->adaptive_min_samples = 16;
+
     double theta           = vertical_fov_deg * RT_DEG2RAD;
     double h               = tan( theta / 2.0 );
     double viewport_h      = 2.0 * h;
@@ -84,35 +170,648 @@ camera_init( camera * cam, double aspect_ratio, double vertical_fov_deg, point3
     cam->viewport_origin   = vec3_add( cam->viewport_origin, half_height );
 }
 
+// Slope of the sRGB transfer function the output image is encoded with, at the linear value `linear`
+static double
+srgb_slope( double linear )
+{
+    if( linear <= 0.0031308 ) return 12.92;
+    return ( 1.055 / 2.4 ) * pow( linear, 1.0 / 2.4 - 1.0 );
+}
+
+// True once the 95% confidence interval of a pixel's displayed luminance, estimated from `n` samples with luminance
+// sum `sum` and sum of squares `sum_sq`, is within +-adaptive_threshold. Display values are the sRGB encoding of the
+// linear mean, so a linear half-width h maps to about h times the slope of the encoding at the mean.
+static bool
+adaptive_converged( const camera * cam, int n, double sum, double sum_sq )
+{
+    const double mean       = sum / n;
+    const double variance   = RT_MAX( ( sum_sq - sum * mean ) / ( n - 1 ), 0.0 );
+    const double half_width = 1.96 * sqrt( variance / n );
+    return half_width * srgb_slope( mean ) <= cam->adaptive_threshold;
+}
+
+// Returns the wavefront state of the worker `thread_index`, created on its first tile; each worker only ever touches
+// its own slot. NULL if memory ran out, and the tile is then rendered recursively instead.
+static wavefront_state *
+job_wavefront( const render_job * job, int thread_index )
+{
+    wavefront_state ** state = &job->wavefront[thread_index];
+    if( NULL == *state ) *state = wavefront_create();
+    return *state;
+}
+
+// Sets [*first, *end) to the samples image pixel (i, j) takes in this pass: up to job->pass_samples more from the
+// samples it already holds, and none once it holds them all or, with adaptive sampling, has converged. Adaptive
+// pixels stop at every multiple of adaptive_min_samples and are only tested there, so a pixel takes the same samples
+// whatever the size of the passes.
+static void
+film_pass_range( const render_job * job, int i, int j, int * first, int * end )
+{
+    const camera * cam = job->cam;
+    const film *   f   = job->film;
+    const size_t   p   = (size_t)( j - job->first_row ) * f->width + i;
+    *first             = (int)f->samples[p];
+    *end               = RT_MAX( RT_MIN( *first + job->pass_samples, cam->samples_per_pixel ), *first );
+    if( cam->adaptive_threshold <= 0.0 || *first == *end ) return;
+
+    const int pass = RT_MAX( cam->adaptive_min_samples, 2 );
+    *end           = RT_MIN( *end, ( *first / pass + 1 ) * pass );
+    if( *first > 0 && 0 == *first % pass )
+        {
+            const color sum = vec3_new( f->radiance[3 * p], f->radiance[3 * p + 1], f->radiance[3 * p + 2] );
+            if( adaptive_converged( cam, *first, color_luminance( sum ), f->lum_sq[p] ) ) *end = *first;
+        }
+}
+
+// Film pass over [x0, x1) x [y0, y1) one ray at a time (see render_film_pass)
+static uint64_t
+render_film_single( const render_job * job, int x0, int y0, int x1, int y1 )
+{
+    const camera * cam            = job->cam;
+    const color    no_attenuation = vec3_new( 1, 1, 1 );
+    rng            gen;
+    uint64_t       taken          = 0;
+
+    for( int j = y0; j < y1; ++j )
+        {
+            for( int i = x0; i < x1; ++i )
+                {
+                    int first, end;
+                    film_pass_range( job, i, j, &first, &end );
+                    if( first >= end ) continue;
+
+                    STATS_PIXEL( i, j, cam->image_width );
+                    color  pixel_color = vec3_new( 0, 0, 0 );
+                    double lum_sq      = 0.0;
+                    for( int s = first; s < end; ++s )
+                        {
+                            ray    r = camera_sample_ray( cam, &gen, i, j, s );
+                            color  c = ray_color( cam, &r, job->world, cam->max_depth, no_attenuation, &gen );
+                            double y = color_luminance( c );
+
+                            pixel_color  = vec3_add( pixel_color, c );
+                            lum_sq      += y * y;
+                        }
+                    film_add( job->film, i, j - job->first_row, pixel_color, lum_sq, end - first );
+                    taken += (uint64_t)( end - first );
+                }
+        }
+    return taken;
+}
+
+// Film pass over [x0, x1) x [y0, y1) in square blocks of job->packet pixels: for each sample, the primary rays of the
+// block's pixels that take it in this pass are traced as one packet, then every ray is shaded and continues on its own
+static uint64_t
+render_film_packets( const render_job * job, int x0, int y0, int x1, int y1 )
+{
+    const camera *   cam  = job->cam;
+    const bvh_flat * bvh  = (const bvh_flat *)job->world;
+    const int        size = job->packet;
+
+    const color no_attenuation = vec3_new( 1, 1, 1 );
+    ray_packet  packet;
+    rng         gens[RAY_PACKET_MAX];
+    int         ray_pixel[RAY_PACKET_MAX]; // Block pixel of every ray of the packet
+    int         first[RAY_PACKET_MAX];
+    int         end[RAY_PACKET_MAX];
+    color       sums[RAY_PACKET_MAX];
+    double      lum_sq[RAY_PACKET_MAX];
+    uint64_t    taken = 0;
+
+    for( int by = y0; by < y1; by += size )
+        {
+            for( int bx = x0; bx < x1; bx += size )
+                {
+                    const int w      = RT_MIN( size, x1 - bx );
+                    const int h      = RT_MIN( size, y1 - by );
+                    int       s_min  = cam->samples_per_pixel;
+                    int       s_end  = 0;
+                    for( int k = 0; k < w * h; ++k )
+                        {
+                            film_pass_range( job, bx + k % w, by + k / w, &first[k], &end[k] );
+                            sums[k]   = vec3_new( 0, 0, 0 );
+                            lum_sq[k] = 0.0;
+                            if( first[k] < end[k] )
+                                {
+                                    s_min = RT_MIN( s_min, first[k] );
+                                    s_end = RT_MAX( s_end, end[k] );
+                                }
+                        }
+
+                    for( int s = s_min; s < s_end; ++s )
+                        {
+                            packet.count = 0;
+                            for( int k = 0; k < w * h; ++k )
+                                {
+                                    if( s < first[k] || s >= end[k] ) continue;
+                                    ray_pixel[packet.count]   = k;
+                                    packet.rays[packet.count] = camera_sample_ray( cam, &gens[packet.count],
+                                                                                   bx + k % w, by + k / w, s );
+                                    ++packet.count;
+                                }
+                            if( 0 == packet.count ) continue;
+
+                            ray_packet_reset( &packet, RT_INFINITY );
+                            bvh_flat_hit_packet( bvh, &packet, CAMERA_RAY_T_MIN );
+
+                            for( int n = 0; n < packet.count; ++n )
+                                {
+                                    const int k = ray_pixel[n];
+                                    STATS_PIXEL( bx + k % w, by + k / w, cam->image_width );
+                                    STATS_RAYS_TRACED( 1 ); // Primary ray, traced with the packet
+
+                                    const hit_record * rec = packet.hit[n] ? &packet.rec[n] : NULL;
+                                    color  c = shade( cam, &packet.rays[n], rec, job->world, cam->max_depth,
+                                                      no_attenuation, &gens[n] );
+                                    double y = color_luminance( c );
+
+                                    sums[k]    = vec3_add( sums[k], c );
+                                    lum_sq[k] += y * y;
+                                }
+                        }
+
+                    for( int k = 0; k < w * h; ++k )
+                        {
+                            if( first[k] >= end[k] ) continue;
+                            film_add( job->film, bx + k % w, by + k / w - job->first_row, sums[k], lum_sq[k],
+                                      end[k] - first[k] );
+                            taken += (uint64_t)( end[k] - first[k] );
+                        }
+                }
+        }
+    return taken;
+}
+
+// Film pass over [x0, x1) x [y0, y1) with the wavefront integrator.
+//
+// Returns:
+//   false if memory ran out, with nothing added to the film
+static bool
+render_film_wavefront( const render_job * job, int x0, int y0, int x1, int y1, int thread_index, uint64_t * taken )
+{
+    const int         tile_width = x1 - x0;
+    const int         pixels     = tile_width * ( y1 - y0 );
+    wavefront_state * state      = job_wavefront( job, thread_index );
+    int *             first      = (int *)malloc( 2 * (size_t)pixels * sizeof( int ) );
+    int *             end        = first + pixels;
+    if( NULL == state || NULL == first )
+        {
+            free( first );
+            return false;
+        }
+
+    for( int k = 0; k < pixels; ++k )
+        {
+            film_pass_range( job, x0 + k % tile_width, y0 + k / tile_width, &first[k], &end[k] );
+        }
+
+    bool ok = wavefront_render_samples( state, job->cam, job->world, x0, y0, x1, y1, first, end );
+    if( ok )
+        {
+            const color *  sums   = wavefront_tile_sums( state );
+            const double * lum_sq = wavefront_tile_lum_sq( state );
+            for( int k = 0; k < pixels; ++k )
+                {
+                    if( first[k] >= end[k] ) continue;
+                    film_add( job->film, x0 + k % tile_width, y0 + k / tile_width - job->first_row, sums[k],
+                              lum_sq[k], end[k] - first[k] );
+                    *taken += (uint64_t)( end[k] - first[k] );
+                }
+        }
+    free( first );
+    return ok;
+}
+
+// Adds up to job->pass_samples samples to every pixel of [x0, x1) x [y0, y1) of the film, each pixel continuing from
+// the samples it already holds, with the camera's integrator and packets. With adaptive sampling, pixels that
+// converged in earlier passes are skipped. Every pixel adds the same samples in the same order whichever way they
+// are traced.
+//
+// Returns:
+//   The number of samples taken
+static uint64_t
+render_film_pass( const render_job * job, int x0, int y0, int x1, int y1, int thread_index )
+{
+    uint64_t taken = 0;
+    if( job->wavefront && render_film_wavefront( job, x0, y0, x1, y1, thread_index, &taken ) ) return taken;
+    if( job->packet > 0 ) return render_film_packets( job, x0, y0, x1, y1 );
+    return render_film_single( job, x0, y0, x1, y1 );
+}
+
+// Follows the primary ray `r` through mirror and glass surfaces, as far as CAMERA_AOV_BOUNCES scatters, and adds the
+// features of the first other surface it meets: its albedo times the attenuation on the way, its normal and the
+// length of the path. Reflections and refractions then get the edges of what they show.
+static void
+aov_sample( const camera * cam, const hittable * world, ray r, rng * gen, color * albedo, vec3 * normal,
+            double * depth )
+{
+    color  throughput = vec3_new( 1, 1, 1 );
+    double length     = 0.0;
+    for( int bounce = 0;; ++bounce )
+        {
+            hit_record rec;
+            STATS_RAYS_TRACED( 1 );
+            if( !world->hit( world, &r, CAMERA_RAY_T_MIN, RT_INFINITY, &rec ) )
+                {
+                    *albedo = vec3_add( *albedo, throughput );
+                    return;
+                }
+            length += rec.t * vec3_length( ray_direction( &r ) );
+
+            const material_type type     = material_id_type( rec.material_id );
+            const bool          specular = MATERIAL_ID_NONE != rec.material_id
+                                  && ( MATERIAL_METAL == type || MATERIAL_DIELECTRIC == type );
+            ray   scattered;
+            color attenuation;
+            sampler_begin_bounce( gen );
+            if( specular && bounce < CAMERA_AOV_BOUNCES
+                && material_scatter( cam->materials, rec.material_id, &r, &rec, &attenuation, &scattered, gen ) )
+                {
+                    throughput = vec3_mul_vec( throughput, attenuation );
+                    r          = scattered;
+                    continue;
+                }
+
+            const color surface  = material_albedo( cam->materials, rec.material_id );
+            *albedo              = vec3_add( *albedo, vec3_mul_vec( throughput, surface ) );
+            *normal              = vec3_add( *normal, rec.normal );
+            *depth              += length;
+            return;
+        }
+}
+
+// Traces the primary rays of the first CAMERA_AOV_SAMPLES samples of every pixel of [x0, x1) x [y0, y1) and stores
+// the features they find, averaged, into job->aov
+static void
+render_aov( const render_job * job, int x0, int y0, int x1, int y1 )
+{
+    const camera * cam     = job->cam;
+    aov_image *    aov     = job->aov;
+    const int      samples = RT_MAX( RT_MIN( cam->samples_per_pixel, CAMERA_AOV_SAMPLES ), 1 );
+    const double   scale   = 1.0 / samples;
+    rng            gen;
+
+    for( int j = y0; j < y1; ++j )
+        {
+            for( int i = x0; i < x1; ++i )
+                {
+                    color  albedo = vec3_new( 0, 0, 0 );
+                    vec3   normal = vec3_new( 0, 0, 0 );
+                    double depth  = 0.0;
+                    for( int s = 0; s < samples; ++s )
+                        {
+                            aov_sample( cam, job->world, camera_sample_ray( cam, &gen, i, j, s ), &gen, &albedo,
+                                        &normal, &depth );
+                        }
+
+                    const size_t p        = (size_t)j * cam->image_width + i;
+                    aov->albedo[3 * p]     = (float)( albedo.x * scale );
+                    aov->albedo[3 * p + 1] = (float)( albedo.y * scale );
+                    aov->albedo[3 * p + 2] = (float)( albedo.z * scale );
+                    aov->normal[3 * p]     = (float)( normal.x * scale );
+                    aov->normal[3 * p + 1] = (float)( normal.y * scale );
+                    aov->normal[3 * p + 2] = (float)( normal.z * scale );
+                    aov->depth[p]          = (float)( depth * scale );
+                }
+        }
+}
+
+// Renders one tile into the image buffer. Tiles never overlap, so workers need no synchronization.
+static void
+render_tile( void * user, int tile_index, int thread_index )
+{
+    const render_job * job = (const render_job *)user;
+    const camera *     cam = job->cam;
+
+    const int x0           = ( tile_index % job->tiles_x ) * job->tile_size;
+    const int y0           = job->first_row + ( tile_index / job->tiles_x ) * job->tile_size;
+    const int x1           = RT_MIN( x0 + job->tile_size, cam->image_width );
+    const int y1           = RT_MIN( y0 + job->tile_size, job->end_row );
+
+    if( job->aov )
+        {
+            render_aov( job, x0, y0, x1, y1 );
+        }
+    else
+        {
+            job->tile_samples[tile_index] = render_film_pass( job, x0, y0, x1, y1, thread_index );
+        }
+
+    stats_flush();
+}
+
+static void
+render_progress( void * user, int tiles_done, int tile_count )
+{
+    RT_UNUSED( user );
+    fprintf( stderr, "\rTiles remaining: %d ", tile_count - tiles_done );
+    fflush( stderr );
+}
+
 void
 camera_render( const camera * cam, const struct hittable * world, unsigned char * image_data )
 {
-    unsigned char * pixel = image_data;
-    for( int j = 0; j < cam->image_height; ++j )
+    camera_render_counted( cam, world, image_data, NULL );
+}
+
+// Fills in the settings shared by every kind of render of the image rows [first_row, end_row).
+//
+// Returns:
+//   The number of tiles covering the rows
+static int
+render_job_init( render_job * job, const camera * cam, const struct hittable * world, int first_row, int end_row )
+{
+    job->cam          = cam;
+    job->world        = (const hittable *)world;
+    job->first_row    = first_row;
+    job->end_row      = end_row;
+    job->packet       = 0;
+    job->wavefront    = NULL;
+    job->film         = NULL;
+    job->pass_samples = 0;
+    job->tile_samples = NULL;
+    job->aov          = NULL;
+    job->tile_size    = ( cam->tile_size > 0 ) ? cam->tile_size : DEFAULT_TILE_SIZE;
+    job->tiles_x      = ( cam->image_width + job->tile_size - 1 ) / job->tile_size;
+
+    const int tiles_y = ( end_row - first_row + job->tile_size - 1 ) / job->tile_size;
+    return job->tiles_x * tiles_y;
+}
+
+// Renders every tile of `job`, tracing packets or wavefronts as the camera asks.
+//
+// Returns:
+//   false if the render workers could not be started (reported)
+static bool
+render_traced_job( render_job * job, int tile_count, tile_progress_fn progress )
+{
+    const camera * cam = job->cam;
+
+    // Packets need the flat BVH's packet traversal and at least one bounce to trace
+    if( cam->packet_size > 1 && cam->max_depth > 0 && bvh_flat_hit == job->world->hit )
+        {
+            job->packet = RT_MIN( cam->packet_size, CAMERA_MAX_PACKET_SIZE );
+        }
+
+    // One wavefront state slot per worker the scheduler may start
+    int worker_count = ( cam->thread_count > 0 ) ? cam->thread_count : tile_scheduler_hardware_threads();
+    if( CAMERA_INTEGRATOR_WAVEFRONT == cam->integrator )
+        {
+            job->wavefront = (wavefront_state **)calloc( (size_t)worker_count, sizeof( wavefront_state * ) );
+            if( !job->wavefront )
+                {
+                    fprintf( stderr, "ERROR: Failed to allocate the wavefront states, rendering recursively.\n" );
+                }
+        }
+
+    bool ok = tile_scheduler_run( worker_count, tile_count, render_tile, progress, job );
+
+    if( job->wavefront )
+        {
+            for( int w = 0; w < worker_count; ++w )
+                {
+                    wavefront_destroy( job->wavefront[w] );
+                }
+            free( job->wavefront );
+            job->wavefront = NULL;
+        }
+
+    if( !ok ) fprintf( stderr, "\rERROR: Failed to start the render workers.\n" );
+    return ok;
+}
+
+// Adds one pass of up to `pass_samples` samples per pixel to `f`, a film of the image rows [first_row, end_row).
+// When `complete` is set, passes are repeated until every pixel is done, which with adaptive sampling takes one pass
+// per adaptive_min_samples samples.
+//
+// Returns:
+//   false if the render could not run (reported); `*taken` receives the number of samples taken
+static bool
+render_film_rows( const camera * cam, const struct hittable * world, film * f, int first_row, int end_row,
+                  int pass_samples, bool complete, tile_progress_fn progress, uint64_t * taken )
+{
+    render_job job;
+    const int  tile_count = render_job_init( &job, cam, world, first_row, end_row );
+    job.film              = f;
+    job.pass_samples      = pass_samples;
+    job.tile_samples      = (uint64_t *)calloc( (size_t)tile_count, sizeof( uint64_t ) );
+    *taken                = 0;
+    if( !job.tile_samples )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the render pass.\n" );
+            return false;
+        }
+
+    bool     ok   = true;
+    uint64_t pass = 1;
+    while( ok && pass > 0 )
+        {
+            ok   = render_traced_job( &job, tile_count, progress );
+            pass = 0;
+            for( int t = 0; ok && t < tile_count; ++t )
+                {
+                    pass += job.tile_samples[t];
+                }
+            *taken += pass;
+            if( !complete || cam->adaptive_threshold <= 0.0 ) break; // A fixed-count pass takes every sample it can
+        }
+
+    free( job.tile_samples );
+    return ok;
+}
+
+// Checks that the camera can render the image rows [first_row, end_row) of `world`.
+//
+// Returns:
+//   false if it cannot (reported)
+static bool
+render_check( const camera * cam, const struct hittable * world, int first_row, int end_row )
+{
+    if( !cam || !world ) return false;
+    if( !cam->materials )
         {
-            fprintf( stderr, "\rScanlines remaining: %d ", cam->image_height - j - 1 );
-            fflush( stderr );
+            fprintf( stderr, "ERROR: The camera has no material table to render with.\n" );
+            return false;
+        }
+    if( first_row < 0 || end_row > cam->image_height || first_row >= end_row )
+        {
+            fprintf( stderr, "ERROR: Rows [%d, %d) are not within the %d rows of the image.\n", first_row, end_row,
+                     cam->image_height );
+            return false;
+        }
+    return true;
+}
 
-            for( int i = 0; i < cam->image_width; ++i )
+// Renders the image rows [first_row, end_row) into `f`, a film of just those rows, taking every remaining sample
+static bool
+render_rows( const camera * cam, const struct hittable * world, film * f, int first_row, int end_row,
+             tile_progress_fn progress )
+{
+    uint64_t taken;
+    return render_film_rows( cam, world, f, first_row, end_row, RT_MAX( cam->samples_per_pixel, 1 ), true, progress,
+                             &taken );
+}
+
+bool
+camera_render_film( const camera * cam, const struct hittable * world, struct film * f )
+{
+    if( !f || !render_check( cam, world, 0, cam ? cam->image_height : 0 ) ) return false;
+    if( f->width != cam->image_width || f->height != cam->image_height )
+        {
+            fprintf( stderr, "ERROR: Film of %dx%d pixels does not match the %dx%d camera image.\n", f->width,
+                     f->height, cam->image_width, cam->image_height );
+            return false;
+        }
+
+    if( !render_rows( cam, world, f, 0, cam->image_height, render_progress ) ) return false;
+    fprintf( stderr, "\rDone.                                                      \n" );
+    return true;
+}
+
+void
+camera_render_counted( const camera * cam, const struct hittable * world, unsigned char * image_data,
+                       int * sample_counts )
+{
+    if( !cam || !image_data ) return;
+
+    film frame;
+    if( !film_init( &frame, cam->image_width, cam->image_height ) ) return;
+    if( camera_render_film( cam, world, &frame ) )
+        {
+            film_resolve( &frame, NULL, image_data );
+            if( sample_counts )
                 {
-                    color pixel_color = vec3_new( 0, 0, 0 );
-                    for( int s = 0; s < cam->samples_per_pixel; ++s )
+                    for( size_t p = 0; p < (size_t)frame.width * frame.height; ++p )
                         {
-                            double u    = (double)( i + random_double() ) / ( cam->image_width - 1 );
-                            double v    = (double)( j + random_double() ) / ( cam->image_height - 1 );
-                            ray    r    = camera_get_ray( cam, u, v );
-                            pixel_color = vec3_add( pixel_color, ray_color( &r, (hittable *)world, cam->max_depth ) );
+                            sample_counts[p] = (int)frame.samples[p];
                         }
-                    write_color_to_buffer( pixel, pixel_color, cam->samples_per_pixel );
-                    pixel += RT_IMAGE_DATA_CHANNELS;
                 }
         }
+    film_free( &frame );
+}
 
-    fprintf( stderr, "\rDone.                                                      \n" );
+bool
+camera_render_rows( const camera * cam, const struct hittable * world, unsigned char * image_data, int first_row,
+                    int end_row )
+{
+    if( !image_data || !render_check( cam, world, first_row, end_row ) ) return false;
+
+    film band;
+    if( !film_init( &band, cam->image_width, end_row - first_row ) ) return false;
+    const bool ok = render_rows( cam, world, &band, first_row, end_row, NULL );
+    if( ok ) postprocess_image( NULL, band.radiance, band.samples, band.width, first_row, end_row, image_data );
+    film_free( &band );
+    return ok;
+}
+
+bool
+camera_render_rows_hdr( const camera * cam, const struct hittable * world, float * radiance, int first_row,
+                        int end_row )
+{
+    if( !radiance || !render_check( cam, world, first_row, end_row ) ) return false;
+
+    film band;
+    if( !film_init( &band, cam->image_width, end_row - first_row ) ) return false;
+    const bool ok = render_rows( cam, world, &band, first_row, end_row, NULL );
+    if( ok )
+        {
+            hdr_image means = { band.width, band.height, radiance };
+            film_resolve_hdr( &band, &means );
+        }
+    film_free( &band );
+    return ok;
+}
+
+uint64_t
+camera_render_pass( const camera * cam, const struct hittable * world, struct film * f, int pass_samples )
+{
+    if( !f || pass_samples <= 0 || !render_check( cam, world, 0, cam ? cam->image_height : 0 ) ) return 0;
+    if( f->width != cam->image_width || f->height != cam->image_height )
+        {
+            fprintf( stderr, "ERROR: Film of %dx%d pixels does not match the %dx%d camera image.\n", f->width,
+                     f->height, cam->image_width, cam->image_height );
+            return 0;
+        }
+
+    uint64_t taken;
+    return render_film_rows( cam, world, f, 0, cam->image_height, pass_samples, false, NULL, &taken ) ? taken : 0;
+}
+
+bool
+camera_render_aov( const camera * cam, const struct hittable * world, struct aov_image * aov )
+{
+    if( !cam || !world || !aov ) return false;
+    if( !cam->materials )
+        {
+            fprintf( stderr, "ERROR: The camera has no material table to render with.\n" );
+            return false;
+        }
+    if( aov->width != cam->image_width || aov->height != cam->image_height )
+        {
+            fprintf( stderr, "ERROR: Feature buffers of %dx%d pixels do not match the %dx%d camera image.\n",
+                     aov->width, aov->height, cam->image_width, cam->image_height );
+            return false;
+        }
+
+    render_job job;
+    const int  tile_count = render_job_init( &job, cam, world, 0, cam->image_height );
+    job.aov               = aov;
+    if( !tile_scheduler_run( cam->thread_count, tile_count, render_tile, NULL, &job ) )
+        {
+            fprintf( stderr, "ERROR: Failed to start the render workers.\n" );
+            return false;
+        }
+    return true;
+}
+
+const char *
+camera_integrator_name( camera_integrator integrator )
+{
+    return ( (unsigned)integrator < CAMERA_INTEGRATOR_COUNT ) ? integrator_names[integrator] : "unknown";
+}
+
+bool
+camera_integrator_parse( const char * text, camera_integrator * integrator )
+{
+    for( int i = 0; i < CAMERA_INTEGRATOR_COUNT; ++i )
+        {
+            if( 0 == strcmp( text, integrator_names[i] ) )
+                {
+                    *integrator = (camera_integrator)i;
+                    return true;
+                }
+        }
+    return false;
+}
+
+uint64_t
+camera_hash( const camera * cam )
+{
+    uint64_t h = rng_hash_u64( 0, cam->seed );
+    h          = rng_hash_double( h, cam->position.x );
+    h          = rng_hash_double( h, cam->position.y );
+    h          = rng_hash_double( h, cam->position.z );
+    h          = rng_hash_double( h, cam->target.x );
+    h          = rng_hash_double( h, cam->target.y );
+    h          = rng_hash_double( h, cam->target.z );
+    h          = rng_hash_double( h, cam->world_up.x );
+    h          = rng_hash_double( h, cam->world_up.y );
+    h          = rng_hash_double( h, cam->world_up.z );
+    h          = rng_hash_double( h, cam->vertical_fov_deg );
+    h          = rng_hash_double( h, cam->aspect_ratio );
+    h          = rng_hash_double( h, cam->aperture );
+    h          = rng_hash_double( h, cam->focal_distance );
+    h          = rng_hash_u64( h, (uint64_t)cam->image_width );
+    h          = rng_hash_u64( h, (uint64_t)cam->image_height );
+    h          = rng_hash_u64( h, (uint64_t)cam->max_depth );
+    h          = rng_hash_u64( h, (uint64_t)cam->roulette_min_depth );
+    h          = rng_hash_double( h, cam->adaptive_threshold );
+    h          = rng_hash_u64( h, (uint64_t)cam->sampler );
+    return h;
 }
 
 ray
-camera_get_ray( const camera * cam, double s, double t )
+camera_get_ray( const camera * cam, rt_real s, rt_real t, rng * gen )
 {
     if( !cam )
         {
@@ -129,7 +828,7 @@ camera_get_ray( const camera * cam, double s, double t )
     viewport_point         = vec3_add( viewport_point, vertical_offset );
 
     // Apply depth of field by sampling random point on lens aperture
-    vec3   lens_sample     = vec3_mul( random_in_unit_disk(), cam->lens_radius );
+    vec3   lens_sample     = vec3_mul( random_in_unit_disk( gen ), cam->lens_radius );
     vec3   lens_offset     = vec3_add( vec3_mul( cam->right, lens_sample.x ), vec3_mul( cam->up, lens_sample.y ) );
     point3 ray_start       = vec3_add( cam->position, lens_offset );
 
@@ -0,0 +1,138 @@
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcmp, memcpy, memset, strlen */
+
+#define CHECKPOINT_MAGIC   "RTCKPT\r\n"
+#define CHECKPOINT_VERSION 1
+
+// File header, followed by the film: width * height * 3 radiance floats, width * height squared luminance floats
+// and width * height 32-bit sample counts
+typedef struct
+{
+    char     magic[8];
+    uint32_t version;
+    int32_t  width;
+    int32_t  height;
+    uint32_t reserved;
+    uint64_t seed;
+    uint64_t camera_hash;
+    uint64_t scene_hash;
+} checkpoint_header;
+
+// Reads and validates the header of an open checkpoint
+static bool
+read_header( FILE * file, const char * path, checkpoint_header * header )
+{
+    if( 1 != fread( header, sizeof( *header ), 1, file )
+        || 0 != memcmp( header->magic, CHECKPOINT_MAGIC, sizeof( header->magic ) ) )
+        {
+            fprintf( stderr, "ERROR: '%s' is not a render checkpoint.\n", path );
+            return false;
+        }
+    if( CHECKPOINT_VERSION != header->version )
+        {
+            fprintf( stderr, "ERROR: Checkpoint '%s' has unsupported version %u.\n", path, header->version );
+            return false;
+        }
+    return true;
+}
+
+bool
+checkpoint_save( const char * path, const film * f, const checkpoint_info * info )
+{
+    const size_t pixels = (size_t)f->width * f->height;
+    const size_t length = strlen( path );
+    char *       temp   = (char *)malloc( length + 5 );
+    if( NULL == temp )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the checkpoint path.\n" );
+            return false;
+        }
+    memcpy( temp, path, length );
+    memcpy( temp + length, ".tmp", 5 );
+
+    checkpoint_header header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, CHECKPOINT_MAGIC, sizeof( header.magic ) );
+    header.version     = CHECKPOINT_VERSION;
+    header.width       = f->width;
+    header.height      = f->height;
+    header.seed        = info->seed;
+    header.camera_hash = info->camera_hash;
+    header.scene_hash  = info->scene_hash;
+
+    FILE * file        = fopen( temp, "wb" );
+    bool   ok          = ( NULL != file );
+    ok                 = ok && 1 == fwrite( &header, sizeof( header ), 1, file );
+    ok                 = ok && pixels * 3 == fwrite( f->radiance, sizeof( float ), pixels * 3, file );
+    ok                 = ok && pixels == fwrite( f->lum_sq, sizeof( float ), pixels, file );
+    ok                 = ok && pixels == fwrite( f->samples, sizeof( uint32_t ), pixels, file );
+    if( NULL != file ) ok = ( 0 == fclose( file ) ) && ok;
+    ok = ok && 0 == rename( temp, path );
+
+    if( !ok )
+        {
+            fprintf( stderr, "ERROR: Failed to write checkpoint '%s'.\n", path );
+            remove( temp );
+        }
+    free( temp );
+    return ok;
+}
+
+bool
+checkpoint_peek( const char * path, checkpoint_info * info )
+{
+    FILE * file = fopen( path, "rb" );
+    if( NULL == file ) return false; // No checkpoint
+
+    checkpoint_header header;
+    bool              ok = read_header( file, path, &header );
+    fclose( file );
+    if( !ok ) return false;
+
+    info->seed        = header.seed;
+    info->camera_hash = header.camera_hash;
+    info->scene_hash  = header.scene_hash;
+    return true;
+}
+
+bool
+checkpoint_load( const char * path, film * f, const checkpoint_info * expected )
+{
+    FILE * file = fopen( path, "rb" );
+    if( NULL == file )
+        {
+            fprintf( stderr, "ERROR: Failed to open checkpoint '%s'.\n", path );
+            return false;
+        }
+
+    checkpoint_header header;
+    bool              ok = read_header( file, path, &header );
+    if( ok && ( header.width != f->width || header.height != f->height ) )
+        {
+            fprintf( stderr, "ERROR: Checkpoint '%s' is %dx%d pixels, the render is %dx%d.\n", path, header.width,
+                     header.height, f->width, f->height );
+            ok = false;
+        }
+    if( ok
+        && ( header.seed != expected->seed || header.camera_hash != expected->camera_hash
+             || header.scene_hash != expected->scene_hash ) )
+        {
+            fprintf( stderr, "ERROR: Checkpoint '%s' belongs to a different camera or scene.\n", path );
+            ok = false;
+        }
+
+    const size_t pixels = (size_t)f->width * f->height;
+    ok                  = ok && pixels * 3 == fread( f->radiance, sizeof( float ), pixels * 3, file );
+    ok                  = ok && pixels == fread( f->lum_sq, sizeof( float ), pixels, file );
+    ok                  = ok && pixels == fread( f->samples, sizeof( uint32_t ), pixels, file );
+    fclose( file );
+
+    if( !ok )
+        {
+            fprintf( stderr, "ERROR: Failed to load checkpoint '%s'.\n", path );
+            film_clear( f );
+        }
+    return ok;
+}
@@ -0,0 +1,303 @@
+#include "denoise.h"
+#include "rtweekend.h"
+#include "tile_scheduler.h"
+#include <math.h> /* exp, sqrt */
+#include <stdio.h>
+#include <stdlib.h> /* calloc, free */
+
+#define BAND_ROWS     16   // Rows a worker fits per scheduled job; at least twice the largest radius
+#define MAX_RADIUS    8    // Largest window radius
+#define MAX_TAPS      ( ( 2 * MAX_RADIUS + 1 ) * ( 2 * MAX_RADIUS + 1 ) )
+#define FEATURES      10   // Terms of the local model: constant, albedo, normal, depth and position
+#define SPATIAL_SIGMA 0.6  // Spatial falloff of the weights, in window radii
+#define RIDGE         1e-3 // Regularization of the fit, relative to the total weight of the window
+#define MIN_WEIGHT    1e-4 // Neighbours weighing less are left out of the fit
+
+// Shared state of a denoise_image call
+typedef struct
+{
+    const hdr_image * input;
+    const aov_image * aov;
+    float *           sum;    // Weighted sum of the predictions for every pixel, 3 floats per pixel
+    float *           weight; // Sum of their weights, 1 float per pixel
+    int               radius;
+    int               parity;          // Bands fitted by this run: the even ones (0), then the odd ones (1)
+    double            spatial_falloff; // 1 / (2 sigma^2) of the distance and of each feature
+    double            albedo_falloff;
+    double            normal_falloff;
+    double            depth_falloff;
+} denoise_job;
+
+// A neighbour in the window being fitted
+typedef struct
+{
+    size_t index;
+    double weight;
+    double x[FEATURES]; // Its features relative to the window's centre
+} denoise_tap;
+
+// Solves the normal equations a * beta = rhs for each color channel by Cholesky decomposition, in place: the lower
+// triangle of `a` becomes the factor and `rhs` the coefficients.
+//
+// Returns:
+//   false if `a` is not positive definite
+static bool
+solve_cholesky( double a[FEATURES][FEATURES], double rhs[FEATURES][3] )
+{
+    for( int j = 0; j < FEATURES; ++j )
+        {
+            double d = a[j][j];
+            for( int k = 0; k < j; ++k )
+                {
+                    d -= a[j][k] * a[j][k];
+                }
+            if( d <= 1e-12 ) return false;
+            a[j][j] = sqrt( d );
+            for( int i = j + 1; i < FEATURES; ++i )
+                {
+                    double t = a[i][j];
+                    for( int k = 0; k < j; ++k )
+                        {
+                            t -= a[i][k] * a[j][k];
+                        }
+                    a[i][j] = t / a[j][j];
+                }
+        }
+
+    for( int c = 0; c < 3; ++c )
+        {
+            for( int i = 0; i < FEATURES; ++i )
+                {
+                    double t = rhs[i][c];
+                    for( int k = 0; k < i; ++k )
+                        {
+                            t -= a[i][k] * rhs[k][c];
+                        }
+                    rhs[i][c] = t / a[i][i];
+                }
+            for( int i = FEATURES - 1; i >= 0; --i )
+                {
+                    double t = rhs[i][c];
+                    for( int k = i + 1; k < FEATURES; ++k )
+                        {
+                            t -= a[k][i] * rhs[k][c];
+                        }
+                    rhs[i][c] = t / a[i][i];
+                }
+        }
+    return true;
+}
+
+// Gathers the neighbours of pixel (x, y) that weigh enough, with their features relative to the pixel's.
+//
+// Returns:
+//   The number of taps; the pixel itself is always the first
+static int
+gather_taps( const denoise_job * job, int x, int y, denoise_tap * taps )
+{
+    const aov_image * aov    = job->aov;
+    const size_t      p      = (size_t)y * aov->width + x;
+    const float *     albedo = aov->albedo + 3 * p;
+    const float *     normal = aov->normal + 3 * p;
+    const float       depth  = aov->depth[p];
+    int               count  = 0;
+
+    for( int dy = -job->radius; dy <= job->radius; ++dy )
+        {
+            const int qy = y + dy;
+            if( qy < 0 || qy >= aov->height ) continue;
+
+            for( int dx = -job->radius; dx <= job->radius; ++dx )
+                {
+                    const int qx = x + dx;
+                    if( qx < 0 || qx >= aov->width ) continue;
+
+                    // Rays that escaped share nothing with rays that hit a surface
+                    const size_t q      = (size_t)qy * aov->width + qx;
+                    const float  qdepth = aov->depth[q];
+                    if( ( depth > 0.0f ) != ( qdepth > 0.0f ) ) continue;
+
+                    denoise_tap * tap = &taps[count];
+                    double        da  = 0.0;
+                    double        dn  = 0.0;
+                    tap->x[0]         = 1.0;
+                    for( int c = 0; c < 3; ++c )
+                        {
+                            tap->x[1 + c]  = aov->albedo[3 * q + c] - albedo[c];
+                            tap->x[4 + c]  = aov->normal[3 * q + c] - normal[c];
+                            da            += tap->x[1 + c] * tap->x[1 + c];
+                            dn            += tap->x[4 + c] * tap->x[4 + c];
+                        }
+                    tap->x[7] = ( depth > 0.0f ) ? ( qdepth - depth ) / depth : 0.0;
+                    tap->x[8] = (double)dx / job->radius;
+                    tap->x[9] = (double)dy / job->radius;
+
+                    tap->index  = q;
+                    tap->weight = exp( -( dx * dx + dy * dy ) * job->spatial_falloff - da * job->albedo_falloff
+                                       - dn * job->normal_falloff - tap->x[7] * tap->x[7] * job->depth_falloff );
+                    if( q == p )
+                        {
+                            // Keep the centre first
+                            const denoise_tap centre = *tap;
+                            *tap                     = taps[0];
+                            taps[0]                  = centre;
+                            ++count;
+                        }
+                    else if( tap->weight >= MIN_WEIGHT )
+                        {
+                            ++count;
+                        }
+                }
+        }
+    return count;
+}
+
+// Fits the window of every pixel in one band of rows and adds its model's predictions for every neighbour into the
+// sums. Bands of the same parity are at least 2 * radius rows apart, so their windows never write the same pixel.
+static void
+fit_band( void * user, int index, int thread_index )
+{
+    const denoise_job * job    = (const denoise_job *)user;
+    const int           width  = job->input->width;
+    const int           band   = 2 * index + job->parity;
+    const int           end    = RT_MIN( ( band + 1 ) * BAND_ROWS, job->input->height );
+    const float *       pixels = job->input->pixels;
+    denoise_tap         taps[MAX_TAPS];
+    RT_UNUSED( thread_index );
+
+    for( int y = band * BAND_ROWS; y < end; ++y )
+        {
+            for( int x = 0; x < width; ++x )
+                {
+                    const int count = gather_taps( job, x, y, taps );
+
+                    // Normal equations of the weighted least squares fit; only the lower triangle is accumulated
+                    double a[FEATURES][FEATURES] = { { 0.0 } };
+                    double b[FEATURES][3]        = { { 0.0 } };
+                    for( int t = 0; t < count; ++t )
+                        {
+                            const float * c = pixels + 3 * taps[t].index;
+                            for( int i = 0; i < FEATURES; ++i )
+                                {
+                                    const double wx = taps[t].weight * taps[t].x[i];
+                                    for( int j = 0; j <= i; ++j )
+                                        {
+                                            a[i][j] += wx * taps[t].x[j];
+                                        }
+                                    b[i][0] += wx * c[0];
+                                    b[i][1] += wx * c[1];
+                                    b[i][2] += wx * c[2];
+                                }
+                        }
+                    const double mean[3] = { b[0][0] / a[0][0], b[0][1] / a[0][0], b[0][2] / a[0][0] };
+                    for( int i = 1; i < FEATURES; ++i )
+                        {
+                            a[i][i] += RIDGE * a[0][0];
+                        }
+
+                    // A window the model cannot be fitted to predicts its weighted mean everywhere
+                    const bool fitted = solve_cholesky( a, b );
+                    for( int t = 0; t < count; ++t )
+                        {
+                            const size_t q = taps[t].index;
+                            for( int c = 0; c < 3; ++c )
+                                {
+                                    double v = mean[c];
+                                    if( fitted )
+                                        {
+                                            v = 0.0;
+                                            for( int i = 0; i < FEATURES; ++i )
+                                                {
+                                                    v += taps[t].x[i] * b[i][c];
+                                                }
+                                        }
+                                    job->sum[3 * q + c] += (float)( taps[t].weight * RT_MAX( v, 0.0 ) );
+                                }
+                            job->weight[q] += (float)taps[t].weight;
+                        }
+                }
+        }
+}
+
+// Returns 1 / (2 sigma^2), the factor of a squared difference in the exponent of a Gaussian weight
+static inline double
+falloff( double sigma )
+{
+    return 1.0 / ( 2.0 * sigma * sigma );
+}
+
+void
+denoise_settings_init( denoise_settings * settings )
+{
+    settings->radius       = 3;
+    settings->sigma_albedo = 0.5;
+    settings->sigma_normal = 1.0;
+    settings->sigma_depth  = 0.1;
+    settings->thread_count = 0;
+}
+
+bool
+denoise_image( const denoise_settings * settings, const hdr_image * input, const aov_image * aov,
+               hdr_image * output )
+{
+    denoise_settings defaults;
+    if( NULL == settings )
+        {
+            denoise_settings_init( &defaults );
+            settings = &defaults;
+        }
+    if( aov->width != input->width || aov->height != input->height || output->width != input->width
+        || output->height != input->height )
+        {
+            fprintf( stderr, "ERROR: The input image, feature buffers and denoised image differ in size.\n" );
+            return false;
+        }
+
+    const size_t pixels = (size_t)input->width * (size_t)input->height;
+    denoise_job  job;
+    job.input           = input;
+    job.aov             = aov;
+    job.radius          = RT_CLAMP( settings->radius, 1, MAX_RADIUS );
+    job.spatial_falloff = falloff( SPATIAL_SIGMA * job.radius );
+    job.albedo_falloff  = falloff( settings->sigma_albedo );
+    job.normal_falloff  = falloff( settings->sigma_normal );
+    job.depth_falloff   = falloff( settings->sigma_depth );
+    job.sum             = (float *)calloc( pixels * 3, sizeof( float ) );
+    job.weight          = (float *)calloc( pixels, sizeof( float ) );
+    if( NULL == job.sum || NULL == job.weight )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory to denoise a %dx%d image.\n", input->width,
+                     input->height );
+            free( job.sum );
+            free( job.weight );
+            return false;
+        }
+
+    // Even bands, then odd bands, so no two workers add into the same pixel
+    const int bands = ( input->height + BAND_ROWS - 1 ) / BAND_ROWS;
+    for( job.parity = 0; job.parity < 2; ++job.parity )
+        {
+            const int count = ( bands + 1 - job.parity ) / 2;
+            if( count > 0 && !tile_scheduler_run( settings->thread_count, count, fit_band, NULL, &job ) )
+                {
+                    fprintf( stderr, "WARN: Failed to start the denoise workers, denoising on the calling thread.\n" );
+                    for( int i = 0; i < count; ++i )
+                        {
+                            fit_band( &job, i, 0 );
+                        }
+                }
+        }
+
+    // Every pixel is the centre of its own window, so its weight is at least 1
+    for( size_t p = 0; p < pixels; ++p )
+        {
+            for( int c = 0; c < 3; ++c )
+                {
+                    output->pixels[3 * p + c] = job.sum[3 * p + c] / job.weight[p];
+                }
+        }
+
+    free( job.sum );
+    free( job.weight );
+    return true;
+}
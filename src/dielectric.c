@@ -1,41 +1,44 @@
 #include "dielectric.h"
 #include "hittable.h"
 #include "rtweekend.h"
+#include "stats.h"
 #include <math.h>
 
 // Schlick approximation for reflectance
-static double
-reflectance( double cosine, double ref_idx )
+static rt_real
+reflectance( rt_real cosine, rt_real ref_idx )
 {
-    double r0 = ( 1.0 - ref_idx ) / ( 1.0 + ref_idx );
-    r0        = r0 * r0;
-    return r0 + ( 1.0 - r0 ) * pow( ( 1.0 - cosine ), 5.0 );
+    rt_real r0 = ( RT_REAL( 1 ) - ref_idx ) / ( RT_REAL( 1 ) + ref_idx );
+    r0         = r0 * r0;
+    return r0 + ( RT_REAL( 1 ) - r0 ) * rt_pow( ( RT_REAL( 1 ) - cosine ), RT_REAL( 5 ) );
 }
 
 void
-dielectric_init( dielectric * mat, double index_of_refraction )
+dielectric_init( dielectric * mat, rt_real index_of_refraction )
 {
     if( !mat ) return;
     mat->base.scatter = dielectric_scatter;
+    mat->base.type    = MATERIAL_DIELECTRIC;
     mat->ir           = index_of_refraction;
 }
 
 bool
 dielectric_scatter( const material * material, const ray * r_in, const struct hit_record_s * rec, color * attenuation,
-                    ray * scattered )
+                    ray * scattered, rng * gen )
 {
     const dielectric * self = (const dielectric *)material;
-    *attenuation            = vec3_new( 1.0, 1.0, 1.0 ); // Glass is clear
-    double refraction_ratio = rec->front_face ? ( 1.0 / self->ir ) : self->ir;
+    STATS_INC( STATS_SCATTER_DIELECTRIC );
+    *attenuation             = vec3_new( 1.0, 1.0, 1.0 ); // Glass is clear
+    rt_real refraction_ratio = rec->front_face ? ( RT_REAL( 1 ) / self->ir ) : self->ir;
 
-    vec3   unit_direction   = vec3_normalize( ray_direction( r_in ) );
-    double cos_theta        = fmin( vec3_dot( vec3_negate( unit_direction ), rec->normal ), 1.0 );
-    double sin_theta        = sqrt( 1.0 - cos_theta * cos_theta );
+    vec3    unit_direction   = vec3_normalize( ray_direction( r_in ) );
+    rt_real cos_theta        = rt_fmin( vec3_dot( vec3_negate( unit_direction ), rec->normal ), RT_REAL( 1 ) );
+    rt_real sin_theta        = rt_sqrt( RT_REAL( 1 ) - cos_theta * cos_theta );
 
-    bool cannot_refract     = ( refraction_ratio * sin_theta ) > 1.0;
+    bool cannot_refract      = ( refraction_ratio * sin_theta ) > RT_REAL( 1 );
     vec3 direction;
 
-    if( cannot_refract || reflectance( cos_theta, refraction_ratio ) > random_double() )
+    if( cannot_refract || reflectance( cos_theta, refraction_ratio ) > random_double( gen ) )
         {
             direction = vec3_reflect( unit_direction, rec->normal );
         }
@@ -0,0 +1,80 @@
+#include "film.h"
+#include "rtweekend.h"
+#include <stdio.h>
+#include <stdlib.h> /* calloc, free */
+#include <string.h> /* memset */
+
+bool
+film_init( film * f, int width, int height )
+{
+    const size_t pixels = (size_t)RT_MAX( width, 0 ) * (size_t)RT_MAX( height, 0 );
+
+    f->width            = width;
+    f->height           = height;
+    f->radiance         = (float *)calloc( pixels * 3, sizeof( float ) );
+    f->lum_sq           = (float *)calloc( pixels, sizeof( float ) );
+    f->samples          = (uint32_t *)calloc( pixels, sizeof( uint32_t ) );
+
+    if( NULL == f->radiance || NULL == f->lum_sq || NULL == f->samples )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the film.\n" );
+            film_free( f );
+            return false;
+        }
+    return true;
+}
+
+void
+film_free( film * f )
+{
+    free( f->radiance );
+    free( f->lum_sq );
+    free( f->samples );
+    f->radiance = NULL;
+    f->lum_sq   = NULL;
+    f->samples  = NULL;
+    f->width    = 0;
+    f->height   = 0;
+}
+
+void
+film_clear( film * f )
+{
+    const size_t pixels = (size_t)f->width * f->height;
+    memset( f->radiance, 0, pixels * 3 * sizeof( float ) );
+    memset( f->lum_sq, 0, pixels * sizeof( float ) );
+    memset( f->samples, 0, pixels * sizeof( uint32_t ) );
+}
+
+uint64_t
+film_sample_count( const film * f )
+{
+    const size_t pixels = (size_t)f->width * f->height;
+    uint64_t     total  = 0;
+    for( size_t p = 0; p < pixels; ++p )
+        {
+            total += f->samples[p];
+        }
+    return total;
+}
+
+void
+film_resolve( const film * f, const postprocess_settings * settings, unsigned char * image_data )
+{
+    postprocess_image( settings, f->radiance, f->samples, f->width, 0, f->height, image_data );
+}
+
+void
+film_resolve_hdr( const film * f, hdr_image * image )
+{
+    const size_t pixels = (size_t)f->width * f->height;
+    for( size_t p = 0; p < pixels; ++p )
+        {
+            // The same float product postprocess_image forms from the sums
+            const float inv = ( f->samples[p] > 0 ) ? 1.0f / (float)f->samples[p] : 0.0f;
+            for( int c = 0; c < 3; ++c )
+                {
+                    image->pixels[3 * p + c] = f->radiance[3 * p + c] * inv;
+                }
+        }
+}
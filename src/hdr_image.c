@@ -0,0 +1,173 @@
+#include "hdr_image.h"
+#include "rtweekend.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> /* calloc, free, strtod, strtol */
+#include <string.h> /* memcpy, strcmp */
+
+#define PFM_HEADER_MAX 64 // Longest header read: magic, size and scale with their separators
+
+static bool
+host_is_little_endian( void )
+{
+    const uint32_t one = 1;
+    unsigned char  first;
+    memcpy( &first, &one, 1 );
+    return 1 == first;
+}
+
+static void
+swap_bytes( float * values, size_t count )
+{
+    unsigned char * bytes = (unsigned char *)values;
+    for( size_t i = 0; i < count; ++i, bytes += 4 )
+        {
+            unsigned char t = bytes[0];
+            bytes[0]        = bytes[3];
+            bytes[3]        = t;
+            t               = bytes[1];
+            bytes[1]        = bytes[2];
+            bytes[2]        = t;
+        }
+}
+
+bool
+hdr_image_init( hdr_image * image, int width, int height )
+{
+    const size_t pixels = (size_t)RT_MAX( width, 0 ) * (size_t)RT_MAX( height, 0 );
+
+    image->width  = width;
+    image->height = height;
+    image->pixels = (float *)calloc( pixels * 3, sizeof( float ) );
+    if( NULL == image->pixels )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for a %dx%d HDR image.\n", width, height );
+            image->width  = 0;
+            image->height = 0;
+            return false;
+        }
+    return true;
+}
+
+void
+hdr_image_free( hdr_image * image )
+{
+    free( image->pixels );
+    image->pixels = NULL;
+    image->width  = 0;
+    image->height = 0;
+}
+
+bool
+hdr_image_write_pfm( const hdr_image * image, const char * path )
+{
+    FILE * file = fopen( path, "wb" );
+    if( NULL == file )
+        {
+            fprintf( stderr, "ERROR: Failed to create '%s'.\n", path );
+            return false;
+        }
+
+    // A negative scale marks little-endian data
+    const size_t stride = (size_t)image->width * 3;
+    bool         ok     = fprintf( file, "PF\n%d %d\n%s\n", image->width, image->height,
+                                   host_is_little_endian() ? "-1.0" : "1.0" ) > 0;
+    for( int y = image->height - 1; ok && y >= 0; --y )
+        {
+            ok = stride == fwrite( image->pixels + (size_t)y * stride, sizeof( float ), stride, file );
+        }
+    ok = ( 0 == fclose( file ) ) && ok;
+    if( !ok ) fprintf( stderr, "ERROR: Failed to write '%s'.\n", path );
+    return ok;
+}
+
+// Reads the next whitespace-separated token of a PFM header, and the single whitespace byte ending it
+static bool
+read_token( FILE * file, char * token, size_t size )
+{
+    int c = fgetc( file );
+    while( ' ' == c || '\t' == c || '\r' == c || '\n' == c )
+        {
+            c = fgetc( file );
+        }
+
+    size_t length = 0;
+    while( EOF != c && ' ' != c && '\t' != c && '\r' != c && '\n' != c )
+        {
+            if( length + 1 >= size ) return false;
+            token[length++] = (char)c;
+            c               = fgetc( file );
+        }
+    token[length] = '\0';
+    return length > 0 && EOF != c;
+}
+
+// Parses an image width or height of a PFM header
+static bool
+parse_dimension( const char * text, int * value )
+{
+    char *     end = NULL;
+    const long n   = strtol( text, &end, 10 );
+    if( '\0' != *end || n <= 0 || n > ( 1 << 16 ) ) return false;
+    *value = (int)n;
+    return true;
+}
+
+bool
+hdr_image_read_pfm( hdr_image * image, const char * path )
+{
+    FILE * file = fopen( path, "rb" );
+    if( NULL == file )
+        {
+            fprintf( stderr, "ERROR: Failed to open '%s'.\n", path );
+            return false;
+        }
+
+    char magic[PFM_HEADER_MAX], width[PFM_HEADER_MAX], height[PFM_HEADER_MAX], scale[PFM_HEADER_MAX];
+    bool ok = read_token( file, magic, sizeof( magic ) ) && read_token( file, width, sizeof( width ) )
+           && read_token( file, height, sizeof( height ) ) && read_token( file, scale, sizeof( scale ) );
+
+    // The scale's magnitude is meant as a unit of radiance, which the pixels already are, so only its sign counts
+    int    w = 0, h = 0;
+    double s = 0.0;
+    if( ok )
+        {
+            char * end = NULL;
+            s          = strtod( scale, &end );
+            ok         = 0 == strcmp( magic, "PF" ) && parse_dimension( width, &w ) && parse_dimension( height, &h )
+              && '\0' == *end && 0.0 != s;
+        }
+    if( !ok )
+        {
+            fprintf( stderr, "ERROR: '%s' is not a color PFM image.\n", path );
+            fclose( file );
+            return false;
+        }
+
+    if( !hdr_image_init( image, w, h ) )
+        {
+            fclose( file );
+            return false;
+        }
+    const size_t stride = (size_t)w * 3;
+    for( int y = h - 1; ok && y >= 0; --y )
+        {
+            ok = stride == fread( image->pixels + (size_t)y * stride, sizeof( float ), stride, file );
+        }
+    fclose( file );
+    if( !ok )
+        {
+            fprintf( stderr, "ERROR: '%s' ends before its last pixel.\n", path );
+            hdr_image_free( image );
+            return false;
+        }
+
+    if( ( s < 0.0 ) != host_is_little_endian() ) swap_bytes( image->pixels, stride * (size_t)h );
+    return true;
+}
+
+void
+hdr_image_tonemap( const hdr_image * image, const postprocess_settings * settings, unsigned char * image_data )
+{
+    postprocess_image( settings, image->pixels, NULL, image->width, 0, image->height, image_data );
+}
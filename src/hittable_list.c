@@ -1,5 +1,6 @@
 #include "hittable_list.h"
 #include "hittable.h"
+#include "stats.h"
 
 // Default initial capacity
 #define DEFAULT_CAPACITY 4
@@ -9,10 +10,12 @@ hittable_list_init( hittable_list * list, int initial_capacity )
 {
     if( NULL == list ) return;
 
-    list->base.hit = hittable_list_hit; // Set the hit function
-    list->count    = 0;
-    list->capacity = ( initial_capacity > 0 ) ? initial_capacity : DEFAULT_CAPACITY;
-    list->objects  = (hittable **)malloc( list->capacity * sizeof( hittable * ) );
+    list->base.hit         = hittable_list_hit; // Set the hit function
+    list->base.material_id = MATERIAL_ID_NONE;
+    list->base.bbox        = aabb_empty();
+    list->count            = 0;
+    list->capacity         = ( initial_capacity > 0 ) ? initial_capacity : DEFAULT_CAPACITY;
+    list->objects          = (hittable **)malloc( list->capacity * sizeof( hittable * ) );
 
     if( NULL == list->objects )
         {
@@ -59,6 +62,7 @@ hittable_list_add( hittable_list * list, hittable * object )
         }
 
     list->objects[list->count++] = object;
+    list->base.bbox              = aabb_union( list->base.bbox, object->bbox );
     return true;
 }
 
@@ -67,47 +71,30 @@ hittable_list_clear( hittable_list * list )
 {
     if( NULL == list ) return;
 
-    for( int i = 0; i < list->count; ++i )
-        {
-            if( list->objects[i] )
-                {
-                    // Get hittable object
-                    hittable * obj = (hittable *)list->objects[i];
-
-                    // Free the material if it exists
-                    if( obj->mat_ptr )
-                        {
-                            free( obj->mat_ptr );
-                            obj->mat_ptr = NULL;
-                        }
-
-                    // Free the object itself
-                    free( obj );
-                    list->objects[i] = NULL;
-                }
-        }
-
-    // Free the objects array
+    // The objects belong to whoever allocated them, typically a scene arena
     free( list->objects );
-    list->objects  = NULL;
-    list->count    = 0;
-    list->capacity = 0;
+    list->objects   = NULL;
+    list->count     = 0;
+    list->capacity  = 0;
+    list->base.bbox = aabb_empty();
 }
 
 bool
-hittable_list_hit( const hittable * list_hittable, const ray * r, double ray_tmin, double ray_tmax, hit_record * rec )
+hittable_list_hit( const hittable * list_hittable, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
 {
     // Cast the generic hittable to hittable_list
     const hittable_list * list = (const hittable_list *)list_hittable;
     hit_record            temp_rec;
     bool                  hit_anything   = false;
-    double                closest_so_far = ray_tmax; // Maximum allowed t for intersection
+    rt_real               closest_so_far = ray_tmax; // Maximum allowed t for intersection
 
+    STATS_INC( STATS_LIST_CALLS );
     for( int i = 0; i < list->count; ++i )
         {
             hittable * current_object = list->objects[i];
             if( current_object && current_object->hit )
                 {
+                    STATS_INC( STATS_OBJECT_CALLS );
                     // Pass closest_so_far as the ray_tmax for the current object,
                     // ensuring that we only record hits that are closer than previous ones
                     if( current_object->hit( current_object, r, ray_tmin, closest_so_far, &temp_rec ) )
@@ -0,0 +1,556 @@
+#include "image_encoder.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> /* calloc, malloc, free, abs */
+#include <string.h> /* memcpy, memmove */
+
+#define DEFLATE_WINDOW    32768 // Farthest back a deflate match may reach
+#define DEFLATE_BUFFER    ( 2 * DEFLATE_WINDOW ) // The window, then as much again of bytes still to code
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_MAX_CHAIN 32 // Earlier positions compared for every match; more compress better, and slower
+#define ADLER_MODULUS     65521
+#define ADLER_BLOCK       5552 // Most bytes the Adler-32 sums take before they must be reduced
+#define IDAT_CHUNK_SIZE   65536
+#define PNG_FILTER_COUNT  5 // None, Sub, Up, Average, Paeth
+
+// LZ77 over a sliding window with the fixed Huffman codes of RFC 1951. The whole stream is a single block, so
+// nothing has to be known about the data ahead before coding it.
+typedef struct
+{
+    unsigned char data[DEFLATE_BUFFER];
+    int32_t       head[1 << DEFLATE_HASH_BITS]; // Latest position of every hash of three bytes, -1 for none
+    int32_t       prev[DEFLATE_WINDOW];         // Previous position with the same hash, by position modulo the window
+    int           pos;                          // Next byte of `data` to code
+    int           end;                          // One past the last byte of `data` filled
+
+    uint16_t literal_codes[288];   // Fixed literal/length codes, bit-reversed as deflate sends them
+    uint8_t  literal_lengths[288]; // Their lengths in bits
+    uint16_t distance_codes[30];   // Fixed 5-bit distance codes, bit-reversed
+    uint32_t bits;                 // Output bits that do not fill a byte yet
+    int      bit_count;
+    uint32_t adler_a; // Adler-32 of the uncompressed stream, which the zlib wrapper ends with
+    uint32_t adler_b;
+} deflate_state;
+
+struct image_encoder
+{
+    FILE *               file;
+    image_encoder_format format;
+    int                  width;
+    int                  height;
+    int                  rows_written;
+    bool                 failed; // Set, and reported, on the first write that fails
+
+    // PNG
+    unsigned char * previous;   // Previous row unfiltered, zero above the first row
+    unsigned char * filtered;   // The row under every filter, each after its filter type byte
+    uint32_t        crc_table[256];
+    unsigned char   chunk[IDAT_CHUNK_SIZE]; // Compressed data of the IDAT chunk being filled
+    int             chunk_size;
+    deflate_state   deflate;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// Output
+//----------------------------------------------------------------------------------------------------------------------
+static void
+write_bytes( image_encoder * enc, const void * data, size_t size )
+{
+    if( enc->failed || 0 == size || size == fwrite( data, 1, size, enc->file ) ) return;
+    fprintf( stderr, "ERROR: Failed to write the output image.\n" );
+    enc->failed = true;
+}
+
+static void
+put_be32( unsigned char * p, uint32_t value )
+{
+    p[0] = (unsigned char)( value >> 24 );
+    p[1] = (unsigned char)( value >> 16 );
+    p[2] = (unsigned char)( value >> 8 );
+    p[3] = (unsigned char)value;
+}
+
+static uint32_t
+crc_update( const uint32_t * table, uint32_t crc, const unsigned char * data, size_t size )
+{
+    for( size_t i = 0; i < size; ++i )
+        {
+            crc = table[( crc ^ data[i] ) & 0xFF] ^ ( crc >> 8 );
+        }
+    return crc;
+}
+
+// Writes a PNG chunk: its length, type, data and the CRC-32 of type and data
+static void
+write_chunk( image_encoder * enc, const char * type, const unsigned char * data, size_t size )
+{
+    unsigned char header[8], footer[4];
+    put_be32( header, (uint32_t)size );
+    memcpy( header + 4, type, 4 );
+
+    uint32_t crc = crc_update( enc->crc_table, 0xFFFFFFFFu, header + 4, 4 );
+    crc          = crc_update( enc->crc_table, crc, data, size );
+    put_be32( footer, crc ^ 0xFFFFFFFFu );
+
+    write_bytes( enc, header, sizeof( header ) );
+    write_bytes( enc, data, size );
+    write_bytes( enc, footer, sizeof( footer ) );
+}
+
+// Appends a byte of compressed data, writing the IDAT chunk out once it is full
+static void
+emit_byte( image_encoder * enc, unsigned char byte )
+{
+    enc->chunk[enc->chunk_size++] = byte;
+    if( IDAT_CHUNK_SIZE == enc->chunk_size )
+        {
+            write_chunk( enc, "IDAT", enc->chunk, IDAT_CHUNK_SIZE );
+            enc->chunk_size = 0;
+        }
+}
+
+// Appends the `count` (up to 16) low bits of `value`, least significant first
+static void
+emit_bits( image_encoder * enc, uint32_t value, int count )
+{
+    deflate_state * d  = &enc->deflate;
+    d->bits           |= value << d->bit_count;
+    d->bit_count      += count;
+    while( d->bit_count >= 8 )
+        {
+            emit_byte( enc, (unsigned char)d->bits );
+            d->bits      >>= 8;
+            d->bit_count  -= 8;
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Deflate
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t
+reverse_bits( uint32_t value, int count )
+{
+    uint32_t reversed = 0;
+    for( int i = 0; i < count; ++i )
+        {
+            reversed = ( reversed << 1 ) | ( value & 1 );
+            value  >>= 1;
+        }
+    return reversed;
+}
+
+// Index of the highest set bit of `value` > 0
+static int
+floor_log2( uint32_t value )
+{
+    int n = 0;
+    while( value >>= 1 )
+        {
+            ++n;
+        }
+    return n;
+}
+
+static void
+deflate_init( deflate_state * d )
+{
+    for( int s = 0; s < 288; ++s )
+        {
+            // RFC 1951, 3.2.6
+            const int      length = ( s < 144 ) ? 8 : ( s < 256 ) ? 9 : ( s < 280 ) ? 7 : 8;
+            const int code        = ( s < 144 ) ? 0x30 + s : ( s < 256 ) ? 0x190 + ( s - 144 )
+                                  : ( s < 280 ) ? s - 256 : 0xC0 + ( s - 280 );
+            d->literal_codes[s]   = (uint16_t)reverse_bits( (uint32_t)code, length );
+            d->literal_lengths[s] = (uint8_t)length;
+        }
+    for( int s = 0; s < 30; ++s )
+        {
+            d->distance_codes[s] = (uint16_t)reverse_bits( (uint32_t)s, 5 );
+        }
+    for( int h = 0; h < ( 1 << DEFLATE_HASH_BITS ); ++h )
+        {
+            d->head[h] = -1;
+        }
+    d->pos       = 0;
+    d->end       = 0;
+    d->bits      = 0;
+    d->bit_count = 0;
+    d->adler_a   = 1;
+    d->adler_b   = 0;
+}
+
+static void
+emit_symbol( image_encoder * enc, int symbol )
+{
+    emit_bits( enc, enc->deflate.literal_codes[symbol], enc->deflate.literal_lengths[symbol] );
+}
+
+// Codes a match of `length` bytes starting `distance` bytes back
+static void
+emit_match( image_encoder * enc, int length, int distance )
+{
+    // Length symbols 257..284 cover 3..257 in groups of four per extra bit; 258 has a symbol of its own
+    const int l = length - DEFLATE_MIN_MATCH;
+    if( l < 8 )
+        {
+            emit_symbol( enc, 257 + l );
+        }
+    else if( DEFLATE_MAX_MATCH - DEFLATE_MIN_MATCH == l )
+        {
+            emit_symbol( enc, 285 );
+        }
+    else
+        {
+            const int extra = floor_log2( (uint32_t)l ) - 2;
+            emit_symbol( enc, 257 + 4 * ( extra + 1 ) + ( ( l >> extra ) & 3 ) );
+            emit_bits( enc, (uint32_t)l & ( ( 1u << extra ) - 1 ), extra );
+        }
+
+    // Distance codes likewise cover 1..32768 in pairs per extra bit
+    const int d = distance - 1;
+    if( d < 4 )
+        {
+            emit_bits( enc, enc->deflate.distance_codes[d], 5 );
+        }
+    else
+        {
+            const int extra = floor_log2( (uint32_t)d ) - 1;
+            emit_bits( enc, enc->deflate.distance_codes[2 * ( extra + 1 ) + ( ( d >> extra ) & 1 )], 5 );
+            emit_bits( enc, (uint32_t)d & ( ( 1u << extra ) - 1 ), extra );
+        }
+}
+
+static uint32_t
+deflate_hash( const unsigned char * p )
+{
+    const uint32_t key = ( (uint32_t)p[0] << 16 ) | ( (uint32_t)p[1] << 8 ) | p[2];
+    return ( key * 2654435761u ) >> ( 32 - DEFLATE_HASH_BITS );
+}
+
+static void
+deflate_insert( deflate_state * d, int pos )
+{
+    const uint32_t h                      = deflate_hash( d->data + pos );
+    d->prev[pos & ( DEFLATE_WINDOW - 1 )] = d->head[h];
+    d->head[h]                            = pos;
+}
+
+// Codes the buffered bytes. Unless `flush`, the last DEFLATE_MAX_MATCH are kept back, as a match starting among
+// them could still grow into bytes that have not arrived.
+static void
+deflate_compress( image_encoder * enc, bool flush )
+{
+    deflate_state * d     = &enc->deflate;
+    const int       limit = flush ? d->end : d->end - DEFLATE_MAX_MATCH;
+    while( d->pos < limit )
+        {
+            const unsigned char * p         = d->data + d->pos;
+            const int             available = RT_MIN( d->end - d->pos, DEFLATE_MAX_MATCH );
+            int                   best      = 0;
+            int                   distance  = 0;
+            if( available >= DEFLATE_MIN_MATCH )
+                {
+                    // Walks the earlier positions with the same hash, nearest first. A position more than a window
+                    // back may have had its chain entry reused, so the walk stops there.
+                    int candidate = d->head[deflate_hash( p )];
+                    for( int chain = 0; candidate >= 0 && chain < DEFLATE_MAX_CHAIN; ++chain )
+                        {
+                            const int back = d->pos - candidate;
+                            if( back <= 0 || back > DEFLATE_WINDOW ) break;
+
+                            const unsigned char * q = d->data + candidate;
+                            if( q[best] == p[best] )
+                                {
+                                    int length = 0;
+                                    while( length < available && q[length] == p[length] )
+                                        {
+                                            ++length;
+                                        }
+                                    if( length > best )
+                                        {
+                                            best     = length;
+                                            distance = back;
+                                            if( available == length ) break;
+                                        }
+                                }
+                            candidate = d->prev[candidate & ( DEFLATE_WINDOW - 1 )];
+                        }
+                    deflate_insert( d, d->pos );
+                }
+
+            if( best >= DEFLATE_MIN_MATCH )
+                {
+                    emit_match( enc, best, distance );
+                    for( int k = 1; k < best; ++k )
+                        {
+                            if( d->pos + k + DEFLATE_MIN_MATCH <= d->end ) deflate_insert( d, d->pos + k );
+                        }
+                    d->pos += best;
+                }
+            else
+                {
+                    emit_symbol( enc, p[0] );
+                    ++d->pos;
+                }
+        }
+}
+
+// Moves the buffer a window ahead. Compression has kept up to within DEFLATE_MAX_MATCH of the end, so everything
+// dropped is more than a window behind the next byte to code.
+static void
+deflate_slide( deflate_state * d )
+{
+    memmove( d->data, d->data + DEFLATE_WINDOW, (size_t)( d->end - DEFLATE_WINDOW ) );
+    d->pos -= DEFLATE_WINDOW;
+    d->end -= DEFLATE_WINDOW;
+    for( int h = 0; h < ( 1 << DEFLATE_HASH_BITS ); ++h )
+        {
+            d->head[h] = ( d->head[h] >= DEFLATE_WINDOW ) ? d->head[h] - DEFLATE_WINDOW : -1;
+        }
+    for( int i = 0; i < DEFLATE_WINDOW; ++i )
+        {
+            d->prev[i] = ( d->prev[i] >= DEFLATE_WINDOW ) ? d->prev[i] - DEFLATE_WINDOW : -1;
+        }
+}
+
+static void
+deflate_write( image_encoder * enc, const unsigned char * data, size_t size )
+{
+    deflate_state * d = &enc->deflate;
+
+    // Adler-32, reduced once per block as late as the sums allow without overflowing
+    for( size_t done = 0; done < size; )
+        {
+            const size_t block = RT_MIN( size - done, (size_t)ADLER_BLOCK );
+            for( size_t i = 0; i < block; ++i )
+                {
+                    d->adler_a += data[done + i];
+                    d->adler_b += d->adler_a;
+                }
+            d->adler_a %= ADLER_MODULUS;
+            d->adler_b %= ADLER_MODULUS;
+            done       += block;
+        }
+
+    while( size > 0 )
+        {
+            if( DEFLATE_BUFFER == d->end ) deflate_slide( d );
+
+            const size_t n = RT_MIN( size, (size_t)( DEFLATE_BUFFER - d->end ) );
+            memcpy( d->data + d->end, data, n );
+            d->end += (int)n;
+            data   += n;
+            size   -= n;
+            deflate_compress( enc, false );
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// PNG
+//----------------------------------------------------------------------------------------------------------------------
+static int
+paeth( int a, int b, int c )
+{
+    const int p  = a + b - c;
+    const int pa = abs( p - a );
+    const int pb = abs( p - b );
+    const int pc = abs( p - c );
+    if( pa <= pb && pa <= pc ) return a;
+    return ( pb <= pc ) ? b : c;
+}
+
+// Filters `row` under every PNG filter and compresses the one whose bytes, taken as signed, have the smallest sum
+// of magnitudes: the heuristic the PNG specification recommends, and the one stb_image_write uses
+static void
+png_encode_row( image_encoder * enc, const unsigned char * row )
+{
+    const int             bpp    = RT_IMAGE_DATA_CHANNELS;
+    const int             stride = enc->width * bpp;
+    const unsigned char * up     = enc->previous;
+    unsigned char *       out[PNG_FILTER_COUNT];
+    long                  cost[PNG_FILTER_COUNT] = { 0 };
+
+    for( int f = 0; f < PNG_FILTER_COUNT; ++f )
+        {
+            out[f]    = enc->filtered + (size_t)f * ( stride + 1 );
+            out[f][0] = (unsigned char)f;
+            ++out[f];
+        }
+    for( int i = 0; i < stride; ++i )
+        {
+            const int a        = ( i >= bpp ) ? row[i - bpp] : 0;
+            const int b        = up[i];
+            const int c        = ( i >= bpp ) ? up[i - bpp] : 0;
+            const int x        = row[i];
+            const int value[5] = { x, x - a, x - b, x - ( ( a + b ) >> 1 ), x - paeth( a, b, c ) };
+            for( int f = 0; f < PNG_FILTER_COUNT; ++f )
+                {
+                    out[f][i]  = (unsigned char)value[f];
+                    cost[f]   += abs( (signed char)out[f][i] );
+                }
+        }
+
+    int best = 0;
+    for( int f = 1; f < PNG_FILTER_COUNT; ++f )
+        {
+            if( cost[f] < cost[best] ) best = f;
+        }
+    deflate_write( enc, out[best] - 1, (size_t)stride + 1 );
+    memcpy( enc->previous, row, (size_t)stride );
+}
+
+static void
+png_begin( image_encoder * enc )
+{
+    for( uint32_t n = 0; n < 256; ++n )
+        {
+            uint32_t c = n;
+            for( int k = 0; k < 8; ++k )
+                {
+                    c = ( c & 1 ) ? 0xEDB88320u ^ ( c >> 1 ) : c >> 1;
+                }
+            enc->crc_table[n] = c;
+        }
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    unsigned char              header[13];
+    put_be32( header, (uint32_t)enc->width );
+    put_be32( header + 4, (uint32_t)enc->height );
+    header[8]  = 8; // Bits per channel
+    header[9]  = 2; // RGB
+    header[10] = 0; // Deflate
+    header[11] = 0; // Adaptive filtering
+    header[12] = 0; // Not interlaced
+    write_bytes( enc, signature, sizeof( signature ) );
+    write_chunk( enc, "IHDR", header, sizeof( header ) );
+
+    // zlib header for a 32 KiB window, then the header of the one fixed-code block: final, type 1
+    deflate_init( &enc->deflate );
+    emit_byte( enc, 0x78 );
+    emit_byte( enc, 0x01 );
+    emit_bits( enc, 1, 1 );
+    emit_bits( enc, 1, 2 );
+}
+
+static void
+png_end( image_encoder * enc )
+{
+    deflate_compress( enc, true );
+    emit_symbol( enc, 256 ); // End of block
+    if( enc->deflate.bit_count > 0 ) emit_bits( enc, 0, 8 - enc->deflate.bit_count );
+
+    unsigned char adler[4];
+    put_be32( adler, ( enc->deflate.adler_b << 16 ) | enc->deflate.adler_a );
+    for( int i = 0; i < 4; ++i )
+        {
+            emit_byte( enc, adler[i] );
+        }
+    if( enc->chunk_size > 0 ) write_chunk( enc, "IDAT", enc->chunk, (size_t)enc->chunk_size );
+    write_chunk( enc, "IEND", NULL, 0 );
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Public interface
+//----------------------------------------------------------------------------------------------------------------------
+image_encoder *
+image_encoder_open( const char * path, image_encoder_format format, int width, int height )
+{
+    if( width <= 0 || height <= 0 )
+        {
+            fprintf( stderr, "ERROR: Cannot encode an image of %dx%d pixels.\n", width, height );
+            return NULL;
+        }
+
+    const size_t    stride = (size_t)width * RT_IMAGE_DATA_CHANNELS;
+    image_encoder * enc    = (image_encoder *)calloc( 1, sizeof( image_encoder ) );
+    bool            ok     = NULL != enc;
+    if( ok && IMAGE_ENCODER_PNG == format )
+        {
+            enc->previous = (unsigned char *)calloc( stride, 1 );
+            enc->filtered = (unsigned char *)malloc( PNG_FILTER_COUNT * ( stride + 1 ) );
+            ok            = NULL != enc->previous && NULL != enc->filtered;
+        }
+    if( !ok ) fprintf( stderr, "ERROR: Failed to allocate memory for the image encoder.\n" );
+
+    if( ok ) enc->file = fopen( path, "wb" );
+    if( ok && NULL == enc->file )
+        {
+            fprintf( stderr, "ERROR: Failed to create '%s'.\n", path );
+            ok = false;
+        }
+    if( !ok )
+        {
+            if( NULL != enc ) free( enc->previous );
+            if( NULL != enc ) free( enc->filtered );
+            free( enc );
+            return NULL;
+        }
+    enc->format = format;
+    enc->width  = width;
+    enc->height = height;
+
+    if( IMAGE_ENCODER_PNG == format )
+        {
+            png_begin( enc );
+        }
+    else
+        {
+            char      header[64];
+            const int length = snprintf( header, sizeof( header ), "P6\n%d %d\n255\n", width, height );
+            write_bytes( enc, header, (size_t)length );
+        }
+    return enc;
+}
+
+bool
+image_encoder_write_rows( image_encoder * enc, const unsigned char * rows, int count )
+{
+    if( count > enc->height - enc->rows_written )
+        {
+            fprintf( stderr, "ERROR: %d rows given for the %d left of the image.\n", count,
+                     enc->height - enc->rows_written );
+            return false;
+        }
+
+    const size_t stride = (size_t)enc->width * RT_IMAGE_DATA_CHANNELS;
+    if( IMAGE_ENCODER_PNG == enc->format )
+        {
+            for( int r = 0; r < count; ++r )
+                {
+                    png_encode_row( enc, rows + (size_t)r * stride );
+                }
+        }
+    else
+        {
+            write_bytes( enc, rows, (size_t)count * stride );
+        }
+    enc->rows_written += count;
+    return !enc->failed;
+}
+
+bool
+image_encoder_close( image_encoder * enc )
+{
+    if( NULL == enc ) return false;
+
+    bool ok = !enc->failed;
+    if( enc->rows_written != enc->height )
+        {
+            fprintf( stderr, "ERROR: The output image got %d of its %d rows.\n", enc->rows_written, enc->height );
+            ok = false;
+        }
+    if( IMAGE_ENCODER_PNG == enc->format ) png_end( enc );
+    ok = ok && !enc->failed;
+    if( 0 != fclose( enc->file ) && ok )
+        {
+            fprintf( stderr, "ERROR: Failed to write the output image.\n" );
+            ok = false;
+        }
+
+    free( enc->previous );
+    free( enc->filtered );
+    free( enc );
+    return ok;
+}
@@ -0,0 +1,34 @@
+#include "instance.h"
+#include <stdio.h> /* fprintf */
+
+bool
+instance_init( instance * inst, const hittable * object, const transform * to_world, material_id mat )
+{
+    if( !transform_invert( to_world, &inst->to_object ) )
+        {
+            fprintf( stderr, "ERROR: An instance's transform is singular.\n" );
+            return false;
+        }
+
+    inst->base.hit         = instance_hit;
+    inst->base.material_id = mat;
+    inst->base.bbox        = transform_aabb( to_world, object->bbox );
+    inst->object           = object;
+    return true;
+}
+
+bool
+instance_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
+{
+    const instance * inst  = (const instance *)object;
+    const ray        local = ray_create( transform_point( &inst->to_object, r->orig ),
+                                         transform_vector( &inst->to_object, r->dir ) );
+
+    if( !inst->object->hit( inst->object, &local, ray_tmin, ray_tmax, rec ) ) return false;
+
+    // The normal keeps its side: dot( d, M^-T n ) equals dot( M^-1 d, n ), so front_face still holds
+    rec->p      = ray_at( r, rec->t );
+    rec->normal = vec3_normalize( transform_vector_transposed( &inst->to_object, rec->normal ) );
+    if( MATERIAL_ID_NONE != inst->base.material_id ) rec->material_id = inst->base.material_id;
+    return true;
+}
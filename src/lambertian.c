@@ -1,26 +1,29 @@
 #include "lambertian.h"
 #include "hittable.h"
 #include "rtweekend.h"
+#include "stats.h"
 
 void
 lambertian_init( lambertian * mat, color albedo )
 {
     if( !mat ) return;
     mat->base.scatter = lambertian_scatter;
+    mat->base.type    = MATERIAL_LAMBERTIAN;
     mat->albedo       = albedo;
 }
 
 bool
 lambertian_scatter( const material * material, const ray * r_in, const struct hit_record_s * rec, color * attenuation,
-                    ray * scattered )
+                    ray * scattered, rng * gen )
 {
     RT_UNUSED( r_in );
     const lambertian * self = (const lambertian *)material;
+    STATS_INC( STATS_SCATTER_LAMBERTIAN );
 
-    vec3 scatter_direction  = vec3_add( rec->normal, random_unit_vector() );
+    vec3 scatter_direction  = vec3_add( rec->normal, random_unit_vector( gen ) );
 
     // Catch degenerate scatter direction
-    if( vec3_is_zero( scatter_direction, 1e-8 ) )
+    if( vec3_is_zero( scatter_direction, RT_REAL_ZERO_EPSILON ) )
         {
             scatter_direction = rec->normal;
         }
@@ -1,176 +1,925 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-#include <stdio.h>  /* printf, fprintf */
-#include <stdlib.h> /* malloc, free, srand */
+#include <math.h>   /* isfinite */
+#include <stdio.h>  /* printf, fprintf, snprintf */
+#include <stdlib.h> /* malloc, free, strtol, strtod, strtoull */
+#include <string.h> /* strcmp, strrchr */
 #include <time.h>   /* time */
 
+#include "arena.h"
+#include "band_writer.h"
+#include "bvh.h"
+#include "bvh_flat.h"
 #include "camera.h"
-#include "dielectric.h"
+#include "checkpoint.h"
+#include "film.h"
+#include "denoise.h"
+#include "hdr_image.h"
+#include "postprocess.h"
 #include "hittable_list.h"
-#include "lambertian.h"
-#include "metal.h"
+#include "image_encoder.h"
+#include "material_table.h"
+#include "progressive.h"
 #include "rtweekend.h"
-#include "sphere.h"
+#include "sampler.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "sphere_soa.h"
+#include "stats.h"
 
 // Constants
 #define ASPECT_RATIO      ( 16.0 / 9.0 )
 #define IMAGE_WIDTH       1200
 #define SAMPLES_PER_PIXEL 10
 #define MAX_DEPTH         20
+#define SPHERE_GROUP_SIZE 16
 
-int
-main( void )
+// Progressive rendering
+#define PASS_SAMPLES         2    // Default samples per pixel added by every pass
+#define CHECKPOINT_SECONDS   60.0 // Interval between checkpoints of the render state
+#define TIME_BUDGET          0.0  // Default seconds to stop rendering within; 0 takes every sample
+#define OUTPUT_FILENAME      "output.png"
+#define CHECKPOINT_EXTENSION ".ckpt"       // Replaces the output image's extension to name its checkpoint
+#define SNAPSHOT_EXTENSION   ".tmp"        // Appended to the output path to name the snapshot being written
+#define HEATMAP_FILENAME     "heatmap.png" // Rays traced per pixel, written by ENABLE_STATS builds
+#define JPG_QUALITY          95
+
+// Streamed output
+#define STREAM_BAND_ROWS  32 // Rows per band when the camera leaves the tile size to the renderer
+#define STREAM_BAND_COUNT 3  // Bands in memory: one rendering, one being written, one queued between them
+
+// Output image formats: the ones stb_image_write encodes, and PPM, which image_encoder writes
+typedef enum
 {
-    srand( time( NULL ) );
+    IMAGE_FORMAT_PNG,
+    IMAGE_FORMAT_BMP,
+    IMAGE_FORMAT_TGA,
+    IMAGE_FORMAT_JPG,
+    IMAGE_FORMAT_PPM,
+    IMAGE_FORMAT_COUNT
+} image_format;
 
-    // World
-    //--------------------------------------------------------------------------------------
-    hittable_list world;
-    hittable_list_init( &world, 500 );
+static const char * const image_format_names[IMAGE_FORMAT_COUNT] = { "png", "bmp", "tga", "jpg", "ppm" };
+
+// Where the render in progress is saved
+typedef struct
+{
+    const char *    image_path;
+    image_format    format;
+    const char *    snapshot_path; // Snapshots are written here, then renamed over the output image
+    const char *    checkpoint_path;
+    checkpoint_info info;
+} render_output;
+
+static bool
+write_image( const char * path, image_format format, const unsigned char * image_data, int width, int height )
+{
+    const int channels = RT_IMAGE_DATA_CHANNELS;
+    switch( format )
+        {
+        case IMAGE_FORMAT_PNG:
+            return 0 != stbi_write_png( path, width, height, channels, image_data, width * channels );
+        case IMAGE_FORMAT_BMP: return 0 != stbi_write_bmp( path, width, height, channels, image_data );
+        case IMAGE_FORMAT_TGA: return 0 != stbi_write_tga( path, width, height, channels, image_data );
+        case IMAGE_FORMAT_JPG: return 0 != stbi_write_jpg( path, width, height, channels, image_data, JPG_QUALITY );
+        case IMAGE_FORMAT_PPM:
+            {
+                image_encoder * encoder = image_encoder_open( path, IMAGE_ENCODER_PPM, width, height );
+                const bool      ok      = encoder && image_encoder_write_rows( encoder, image_data, height );
+                return image_encoder_close( encoder ) && ok;
+            }
+        default: return false;
+        }
+}
+
+// Writes a snapshot of the render in progress to the output image. The snapshot is written next to it first and
+// then renamed over it, so a viewer never reads a half-written image.
+static bool
+write_snapshot( void * user, const unsigned char * image_data, int width, int height, int pass )
+{
+    const render_output * output = (const render_output *)user;
+    RT_UNUSED( pass );
+    bool ok = write_image( output->snapshot_path, output->format, image_data, width, height );
+    ok      = ok && 0 == rename( output->snapshot_path, output->image_path );
+    if( !ok ) remove( output->snapshot_path );
+    return ok;
+}
+
+// Saves the render state to the checkpoint file
+static bool
+write_checkpoint( void * user, const film * f )
+{
+    const render_output * output = (const render_output *)user;
+    return checkpoint_save( output->checkpoint_path, f, &output->info );
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Command line
+//----------------------------------------------------------------------------------------------------------------------
+// Settings given on the command line. Zero, or NULL, leaves the setting to the scene.
+typedef struct
+{
+    const char * scene_path;
+    const char * output_path;
+    image_format format;
+    bool         has_format;
+    int          image_width;
+    double       aspect_ratio;
+    int          samples_per_pixel;
+    int          max_depth;
+    int          thread_count; // 0 uses every hardware thread
+    int          tile_size;
+    int          packet_size; // Edge length of the primary-ray packets
+    double       time_budget;
+    bool         progressive;      // Render in passes, with snapshots and checkpoints, instead of all at once
+    int          pass_samples;     // Samples per pixel of every progressive pass; 0 for PASS_SAMPLES
+    int          snapshot_passes;  // Snapshot the output image every this many passes; 0 for none
+    double       snapshot_seconds; // Snapshot the output image every this many seconds; 0 for none
+    bool         resume;           // Continue the progressive render saved in a checkpoint
+    const char * resume_path;      // Checkpoint to continue and save to; NULL for the one named after the output
+    bool         no_checkpoint;    // Save no checkpoints of a progressive render
+    uint64_t     seed;
+    bool         has_seed;
+    bool         stream;       // Render band by band, writing each band while the next renders
+    const char * hdr_path;     // Also write the linear radiance here as a PFM; NULL for none
+    const char * tonemap_path; // Grade this PFM into the output image instead of rendering; NULL to render
+    bool         denoise;      // Denoise the rendered film before grading it into the output image
+    sampler_type sampler;      // Sequence the samples draw from
+    bool         has_sampler;
+
+    // Path integration, each setting with whether it was given
+    camera_integrator integrator;
+    bool              has_integrator;
+    int               roulette_depth;
+    bool              has_roulette_depth;
+    double            adaptive_threshold;
+    bool              has_adaptive_threshold;
+    int               adaptive_min_samples; // 0 leaves it to the scene
+
+    postprocess_settings post; // Conversion of the linear radiance to the 8-bit output
+} render_options;
+
+static void
+print_usage( FILE * stream, const char * program )
+{
+    fprintf( stream,
+             "Usage: %s [options] [scene file]\n"
+             "Renders the scene file, or the built-in scene, to %s. Options override the scene's settings.\n"
+             "\n"
+             "  -w, --width <pixels>      Image width\n"
+             "  -a, --aspect <ratio>      Image aspect ratio, as w:h or a number such as 16:9 or 1.5\n"
+             "  -s, --spp <samples>       Samples per pixel\n"
+             "  -d, --depth <bounces>     Maximum path depth\n"
+             "  -j, --threads <count>     Render threads (default: every hardware thread)\n"
+             "      --seed <integer>      Seed of the scene and the samples (default: the resumed checkpoint's, or\n"
+             "                            the time)\n"
+             "  -o, --output <path>       Output image (default: %s)\n"
+             "  -f, --format <format>     png, bmp, tga, jpg or ppm (default: from the output extension)\n"
+             "      --tile <pixels>       Edge length of the render tiles\n"
+             "      --packet <size>       Trace primary rays in size x size packets, up to 8; 1 traces single rays\n"
+             "                            (default: 1); packets are currently no faster, and often slower\n"
+             "      --integrator <name>   Path integrator: recursive or wavefront (default: recursive)\n"
+             "      --roulette-depth <bounces>\n"
+             "                            Bounces before Russian roulette may end a path; 0 disables it (default: 0)\n"
+             "      --adaptive <threshold>\n"
+             "                            Stop sampling a pixel once its displayed luminance is known within the\n"
+             "                            threshold, at most --spp samples; 0 disables it (default: 0)\n"
+             "      --adaptive-min <samples>\n"
+             "                            Samples per adaptive pass, each ending in a convergence test (default: 16)\n"
+             "  -t, --time <seconds>      Time budget; the render stops within it, rendering progressively\n"
+             "                            (default: take every sample)\n"
+             "      --progressive         Render in passes, checkpointing the render every minute to resume it\n"
+             "      --resume [path]       Continue the progressive render saved in the checkpoint at path, a %s file\n"
+             "                            (default: the output path with that extension)\n"
+             "      --no-checkpoint       Save no checkpoints of a progressive render\n"
+             "      --pass-spp <samples>  Samples per pixel of every progressive pass (default: %d)\n"
+             "      --snapshot-every <passes|seconds>\n"
+             "                            Write the output image every this many progressive passes, or seconds with\n"
+             "                            an s suffix such as 10s (default: only once done)\n"
+             "      --sampler <name>      Sample sequence: random, stratified, sobol or bluenoise\n"
+             "                            (default: the scene's, or random)\n"
+             "      --stream              Write the image band by band while rendering, holding only a few bands in\n"
+             "                            memory; png or ppm, without snapshots, checkpoints or a time budget\n"
+             "      --hdr <path>          Also write the linear radiance, unclamped, as a PFM image\n"
+             "      --tonemap <path>      Grade a PFM written with --hdr into the output image instead of rendering\n"
+             "      --denoise             Denoise the output image, guided by the albedo, normal and depth of the\n"
+             "                            scene; --hdr still writes the noisy radiance\n"
+             "      --exposure <stops>    Exposure of the output image (default: 0)\n"
+             "      --tonemapper <name>   Tone curve of the output image: clamp, reinhard or aces (default: clamp)\n"
+             "      --no-dither           Round the output image to 8 bits instead of dithering it\n"
+             "  -h, --help                Print this help\n",
+             program, OUTPUT_FILENAME, OUTPUT_FILENAME, CHECKPOINT_EXTENSION, PASS_SAMPLES );
+}
+
+// Parses `text` as an integer within [min, max]
+static bool
+parse_int( const char * text, int min, int max, int * value )
+{
+    char * end = NULL;
+    long   n   = strtol( text, &end, 10 );
+    if( end == text || '\0' != *end || n < min || n > max ) return false;
+    *value = (int)n;
+    return true;
+}
 
-    // Ground Sphere
-    {
-        lambertian * mat_ground = malloc( sizeof( lambertian ) );
-        lambertian_init( mat_ground, vec3_new( 0.5, 0.5, 0.5 ) );
+// Parses `text` as a positive real number, or as a ratio `w:h` of two
+static bool
+parse_ratio( const char * text, double * value )
+{
+    char * end = NULL;
+    double n   = strtod( text, &end );
+    double d   = 1.0;
+    if( end == text ) return false;
+    if( ':' == *end )
+        {
+            const char * denominator = end + 1;
+            d                        = strtod( denominator, &end );
+            if( end == denominator ) return false;
+        }
+    if( '\0' != *end || !( n > 0.0 ) || !( d > 0.0 ) ) return false;
+    *value = n / d;
+    return true;
+}
 
-        sphere * sphere_gnd = malloc( sizeof( sphere ) );
-        sphere_init( sphere_gnd, vec3_new( 0.0, -1000, 0 ), 1000.0, (material *)mat_ground );
-        hittable_list_add( &world, (hittable *)sphere_gnd );
-    }
+// True if `text` ends with `suffix` and has more before it
+static bool
+ends_with( const char * text, const char * suffix )
+{
+    const size_t length        = strlen( text );
+    const size_t suffix_length = strlen( suffix );
+    return length > suffix_length && 0 == strcmp( text + length - suffix_length, suffix );
+}
 
-    // Random Spheres
-    for( int a = -11; a < 11; ++a )
+// Parses `text` as a snapshot interval: a number of passes, or of seconds when followed by `s`
+static bool
+parse_interval( const char * text, int * passes, double * seconds )
+{
+    char * end = NULL;
+    double n   = strtod( text, &end );
+    if( end != text && 0 == strcmp( end, "s" ) && isfinite( n ) && n > 0.0 )
         {
-            for( int b = -11; b < 11; ++b )
+            *seconds = n;
+            return true;
+        }
+    return parse_int( text, 1, INT32_MAX, passes );
+}
+
+static bool
+parse_format( const char * text, image_format * format )
+{
+    for( int f = 0; f < IMAGE_FORMAT_COUNT; ++f )
+        {
+            if( 0 == strcmp( text, image_format_names[f] ) )
                 {
-                    double choose_mat = random_double();
-                    point3 center     = vec3_new( a + 0.9 * random_double(), 0.2, b + 0.9 * random_double() );
+                    *format = (image_format)f;
+                    return true;
+                }
+        }
+    return false;
+}
 
-                    if( vec3_length( vec3_sub( center, vec3_new( 4, 0.2, 0 ) ) ) > 0.9 )
-                        {
-                            sphere * s = malloc( sizeof( sphere ) );
+// Looks up a tone curve by its name.
+//
+// Returns:
+//   true if `text` names a tone curve, stored in `*tonemap`
+static bool
+parse_tonemapper( const char * text, postprocess_tonemap * tonemap )
+{
+    for( int t = 0; t < POSTPROCESS_TONEMAP_COUNT; ++t )
+        {
+            if( 0 == strcmp( text, postprocess_tonemap_name( (postprocess_tonemap)t ) ) )
+                {
+                    *tonemap = (postprocess_tonemap)t;
+                    return true;
+                }
+        }
+    return false;
+}
 
-                            if( 0.8 > choose_mat )
-                                {
-                                    // Diffuse material
-                                    lambertian * mat = malloc( sizeof( lambertian ) );
-                                    color        albedo
-                                        = vec3_mul_vec( vec3_new( random_double(), random_double(), random_double() ),
-                                                        vec3_new( random_double(), random_double(), random_double() ) );
-                                    lambertian_init( mat, albedo );
-                                    sphere_init( s, center, 0.2, (material *)mat );
-                                }
-                            else if( 0.95 > choose_mat )
-                                {
-                                    // Metal material
-                                    metal * mat = malloc( sizeof( metal ) );
-                                    color   albedo
-                                        = vec3_new( random_double_range( 0.5, 1 ), random_double_range( 0.5, 1 ),
-                                                    random_double_range( 0.5, 1 ) );
-                                    double fuzz = random_double_range( 0, 0.5 );
-                                    metal_init( mat, albedo, fuzz );
-                                    sphere_init( s, center, 0.2, (material *)mat );
-                                }
-                            else
-                                {
-                                    // Glass material
-                                    dielectric * mat = malloc( sizeof( dielectric ) );
-                                    dielectric_init( mat, 1.5 );
-                                    sphere_init( s, center, 0.2, (material *)mat );
-                                }
+// Parses the command line into `options`.
+//
+// Returns:
+//   true to render; false on an error (reported) or after printing the help, with `*status` the exit status
+static bool
+parse_options( int argc, char ** argv, render_options * options, int * status )
+{
+    memset( options, 0, sizeof( *options ) );
+    options->output_path = OUTPUT_FILENAME;
+    options->time_budget = TIME_BUDGET;
+    *status              = EXIT_FAILURE;
+    postprocess_settings_init( &options->post );
 
-                            hittable_list_add( &world, (hittable *)s );
+    for( int i = 1; i < argc; ++i )
+        {
+            const char * arg = argv[i];
+            if( '-' != arg[0] )
+                {
+                    if( NULL != options->scene_path )
+                        {
+                            fprintf( stderr, "ERROR: More than one scene file given: '%s'.\n", arg );
+                            return false;
                         }
+                    options->scene_path = arg;
+                    continue;
+                }
+
+            if( 0 == strcmp( arg, "-h" ) || 0 == strcmp( arg, "--help" ) )
+                {
+                    print_usage( stdout, argv[0] );
+                    *status = EXIT_SUCCESS;
+                    return false;
+                }
+            if( 0 == strcmp( arg, "--stream" ) )
+                {
+                    options->stream = true;
+                    continue;
+                }
+            if( 0 == strcmp( arg, "--denoise" ) )
+                {
+                    options->denoise = true;
+                    continue;
+                }
+            if( 0 == strcmp( arg, "--progressive" ) )
+                {
+                    options->progressive = true;
+                    continue;
+                }
+            if( 0 == strcmp( arg, "--no-checkpoint" ) )
+                {
+                    options->no_checkpoint = true;
+                    continue;
+                }
+            if( 0 == strcmp( arg, "--resume" ) )
+                {
+                    // The path is optional, so only a checkpoint file is taken as one, never the scene file
+                    options->resume = true;
+                    if( i + 1 < argc && ends_with( argv[i + 1], CHECKPOINT_EXTENSION ) )
+                        {
+                            options->resume_path = argv[++i];
+                        }
+                    continue;
+                }
+            if( 0 == strcmp( arg, "--no-dither" ) )
+                {
+                    options->post.dither = false;
+                    continue;
+                }
+
+            // Every other option takes a value
+            const char * value = ( i + 1 < argc ) ? argv[i + 1] : NULL;
+            bool         valid = ( NULL != value );
+            ++i;
+
+#define OPTION( short_name, long_name ) ( 0 == strcmp( arg, short_name ) || 0 == strcmp( arg, long_name ) )
+            if( OPTION( "-w", "--width" ) )
+                valid = valid && parse_int( value, 1, 1 << 16, &options->image_width );
+            else if( OPTION( "-a", "--aspect" ) )
+                valid = valid && parse_ratio( value, &options->aspect_ratio );
+            else if( OPTION( "-s", "--spp" ) )
+                valid = valid && parse_int( value, 1, INT32_MAX, &options->samples_per_pixel );
+            else if( OPTION( "-d", "--depth" ) )
+                valid = valid && parse_int( value, 1, INT32_MAX, &options->max_depth );
+            else if( OPTION( "-j", "--threads" ) )
+                valid = valid && parse_int( value, 0, 4096, &options->thread_count );
+            else if( OPTION( "--seed", "--seed" ) )
+                {
+                    char * end        = NULL;
+                    valid             = valid && '-' != value[0];
+                    options->seed     = valid ? strtoull( value, &end, 0 ) : 0;
+                    valid             = valid && end != value && '\0' == *end;
+                    options->has_seed = true;
+                }
+            else if( OPTION( "-o", "--output" ) )
+                options->output_path = value;
+            else if( OPTION( "-f", "--format" ) )
+                valid = options->has_format = valid && parse_format( value, &options->format );
+            else if( OPTION( "--tile", "--tile" ) )
+                valid = valid && parse_int( value, 1, 1 << 16, &options->tile_size );
+            else if( OPTION( "--packet", "--packet" ) )
+                valid = valid && parse_int( value, 1, CAMERA_MAX_PACKET_SIZE, &options->packet_size );
+            else if( OPTION( "--integrator", "--integrator" ) )
+                valid = options->has_integrator = valid && camera_integrator_parse( value, &options->integrator );
+            else if( OPTION( "--roulette-depth", "--roulette-depth" ) )
+                valid = options->has_roulette_depth
+                    = valid && parse_int( value, 0, INT32_MAX, &options->roulette_depth );
+            else if( OPTION( "--adaptive", "--adaptive" ) )
+                {
+                    char * end                      = NULL;
+                    options->adaptive_threshold     = valid ? strtod( value, &end ) : 0.0;
+                    valid                           = valid && end != value && '\0' == *end
+                        && isfinite( options->adaptive_threshold ) && options->adaptive_threshold >= 0.0;
+                    options->has_adaptive_threshold = true;
+                }
+            else if( OPTION( "--adaptive-min", "--adaptive-min" ) )
+                valid = valid && parse_int( value, 1, INT32_MAX, &options->adaptive_min_samples );
+            else if( OPTION( "--hdr", "--hdr" ) )
+                options->hdr_path = value;
+            else if( OPTION( "--tonemap", "--tonemap" ) )
+                options->tonemap_path = value;
+            else if( OPTION( "--exposure", "--exposure" ) )
+                {
+                    char * end             = NULL;
+                    options->post.exposure = valid ? strtod( value, &end ) : 0.0;
+                    valid = valid && end != value && '\0' == *end && isfinite( options->post.exposure );
+                }
+            else if( OPTION( "--sampler", "--sampler" ) )
+                valid = options->has_sampler = valid && sampler_parse( value, &options->sampler );
+            else if( OPTION( "--tonemapper", "--tonemapper" ) )
+                valid = valid && parse_tonemapper( value, &options->post.tonemap );
+            else if( OPTION( "--pass-spp", "--pass-spp" ) )
+                valid = valid && parse_int( value, 1, INT32_MAX, &options->pass_samples );
+            else if( OPTION( "--snapshot-every", "--snapshot-every" ) )
+                valid = valid && parse_interval( value, &options->snapshot_passes, &options->snapshot_seconds );
+            else if( OPTION( "-t", "--time" ) )
+                {
+                    char * end           = NULL;
+                    options->time_budget = valid ? strtod( value, &end ) : 0.0;
+                    valid                = valid && end != value && '\0' == *end && options->time_budget >= 0.0;
+                }
+            else
+                {
+                    fprintf( stderr, "ERROR: Unknown option '%s'.\n", arg );
+                    print_usage( stderr, argv[0] );
+                    return false;
+                }
+#undef OPTION
+
+            if( !valid )
+                {
+                    fprintf( stderr, "ERROR: Invalid value for %s: '%s'.\n", arg, value ? value : "" );
+                    return false;
                 }
         }
 
-    // Three large central spheres
-    {
-        // Glass sphere
-        dielectric * mat1 = malloc( sizeof( dielectric ) );
-        dielectric_init( mat1, 1.5 );
+    // Without --format, the output extension names the format
+    if( !options->has_format )
+        {
+            const char * dot   = strrchr( options->output_path, '.' );
+            const char * slash = strrchr( options->output_path, '/' );
+            if( NULL == dot || ( NULL != slash && dot < slash ) || !parse_format( dot + 1, &options->format ) )
+                {
+                    fprintf( stderr, "ERROR: Cannot tell the format of '%s'; pass --format.\n", options->output_path );
+                    return false;
+                }
+        }
 
-        sphere * sphere1 = malloc( sizeof( sphere ) );
-        sphere_init( sphere1, vec3_new( 0, 1, 0 ), 1.0, (material *)mat1 );
-        hittable_list_add( &world, (hittable *)sphere1 );
-    }
+    // A time budget is kept between passes, and only progressive renders are checkpointed to resume; the pass
+    // settings only apply to a progressive render
+    if( options->time_budget > 0.0 || options->resume ) options->progressive = true;
+    if( !options->progressive && ( options->pass_samples > 0 || options->snapshot_passes > 0
+                                   || options->snapshot_seconds > 0.0 ) )
+        {
+            fprintf( stderr, "ERROR: --pass-spp and --snapshot-every need --progressive.\n" );
+            return false;
+        }
+    if( options->pass_samples <= 0 ) options->pass_samples = PASS_SAMPLES;
 
-    {
-        // Brown diffuse sphere
-        lambertian * mat2 = malloc( sizeof( lambertian ) );
-        lambertian_init( mat2, vec3_new( 0.4, 0.2, 0.1 ) );
+    // Only the encoders of image_encoder write a row at a time, and a streamed render takes every sample
+    if( options->stream && IMAGE_FORMAT_PNG != options->format && IMAGE_FORMAT_PPM != options->format )
+        {
+            fprintf( stderr, "ERROR: --stream writes png or ppm, not %s.\n", image_format_names[options->format] );
+            return false;
+        }
+    if( options->stream && options->progressive )
+        {
+            fprintf( stderr, "ERROR: --stream takes every sample at once, not with --progressive, --time or "
+                             "--resume.\n" );
+            return false;
+        }
 
-        sphere * sphere2 = malloc( sizeof( sphere ) );
-        sphere_init( sphere2, vec3_new( -4, 1, 0 ), 1.0, (material *)mat2 );
-        hittable_list_add( &world, (hittable *)sphere2 );
-    }
+    // The HDR image is resolved from the film, which streamed and graded images do not have
+    if( NULL != options->hdr_path && ( options->stream || NULL != options->tonemap_path ) )
+        {
+            fprintf( stderr, "ERROR: --hdr writes a rendered film, not with --stream or --tonemap.\n" );
+            return false;
+        }
+    if( NULL != options->tonemap_path && options->stream )
+        {
+            fprintf( stderr, "ERROR: --tonemap does not render, so it cannot --stream.\n" );
+            return false;
+        }
 
-    {
-        // Metal sphere
-        metal * mat3 = malloc( sizeof( metal ) );
-        metal_init( mat3, vec3_new( 0.7, 0.6, 0.5 ), 0.0 );
+    // The denoiser needs the whole image, and the feature buffers of the scene it was rendered from
+    if( options->denoise && ( options->stream || NULL != options->tonemap_path ) )
+        {
+            fprintf( stderr, "ERROR: --denoise filters a rendered film, not with --stream or --tonemap.\n" );
+            return false;
+        }
 
-        sphere * sphere3 = malloc( sizeof( sphere ) );
-        sphere_init( sphere3, vec3_new( 4, 1, 0 ), 1.0, (material *)mat3 );
-        hittable_list_add( &world, (hittable *)sphere3 );
-    }
+    options->post.thread_count = options->thread_count;
+    return true;
+}
 
-    // Camera
+// Applies the options that override the camera's settings, keeping its view
+static void
+apply_options( const render_options * options, camera * cam )
+{
+    const double aspect = ( options->aspect_ratio > 0.0 ) ? options->aspect_ratio : cam->aspect_ratio;
+    const int    width  = ( options->image_width > 0 ) ? options->image_width : cam->image_width;
+    const int    spp    = ( options->samples_per_pixel > 0 ) ? options->samples_per_pixel : cam->samples_per_pixel;
+    const int    depth  = ( options->max_depth > 0 ) ? options->max_depth : cam->max_depth;
+    const camera scene  = *cam; // camera_init resets the integration settings, which the scene may have set
+
+    camera_init( cam, aspect, cam->vertical_fov_deg, cam->position, cam->target, cam->world_up, cam->aperture,
+                 cam->focal_distance, width, spp, depth );
+    cam->thread_count       = options->thread_count;
+    cam->packet_size        = ( options->packet_size > 0 ) ? options->packet_size : scene.packet_size;
+    cam->integrator         = options->has_integrator ? options->integrator : scene.integrator;
+    cam->roulette_min_depth = options->has_roulette_depth ? options->roulette_depth : scene.roulette_min_depth;
+    cam->adaptive_threshold = options->has_adaptive_threshold ? options->adaptive_threshold : scene.adaptive_threshold;
+    cam->sampler            = options->has_sampler ? options->sampler : scene.sampler;
+    cam->adaptive_min_samples
+        = ( options->adaptive_min_samples > 0 ) ? options->adaptive_min_samples : scene.adaptive_min_samples;
+    if( options->tile_size > 0 ) cam->tile_size = options->tile_size;
+}
+
+// Renders the image a band of rows at a time into the output file. Each band is encoded and written by the band
+// writer while the next one renders, so neither the 8-bit image nor a film is ever held whole.
+static bool
+render_streamed( const camera * cam, const bvh_flat * world, const render_options * options )
+{
+    const image_encoder_format format    = ( IMAGE_FORMAT_PPM == options->format ) ? IMAGE_ENCODER_PPM
+                                                                                   : IMAGE_ENCODER_PNG;
+    const int                  band_rows = ( cam->tile_size > 0 ) ? cam->tile_size : STREAM_BAND_ROWS;
+
+    // The band renders into linear radiance, which is post-processed into the band the writer encodes
+    float * radiance = (float *)malloc( (size_t)cam->image_width * band_rows * 3 * sizeof( float ) );
+    if( NULL == radiance )
+        {
+            fprintf( stderr, "Failed to alloc memory\n" );
+            return false;
+        }
+
+    image_encoder * encoder = image_encoder_open( options->output_path, format, cam->image_width, cam->image_height );
+    band_writer *   writer  = encoder ? band_writer_start( encoder, cam->image_width, band_rows, STREAM_BAND_COUNT )
+                                      : NULL;
+    bool ok = NULL != writer;
+    for( int y = 0; ok && y < cam->image_height; y += band_rows )
+        {
+            const int       rows = RT_MIN( band_rows, cam->image_height - y );
+            unsigned char * band = band_writer_acquire( writer );
+            ok = camera_render_rows_hdr( cam, (const struct hittable *)&world->base, radiance, y, y + rows );
+            if( ok ) postprocess_image( &options->post, radiance, NULL, cam->image_width, y, y + rows, band );
+            band_writer_submit( writer, band, ok ? rows : 0 );
+
+            fprintf( stderr, "\rRows remaining: %d ", cam->image_height - y - rows );
+            fflush( stderr );
+        }
+    ok = band_writer_finish( writer ) && ok;
+    ok = image_encoder_close( encoder ) && ok;
+    free( radiance );
+    fprintf( stderr, "\rDone.                                                      \n" );
+    return ok;
+}
+
+// Writes the mean linear radiance of the film to `path` as a PFM
+static bool
+write_hdr( const film * f, const char * path )
+{
+    hdr_image image;
+    if( !hdr_image_init( &image, f->width, f->height ) ) return false;
+    film_resolve_hdr( f, &image );
+    const bool ok = hdr_image_write_pfm( &image, path );
+    hdr_image_free( &image );
+    if( ok ) printf( "Wrote linear radiance to %s\n", path );
+    return ok;
+}
+
+// Resolves the film into linear radiance, denoises it guided by feature buffers traced from the same primary rays,
+// and grades the result into `image_data`
+static bool
+resolve_denoised( const camera * cam, const bvh_flat * world, const film * f, const render_options * options,
+                  unsigned char * image_data )
+{
+    hdr_image radiance;
+    hdr_image denoised;
+    aov_image aov;
+    bool      ok = hdr_image_init( &radiance, f->width, f->height );
+    ok           = hdr_image_init( &denoised, f->width, f->height ) && ok;
+    ok           = aov_image_init( &aov, f->width, f->height ) && ok;
+    if( ok )
+        {
+            denoise_settings settings;
+            denoise_settings_init( &settings );
+            settings.thread_count = options->thread_count;
+
+            film_resolve_hdr( f, &radiance );
+            ok = camera_render_aov( cam, (const struct hittable *)&world->base, &aov )
+                 && denoise_image( &settings, &radiance, &aov, &denoised );
+            if( ok ) hdr_image_tonemap( &denoised, &options->post, image_data );
+        }
+    hdr_image_free( &radiance );
+    hdr_image_free( &denoised );
+    aov_image_free( &aov );
+    return ok;
+}
+
+// Grades the PFM image given with --tonemap into the output image, without building a scene or rendering
+static int
+tonemap_file( const render_options * options )
+{
+    hdr_image image;
+    if( !hdr_image_read_pfm( &image, options->tonemap_path ) ) return EXIT_FAILURE;
+
+    const size_t    image_size = (size_t)image.width * image.height * RT_IMAGE_DATA_CHANNELS;
+    unsigned char * image_data = (unsigned char *)malloc( image_size );
+    bool            ok         = NULL != image_data;
+    if( ok )
+        {
+            hdr_image_tonemap( &image, &options->post, image_data );
+            ok = write_image( options->output_path, options->format, image_data, image.width, image.height );
+            if( !ok ) fprintf( stderr, "Failed to write output image\n" );
+        }
+    else
+        {
+            fprintf( stderr, "Failed to alloc memory\n" );
+        }
+    if( ok ) printf( "Successfully wrote output image to %s\n", options->output_path );
+
+    free( image_data );
+    hdr_image_free( &image );
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Names the checkpoint of the render to `output_path`: the path with its extension replaced by CHECKPOINT_EXTENSION
+static bool
+checkpoint_path_for( const char * output_path, char * path, size_t size )
+{
+    const char * dot    = strrchr( output_path, '.' );
+    const char * slash  = strrchr( output_path, '/' );
+    const int    length = ( NULL == dot || ( NULL != slash && dot < slash ) ) ? (int)strlen( output_path )
+                                                                             : (int)( dot - output_path );
+    const int written = snprintf( path, size, "%.*s%s", length, output_path, CHECKPOINT_EXTENSION );
+    return written >= 0 && (size_t)written < size;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Main
+//----------------------------------------------------------------------------------------------------------------------
+int
+main( int argc, char ** argv )
+{
+    render_options options;
+    int            status;
+    if( !parse_options( argc, argv, &options, &status ) ) return status;
+    if( NULL != options.tonemap_path ) return tonemap_file( &options );
+
+    char       checkpoint_path[4096];
+    char       snapshot_path[4096];
+    const int  snapshot_length = snprintf( snapshot_path, sizeof( snapshot_path ), "%s%s", options.output_path,
+                                           SNAPSHOT_EXTENSION );
+    if( !checkpoint_path_for( options.output_path, checkpoint_path, sizeof( checkpoint_path ) )
+        || snapshot_length < 0 || (size_t)snapshot_length >= sizeof( snapshot_path ) )
+        {
+            fprintf( stderr, "ERROR: Output path too long: '%s'.\n", options.output_path );
+            return EXIT_FAILURE;
+        }
+
+    // Resuming a checkpoint needs the seed it was started with, to generate the same scene and samples; an explicit
+    // seed must agree with it. Without --resume, the seed is the given one or the time, whatever checkpoint is there.
+    const char *    checkpoint_file = options.resume_path ? options.resume_path : checkpoint_path;
+    checkpoint_info resume          = { 0 };
+    if( options.resume && !checkpoint_peek( checkpoint_file, &resume ) )
+        {
+            fprintf( stderr, "ERROR: No checkpoint to resume at '%s'.\n", checkpoint_file );
+            return EXIT_FAILURE;
+        }
+    if( options.resume && options.has_seed && options.seed != resume.seed )
+        {
+            fprintf( stderr, "ERROR: The checkpoint '%s' was started from seed %llu, not %llu.\n", checkpoint_file,
+                     (unsigned long long)resume.seed, (unsigned long long)options.seed );
+            return EXIT_FAILURE;
+        }
+    const bool checkpointed = options.progressive && !options.no_checkpoint;
+    if( checkpointed && !options.resume && checkpoint_peek( checkpoint_file, &resume ) )
+        {
+            fprintf( stderr, "WARN: Replacing the checkpoint '%s' of an earlier render; --resume continues it.\n",
+                     checkpoint_file );
+        }
+    const uint64_t seed = options.resume ? resume.seed : options.has_seed ? options.seed : (uint64_t)time( NULL );
+
+    // Scene generation draws from its own stream, independent of the render samples
+    rng gen;
+    rng_seed( &gen, seed, 0 );
+
+    // World
     //--------------------------------------------------------------------------------------
+    // Objects are allocated from the scene arena, which frees them all at once at the end, and materials are
+    // stored in the scene's material table
+    hittable_list  world;
+    arena          scene;
+    material_table materials;
+    hittable_list_init( &world, 500 );
+    arena_init( &scene, 0 );
+    material_table_init( &materials );
+
+    // A scene file overrides the camera and settings of the built-in scene, which are its defaults
     camera cam;
-    {
-        point3 position      = vec3_new( 13, 2, 3 );
-        point3 lookat        = vec3_new( 0, 0, 0 );
-        vec3   vup           = vec3_new( 0, 1, 0 );
-        double dist_to_focus = 10.0;
-        double aperture      = 0.1;
-        double vfov          = 20.0;
-
-        camera_init( &cam, ASPECT_RATIO, vfov, position, lookat, vup, aperture, dist_to_focus, IMAGE_WIDTH,
-                     SAMPLES_PER_PIXEL, MAX_DEPTH );
-    }
-
-    // Allocate image buffer
-    unsigned char * image_data;
-    {
-        const size_t image_size = cam.image_width * cam.image_height * RT_IMAGE_DATA_CHANNELS;
-        image_data              = (unsigned char *)malloc( image_size );
-        if( !image_data )
-            {
-                fprintf( stderr, "Failed to alloc memory\n" );
-                hittable_list_clear( &world );
-                return EXIT_FAILURE;
-            }
-    }
+    scene_book_camera( &cam, ASPECT_RATIO, IMAGE_WIDTH, SAMPLES_PER_PIXEL, MAX_DEPTH );
+
+    const bool built = ( NULL != options.scene_path )
+                         ? scene_file_load( options.scene_path, &world, &scene, &materials, &cam )
+                         : scene_book( &world, &scene, &materials, &gen );
+    if( !built )
+        {
+            fprintf( stderr, "Failed to build the scene\n" );
+            hittable_list_clear( &world );
+            arena_free( &scene );
+            material_table_free( &materials );
+            return EXIT_FAILURE;
+        }
+    if( 0 == world.count )
+        {
+            fprintf( stderr, "WARN: %s has no objects, only the sky is rendered.\n", options.scene_path );
+        }
+
+    // Acceleration structure over the world; the list keeps ownership of the objects.
+    // Spheres are packed into SIMD groups that become the BVH leaves, and the pointer tree
+    // is only needed to build the flat, cache-friendly copy used for rendering. An empty world has no tree and gets
+    // an empty hierarchy.
+    hittable_list groups;
+    hittable_list_init( &groups, 64 );
+
+    bvh_flat * world_bvh = NULL;
+    if( sphere_soa_cluster( &world, SPHERE_GROUP_SIZE, &groups ) )
+        {
+            hittable * tree = bvh_node_build( &groups );
+            if( NULL != tree || 0 == groups.count ) world_bvh = bvh_flat_build( tree );
+            bvh_node_free( tree );
+        }
+    if( !world_bvh )
+        {
+            sphere_soa_cluster_free( &groups );
+            hittable_list_clear( &world );
+            arena_free( &scene );
+            material_table_free( &materials );
+            return EXIT_FAILURE;
+        }
+
+    // Camera
+    //--------------------------------------------------------------------------------------
+    apply_options( &options, &cam );
+    cam.seed      = seed;
+    cam.materials = &materials;
+
+    // Allocate image buffer, which a streamed render does without
+    unsigned char * image_data = NULL;
+    if( !options.stream )
+        {
+            const size_t image_size = (size_t)cam.image_width * cam.image_height * RT_IMAGE_DATA_CHANNELS;
+            image_data              = (unsigned char *)malloc( image_size );
+            if( !image_data )
+                {
+                    fprintf( stderr, "Failed to alloc memory\n" );
+                    bvh_flat_free( world_bvh );
+                    sphere_soa_cluster_free( &groups );
+                    hittable_list_clear( &world );
+                    arena_free( &scene );
+                    material_table_free( &materials );
+                    return EXIT_FAILURE;
+                }
+        }
 
     // Render
     //--------------------------------------------------------------------------------------
-    {
-        camera_render( &cam, (struct hittable *)&world, image_data );
-    }
+#ifdef ENABLE_STATS
+    stats_heatmap_begin( cam.image_width, cam.image_height );
+#endif
+
+    if( options.stream )
+        {
+            if( !render_streamed( &cam, world_bvh, &options ) )
+                {
+                    fprintf( stderr, "Failed to render\n" );
+                    bvh_flat_free( world_bvh );
+                    sphere_soa_cluster_free( &groups );
+                    hittable_list_clear( &world );
+                    arena_free( &scene );
+                    material_table_free( &materials );
+                    return EXIT_FAILURE;
+                }
+            printf( "Successfully wrote output image to %s\n", options.output_path );
+        }
+    else
+        {
+            // Accumulates in a float film, all at once or in passes that snapshot the output file and checkpoint the
+            // render along the way
+            render_output output    = { options.output_path, options.format, snapshot_path, checkpoint_file, { 0 } };
+            output.info.seed        = seed;
+            output.info.camera_hash = camera_hash( &cam );
+            output.info.scene_hash  = scene_hash( &world, &materials );
+
+            film frame;
+            bool ok = film_init( &frame, cam.image_width, cam.image_height );
+            if( ok )
+                {
+                    progressive_result result = { 0 };
+                    result.complete           = true;
+                    if( options.progressive )
+                        {
+                            if( options.resume )
+                                {
+                                    ok = checkpoint_load( checkpoint_file, &frame, &output.info );
+                                    if( ok ) printf( "Resuming from %s\n", checkpoint_file );
+                                }
+
+                            progressive_settings settings = { 0 };
+                            settings.pass_samples         = options.pass_samples;
+                            settings.snapshot_passes      = options.snapshot_passes;
+                            settings.snapshot_seconds     = options.snapshot_seconds;
+                            settings.checkpoint_seconds   = CHECKPOINT_SECONDS;
+                            settings.time_budget          = options.time_budget;
+                            settings.snapshot             = write_snapshot;
+                            settings.checkpoint           = options.no_checkpoint ? NULL : write_checkpoint;
+                            settings.post                 = &options.post;
+                            settings.user                 = &output;
+
+                            ok = ok && progressive_render( &cam, &world_bvh->base, &frame, &settings, &result );
+                        }
+                    else
+                        {
+                            ok = camera_render_film( &cam, (const struct hittable *)&world_bvh->base, &frame );
+                        }
+                    if( ok )
+                        {
+                            if( options.denoise )
+                                {
+                                    ok = resolve_denoised( &cam, world_bvh, &frame, &options, image_data );
+                                }
+                            else
+                                {
+                                    film_resolve( &frame, &options.post, image_data );
+                                }
+                        }
+                    if( ok && NULL != options.hdr_path ) ok = write_hdr( &frame, options.hdr_path );
+                    film_free( &frame );
+
+                    // A finished render has nothing left to resume
+                    if( ok && result.complete && ( checkpointed || options.resume ) ) remove( checkpoint_file );
+                }
+            if( !ok )
+                {
+                    fprintf( stderr, "Failed to render\n" );
+                    free( image_data );
+                    bvh_flat_free( world_bvh );
+                    sphere_soa_cluster_free( &groups );
+                    hittable_list_clear( &world );
+                    arena_free( &scene );
+                    material_table_free( &materials );
+                    return EXIT_FAILURE;
+                }
+        }
 
     // Output
     //--------------------------------------------------------------------------------------
-    {
-        const char * filename        = "output.png";
-        const int    stride_in_bytes = cam.image_width * RT_IMAGE_DATA_CHANNELS;
+    if( !options.stream )
+        {
+            const char * filename = options.output_path;
+            if( !write_image( filename, options.format, image_data, cam.image_width, cam.image_height ) )
+                {
+                    fprintf( stderr, "Failed to write output image\n" );
+                    free( image_data );
+                    bvh_flat_free( world_bvh );
+                    sphere_soa_cluster_free( &groups );
+                    hittable_list_clear( &world );
+                    arena_free( &scene );
+                    material_table_free( &materials );
+                    return EXIT_FAILURE;
+                }
 
-        if( !stbi_write_png( filename, cam.image_width, cam.image_height, RT_IMAGE_DATA_CHANNELS, image_data,
-                             stride_in_bytes ) )
-            {
-                fprintf( stderr, "Failed to write output image\n" );
-                free( image_data );
-                hittable_list_clear( &world );
-                return EXIT_FAILURE;
-            }
+            printf( "Successfully wrote output image to %s\n", filename );
+        }
+
+#ifdef ENABLE_STATS
+    // Statistics
+    //--------------------------------------------------------------------------------------
+    stats_print();
 
-        printf( "Successfully wrote output image to %s\n", filename );
-    }
+    // The output image is written, so its buffer is free for the heatmap; a streamed render has none to reuse
+    if( stats_heatmap && !image_data )
+        {
+            image_data = (unsigned char *)malloc( (size_t)cam.image_width * cam.image_height * RT_IMAGE_DATA_CHANNELS );
+        }
+    if( stats_heatmap && image_data )
+        {
+            stats_heatmap_resolve( image_data );
+            if( stbi_write_png( HEATMAP_FILENAME, cam.image_width, cam.image_height, RT_IMAGE_DATA_CHANNELS,
+                                image_data, cam.image_width * RT_IMAGE_DATA_CHANNELS ) )
+                {
+                    printf( "Wrote ray cost heatmap to %s\n", HEATMAP_FILENAME );
+                }
+        }
+    stats_heatmap_end();
+#endif
 
     // De-Initialization
     //--------------------------------------------------------------------------------------
+    bvh_flat_free( world_bvh );
+    sphere_soa_cluster_free( &groups );
     hittable_list_clear( &world );
+    arena_free( &scene );
+    material_table_free( &materials );
     free( image_data );
 
     return EXIT_SUCCESS;
@@ -0,0 +1,219 @@
+#include "material_table.h"
+#include <stdio.h>
+#include <stdlib.h> /* realloc, malloc, free */
+#include <string.h> /* memcmp, memcpy */
+
+// Size of an entry of the array of each type
+static const size_t entry_size[MATERIAL_TYPE_COUNT] = {
+    sizeof( material * ),
+    sizeof( lambertian ),
+    sizeof( metal ),
+    sizeof( dielectric ),
+};
+
+static void **
+type_array( material_table * table, material_type type )
+{
+    switch( type )
+        {
+        case MATERIAL_LAMBERTIAN: return (void **)&table->lambertians;
+        case MATERIAL_METAL: return (void **)&table->metals;
+        case MATERIAL_DIELECTRIC: return (void **)&table->dielectrics;
+        default: return (void **)&table->customs;
+        }
+}
+
+// Folds the bit patterns of `size` bytes of parameters into `h`
+static uint64_t
+hash_params( uint64_t h, const void * params, size_t size )
+{
+    const unsigned char * bytes = (const unsigned char *)params;
+    for( size_t k = 0; k + sizeof( uint64_t ) <= size; k += sizeof( uint64_t ) )
+        {
+            uint64_t word;
+            memcpy( &word, bytes + k, sizeof( word ) );
+            h = rng_hash_u64( h, word );
+        }
+    return h;
+}
+
+// Parameters of a built-in material: everything after the material header, which only holds its type and `scatter`
+static const void *
+params_of( const material * mat )
+{
+    return (const unsigned char *)mat + sizeof( material );
+}
+
+static size_t
+params_size( material_type type )
+{
+    return entry_size[type] - sizeof( material );
+}
+
+static uint64_t
+material_hash( material_type type, const material * mat )
+{
+    return hash_params( rng_hash_u64( 0, (uint64_t)type ), params_of( mat ), params_size( type ) );
+}
+
+// Appends the built-in material `entry` to the array of its type.
+//
+// Returns:
+//   Its id, or MATERIAL_ID_NONE on allocation failure
+static material_id
+append( material_table * table, material_type type, const void * entry )
+{
+    void ** array = type_array( table, type );
+    size_t  count = table->count[type];
+    if( count >= MATERIAL_ID_INDEX_MASK ) return MATERIAL_ID_NONE; // Index space exhausted
+
+    if( count >= table->capacity[type] )
+        {
+            size_t new_capacity = ( table->capacity[type] > 0 ) ? table->capacity[type] * 2 : 16;
+            void * grown        = realloc( *array, new_capacity * entry_size[type] );
+            if( NULL == grown ) return MATERIAL_ID_NONE;
+            *array                = grown;
+            table->capacity[type] = new_capacity;
+        }
+
+    memcpy( (unsigned char *)*array + count * entry_size[type], entry, entry_size[type] );
+    table->count[type] = count + 1;
+    return material_id_make( type, (uint32_t)count );
+}
+
+// Inserts `id` into the hash set, which must have a free slot
+static void
+slot_insert( material_id * slots, size_t slot_count, uint64_t hash, material_id id )
+{
+    size_t s = (size_t)hash & ( slot_count - 1 );
+    while( MATERIAL_ID_NONE != slots[s] )
+        {
+            s = ( s + 1 ) & ( slot_count - 1 );
+        }
+    slots[s] = id;
+}
+
+// Keeps the hash set at most half full
+static bool
+slots_reserve( material_table * table )
+{
+    if( 2 * ( table->slot_used + 1 ) <= table->slot_count ) return true;
+
+    const size_t  new_count = ( table->slot_count > 0 ) ? table->slot_count * 2 : 64;
+    material_id * slots     = (material_id *)malloc( new_count * sizeof( material_id ) );
+    if( NULL == slots ) return false;
+    for( size_t s = 0; s < new_count; ++s )
+        {
+            slots[s] = MATERIAL_ID_NONE;
+        }
+
+    for( size_t s = 0; s < table->slot_count; ++s )
+        {
+            const material_id id = table->slots[s];
+            if( MATERIAL_ID_NONE == id ) continue;
+            const material_type type = material_id_type( id );
+            slot_insert( slots, new_count, material_hash( type, material_table_get( table, id ) ), id );
+        }
+
+    free( table->slots );
+    table->slots      = slots;
+    table->slot_count = new_count;
+    return true;
+}
+
+// Returns the id of the material identical to `candidate`, adding it first if the table has none
+static material_id
+find_or_add( material_table * table, material_type type, const material * candidate )
+{
+    if( !slots_reserve( table ) )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the material table.\n" );
+            return MATERIAL_ID_NONE;
+        }
+
+    const uint64_t hash = material_hash( type, candidate );
+    for( size_t s = (size_t)hash & ( table->slot_count - 1 ); MATERIAL_ID_NONE != table->slots[s];
+         s = ( s + 1 ) & ( table->slot_count - 1 ) )
+        {
+            const material_id id = table->slots[s];
+            if( material_id_type( id ) == type
+                && 0 == memcmp( params_of( material_table_get( table, id ) ), params_of( candidate ),
+                                params_size( type ) ) )
+                {
+                    return id;
+                }
+        }
+
+    const material_id id = append( table, type, candidate );
+    if( MATERIAL_ID_NONE == id )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the material table.\n" );
+            return MATERIAL_ID_NONE;
+        }
+    slot_insert( table->slots, table->slot_count, hash, id );
+    table->slot_used += 1;
+    return id;
+}
+
+void
+material_table_init( material_table * table )
+{
+    memset( table, 0, sizeof( *table ) );
+}
+
+void
+material_table_free( material_table * table )
+{
+    free( table->lambertians );
+    free( table->metals );
+    free( table->dielectrics );
+    free( table->customs );
+    free( table->slots );
+    material_table_init( table );
+}
+
+material_id
+material_table_add_lambertian( material_table * table, color albedo )
+{
+    lambertian mat;
+    memset( &mat, 0, sizeof( mat ) ); // Padding takes part in the comparison
+    lambertian_init( &mat, albedo );
+    return find_or_add( table, MATERIAL_LAMBERTIAN, &mat.base );
+}
+
+material_id
+material_table_add_metal( material_table * table, color albedo, rt_real fuzz )
+{
+    metal mat;
+    memset( &mat, 0, sizeof( mat ) );
+    metal_init( &mat, albedo, fuzz );
+    return find_or_add( table, MATERIAL_METAL, &mat.base );
+}
+
+material_id
+material_table_add_dielectric( material_table * table, rt_real index_of_refraction )
+{
+    dielectric mat;
+    memset( &mat, 0, sizeof( mat ) );
+    dielectric_init( &mat, index_of_refraction );
+    return find_or_add( table, MATERIAL_DIELECTRIC, &mat.base );
+}
+
+material_id
+material_table_add_custom( material_table * table, material * mat )
+{
+    const material_id id = append( table, MATERIAL_CUSTOM, &mat );
+    if( MATERIAL_ID_NONE == id ) fprintf( stderr, "ERROR: Failed to allocate memory for the material table.\n" );
+    return id;
+}
+
+size_t
+material_table_count( const material_table * table )
+{
+    size_t total = 0;
+    for( int t = 0; t < MATERIAL_TYPE_COUNT; ++t )
+        {
+            total += table->count[t];
+        }
+    return total;
+}
@@ -1,25 +1,28 @@
 #include "metal.h"
 #include "hittable.h"
 #include "rtweekend.h"
+#include "stats.h"
 
 void
-metal_init( metal * mat, color albedo, double fuzz )
+metal_init( metal * mat, color albedo, rt_real fuzz )
 {
     if( !mat ) return;
     mat->base.scatter = metal_scatter;
+    mat->base.type    = MATERIAL_METAL;
     mat->albedo       = albedo;
     mat->fuzz         = RT_MIN( fuzz, 1 );
 }
 
 bool
 metal_scatter( const material * material, const ray * r_in, const struct hit_record_s * rec, color * attenuation,
-               ray * scattered )
+               ray * scattered, rng * gen )
 {
     const metal * self      = (const metal *)material;
     vec3          reflected = vec3_reflect( vec3_normalize( ray_direction( r_in ) ), rec->normal );
+    STATS_INC( STATS_SCATTER_METAL );
 
-    *scattered   = ray_create( rec->p, vec3_add( reflected, vec3_mul( random_in_unit_sphere(), self->fuzz ) ) );
+    *scattered   = ray_create( rec->p, vec3_add( reflected, vec3_mul( random_in_unit_sphere( gen ), self->fuzz ) ) );
     *attenuation = self->albedo;
 
-    return ( vec3_dot( ray_direction( scattered ), rec->normal ) > 0 );
+    return ( vec3_dot( ray_direction( scattered ), rec->normal ) > RT_REAL( 0 ) );
 }
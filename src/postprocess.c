@@ -0,0 +1,601 @@
+#include "postprocess.h"
+#include "rtweekend.h"
+#include "tile_scheduler.h"
+#include <math.h>   /* exp2 */
+#include <stdio.h>
+#include <string.h> /* memcpy */
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#    define POSTPROCESS_X86 1
+#    include <immintrin.h>
+#else
+#    define POSTPROCESS_X86 0
+#endif
+
+#define BLOCK_PIXELS    8                      // Pixels a kernel converts per step: one row of the dither matrix
+#define BLOCK_VALUES    ( 3 * BLOCK_PIXELS )   // Values of a block, 3 AVX or 6 SSE registers
+#define BAND_ROWS       8                      // Rows a worker converts per scheduled job
+#define MAX_RADIANCE    65504.0f               // Radiance is clipped here first so no tone curve meets infinity
+#define SRGB_LINEAR_END 0.0031308f             // Up to here the sRGB transfer function is linear
+#define ACES_INPUT      0.6f                   // Narkowicz's fit expects radiance pre-scaled by this
+
+// 8x8 Bayer matrix: every threshold level once, neighbouring levels as far apart as possible
+static const unsigned char bayer[8][8] = {
+    { 0, 32, 8, 40, 2, 34, 10, 42 },  { 48, 16, 56, 24, 50, 18, 58, 26 }, { 12, 44, 4, 36, 14, 46, 6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 }, { 3, 35, 11, 43, 1, 33, 9, 41 },  { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47, 7, 39, 13, 45, 5, 37 },  { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+// log2(1 + t) = t * P(t) and 2^f = Q(f) on [0, 1), least-squares fits on Chebyshev nodes. Errors are below 3e-6
+// and 1e-7, far under the 1/255 step of the output.
+static const float log2_poly[6] = { 1.4425347793f,  -0.7180335869f, 0.4571581055f,
+                                    -0.2773416152f, 0.1214729207f,  -0.0257923358f };
+static const float exp2_poly[6] = { 0.9999999269f, 0.6931529682f, 0.2401545300f,
+                                    0.0558236041f, 0.0089925845f, 0.0018762328f };
+
+// Settings of a conversion, as the kernels use them
+typedef struct
+{
+    float               exposure; // 2^stops
+    postprocess_tonemap tonemap;
+} post_params;
+
+// Converts one row of `width` pixels; `samples` is NULL for a row of means. `dither` holds the BLOCK_VALUES
+// thresholds of the row's Bayer row.
+typedef void ( *row_fn )( const post_params * params, const float * radiance, const uint32_t * samples,
+                          const float * dither, int width, unsigned char * out );
+
+// A block of fewer than BLOCK_PIXELS pixels at the end of a row, padded with black
+typedef struct
+{
+    float         radiance[BLOCK_VALUES];
+    float         inv[BLOCK_VALUES];
+    unsigned char out[BLOCK_VALUES];
+} tail_block;
+
+// Ones for rows of means: every pixel counts as one sample
+static const float no_samples[BLOCK_VALUES] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                                                1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+// Fills `inv` with 1 / samples of `count` pixels, repeated for their 3 channels, and 0 past them
+static inline void
+block_inverse( const uint32_t * samples, int count, float * inv )
+{
+    for( int p = 0; p < BLOCK_PIXELS; ++p )
+        {
+            const float s = ( p < count && samples[p] > 0 ) ? 1.0f / (float)samples[p] : 0.0f;
+            inv[3 * p]    = s;
+            inv[3 * p + 1] = s;
+            inv[3 * p + 2] = s;
+        }
+}
+
+// Copies the last `count` pixels of a row into `tail`, padded with black
+static inline void
+tail_load( tail_block * tail, const float * radiance, const uint32_t * samples, int count )
+{
+    memset( tail->radiance, 0, sizeof( tail->radiance ) );
+    memcpy( tail->radiance, radiance, (size_t)count * 3 * sizeof( float ) );
+    if( samples )
+        {
+            block_inverse( samples, count, tail->inv );
+        }
+    else
+        {
+            for( int k = 0; k < BLOCK_VALUES; ++k )
+                {
+                    tail->inv[k] = ( k < 3 * count ) ? 1.0f : 0.0f;
+                }
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Scalar kernel
+//----------------------------------------------------------------------------------------------------------------------
+// Horner's rule in sse2_poly's order, written out so the compiler can vectorize loops that call it
+static inline float
+scalar_poly( const float * c, float x )
+{
+    return ( ( ( ( c[5] * x + c[4] ) * x + c[3] ) * x + c[2] ) * x + c[1] ) * x + c[0];
+}
+
+// sRGB transfer function of v in [0, 1], computed one lane of sse2_srgb at a time, operation for operation, so every
+// kernel produces the same bytes
+static inline float
+scalar_srgb( float v )
+{
+    uint32_t bits;
+    memcpy( &bits, &v, sizeof( bits ) );
+    const float    e      = (float)( (int32_t)( bits >> 23 ) - 127 );
+    const uint32_t m_bits = ( bits & 0x7fffff ) | 0x3f800000;
+    float          m;
+    memcpy( &m, &m_bits, sizeof( m ) );
+    const float t = m - 1.0f;
+    const float y = ( scalar_poly( log2_poly, t ) * t + e ) * ( 1.0f / 2.4f );
+
+    int32_t i = (int32_t)y;
+    i        -= ( (float)i > y );
+    float    p = scalar_poly( exp2_poly, y - (float)i );
+    uint32_t p_bits;
+    memcpy( &p_bits, &p, sizeof( p_bits ) );
+    p_bits += (uint32_t)i << 23;
+    memcpy( &p, &p_bits, sizeof( p ) );
+
+    // Both sides are computed and blended through a mask, as in the SIMD kernels: a conditional on floats would keep
+    // the compiler from vectorizing the loops calling this
+    const float curve = p * 1.055f - 0.055f;
+    const float line  = v * 12.92f;
+    uint32_t    curve_bits, line_bits;
+    memcpy( &curve_bits, &curve, sizeof( curve_bits ) );
+    memcpy( &line_bits, &line, sizeof( line_bits ) );
+    const uint32_t low      = -(uint32_t)( v <= SRGB_LINEAR_END );
+    const uint32_t out_bits = ( line_bits & low ) | ( curve_bits & ~low );
+    float          out;
+    memcpy( &out, &out_bits, sizeof( out ) );
+    return out;
+}
+
+// Converts a block stage by stage, with the tone curve picked once per block rather than per value, so the compiler
+// keeps many values in flight and can vectorize every stage
+static inline void
+scalar_block( const post_params * params, const float * radiance, const float * inv, const float * dither,
+              unsigned char * out )
+{
+    float v[BLOCK_VALUES];
+    for( int k = 0; k < BLOCK_VALUES; ++k )
+        {
+            const float x = radiance[k] * inv[k] * params->exposure;
+            v[k]          = ( x > 0.0f ) ? x : 0.0f; // Also turns NaN black
+            v[k]          = ( v[k] < MAX_RADIANCE ) ? v[k] : MAX_RADIANCE;
+        }
+
+    switch( params->tonemap )
+        {
+        case POSTPROCESS_TONEMAP_REINHARD:
+            for( int k = 0; k < BLOCK_VALUES; ++k )
+                {
+                    v[k] = v[k] / ( v[k] + 1.0f );
+                }
+            break;
+        case POSTPROCESS_TONEMAP_ACES:
+            for( int k = 0; k < BLOCK_VALUES; ++k )
+                {
+                    const float x = v[k] * ACES_INPUT;
+                    v[k]          = ( x * ( x * 2.51f + 0.03f ) ) / ( x * ( x * 2.43f + 0.59f ) + 0.14f );
+                }
+            break;
+        default: break;
+        }
+
+    for( int k = 0; k < BLOCK_VALUES; ++k )
+        {
+            v[k] = ( v[k] < 1.0f ) ? v[k] : 1.0f;
+        }
+    for( int k = 0; k < BLOCK_VALUES; ++k )
+        {
+            const int q = (int)( scalar_srgb( v[k] ) * 255.0f + dither[k] );
+            out[k]      = (unsigned char)( ( q < 255 ) ? q : 255 );
+        }
+}
+
+static void
+row_scalar( const post_params * params, const float * radiance, const uint32_t * samples, const float * dither,
+            int width, unsigned char * out )
+{
+    float inv[BLOCK_VALUES];
+    int   x = 0;
+    for( ; x + BLOCK_PIXELS <= width; x += BLOCK_PIXELS )
+        {
+            if( samples ) block_inverse( samples + x, BLOCK_PIXELS, inv );
+            scalar_block( params, radiance + 3 * x, samples ? inv : no_samples, dither, out + 3 * x );
+        }
+    if( x < width )
+        {
+            tail_block tail;
+            tail_load( &tail, radiance + 3 * x, samples ? samples + x : NULL, width - x );
+            scalar_block( params, tail.radiance, tail.inv, dither, tail.out );
+            memcpy( out + 3 * x, tail.out, (size_t)( width - x ) * 3 );
+        }
+}
+
+#if POSTPROCESS_X86
+//----------------------------------------------------------------------------------------------------------------------
+// SSE2 kernel
+//----------------------------------------------------------------------------------------------------------------------
+__attribute__( ( target( "sse2" ) ) ) static inline __m128
+sse2_poly( const float * c, __m128 x )
+{
+    __m128 p = _mm_set1_ps( c[5] );
+    for( int i = 4; i >= 0; --i )
+        {
+            p = _mm_add_ps( _mm_mul_ps( p, x ), _mm_set1_ps( c[i] ) );
+        }
+    return p;
+}
+
+// sRGB transfer function of v in [0, 1]: v^(1/2.4) is 2^(log2(v) / 2.4), with log2 split into the exponent of v and
+// a polynomial of its mantissa, and 2^y into an integer added to the exponent and a polynomial of the fraction
+__attribute__( ( target( "sse2" ) ) ) static inline __m128
+sse2_srgb( __m128 v )
+{
+    const __m128i bits = _mm_castps_si128( v );
+    const __m128  e    = _mm_cvtepi32_ps( _mm_sub_epi32( _mm_srli_epi32( bits, 23 ), _mm_set1_epi32( 127 ) ) );
+    const __m128  m    = _mm_castsi128_ps(
+        _mm_or_si128( _mm_and_si128( bits, _mm_set1_epi32( 0x7fffff ) ), _mm_set1_epi32( 0x3f800000 ) ) );
+    const __m128 t     = _mm_sub_ps( m, _mm_set1_ps( 1.0f ) );
+    const __m128 y     = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( sse2_poly( log2_poly, t ), t ), e ),
+                                     _mm_set1_ps( 1.0f / 2.4f ) );
+
+    // SSE2 has no floor: truncate, then step down where that rounded up
+    __m128i i          = _mm_cvttps_epi32( y );
+    i                  = _mm_add_epi32( i, _mm_castps_si128( _mm_cmpgt_ps( _mm_cvtepi32_ps( i ), y ) ) );
+    const __m128 f     = _mm_sub_ps( y, _mm_cvtepi32_ps( i ) );
+    const __m128 p     = _mm_castsi128_ps(
+        _mm_add_epi32( _mm_castps_si128( sse2_poly( exp2_poly, f ) ), _mm_slli_epi32( i, 23 ) ) );
+
+    const __m128 curve = _mm_sub_ps( _mm_mul_ps( p, _mm_set1_ps( 1.055f ) ), _mm_set1_ps( 0.055f ) );
+    const __m128 line  = _mm_mul_ps( v, _mm_set1_ps( 12.92f ) );
+    const __m128 low   = _mm_cmple_ps( v, _mm_set1_ps( SRGB_LINEAR_END ) );
+    return _mm_or_ps( _mm_and_ps( low, line ), _mm_andnot_ps( low, curve ) );
+}
+
+// Everything up to quantization: the value to truncate to the output byte
+__attribute__( ( target( "sse2" ) ) ) static inline __m128i
+sse2_value( const post_params * params, __m128 v, __m128 inv, __m128 dither )
+{
+    const __m128 one = _mm_set1_ps( 1.0f );
+    v                = _mm_mul_ps( _mm_mul_ps( v, inv ), _mm_set1_ps( params->exposure ) );
+    v                = _mm_min_ps( _mm_max_ps( v, _mm_setzero_ps() ), _mm_set1_ps( MAX_RADIANCE ) );
+
+    switch( params->tonemap )
+        {
+        case POSTPROCESS_TONEMAP_REINHARD: v = _mm_div_ps( v, _mm_add_ps( v, one ) ); break;
+        case POSTPROCESS_TONEMAP_ACES:
+            {
+                const __m128 x   = _mm_mul_ps( v, _mm_set1_ps( ACES_INPUT ) );
+                const __m128 num = _mm_mul_ps( x, _mm_add_ps( _mm_mul_ps( x, _mm_set1_ps( 2.51f ) ),
+                                                              _mm_set1_ps( 0.03f ) ) );
+                const __m128 den = _mm_add_ps( _mm_mul_ps( x, _mm_add_ps( _mm_mul_ps( x, _mm_set1_ps( 2.43f ) ),
+                                                                          _mm_set1_ps( 0.59f ) ) ),
+                                               _mm_set1_ps( 0.14f ) );
+                v                = _mm_div_ps( num, den );
+                break;
+            }
+        default: break;
+        }
+    v = _mm_min_ps( v, one );
+
+    v = _mm_add_ps( _mm_mul_ps( sse2_srgb( v ), _mm_set1_ps( 255.0f ) ), dither );
+    return _mm_cvttps_epi32( v );
+}
+
+// Spreads 1 / samples of 8 pixels over the 6 registers of their values, 3 lanes per pixel. The division is exact,
+// as block_inverse's.
+__attribute__( ( target( "sse2" ) ) ) static inline void
+sse2_inverse( const uint32_t * samples, __m128 inv[6] )
+{
+    for( int h = 0; h < 2; ++h )
+        {
+            const __m128 n = _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i *)( samples + 4 * h ) ) );
+            const __m128 r = _mm_and_ps( _mm_div_ps( _mm_set1_ps( 1.0f ), n ), _mm_cmpgt_ps( n, _mm_setzero_ps() ) );
+            inv[3 * h]     = _mm_shuffle_ps( r, r, _MM_SHUFFLE( 1, 0, 0, 0 ) );
+            inv[3 * h + 1] = _mm_shuffle_ps( r, r, _MM_SHUFFLE( 2, 2, 1, 1 ) );
+            inv[3 * h + 2] = _mm_shuffle_ps( r, r, _MM_SHUFFLE( 3, 3, 3, 2 ) );
+        }
+}
+
+__attribute__( ( target( "sse2" ) ) ) static inline void
+sse2_block( const post_params * params, const float * radiance, const __m128 inv[6], const float * dither,
+            unsigned char * out )
+{
+    __m128i q[6];
+    for( int r = 0; r < 6; ++r )
+        {
+            q[r] = sse2_value( params, _mm_loadu_ps( radiance + 4 * r ), inv[r], _mm_loadu_ps( dither + 4 * r ) );
+        }
+
+    // Saturating packs 32 -> 16 -> 8 bits keep the values in order
+    const __m128i w01 = _mm_packs_epi32( q[0], q[1] );
+    const __m128i w23 = _mm_packs_epi32( q[2], q[3] );
+    const __m128i w45 = _mm_packs_epi32( q[4], q[5] );
+    _mm_storeu_si128( (__m128i *)out, _mm_packus_epi16( w01, w23 ) );
+    _mm_storel_epi64( (__m128i *)( out + 16 ), _mm_packus_epi16( w45, w45 ) );
+}
+
+__attribute__( ( target( "sse2" ) ) ) static void
+row_sse2( const post_params * params, const float * radiance, const uint32_t * samples, const float * dither,
+          int width, unsigned char * out )
+{
+    __m128 inv[6];
+    for( int r = 0; r < 6; ++r )
+        {
+            inv[r] = _mm_set1_ps( 1.0f );
+        }
+
+    int x = 0;
+    for( ; x + BLOCK_PIXELS <= width; x += BLOCK_PIXELS )
+        {
+            if( samples ) sse2_inverse( samples + x, inv );
+            sse2_block( params, radiance + 3 * x, inv, dither, out + 3 * x );
+        }
+    if( x < width )
+        {
+            tail_block tail;
+            tail_load( &tail, radiance + 3 * x, samples ? samples + x : NULL, width - x );
+            for( int r = 0; r < 6; ++r )
+                {
+                    inv[r] = _mm_loadu_ps( tail.inv + 4 * r );
+                }
+            sse2_block( params, tail.radiance, inv, dither, tail.out );
+            memcpy( out + 3 * x, tail.out, (size_t)( width - x ) * 3 );
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// AVX2 kernel: the SSE2 arithmetic, step for step, eight lanes wide
+//----------------------------------------------------------------------------------------------------------------------
+__attribute__( ( target( "avx2" ) ) ) static inline __m256
+avx2_poly( const float * c, __m256 x )
+{
+    __m256 p = _mm256_set1_ps( c[5] );
+    for( int i = 4; i >= 0; --i )
+        {
+            p = _mm256_add_ps( _mm256_mul_ps( p, x ), _mm256_set1_ps( c[i] ) );
+        }
+    return p;
+}
+
+__attribute__( ( target( "avx2" ) ) ) static inline __m256
+avx2_srgb( __m256 v )
+{
+    const __m256i bits = _mm256_castps_si256( v );
+    const __m256  e    = _mm256_cvtepi32_ps(
+        _mm256_sub_epi32( _mm256_srli_epi32( bits, 23 ), _mm256_set1_epi32( 127 ) ) );
+    const __m256  m    = _mm256_castsi256_ps(
+        _mm256_or_si256( _mm256_and_si256( bits, _mm256_set1_epi32( 0x7fffff ) ), _mm256_set1_epi32( 0x3f800000 ) ) );
+    const __m256 t     = _mm256_sub_ps( m, _mm256_set1_ps( 1.0f ) );
+    const __m256 y     = _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( avx2_poly( log2_poly, t ), t ), e ),
+                                        _mm256_set1_ps( 1.0f / 2.4f ) );
+
+    __m256i i          = _mm256_cvttps_epi32( y );
+    i = _mm256_add_epi32( i, _mm256_castps_si256( _mm256_cmp_ps( _mm256_cvtepi32_ps( i ), y, _CMP_GT_OQ ) ) );
+    const __m256 f     = _mm256_sub_ps( y, _mm256_cvtepi32_ps( i ) );
+    const __m256 p     = _mm256_castsi256_ps(
+        _mm256_add_epi32( _mm256_castps_si256( avx2_poly( exp2_poly, f ) ), _mm256_slli_epi32( i, 23 ) ) );
+
+    const __m256 curve = _mm256_sub_ps( _mm256_mul_ps( p, _mm256_set1_ps( 1.055f ) ), _mm256_set1_ps( 0.055f ) );
+    const __m256 line  = _mm256_mul_ps( v, _mm256_set1_ps( 12.92f ) );
+    const __m256 low   = _mm256_cmp_ps( v, _mm256_set1_ps( SRGB_LINEAR_END ), _CMP_LE_OQ );
+    return _mm256_blendv_ps( curve, line, low );
+}
+
+__attribute__( ( target( "avx2" ) ) ) static inline __m256i
+avx2_value( const post_params * params, __m256 v, __m256 inv, __m256 dither )
+{
+    const __m256 one = _mm256_set1_ps( 1.0f );
+    v                = _mm256_mul_ps( _mm256_mul_ps( v, inv ), _mm256_set1_ps( params->exposure ) );
+    v                = _mm256_min_ps( _mm256_max_ps( v, _mm256_setzero_ps() ), _mm256_set1_ps( MAX_RADIANCE ) );
+
+    switch( params->tonemap )
+        {
+        case POSTPROCESS_TONEMAP_REINHARD: v = _mm256_div_ps( v, _mm256_add_ps( v, one ) ); break;
+        case POSTPROCESS_TONEMAP_ACES:
+            {
+                const __m256 x   = _mm256_mul_ps( v, _mm256_set1_ps( ACES_INPUT ) );
+                const __m256 num = _mm256_mul_ps( x, _mm256_add_ps( _mm256_mul_ps( x, _mm256_set1_ps( 2.51f ) ),
+                                                                    _mm256_set1_ps( 0.03f ) ) );
+                const __m256 den = _mm256_add_ps(
+                    _mm256_mul_ps( x, _mm256_add_ps( _mm256_mul_ps( x, _mm256_set1_ps( 2.43f ) ),
+                                                     _mm256_set1_ps( 0.59f ) ) ),
+                    _mm256_set1_ps( 0.14f ) );
+                v                = _mm256_div_ps( num, den );
+                break;
+            }
+        default: break;
+        }
+    v = _mm256_min_ps( v, one );
+
+    v = _mm256_add_ps( _mm256_mul_ps( avx2_srgb( v ), _mm256_set1_ps( 255.0f ) ), dither );
+    return _mm256_cvttps_epi32( v );
+}
+
+__attribute__( ( target( "avx2" ) ) ) static inline void
+avx2_inverse( const uint32_t * samples, __m256 inv[3] )
+{
+    const __m256 n = _mm256_cvtepi32_ps( _mm256_loadu_si256( (const __m256i *)samples ) );
+    const __m256 r = _mm256_and_ps( _mm256_div_ps( _mm256_set1_ps( 1.0f ), n ),
+                                    _mm256_cmp_ps( n, _mm256_setzero_ps(), _CMP_GT_OQ ) );
+    inv[0]         = _mm256_permutevar8x32_ps( r, _mm256_setr_epi32( 0, 0, 0, 1, 1, 1, 2, 2 ) );
+    inv[1]         = _mm256_permutevar8x32_ps( r, _mm256_setr_epi32( 2, 3, 3, 3, 4, 4, 4, 5 ) );
+    inv[2]         = _mm256_permutevar8x32_ps( r, _mm256_setr_epi32( 5, 5, 6, 6, 6, 7, 7, 7 ) );
+}
+
+__attribute__( ( target( "avx2" ) ) ) static inline void
+avx2_block( const post_params * params, const float * radiance, const __m256 inv[3], const float * dither,
+            unsigned char * out )
+{
+    __m256i q[3];
+    for( int r = 0; r < 3; ++r )
+        {
+            q[r] = avx2_value( params, _mm256_loadu_ps( radiance + 8 * r ), inv[r],
+                               _mm256_loadu_ps( dither + 8 * r ) );
+        }
+
+    // The packs work within 128-bit halves, leaving 4-byte groups in the order q0 q1 q2 q2 | q0 q1 q2 q2, by half
+    // of each register; the permute puts them back in image order
+    const __m256i w01   = _mm256_packs_epi32( q[0], q[1] );
+    const __m256i w22   = _mm256_packs_epi32( q[2], q[2] );
+    const __m256i bytes = _mm256_permutevar8x32_epi32( _mm256_packus_epi16( w01, w22 ),
+                                                       _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 ) );
+    _mm_storeu_si128( (__m128i *)out, _mm256_castsi256_si128( bytes ) );
+    _mm_storel_epi64( (__m128i *)( out + 16 ), _mm256_extracti128_si256( bytes, 1 ) );
+}
+
+__attribute__( ( target( "avx2" ) ) ) static void
+row_avx2( const post_params * params, const float * radiance, const uint32_t * samples, const float * dither,
+          int width, unsigned char * out )
+{
+    __m256 inv[3] = { _mm256_set1_ps( 1.0f ), _mm256_set1_ps( 1.0f ), _mm256_set1_ps( 1.0f ) };
+    int    x      = 0;
+    for( ; x + BLOCK_PIXELS <= width; x += BLOCK_PIXELS )
+        {
+            if( samples ) avx2_inverse( samples + x, inv );
+            avx2_block( params, radiance + 3 * x, inv, dither, out + 3 * x );
+        }
+    if( x < width )
+        {
+            tail_block tail;
+            tail_load( &tail, radiance + 3 * x, samples ? samples + x : NULL, width - x );
+            for( int r = 0; r < 3; ++r )
+                {
+                    inv[r] = _mm256_loadu_ps( tail.inv + 8 * r );
+                }
+            avx2_block( params, tail.radiance, inv, dither, tail.out );
+            memcpy( out + 3 * x, tail.out, (size_t)( width - x ) * 3 );
+        }
+}
+#endif // POSTPROCESS_X86
+
+static const row_fn kernels[POSTPROCESS_KERNEL_COUNT] = {
+    row_scalar,
+#if POSTPROCESS_X86
+    row_sse2,
+    row_avx2,
+#else
+    row_scalar,
+    row_scalar,
+#endif
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// Public interface
+//----------------------------------------------------------------------------------------------------------------------
+void
+postprocess_settings_init( postprocess_settings * settings )
+{
+    settings->exposure     = 0.0;
+    settings->tonemap      = POSTPROCESS_TONEMAP_CLAMP;
+    settings->dither       = true;
+    settings->kernel       = postprocess_best_kernel();
+    settings->thread_count = 0;
+}
+
+bool
+postprocess_kernel_supported( postprocess_kernel kernel )
+{
+    switch( kernel )
+        {
+        case POSTPROCESS_KERNEL_SCALAR: return true;
+#if POSTPROCESS_X86
+        case POSTPROCESS_KERNEL_SSE2: __builtin_cpu_init(); return __builtin_cpu_supports( "sse2" );
+        case POSTPROCESS_KERNEL_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports( "avx2" );
+#endif
+        default: return false;
+        }
+}
+
+postprocess_kernel
+postprocess_best_kernel( void )
+{
+    if( postprocess_kernel_supported( POSTPROCESS_KERNEL_AVX2 ) ) return POSTPROCESS_KERNEL_AVX2;
+    if( postprocess_kernel_supported( POSTPROCESS_KERNEL_SSE2 ) ) return POSTPROCESS_KERNEL_SSE2;
+    return POSTPROCESS_KERNEL_SCALAR;
+}
+
+const char *
+postprocess_kernel_name( postprocess_kernel kernel )
+{
+    switch( kernel )
+        {
+        case POSTPROCESS_KERNEL_SCALAR: return "scalar";
+        case POSTPROCESS_KERNEL_SSE2: return "sse2";
+        case POSTPROCESS_KERNEL_AVX2: return "avx2";
+        default: return "unknown";
+        }
+}
+
+const char *
+postprocess_tonemap_name( postprocess_tonemap tonemap )
+{
+    switch( tonemap )
+        {
+        case POSTPROCESS_TONEMAP_CLAMP: return "clamp";
+        case POSTPROCESS_TONEMAP_REINHARD: return "reinhard";
+        case POSTPROCESS_TONEMAP_ACES: return "aces";
+        default: return "unknown";
+        }
+}
+
+// Shared, read-only state of a single postprocess_image call
+typedef struct
+{
+    post_params      params;
+    row_fn           row;
+    const float *    radiance;
+    const uint32_t * samples;
+    unsigned char *  image_data;
+    int              width;
+    int              first_row;
+    int              row_count;
+    float            dither[8][BLOCK_VALUES]; // Thresholds of every Bayer row, for the 3 channels of 8 pixels
+} post_job;
+
+// Converts one band of BAND_ROWS rows
+static void
+post_band( void * user, int band, int thread_index )
+{
+    const post_job * job   = (const post_job *)user;
+    const int        first = band * BAND_ROWS;
+    const int        end   = RT_MIN( first + BAND_ROWS, job->row_count );
+    RT_UNUSED( thread_index );
+
+    for( int r = first; r < end; ++r )
+        {
+            const size_t offset = (size_t)r * job->width;
+            job->row( &job->params, job->radiance + 3 * offset, job->samples ? job->samples + offset : NULL,
+                      job->dither[( job->first_row + r ) & 7], job->width, job->image_data + 3 * offset );
+        }
+}
+
+void
+postprocess_image( const postprocess_settings * settings, const float * radiance, const uint32_t * samples,
+                   int width, int first_row, int end_row, unsigned char * image_data )
+{
+    postprocess_settings defaults;
+    if( NULL == settings )
+        {
+            postprocess_settings_init( &defaults );
+            settings = &defaults;
+        }
+    if( width <= 0 || end_row <= first_row ) return;
+
+    post_job job;
+    job.params.exposure = (float)exp2( settings->exposure );
+    job.params.tonemap  = settings->tonemap;
+    job.row             = postprocess_kernel_supported( settings->kernel ) ? kernels[settings->kernel] : row_scalar;
+    job.radiance        = radiance;
+    job.samples         = samples;
+    job.image_data      = image_data;
+    job.width           = width;
+    job.first_row       = first_row;
+    job.row_count       = end_row - first_row;
+
+    // Truncating v + t with t the threshold of a level in (0, 1) dithers; t = 0.5 rounds
+    for( int y = 0; y < 8; ++y )
+        {
+            for( int k = 0; k < BLOCK_VALUES; ++k )
+                {
+                    job.dither[y][k] = settings->dither ? ( bayer[y][k / 3] + 0.5f ) / 64.0f : 0.5f;
+                }
+        }
+
+    const int bands = ( job.row_count + BAND_ROWS - 1 ) / BAND_ROWS;
+    if( !tile_scheduler_run( settings->thread_count, bands, post_band, NULL, &job ) )
+        {
+            fprintf( stderr, "WARN: Failed to start the post-process workers, converting on one thread.\n" );
+            for( int b = 0; b < bands; ++b )
+                {
+                    post_band( &job, b, 0 );
+                }
+        }
+}
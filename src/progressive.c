@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+#include "progressive.h"
+#include "rtweekend.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h> /* malloc, free */
+#include <time.h>   /* clock_gettime */
+
+// Hands resolved images from the render thread to the snapshot thread.
+// Three buffers rotate: the render thread resolves into `staging`, publishes it by swapping it with `pending`, and
+// the snapshot thread swaps `pending` with `writing` before calling the callback without holding the lock.
+typedef struct
+{
+    const progressive_settings * settings;
+    int                          width;
+    int                          height;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    unsigned char * staging;
+    unsigned char * pending;
+    unsigned char * writing;
+    int             pending_pass; // Pass of the image in `pending`
+    bool            has_pending;  // True while `pending` holds an image not yet written
+    bool            quit;         // Set once the render is over; the thread drains `pending` and exits
+} snapshot_writer;
+
+static double
+now_seconds( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void
+snapshot_write( const snapshot_writer * writer, const unsigned char * image_data, int pass )
+{
+    const progressive_settings * settings = writer->settings;
+    if( !settings->snapshot( settings->user, image_data, writer->width, writer->height, pass ) )
+        {
+            fprintf( stderr, "\nWARN: Failed to write the snapshot of pass %d.\n", pass );
+        }
+}
+
+static void *
+snapshot_thread_main( void * arg )
+{
+    snapshot_writer * writer = (snapshot_writer *)arg;
+
+    pthread_mutex_lock( &writer->lock );
+    for( ;; )
+        {
+            while( !writer->has_pending && !writer->quit )
+                {
+                    pthread_cond_wait( &writer->wake, &writer->lock );
+                }
+            if( !writer->has_pending ) break; // Quit with nothing left to write
+
+            unsigned char * swap = writer->writing;
+            writer->writing      = writer->pending;
+            writer->pending      = swap;
+            writer->has_pending  = false;
+            const int pass       = writer->pending_pass;
+
+            pthread_mutex_unlock( &writer->lock );
+            snapshot_write( writer, writer->writing, pass );
+            pthread_mutex_lock( &writer->lock );
+        }
+    pthread_mutex_unlock( &writer->lock );
+    return NULL;
+}
+
+static void
+progressive_save( const progressive_settings * settings, const film * f )
+{
+    if( !settings->checkpoint( settings->user, f ) )
+        {
+            fprintf( stderr, "\nWARN: Failed to save the render checkpoint.\n" );
+        }
+}
+
+// Publishes the image in `staging` as the newest snapshot, replacing one that was not written yet
+static void
+snapshot_post( snapshot_writer * writer, int pass )
+{
+    pthread_mutex_lock( &writer->lock );
+    unsigned char * swap = writer->pending;
+    writer->pending      = writer->staging;
+    writer->staging      = swap;
+    writer->pending_pass = pass;
+    writer->has_pending  = true;
+    pthread_cond_signal( &writer->wake );
+    pthread_mutex_unlock( &writer->lock );
+}
+
+bool
+progressive_render( const camera * cam, const hittable * world, film * f, const progressive_settings * settings,
+                    progressive_result * result )
+{
+    if( !cam || !world || !f || !settings || settings->pass_samples <= 0 ) return false;
+
+    const double start    = now_seconds();
+    const size_t size     = (size_t)f->width * f->height * RT_IMAGE_DATA_CHANNELS;
+    const bool   snapshot = ( NULL != settings->snapshot )
+                         && ( settings->snapshot_passes > 0 || settings->snapshot_seconds > 0.0 );
+
+    snapshot_writer writer = { 0 };
+    writer.settings        = settings;
+    writer.width           = f->width;
+    writer.height          = f->height;
+
+    // Without a snapshot thread, snapshots are written from the render thread
+    pthread_t thread;
+    bool      threaded = false;
+    if( snapshot )
+        {
+            writer.staging = (unsigned char *)malloc( size );
+            writer.pending = (unsigned char *)malloc( size );
+            writer.writing = (unsigned char *)malloc( size );
+            if( NULL == writer.staging || NULL == writer.pending || NULL == writer.writing )
+                {
+                    fprintf( stderr, "ERROR: Failed to allocate memory for the render snapshots.\n" );
+                    free( writer.staging );
+                    free( writer.pending );
+                    free( writer.writing );
+                    return false;
+                }
+
+            pthread_mutex_init( &writer.lock, NULL );
+            pthread_cond_init( &writer.wake, NULL );
+            threaded = ( 0 == pthread_create( &thread, NULL, snapshot_thread_main, &writer ) );
+            if( !threaded )
+                {
+                    fprintf( stderr, "WARN: Failed to spawn the snapshot thread, writing snapshots inline.\n" );
+                }
+        }
+
+    progressive_result stats           = { 0 };
+    double             last            = start; // Time of the last snapshot
+    double             last_checkpoint = start; // Time of the last checkpoint
+    double             previous        = 0.0;   // Duration of the last pass
+    for( ;; )
+        {
+            const double pass_start = now_seconds();
+            if( settings->time_budget > 0.0 && stats.passes > 0
+                && pass_start + previous - start > settings->time_budget )
+                {
+                    break; // The next pass would overrun the budget
+                }
+
+            const uint64_t taken = camera_render_pass( cam, (const struct hittable *)world, f,
+                                                       settings->pass_samples );
+            if( 0 == taken )
+                {
+                    stats.complete = true;
+                    break;
+                }
+
+            const double pass_end  = now_seconds();
+            previous               = pass_end - pass_start;
+            stats.passes          += 1;
+            stats.samples         += taken;
+            fprintf( stderr, "\rPass %d: %.1f samples/pixel, %.1f s ", stats.passes,
+                     (double)film_sample_count( f ) / ( (double)f->width * f->height ), pass_end - start );
+            fflush( stderr );
+
+            const bool due = ( settings->snapshot_passes > 0 && 0 == stats.passes % settings->snapshot_passes )
+                          || ( settings->snapshot_seconds > 0.0 && pass_end - last >= settings->snapshot_seconds );
+            if( snapshot && due )
+                {
+                    film_resolve( f, settings->post, writer.staging );
+                    if( threaded )
+                        {
+                            snapshot_post( &writer, stats.passes );
+                        }
+                    else
+                        {
+                            snapshot_write( &writer, writer.staging, stats.passes );
+                        }
+                    last = pass_end;
+                }
+
+            if( settings->checkpoint && settings->checkpoint_seconds > 0.0
+                && pass_end - last_checkpoint >= settings->checkpoint_seconds )
+                {
+                    progressive_save( settings, f );
+                    last_checkpoint = now_seconds();
+                }
+        }
+
+    // Keep what an unfinished render got so far
+    if( !stats.complete && settings->checkpoint ) progressive_save( settings, f );
+
+    if( snapshot )
+        {
+            if( threaded )
+                {
+                    pthread_mutex_lock( &writer.lock );
+                    writer.quit = true;
+                    pthread_cond_signal( &writer.wake );
+                    pthread_mutex_unlock( &writer.lock );
+                    pthread_join( thread, NULL );
+                }
+            pthread_cond_destroy( &writer.wake );
+            pthread_mutex_destroy( &writer.lock );
+            free( writer.staging );
+            free( writer.pending );
+            free( writer.writing );
+        }
+
+    stats.seconds = now_seconds() - start;
+    fprintf( stderr, "\r%s after %d passes, %.1f s.                              \n",
+             stats.complete ? "Done" : "Time budget reached", stats.passes, stats.seconds );
+
+    if( result ) *result = stats;
+    return true;
+}
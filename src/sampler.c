@@ -0,0 +1,465 @@
+#include "sampler.h"
+#include <string.h> /* strcmp */
+
+// Sobol generator matrices of the first four dimensions, one column per bit of the index (Joe and Kuo 2008)
+static const uint32_t sobol_directions[SAMPLER_BOUNCE_DIMENSIONS][32] = {
+    {
+        0x80000000, 0x40000000, 0x20000000, 0x10000000, 0x08000000, 0x04000000, 0x02000000, 0x01000000,
+        0x00800000, 0x00400000, 0x00200000, 0x00100000, 0x00080000, 0x00040000, 0x00020000, 0x00010000,
+        0x00008000, 0x00004000, 0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100,
+        0x00000080, 0x00000040, 0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001,
+    },
+    {
+        0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+        0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+        0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+        0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff,
+    },
+    {
+        0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000,
+        0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+        0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500,
+        0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555,
+    },
+    {
+        0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000,
+        0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+        0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00,
+        0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093,
+    },
+};
+
+// Ranks 0-4095 of a 64x64 void-and-cluster blue-noise mask (Ulichney 1993, Gaussian sigma 1.5), row by row: the
+// pixels below any rank are spread evenly, without clumps, so neighbouring pixels get dissimilar shifts
+static const uint16_t blue_noise_mask[SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE] = {
+    1250, 2060,  343, 3903, 1083,  504, 1406, 3779,  205, 1308, 2533,   76, 3751, 3075,  850, 2109,
+     125, 3318,  806,  354, 3089, 1577, 3448, 2235, 2959, 1984, 3708,  612, 1825, 2945,  766, 1671,
+     217, 1139, 2451, 2012,  877, 3297, 1287,   30, 2042, 2987, 2266, 1717,  369, 2812, 1502, 2124,
+    3905,  309, 2666, 2039, 2389, 1772,  691, 1475, 1125, 3557,  726, 1429, 3115, 2071, 2907,  157,
+    3605,  834, 3263, 2375, 1855, 3608, 2985,  762, 2797, 1690, 3248, 2052, 1254, 2398, 1830, 3965,
+    2795, 1166, 2431, 4027, 1057,  563, 3792, 1216,  438, 1541,  978, 3459, 2280,  387, 3215, 1988,
+    4047,  618, 3395, 1413,  471, 3664, 2723,  646, 3247, 1027,  441, 3439, 2452, 1135, 3330,   41,
+     937, 1736, 3118,  448, 1022, 3264, 2697, 2180,  434, 1699, 3295, 2645, 1092,  375, 1536, 2330,
+    3070, 2615, 1618,  665, 2739,  116, 2116, 1185, 3422,  411,  856, 3921,  593, 3438,  347, 1514,
+     659, 3477, 2175, 1479, 2807, 2083, 2593, 1729, 3299, 2475, 3122,   63, 2728, 1509, 3596, 1239,
+    2258, 2980, 1698, 3880, 2512, 1089, 1927, 1520, 2434, 3835, 2740, 1363, 3618,  780, 3773, 2366,
+    2934, 3512, 1233, 4092, 1588, 3610,  104, 3152, 4004, 2345,  243, 3732, 2233, 3256, 3990,  583,
+    1785,   83, 4079, 1311, 3416, 1564, 3939, 2477, 1887, 3633, 2264, 2717, 1743, 2868, 1006, 2565,
+    3727, 1728,  457, 3176,  133, 3614,  857,  247, 4071,  682, 2139, 1264, 3944,  895, 2501,  131,
+    2765,  927,  296, 2115, 3105,  150, 4070, 3384,  229, 1805,  738, 2111,  152, 1933, 1585,  502,
+    1388, 2164,  221, 2498, 2899,  830, 1336, 1903,  970, 2863, 1307,  607, 1758,  883, 2537, 1181,
+    3495, 1003, 2108, 2936,  534,  938, 3126,  256,  680, 2922, 1070, 1457,  185, 3853, 3306, 2251,
+      35, 3044,  939, 3876, 1935, 1189, 3385, 2269, 2819, 1103, 3654, 1681, 3033, 2051,  494, 3851,
+    1552, 3243, 3571, 1209,  736, 2814, 2241,  920, 2902, 1257, 3223, 4020, 2994, 2500, 3150, 3968,
+    2783,  717, 3757, 1915,  561, 2256, 3830, 2602,  633, 3505, 2066, 3868, 2805,  198, 3363, 2049,
+    2674, 3749,  294, 2446, 3841, 1992, 2669, 1149, 1602, 4043,  400, 3131, 2047,  774, 1373, 1908,
+    1155, 2751, 2079, 1385, 2519,  554, 2952, 1438, 1856,  478, 2639,  291,  729, 3521, 2817, 1067,
+    1958,  590, 2607, 1795, 3817, 1370, 1693,  481, 3767, 2354,  312, 1648,  604, 1228,  942,  187,
+    1754, 3382,  990, 3159, 1491, 3320,  290, 1675, 3091,   15, 1565, 2460, 1121, 3638, 1423,  419,
+     652, 1574, 3240, 1203, 1703,  348, 3321, 3720, 2338, 1965, 3351, 2427, 3556, 2636,  498, 3174,
+    4060,  648, 3458,  206, 3211, 1696, 3938,    8, 3736, 3151, 2022, 3345, 2380, 1366, 1727, 3305,
+    2361, 3690,   69, 2174, 3201,  300, 3603, 2675, 1964, 3450,  988, 2158, 2692, 3682, 3273, 2005,
+    2633, 1305, 2381,   67, 2690, 3706, 1225, 2112, 3948, 1044, 3347,  466, 3026, 1852, 2319, 3116,
+    1157, 2247, 2834,  757, 3461, 2223, 1418,    1, 2786,  820, 1294,  110,  981, 1619, 3657,  241,
+    2483, 1584, 2302, 3784,  775, 2644, 1002, 2212, 1268,  783, 1460, 3799, 1026,   82, 3992,  368,
+     808, 1338, 2856, 1062,  644, 2467, 3064, 1132,  684, 1481, 2929, 3840,  101, 1458, 2255,  379,
+    3531,  552, 3883, 1802, 1068,  517, 2949,  758, 2404, 2784, 1911,  816, 4040,  118,  865, 3819,
+    3379,   53, 1957, 3689,  463, 2591,  991, 3097,  577, 3812, 1791, 2997, 3978, 2199, 2886, 1453,
+     869, 3101,  367, 1193, 1997, 3572,  355, 2854, 3508, 2561,  233, 2911, 1834, 2573, 2972, 2073,
+    3158, 3842, 1715, 3407, 4014, 1524, 1891,   27, 3961, 2516,  370, 3304, 1842,  740, 2836, 3933,
+     900, 1559, 2852, 2146, 3579, 2504, 1533, 3759,  213, 1331, 3586, 2271, 1547, 2614, 2918, 1680,
+    2443, 4028,  968, 1500, 3009, 3942, 1866, 3547, 1537, 2282, 3431,  435, 1946,  610, 1141, 3377,
+    2034, 3913, 1814, 2932, 2396, 1444, 3160, 1893,  530, 1706, 4044, 2185,  598, 3707,  901, 1501,
+    2465,  186, 2662,  468, 2289,  887, 3564, 2190, 3161, 1748,  909, 1272, 2437, 3479, 1142, 1720,
+    2518, 3138,  263,  807, 3229,  301, 2024, 3364, 1771,  600, 3053,  284, 3283, 1255, 2055,  336,
+    1417,  597, 2738, 2285,  183, 1177,  694, 2118,  203, 2630,  860, 1442, 2811, 2371, 3709,   70,
+    2661,  544, 1019, 3721,   89,  699, 3972, 1066, 2314, 3222,  870, 1244, 3374, 1594,  408, 3491,
+    1164,  718, 2011, 1427, 3016,  227, 2735, 1322,  485, 3750, 2804, 2046, 4074,  410, 3015,    0,
+    1990, 3464, 1353, 4023, 1692, 1176, 3061,  963, 2726, 3969, 2044, 1091, 3643,  516, 3879, 3041,
+    3558, 1916, 3170, 3641, 1737, 2517, 3302, 2859, 4082, 1198, 3186, 3846,  254,  933, 3049, 1622,
+    2262, 3523, 1421, 3208, 2582, 1663, 2750,  167, 3730, 1506, 2649,  193, 2999, 2268, 2724, 1913,
+    4083, 2877, 3619, 3280, 1174, 3860, 1653, 3449,  855, 2308,  156, 3130,  661, 1528, 2209, 3822,
+     624, 1010, 2327, 2704,  572, 2252, 3887,   52, 1468, 2291,  767, 2882, 1816, 2367,  750, 1033,
+    2522,  160, 1234,  843,  490, 3838, 1411,  352, 1768,  654, 2037, 2462, 3469, 1837, 3956, 1263,
+     760, 2776,  275, 1952,  835, 3468, 2103, 1326, 2950,  376, 3520, 2002, 3927, 1023,  124, 3236,
+     508, 1661,  908, 2426,  397, 2133,  666, 2450, 3047, 1240, 1670, 3652, 1018, 2492, 3250, 1207,
+    2763, 3716,  145, 1838, 3632, 2869,  776, 2559, 3507,  418, 3722, 1522,   74, 2761, 3441, 1646,
+    2908, 3964, 2218, 3444, 1895, 2745,  985, 2414, 3658, 2971,   75, 1551, 1081,  548, 2544,  392,
+    3286, 1702, 4078, 2341, 1230, 3844,  574, 3308, 1846,  765, 2372, 1642,  559, 1420, 3621, 2448,
+    1261, 2194,   40, 3934, 1867, 2792, 3735,   90, 1926, 3924,  391, 2626, 1875, 3522,  209, 1695,
+    2135, 3102, 1454, 3426,  329, 1280, 1650, 2065, 3191, 1297, 2473, 3073, 4069, 1194, 2130,  322,
+    1351,  584, 1608, 2938,   46, 3252, 2050,  737, 3409, 1387, 2713, 3781, 2183, 3200, 2895, 2014,
+    3650,  972, 3068,  514, 2841,  228, 2470,  961, 4021, 2729, 1180, 3756, 3212, 2781, 1780,  746,
+    3037, 3437, 2658, 1126, 3153,  844, 1364, 3276, 1011, 2825, 3394, 1330,  521, 2927,  851, 3877,
+     437,  800, 2489, 1078, 2140, 3287, 3793,  524, 1040, 1839,  246,  919, 2009,  476, 3227, 3653,
+    2350,  955, 2592, 3678, 1095, 1535, 3908,  216, 2213, 1025,  416, 3329,  756, 1672,  271, 1397,
+    2422,   17, 2122, 1486, 3419, 1869, 3088, 1631, 2198,  440, 2975,   21,  888, 2201,  280, 3831,
+    1993,  421, 3697, 1560,  545, 3550, 1766, 2594,  299, 2157,  735, 2388, 4003, 2085, 1495, 2640,
+    3331, 1925, 4056, 2947,  723, 2601,  148, 2969, 4005, 2733, 3291, 3563, 1582, 2621,  809, 1763,
+    3802, 3358,  357, 2088,  656, 2442, 2885, 1725, 3107, 3976, 1947, 2497, 1278, 4035, 3418,  789,
+    3861, 1171, 3553, 2603,  853, 3780, 1274,  107, 3660, 1470, 3490, 1901, 2510, 4036, 1159, 2879,
+    1430,  867, 1844, 2386, 3005,  235, 2243, 3963, 1472, 3698, 1777, 3255,   79, 1058, 3590, 2312,
+    1292,   54, 1596,  473, 3672, 1851, 1463, 2335,  769, 2145, 1357,  639, 2274, 3902, 3100,   92,
+    1940, 1220, 2993, 4063, 1350, 3350,  461,  882, 2531, 1448,  667, 3032,  188, 2276, 2677, 1879,
+    3128, 2772,  643, 1779,  338, 2089, 2754,  722, 3221, 2608,  568, 1306, 3066, 1590,  628, 3552,
+    2579, 3172,  136, 4050, 1259, 2760, 1047,  640, 2924,  455, 1146, 2770, 1566, 2998,  388,  658,
+    3084, 3555, 2722, 2273, 1231, 3096,  967, 3600, 1724,   44, 3760, 2939,  288, 1076, 1435, 2847,
+    2553,  744, 1683,  134, 2718, 1832, 3810, 1247, 3645,   25, 3516, 1716, 3688, 1093,  484, 1554,
+     172, 2228, 1386, 3713, 3155, 1098, 3987, 2378, 1747, 1012, 2163, 3734,  310, 3430, 2080,  218,
+    2281, 1096, 3396, 2113,  701, 3667, 1942, 3354, 2402, 3483, 2059,  829, 3725, 2211, 1828, 3970,
+    1109, 2028,  899, 3258,  180, 3856, 2466,  366, 3417, 2641, 1153, 1629, 2524, 3415, 2160,  417,
+    3925, 3278, 2283, 3581,  989, 2162,  260, 3154, 1986, 2779, 2224,  863, 2831, 2056, 3816, 3378,
+     995, 3996,  428, 2837, 2322,  171, 3393, 1375,  334, 3890, 2846,  836, 2424, 1029, 2793, 1765,
+    3717,  527, 1676, 2647, 1510, 3148,   12, 1281, 1641,  199, 4089, 2478,  305, 3425, 1383, 2810,
+    2464,  351, 3915, 1513, 1905,  627, 2833, 1379, 1974,  566, 3232, 3962, 1871,  581, 3691,  969,
+    1833,  257, 1466, 2880,  546, 3388, 2417, 1525,  599, 1077, 3392,  356, 1404, 3144,  733, 2471,
+    2943, 1983, 3455,  796, 1576, 1939,  626, 2988, 2013, 3352,   84, 1880, 3275, 1488, 3966,  795,
+    1339, 2842, 3870,  957,  407, 2298, 3954, 2700,  889, 2977, 1750, 1304,  672, 3125,  916,  182,
+    1571, 2984,  720, 2588, 3503, 2181,  914, 4090, 3029, 1008, 2202,  196,  876, 2799, 1553, 3112,
+    2480,  663, 3728, 1151, 1732, 3854,  828, 2937, 4039, 2581, 1605, 3738, 2521,   85, 1803, 1269,
+     306, 1623, 2526, 1236, 3862, 2657, 3635,  874, 2556, 1148, 1595, 3824,  586, 3018,  142, 2542,
+    3234, 2093,   95, 3056, 3559, 1752,  578, 2045, 3683,  443, 3298, 2664, 3794, 1861, 2365, 3855,
+    3370, 1870, 3703, 1286,  396, 3183, 1685,   99, 2324, 3646, 1516, 3093, 3569, 2297,   22, 1205,
+    3485, 2062, 3137, 2362,   60, 2673, 1221, 1849,  146, 3271,  522, 1920, 1007, 3341, 4081, 2177,
+    3625,  657, 3003,   51, 3175,  462, 1464, 2290, 4009,  445, 2762, 2360, 1285, 2222, 1900, 3562,
+     446, 1113, 1823, 2461, 1325, 2813, 1110, 3189, 1484, 2325, 1039, 2106,   61, 2862, 1232,  512,
+    2170,  992,   14, 2321, 2867, 1055, 3719, 2688,  748, 1807,  426, 2622, 1100, 1937, 4053, 2900,
+    1609,  297,  947, 4015, 1975, 3184,  432, 3673, 2127, 1320, 2385, 3894, 2948, 1555,  477, 2568,
+    3205, 1150, 3941, 1745, 2182, 1042, 3489,  132, 1721, 3062,  747, 3443,  332, 3755,  697, 1465,
+    2292, 4022, 3314,  690, 3806,  249, 3436, 2438,  119, 3899,  605, 3460, 1632,  802, 3548, 3090,
+    1422, 2743, 3209, 1601, 3979, 1936,  474, 1449, 3309, 2897, 3940, 1342,  601, 3195,  383,  845,
+    3833, 2650, 1424, 2850,  688, 1359, 3429, 2491,  650, 3087,  913,  215, 2153,  721, 2840, 1021,
+     267, 1967, 2416,  824, 3700, 2921, 1896, 3290, 1275, 3681, 2021, 1512, 2912, 1124, 3210, 2698,
+     905, 2893,  314, 1474, 2217,  950, 1953,  739, 2788, 1813, 3011, 1335, 4029, 2484, 2030,  168,
+    3912,  592, 3591,  858,  268, 2253, 3493, 2468, 1190,  321, 1968, 2339, 3752, 1704, 2590, 2236,
+     551, 3344, 1804,  214, 3606, 2225, 1686, 1037, 3981, 1592, 2714, 3510, 1340, 3675, 1776, 3839,
+    1496, 3474, 2851,  223, 1531,  562, 2523,  313, 2244,  949, 2625,    5, 4054, 2445, 1678,  114,
+    3661, 2033, 1701, 2654, 3498, 3031, 4038, 1446, 3655, 1129, 2226,  236, 3192,  486, 1104, 2676,
+    1734, 2377, 1966, 2604, 1392, 3111,  711, 1774, 3827,  912, 3424,  177, 2809, 1017, 3551, 1290,
+    3040, 1045, 3763, 2508,  871, 3021,  372, 2803,   94, 3356, 1882,  395, 2499, 3067,   11, 2246,
+    2638,  589, 1248, 3167, 2267, 4062, 1179, 2829, 3789,  489, 3496, 1820,  987,  505, 2136, 3423,
+    1299,  547, 3914, 1147,   33, 1735,  492, 2549,  283, 3372,  790, 2613, 1862, 1469, 3753, 3019,
+     839, 1242,  378, 3366, 3739, 1123, 2796,   64, 2624, 2143, 3083, 1612,  728, 3254,   88, 1963,
+    2413,  319, 2117, 3193, 1256, 3864, 1951, 3502, 1396, 2277, 1118, 3865,  838, 2020, 1162, 3279,
+     873, 3957, 1914, 3644,  923, 1801, 3123,  695, 1666, 1356, 3098, 2304, 3362, 2777, 3893,  825,
+    2966, 2415, 3235,  754, 2920, 2369, 1252, 3134, 2094, 1656, 2931, 3857,  977, 3404, 2070,  325,
+    3319, 4010, 2858, 1691,  173, 2078, 4048, 1526, 3525,  579, 1301, 3985, 2520, 2179, 1523, 3931,
+    2889, 1677,  670, 1519,   24, 2412,  591, 2558,  798, 2926,  519, 3177, 1567, 3484,  538, 2785,
+    1689,  164, 2514,  480, 2721,   42, 3583, 2092, 2432, 3952,  212,  713, 1543, 1163,  232, 1943,
+    1575,  170, 2128, 3545, 1886, 3702,  932, 3874,  709, 3560,  429, 2357,   43, 2806,  727, 2447,
+    1568, 2154,  634, 2481,  954, 2996,  506, 2379, 1056, 2935, 1888,  385, 1114, 3699,  500,  833,
+    1235, 3312, 4087, 2832, 3593, 1712, 1101, 3932, 1640, 3626, 2064, 2660,  197, 2309, 3892, 1293,
+    3402, 2188, 3517, 1316, 1597, 3265, 1085,  362, 2986,  880, 2719, 2063, 3821, 3028, 2496, 3268,
+    3740, 2687, 1074, 1461,  315, 2791, 1578,  106, 2702, 1362, 1043, 2001, 1573, 3997, 1300, 3684,
+     127, 1063, 3149, 3845, 1490, 3640, 1819, 3300,  281, 3770, 2334, 3447, 2790, 1731, 2610, 3478,
+    2284,  151, 2555,  943, 2178, 3368, 2991,  337, 3220,  147, 1277, 4066, 1048, 1761, 2567,  272,
+    3042, 1001,  681, 2925, 3804, 1999, 2569, 1451, 3663, 1840, 1295, 3433,  298, 1784,  637, 1344,
+     921,  482, 3012, 4093,  635, 2261, 3371, 1924, 2394, 3277, 3790, 3054, 2536,  472, 3198, 1793,
+    2659, 3540, 1876,  269, 2257,  696, 2727, 1321, 2058,  764, 1508,    3,  917, 3194,  264, 1944,
+    3623,  609, 1857, 1382,  248,  745, 2003, 1412, 2305, 2757, 1873,  632, 3025, 3694,  819, 2097,
+    1517, 4034, 1829, 2355,  340,  813, 3980,  575, 3336,  103, 2326, 2942,  980, 3536, 2219, 3988,
+    1970, 3427, 1687, 2503, 3178, 1279,  868, 3935,  525, 1726,  219,  752, 3532, 1137, 2216,  818,
+    3030,  523, 1314, 2606, 3442, 1173,   87, 3570, 3106, 2554, 4032, 2888, 2095, 1381, 3949, 1054,
+    1538, 2685, 3199, 3666, 2374, 3974, 2684,  513, 3803,  831, 3533, 2254, 1483,  430, 2848, 3575,
+     542, 2585,   81, 3369, 1204, 3077, 2279, 1654, 2774, 1138, 4073,  541, 1476, 2557,  403, 2821,
+     245, 2347, 1161,   55, 1982, 3747,  255, 3002, 1213, 2835, 2275, 1498, 1934, 2827,  194, 3895,
+    1447, 2104, 4088,  791, 3058, 1987, 3945, 1667,  423, 1015, 1815,  615, 3576, 2457,  702, 2995,
+    2193, 3896, 1130,  442, 2941, 1607, 1090, 3457, 1787, 1187, 3092,   32, 3367, 2439, 1270, 1858,
+    3288, 1064, 3774, 1556, 2706, 1859,  162, 3188,  773, 2125, 2627, 1718, 3676, 3162, 1116, 1587,
+    3085, 3872,  719, 3573, 2857, 1544, 2469, 2084, 3526,  910, 4061, 3182,  393, 3659, 1688, 3310,
+    2390,   28, 2916, 1679,  414, 2440,  941, 2919, 2300, 3391, 1329, 3072,  220, 1652, 3389,  377,
+     918,  105, 1744, 2129,  803, 3285,   96, 2455, 2905,  311, 1589, 3823, 1919,  996, 3960,  141,
+    2331, 2953, 2025,  664, 3539,  966, 3710, 1345, 3837,  390, 3390,  906,   37, 1904, 3795,  784,
+    2132, 1390, 2596, 1817,  975,  424, 3311,  679, 1773,   16, 1360, 2667, 1053, 2320,  708, 1211,
+    2712,  962, 3743, 1199, 3611, 3284, 1492,  585, 3836,  149, 2642, 2151, 3801, 1115, 2017, 2800,
+    3165, 2423, 3452, 2823, 1347, 3742, 1932,  669, 4018, 2149, 2600,  801, 2769,  373, 3006, 1664,
+     759, 1419,  274, 3168, 2295,  444, 2061, 2505, 2970, 1201, 1971, 2828, 2296,  595, 2506, 3349,
+     126, 3636,  503, 3373, 2265, 4011, 1337, 2778, 3847, 2486, 3334,  625, 1973, 3867, 3110,  364,
+    3472, 1843,  560, 2286, 1892,  374, 2701, 2110, 1215, 1931, 3620,  928,  483, 2574, 4026, 1361,
+    3662, 1546,  620, 3947,  286, 2270, 3057, 1431, 1013, 3492,  475, 1309, 3303, 2102, 3604, 2513,
+    3405, 3878, 2747, 1168, 4046, 1504, 3398,  623, 1694,  184, 3602, 1445, 3917, 3034, 1245, 1730,
+    2798, 1075, 3043, 1450,  161, 2978, 2004, 1084,  335, 2119, 1581, 3580,  224, 2913, 1352, 2068,
+    3998, 1437, 3218, 2775,  109, 3982,  890, 3528, 3132,  698, 1570, 2875, 3301, 1783,  749,  225,
+    1954, 1038, 2587, 1864, 1184, 2710,  406, 3333, 2428, 1746, 2965, 3897, 1620,  602, 1223,  250,
+     976, 2172,  499, 1794, 2543,   31, 2820, 1031, 3989, 2155, 3133,  712, 1094,  266, 2082, 4052,
+     380, 2384, 1874, 3888,  891, 2535,  533, 3462, 3079,  864, 2699, 1182, 2401, 1741,  907, 2618,
+     163, 2410,  861, 3567, 1328, 3063, 1665, 2337,  253, 4068, 2459,   39, 1400, 3541, 2359, 2855,
+     526, 3365,   58, 3624, 3187,  929, 1682, 3771,   66,  847, 2040,  210, 2370, 2731, 4095, 1972,
+    3213, 1586, 3737, 3055,  778, 3613, 1950, 3269, 2408,  454, 2612, 1824, 3524, 2695, 3400,  885,
+    1493, 3704,  641, 2142, 3262, 1625, 3745, 1872, 1369, 3687,  135, 4016, 3239,  433, 3786, 3315,
+     676, 3013, 1707,  425, 2069, 2545,  511, 1266, 2789,  998, 1868, 3094, 2230,  384, 1222, 3776,
+    2161, 2766, 1313, 2204,  675, 4072, 2029, 1206, 2802, 3634, 3171, 1117, 3530,  814, 1459, 2930,
+     571, 2575,  222, 1060, 2107, 1368,  363, 1591,  786, 1258, 3775,  112, 2313, 1630,  543, 3145,
+    2566, 2958, 1172,  293, 2741, 1251,   62, 2409,  673, 2195, 2967, 1922,  742, 1439, 2250, 1889,
+    1136, 3642, 2189, 3882, 1036, 3339, 3788, 2019, 3386, 1521, 3649,  611, 3884,  951, 3010, 1580,
+    4001,  785, 3078, 1657, 2529,  427, 2983, 2294,  629, 1402, 2572,  449, 1906, 3233,   10, 2307,
+    3628, 1318, 3434, 2348, 3843, 3157, 2563, 3904, 2906, 3420, 1505, 3000,  904, 3906, 1349, 2038,
+       2, 1762, 3359, 2353, 3578,  779, 4080, 2884, 3411, 1637,  488, 1106, 2538, 3004, 3565,  326,
+    2725, 1401,  129, 2611, 1534,  705,   59, 2992,  799,  404, 2541, 1246, 1996, 3326, 2597,  259,
+    1154, 1847, 3671,  176, 3376, 1473, 3518,  262, 3891, 1709, 2205, 3994, 2822, 1662, 3829, 1087,
+    1848,  763, 2873, 1549,  121,  662, 1111, 2197,  179, 1928,  564, 2121, 3340,  303, 2511, 3629,
+     797, 3973,  501, 1428, 1981, 3082, 1719,  353, 1004, 3858, 2373, 3317, 3911,   45,  965, 1645,
+    4067, 3146,  911, 3467, 2910, 1910, 2476, 1644, 3950, 2105, 3482, 2878,  158, 1700,  700, 3476,
+    2720,  469, 2418, 1005, 2838,  716, 1809, 2637,  956, 3307,  113,  892, 1262,  606, 2628,  359,
+    3069, 3910,  452, 2006, 3353, 2715, 1764, 3692,  922, 2753, 4084, 1120, 2663, 1753, 1160, 3257,
+    2186, 1080, 2849, 3797,  175, 1097, 2156, 2577, 1494, 2794,  239, 1371, 1739, 2067, 2839, 2430,
+     647, 1985, 2343,  304, 3971, 1197, 3272,  934, 2737,  234, 1572,  979, 4037, 2479, 1354, 2048,
+    3791, 3180, 1405, 3977, 2018, 1158, 3796, 3141, 1334, 1989, 3594, 2960, 2318, 3335, 1961, 3519,
+    2249, 1628, 2656,  999, 4042, 1348, 3076,  479, 3249, 1621, 2400,   57, 3585,  685, 2870,  401,
+    1507, 2629, 1811,  753, 2441, 3348, 3674,  649, 3267, 1976,  886, 3527,  622, 3190, 1243, 3432,
+     360, 3746, 1276, 1759,  608, 2259,  389, 3574, 1323, 2340, 3251,  567, 2150, 3544, 3108,   18,
+    1635,  734, 2227,  307, 3504, 2474,   38, 2242,  536, 2539,  342, 1606, 3762,  165, 1436,  812,
+    1169,   86, 3679, 2407,  732,  276, 2072, 2485, 1196, 3514,  730, 1393, 3140, 1885, 4006, 2342,
+    3729,  144, 3543, 2973, 1583,  399, 2744, 1315,   72, 3764, 2979, 2168, 2680,  265, 3813,  849,
+    1593, 2570, 3104, 3410, 2730, 3765, 2036, 3045,  636, 3849, 1781, 2940, 1224,  361,  925, 2349,
+    1140, 3470, 2746, 1757,  613, 3027, 1639,  823, 4051, 3246,  993, 2696,  683, 2076, 3014, 4013,
+    2734, 3185, 1399, 1782, 2933, 3456, 1562, 3863,  201, 1959, 2946, 3820, 2207,  270, 1324,  866,
+    3114,  642, 2057, 1219, 4025,  971, 1789, 3898, 2406, 1626,  330, 1035, 3995, 1487, 2344, 1923,
+    2968, 1046,   13,  787, 1542, 1071,  155, 1489, 2548, 1034,   71, 3724, 2623, 1884, 3928, 2951,
+    1977,  189, 3826,  964, 3281, 1389, 3744, 2872, 1865, 1376, 2184, 3916, 1237, 3453, 2433,  531,
+    1853,  331, 3501,  510, 2239, 1102, 2768,  881, 3173, 2332,  453, 1599,  931, 2619, 3471, 1980,
+    1638, 2530, 3397,  292, 2329, 3095, 2126,  822, 3207, 1195, 3592, 2472, 1845,  704, 3109,  178,
+    3599, 2206, 3991, 2007, 2435, 3513, 2801, 4094, 1945, 3435, 2200, 1511,  772, 3381, 1443,  497,
+    2493, 3022, 1317, 2137, 2634,  279, 2317, 1073,  153, 3639,  431, 2990, 1821,  350,  974, 1545,
+    3805, 2391,  896, 3071, 3936,   36, 3577,  518, 1770, 3946, 1112, 2752, 3647,  580, 3052,   98,
+    3907, 1049, 1455, 2703,  671, 3609,  166, 2853,  557, 1948, 2767,  450, 3408, 1217, 3701, 2668,
+     616, 1409, 2876,  394, 3203,  549, 1769,  862,  318, 2871,  588, 3219, 2387,  244, 2764, 3718,
+    1668,  707, 3355,  402, 4017, 1907,  693, 3403, 2547, 3124, 1655,  854, 2599, 3693, 2874, 3242,
+    2159, 1192, 2646, 1921, 1284, 1643, 2123, 2631, 1414, 2915,   93, 3294, 1798, 2425, 1131, 2165,
+    2887,  459, 3696, 3156, 1909, 1539, 1145, 3446, 2323, 4064,  893, 1569, 2898, 2091,  405, 1760,
+    1107, 3486, 1705,  960, 3886, 1229, 2356, 3260, 1341, 3807, 1082, 1799, 4024, 1188, 2148,  915,
+      77, 3889, 2352, 1711, 1134, 3509, 2771, 1283, 2035,  631, 2363, 3428,  137, 2041, 1282,  282,
+     687, 3542,  154, 3772,  706, 2515, 3270, 1009, 3711,  715, 2187, 1380,  345, 3818, 1550, 3534,
+     832, 1755, 2272,   23,  879, 3953, 2525, 1722,  358, 1271, 3324,   48, 3825,  811, 2528, 4045,
+    3217, 2336,  204, 2617, 1938, 2981,   65, 3615, 2016, 2303, 2678,  123, 2890,  556, 3139, 3494,
+    2077, 1415, 2826,  846, 3113,   91, 1557, 3758,  302, 4008, 1425, 1052, 3828, 1598, 2458, 4055,
+    1786, 2816, 1529, 3323, 2917,  412, 4065,  195, 1881, 3466, 2546, 4002, 2053,  678, 3230,  251,
+    2748, 4076, 1210, 3481, 2054, 2903,  226, 3777, 2169, 2982, 2551, 1796, 2301, 3143, 1499,  122,
+    2010,  703, 3039, 3680, 1485,  751, 2580, 1616,  371,  782, 3406, 1416, 3631, 1898, 1319, 2586,
+    1050, 3266,  529, 3723, 1960, 2421, 3001,  940, 2632, 1850, 3282, 2708,  535, 3023,  788, 3361,
+    1024, 2351,  381, 2210,  984, 1998, 1327, 2306, 3119,  456, 1212,  935, 3020, 2648, 1298, 2358,
+    1962,  558, 3035, 2609, 1394,  603, 3241,  930, 1452,  630, 3726, 1105,  540, 1267, 3511, 2928,
+    1014, 3859, 1303,  487, 2248, 3214, 3768, 1152, 3103, 3900, 1723,  420, 2221,  777, 3761,  327,
+    4077, 1751, 2655,  285, 1343, 3967,  436, 2171, 3607,  755,   80, 2232, 1218, 3597, 2096,   29,
+    2957, 3832, 1358, 3617, 1733, 3197, 2691,  841, 1563, 2843, 1808, 3582,  181, 1708, 3778, 1016,
+    3412, 1624,  948,  295, 3869, 2311, 1647, 2589, 3499, 1994,  277, 3245, 3937, 2081,  324, 2376,
+    1669, 2683, 1899, 3473, 1079,  240, 2099,  555, 2759, 2429,  953, 3046, 2652, 3327, 1610, 2914,
+    2215,  897, 3568, 2120, 3253,  725, 1792, 1178, 3202, 1604, 3048, 3875, 1800,  333, 2616, 1462,
+    1918,  528, 2682,  781,  115, 3808,  520, 3343, 3677,    7, 2346, 3204,  794, 2191,  507, 2894,
+      78, 3741, 2405, 3164, 1860, 1108, 3670,  386, 3059, 1051, 2393, 2818, 1613, 2672,  926, 3785,
+     458, 3117,   73, 2444, 2896, 3984, 1788, 3316, 1289,  207, 2027, 4012, 1122,    9, 2436,  582,
+    3166,  130, 1532, 2488, 1069, 2755, 3463, 2364,  273, 2562, 1332,  815, 2787, 3337,  936, 3959,
+    3224, 1167, 3375, 2260, 2964, 1478, 2456, 1170, 2101,  660, 3866, 1440, 2736, 4033, 3296, 1518,
+    2584, 2032, 1312,  645, 3454,  108, 2782,  805, 1740, 3630, 1408,  768,  191, 3595, 1930, 3231,
+    1398,  826, 3920, 1627,  587, 1410,  852, 2287, 3814, 1651, 3529,  537, 1515, 1969, 3848, 1302,
+    3686, 1955, 2956,  573, 3798,   34, 1477, 3731,  638, 4085, 2141,  447, 3695, 1633, 2411,  621,
+    2167,  211, 1827, 4031,  994, 1979,  320, 3919, 1673, 2651, 1061, 1995,  317, 1200, 1894,  837,
+    3588,  365, 4007, 2909, 2166, 1433, 3901, 2015, 2490,   26, 3986, 2231, 3081, 1191,  596, 2583,
+    2203, 3535, 1214, 2131, 3380, 2670, 3616,   50, 2824,  741, 3179, 2395, 2904, 3488,  761, 2742,
+    1041,  382, 3951, 1288, 1897, 3060, 2086,  973, 2865, 1877, 3387, 1065, 2278,  120, 1296, 3129,
+    2635, 3648, 1530,  594, 2665, 3537, 3065,  817, 2866, 3506,  439, 3080, 3546, 2509,  140, 2328,
+    3086, 1127, 1778,  902, 2578,  539, 3099, 1226, 3274,  674, 2891, 1902, 3414, 1558, 4041,  117,
+    1738, 2749,  287, 3007,  959,  339, 1941, 3127, 1144, 2134, 1395,  328,  983, 2234,  202, 1649,
+    3401, 2240, 2595, 3237,  821, 2419,  465, 3346, 1659,  192, 2620, 1503, 3226, 2881, 3871, 1749,
+     413, 1030, 3017, 2397,   49, 1310, 1790, 2229,  230, 1407, 2399, 1636,  710, 2901, 3766, 1378,
+     550, 2711, 3328,  278, 3715, 1634, 2333,  323, 3554, 1660, 1128,  398,  859, 2382, 2864,  982,
+    3313,  655, 3811, 1841, 2482, 4075, 1561, 2420,  493, 3885, 2653, 3360, 3975, 1826, 3120, 2534,
+    1434,  714, 1714,  159, 3656, 1377, 3918, 2540, 1253, 3587,  668, 3929,  346, 2000,  692, 1143,
+    3480, 2100, 3881,  810, 3261, 3787,  570, 3383, 4091,  958, 3206, 3665, 2176, 1032, 1710, 3228,
+    2075, 3809, 1456, 2008, 2976, 1086, 4086,  848, 2707, 2196, 3733, 2564, 3873,  238, 2087, 3669,
+    1480, 2368, 1156, 3445,  532, 1249, 3293,  792, 3561, 1863,  102, 1617,  617, 1260, 3584,  460,
+    4030, 2845, 3538, 1059, 2758, 1797,  242, 3181,  875, 2238, 3036, 1818, 1000, 2671, 3668, 2245,
+    2815,  190, 1812, 1367, 2138, 2773, 1099, 2550, 1603, 2074,   56, 1291,  496, 3922,  261, 2571,
+     878,   19, 2463,  677, 3487,  128, 1831, 3216, 1365,  139, 3008, 1426, 1822, 3051, 1227,  467,
+    1929, 3169,    4, 1611, 2860, 2237,  138, 2705, 1333, 2954,  997, 2310, 3038, 2686,  872, 2031,
+     231, 1175, 2173,  495, 3135, 2315,  689, 2043, 3815,   97, 1346, 2449, 3399, 1441,    6, 3196,
+    1548,  651, 3357, 2923,  422, 1713,  208, 3142,  731, 2892, 3834, 2453, 2780, 1912, 3413, 1186,
+    4019, 1806, 3601, 1265, 2756, 2114, 2598,  491, 3598, 1917,  944,  509, 3497,  743, 3342, 2681,
+    3955,  842, 2560, 3852,  898, 3589, 1684, 3930, 2098,  409, 3421, 3782, 1991,  169, 3748, 2383,
+    2962, 3322, 1836, 3714, 1540, 4049, 1202, 2974, 1579, 2693, 3651,  415,  771, 4059, 1883, 2502,
+     946, 3943, 2316,  986, 3500, 3983, 2293, 1374, 3612,  464, 1742,  840, 3147, 1497,  653, 2883,
+    2263, 3050,  451, 3225,  924, 1482, 3754, 1119, 2403, 3136, 3850, 2144, 2605, 1600, 2299,  200,
+    1372, 2961, 2152,  341, 1949, 3121,  565, 1072, 3259, 2552, 1527,  569, 1133, 3244, 1355, 1658,
+     952,  614, 2527,   20,  884, 2679,  308, 3475,  945,  576, 1854, 3292, 2220, 2844, 1208,  515,
+    3627, 1956,  252, 2576, 1273,  686, 3238, 1835, 2507, 1165, 3325, 2214,  143, 3549, 2090,  344,
+    1403,  804, 1615, 2208, 3958,  349, 2861,  724, 1697,  289, 2732, 1241,  100, 4058, 1020, 3566,
+    1810,  553, 3637, 1471, 2808, 1238, 2494, 1890,  237,  903, 4057, 2830, 1775, 2495,  470, 3451,
+    2716, 3783, 1467, 3024, 2192, 3332, 1767, 2454, 2147, 3993, 2955, 1028, 1614,  316, 3515, 2643,
+    1391, 2989, 1674, 3705, 2023, 2709,   68,  894, 3926,  258, 2689, 1384, 4000, 1088, 2532, 3769,
+    3289, 2694, 3712,  111, 2963, 1756, 2288, 3465, 3999, 1432,  793, 3685, 3163, 1978,  619, 3074,
+    2487, 1183, 3338,  770, 3923,  174, 3440, 3800, 2944, 2392, 2026,   47, 3622,  827, 3909, 1878,
+};
+
+static const char * const sampler_names[SAMPLER_TYPE_COUNT] = { "random", "stratified", "sobol", "bluenoise" };
+
+// Hashes `value` with `seed` into 32 well-spread bits
+static inline uint32_t
+hash32( uint32_t seed, uint32_t value )
+{
+    return (uint32_t)rng_mix64( ( (uint64_t)seed << 32 ) | value );
+}
+
+static inline uint32_t
+reverse_bits( uint32_t x )
+{
+    x = ( ( x >> 1 ) & 0x55555555u ) | ( ( x & 0x55555555u ) << 1 );
+    x = ( ( x >> 2 ) & 0x33333333u ) | ( ( x & 0x33333333u ) << 2 );
+    x = ( ( x >> 4 ) & 0x0F0F0F0Fu ) | ( ( x & 0x0F0F0F0Fu ) << 4 );
+    x = ( ( x >> 8 ) & 0x00FF00FFu ) | ( ( x & 0x00FF00FFu ) << 8 );
+    return ( x >> 16 ) | ( x << 16 );
+}
+
+// Owen scrambling of the bits of `x`: every bit is flipped or not depending on the bits above it only, which keeps
+// the stratification of a (0,2)-sequence. Hash-based, after Laine and Karras 2011 and Burley 2020.
+static inline uint32_t
+owen_scramble( uint32_t x, uint32_t seed )
+{
+    x  = reverse_bits( x );
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits( x );
+}
+
+// Returns dimension `dim` of Sobol point `index`, as 32 bits of a fraction. Scrambled indices use all 32 bits, so
+// every column is applied without branching.
+static inline uint32_t
+sobol( uint32_t index, int dim )
+{
+    if( 0 == dim ) return reverse_bits( index );
+
+    uint32_t x = 0;
+    for( int bit = 0; bit < 32; ++bit )
+        {
+            x ^= sobol_directions[dim][bit] & ( 0u - ( ( index >> bit ) & 1u ) );
+        }
+    return x;
+}
+
+// Returns the next dimension of the Owen scrambled Sobol point of `gen`. Each 4D tuple of dimensions has its own
+// scramble and its own shuffle of the points, so tuples are independent of each other while each stays a
+// well-stratified 4D point set. The shuffle is drawn once per tuple, on its first dimension.
+static double
+sobol_owen( rng * gen, uint32_t dimension )
+{
+    const int dim = (int)( dimension % SAMPLER_BOUNCE_DIMENSIONS );
+    if( 0 == dim )
+        {
+            gen->tuple_seed = hash32( gen->scramble, dimension / SAMPLER_BOUNCE_DIMENSIONS );
+            gen->shuffled   = owen_scramble( gen->index, gen->tuple_seed );
+        }
+    return owen_scramble( sobol( gen->shuffled, dim ), hash32( gen->tuple_seed, (uint32_t)dim + 1 ) ) * 0x1.0p-32;
+}
+
+// Permutation of [0, length) picked by `seed`, applied to `i` (Kensler 2013, cycle walking over a power-of-two
+// domain)
+static uint32_t
+permute( uint32_t i, uint32_t length, uint32_t seed )
+{
+    uint32_t w = length - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do
+        {
+            i ^= seed;
+            i *= 0xe170893du;
+            i ^= seed >> 16;
+            i ^= ( i & w ) >> 4;
+            i ^= seed >> 8;
+            i *= 0x0929eb3fu;
+            i ^= seed >> 23;
+            i ^= ( i & w ) >> 1;
+            i *= 1u | seed >> 27;
+            i *= 0x6935fa69u;
+            i ^= ( i & w ) >> 11;
+            i *= 0x74dcb303u;
+            i ^= ( i & w ) >> 2;
+            i *= 0x9e501cc3u;
+            i ^= ( i & w ) >> 2;
+            i *= 0xc860a3dfu;
+            i &= w;
+            i ^= i >> 5;
+        }
+    while( i >= length );
+    return ( i + seed ) % length;
+}
+
+// Returns a jitter in [0,1) for sample `i`, picked by `seed`
+static inline double
+jitter( uint32_t i, uint32_t seed )
+{
+    return hash32( seed, i ) * 0x1.0p-32;
+}
+
+// Returns dimension `dimension` of sample `index` of `count` correlated multi-jittered samples (Kensler 2013): each
+// pair of dimensions has one sample in every cell of an m x n grid of about sqrt(count) cells a side, and in every
+// row and every column of a count x count grid. The pattern of a pair is picked by `scramble` and the pair's index.
+static double
+stratified( uint32_t index, uint32_t count, uint32_t dimension, uint32_t scramble )
+{
+    const uint32_t pattern = hash32( scramble, dimension / 2 );
+    uint32_t       m       = 1;
+    while( ( m + 1 ) * ( m + 1 ) <= count )
+        {
+            ++m;
+        }
+    const uint32_t n = ( count + m - 1 ) / m;
+    const uint32_t s = permute( index, count, pattern * 0x51633e2du );
+
+    if( dimension & 1u ) return ( s + jitter( s, pattern * 0x368cc8b7u ) ) / count;
+    const uint32_t sx = permute( s % m, m, pattern * 0x68bc21ebu );
+    const uint32_t sy = permute( s / m, n, pattern * 0x02e5be93u );
+    return ( sx + ( sy + jitter( s, pattern * 0x967a889bu ) ) / n ) / m;
+}
+
+const char *
+sampler_name( sampler_type type )
+{
+    return ( (unsigned)type < SAMPLER_TYPE_COUNT ) ? sampler_names[type] : "unknown";
+}
+
+bool
+sampler_parse( const char * text, sampler_type * type )
+{
+    for( int t = 0; t < SAMPLER_TYPE_COUNT; ++t )
+        {
+            if( 0 == strcmp( text, sampler_names[t] ) )
+                {
+                    *type = (sampler_type)t;
+                    return true;
+                }
+        }
+    return false;
+}
+
+double
+sampler_next( rng * gen )
+{
+    const uint32_t dimension = gen->dimension++;
+    switch( (sampler_type)gen->sequence )
+        {
+        case SAMPLER_STRATIFIED:
+            if( gen->index < gen->count ) return stratified( gen->index, gen->count, dimension, gen->scramble );
+            break;
+        case SAMPLER_SOBOL: return sobol_owen( gen, dimension );
+        case SAMPLER_BLUE_NOISE:
+            {
+                // Toroidal shift of the shared sequence by the pixel's rank in the mask, the mask being offset
+                // differently for every dimension so the dimensions of a pixel are not shifted alike
+                const uint32_t offset = hash32( 0x9e3779b9u, dimension );
+                const uint32_t x      = ( gen->mask_pixel + offset ) % SAMPLER_MASK_SIZE;
+                const uint32_t y      = ( gen->mask_pixel / SAMPLER_MASK_SIZE + ( offset >> 16 ) ) % SAMPLER_MASK_SIZE;
+                const double   shift  = ( blue_noise_mask[y * SAMPLER_MASK_SIZE + x] + 0.5 )
+                                     / ( SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE );
+                const double   value  = sobol_owen( gen, dimension ) + shift;
+                return ( value >= 1.0 ) ? value - 1.0 : value;
+            }
+        default: break;
+        }
+    return rng_next_double( gen );
+}
@@ -0,0 +1,282 @@
+#include "scene.h"
+#include "instance.h"
+#include "rtweekend.h"
+#include "sphere.h"
+#include <math.h>   /* cbrt, ceil, cos, sin, sqrt */
+#include <stdlib.h> /* malloc, free */
+
+// Edge length of the square cell of every object of scene_instance_field
+#define INSTANCE_FIELD_SPACING 3.0
+
+// Adds a random material to `materials`. `choose_mat` in [0,1) picks it with the book's 80/15/5 diffuse/metal/glass
+// mix; the material parameters are then drawn from `gen`.
+static material_id
+random_material( material_table * materials, rng * gen, double choose_mat )
+{
+    if( 0.8 > choose_mat )
+        {
+            // Diffuse material
+            color albedo = vec3_mul_vec( vec3_new( random_double( gen ), random_double( gen ), random_double( gen ) ),
+                                         vec3_new( random_double( gen ), random_double( gen ), random_double( gen ) ) );
+            return material_table_add_lambertian( materials, albedo );
+        }
+
+    if( 0.95 > choose_mat )
+        {
+            // Metal material
+            color  albedo = vec3_new( random_double_range( gen, 0.5, 1 ), random_double_range( gen, 0.5, 1 ),
+                                      random_double_range( gen, 0.5, 1 ) );
+            double fuzz   = random_double_range( gen, 0, 0.5 );
+            return material_table_add_metal( materials, albedo, fuzz );
+        }
+
+    // Glass material
+    return material_table_add_dielectric( materials, 1.5 );
+}
+
+// Adds a sphere allocated from `memory` to `world`.
+//
+// Returns:
+//   true on success, false if memory ran out
+static bool
+add_sphere( hittable_list * world, arena * memory, point3 center, double radius, material_id mat )
+{
+    sphere * s = ARENA_NEW( memory, sphere );
+    if( !s || MATERIAL_ID_NONE == mat ) return false;
+
+    sphere_init( s, center, radius, mat );
+    return hittable_list_add( world, (hittable *)s );
+}
+
+bool
+scene_book( hittable_list * world, arena * memory, material_table * materials, rng * gen )
+{
+    // Ground Sphere
+    const material_id mat_ground = material_table_add_lambertian( materials, vec3_new( 0.5, 0.5, 0.5 ) );
+    if( !add_sphere( world, memory, vec3_new( 0.0, -1000, 0 ), 1000.0, mat_ground ) ) return false;
+
+    // Random Spheres
+    for( int a = -11; a < 11; ++a )
+        {
+            for( int b = -11; b < 11; ++b )
+                {
+                    double choose_mat = random_double( gen );
+                    point3 center     = vec3_new( a + 0.9 * random_double( gen ), 0.2, b + 0.9 * random_double( gen ) );
+
+                    if( vec3_length( vec3_sub( center, vec3_new( 4, 0.2, 0 ) ) ) > 0.9 )
+                        {
+                            material_id mat = random_material( materials, gen, choose_mat );
+                            if( !add_sphere( world, memory, center, 0.2, mat ) ) return false;
+                        }
+                }
+        }
+
+    // Three large central spheres: glass, brown diffuse and metal
+    const material_id mat1 = material_table_add_dielectric( materials, 1.5 );
+    const material_id mat2 = material_table_add_lambertian( materials, vec3_new( 0.4, 0.2, 0.1 ) );
+    const material_id mat3 = material_table_add_metal( materials, vec3_new( 0.7, 0.6, 0.5 ), 0.0 );
+
+    return add_sphere( world, memory, vec3_new( 0, 1, 0 ), 1.0, mat1 )
+        && add_sphere( world, memory, vec3_new( -4, 1, 0 ), 1.0, mat2 )
+        && add_sphere( world, memory, vec3_new( 4, 1, 0 ), 1.0, mat3 );
+}
+
+void
+scene_book_camera( camera * cam, double aspect_ratio, int image_width, int samples_per_pixel, int max_depth )
+{
+    point3 position      = vec3_new( 13, 2, 3 );
+    point3 lookat        = vec3_new( 0, 0, 0 );
+    vec3   vup           = vec3_new( 0, 1, 0 );
+    double dist_to_focus = 10.0;
+    double aperture      = 0.1;
+    double vfov          = 20.0;
+
+    camera_init( cam, aspect_ratio, vfov, position, lookat, vup, aperture, dist_to_focus, image_width,
+                 samples_per_pixel, max_depth );
+}
+
+// Half the edge length of the cube holding a sphere cloud: roughly one sphere per unit volume
+static double
+sphere_cloud_half_extent( int count )
+{
+    return 0.5 * cbrt( (double)count );
+}
+
+bool
+scene_sphere_cloud( hittable_list * world, arena * memory, material_table * materials, rng * gen, int count )
+{
+    const double half = sphere_cloud_half_extent( count );
+
+    for( int i = 0; i < count; ++i )
+        {
+            point3 center = vec3_new( random_double_range( gen, -half, half ), random_double_range( gen, -half, half ),
+                                      random_double_range( gen, -half, half ) );
+            double radius = random_double_range( gen, 0.1, 0.3 );
+
+            material_id mat = random_material( materials, gen, random_double( gen ) );
+            if( !add_sphere( world, memory, center, radius, mat ) ) return false;
+        }
+    return true;
+}
+
+void
+scene_sphere_cloud_camera( camera * cam, int count, double aspect_ratio, int image_width, int samples_per_pixel,
+                           int max_depth )
+{
+    const double half     = sphere_cloud_half_extent( count );
+    point3       position = vec3_new( 2.0 * half, 1.5 * half, 3.0 * half );
+    point3       lookat   = vec3_new( 0, 0, 0 );
+    vec3         vup      = vec3_new( 0, 1, 0 );
+
+    camera_init( cam, aspect_ratio, 40.0, position, lookat, vup, 0.0, vec3_length( position ), image_width,
+                 samples_per_pixel, max_depth );
+}
+
+triangle_mesh *
+scene_torus_mesh( arena * memory, int major, int minor, material_id mat )
+{
+    const size_t    vertex_count   = (size_t)major * minor;
+    const size_t    triangle_count = 2 * vertex_count;
+    point3 *        positions      = (point3 *)malloc( vertex_count * sizeof( point3 ) );
+    vec3 *          normals        = (vec3 *)malloc( vertex_count * sizeof( vec3 ) );
+    uint32_t *      indices        = (uint32_t *)malloc( 3 * triangle_count * sizeof( uint32_t ) );
+    triangle_mesh * mesh           = ARENA_NEW( memory, triangle_mesh );
+
+    bool ok = NULL != positions && NULL != normals && NULL != indices && NULL != mesh && major >= 3 && minor >= 3;
+    if( ok )
+        {
+            for( int i = 0; i < major; ++i )
+                {
+                    const double u = RT_TAU * i / major;
+                    for( int j = 0; j < minor; ++j )
+                        {
+                            const double v    = RT_TAU * j / minor;
+                            const double ring = 1.0 + 0.4 * cos( v );
+                            const size_t k    = (size_t)i * minor + j;
+                            positions[k]      = vec3_new( ring * cos( u ), 0.4 * sin( v ), ring * sin( u ) );
+                            normals[k]        = vec3_new( cos( v ) * cos( u ), sin( v ), cos( v ) * sin( u ) );
+                        }
+                }
+
+            // Two triangles per quad, wound counter-clockwise seen from outside
+            uint32_t * out = indices;
+            for( int i = 0; i < major; ++i )
+                {
+                    for( int j = 0; j < minor; ++j )
+                        {
+                            const uint32_t a = (uint32_t)( i * minor + j );
+                            const uint32_t b = (uint32_t)( ( ( i + 1 ) % major ) * minor + j );
+                            const uint32_t c = (uint32_t)( ( ( i + 1 ) % major ) * minor + ( j + 1 ) % minor );
+                            const uint32_t d = (uint32_t)( i * minor + ( j + 1 ) % minor );
+                            const uint32_t quad[6] = { a, d, c, a, c, b };
+                            for( int q = 0; q < 6; ++q )
+                                {
+                                    *out++ = quad[q];
+                                }
+                        }
+                }
+
+            ok = triangle_mesh_init( mesh, memory, positions, vertex_count, indices, triangle_count, normals,
+                                     vertex_count, indices, mat );
+        }
+
+    free( positions );
+    free( normals );
+    free( indices );
+    return ok ? mesh : NULL;
+}
+
+// Number of objects along each side of the square grid of a scene_instance_field
+static int
+instance_field_side( int count )
+{
+    return (int)ceil( sqrt( (double)count ) );
+}
+
+bool
+scene_instance_field( hittable_list * world, arena * memory, material_table * materials, rng * gen,
+                      const hittable * object, int count )
+{
+    const material_id mat_ground = material_table_add_lambertian( materials, vec3_new( 0.5, 0.5, 0.5 ) );
+    if( !add_sphere( world, memory, vec3_new( 0.0, -1000, 0 ), 1000.0, mat_ground ) ) return false;
+
+    // Every copy is first centered and scaled to one unit across, then to between one and two units
+    const vec3   extent = aabb_extent( object->bbox );
+    const double size   = fmax( extent.x, fmax( extent.y, extent.z ) );
+    const vec3   center = aabb_centroid( object->bbox );
+    if( !( size > 0.0 ) ) return false;
+
+    const transform to_origin = transform_translate( vec3_negate( center ) );
+    const int       side      = instance_field_side( count );
+    const double    half      = 0.5 * side * INSTANCE_FIELD_SPACING;
+
+    for( int i = 0; i < count; ++i )
+        {
+            const double scale = random_double_range( gen, 1.0, 2.0 );
+            const double x     = -half + ( i % side + random_double_range( gen, 0.25, 0.75 ) ) * INSTANCE_FIELD_SPACING;
+            const double z     = -half + ( i / side + random_double_range( gen, 0.25, 0.75 ) ) * INSTANCE_FIELD_SPACING;
+            const double tilt  = random_double_range( gen, -30.0, 30.0 );
+            const double turn  = random_double_range( gen, 0.0, 360.0 );
+
+            const transform scaling = transform_scale( vec3_new( scale / size, scale / size, scale / size ) );
+            const transform tilting = transform_rotate( vec3_new( 1, 0, 0 ), tilt );
+            const transform turning = transform_rotate( vec3_new( 0, 1, 0 ), turn );
+            const transform moving  = transform_translate( vec3_new( x, 0.6 * scale, z ) );
+            transform       placed  = transform_compose( &scaling, &to_origin );
+            placed                  = transform_compose( &tilting, &placed );
+            placed                  = transform_compose( &turning, &placed );
+            placed                  = transform_compose( &moving, &placed );
+
+            material_id mat  = random_material( materials, gen, random_double( gen ) );
+            instance *  inst = ARENA_NEW( memory, instance );
+            if( !inst || MATERIAL_ID_NONE == mat || !instance_init( inst, object, &placed, mat ) ) return false;
+            if( !hittable_list_add( world, (hittable *)inst ) ) return false;
+        }
+    return true;
+}
+
+void
+scene_instance_field_camera( camera * cam, int count, double aspect_ratio, int image_width, int samples_per_pixel,
+                             int max_depth )
+{
+    const double half     = 0.5 * instance_field_side( count ) * INSTANCE_FIELD_SPACING;
+    point3       position = vec3_new( 0.9 * half, 0.4 * half + 2.0, 0.9 * half );
+    point3       lookat   = vec3_new( 0, 0, 0 );
+    vec3         vup      = vec3_new( 0, 1, 0 );
+
+    camera_init( cam, aspect_ratio, 40.0, position, lookat, vup, 0.0, vec3_length( position ), image_width,
+                 samples_per_pixel, max_depth );
+}
+
+static uint64_t
+hash_vec3( uint64_t h, vec3 v )
+{
+    return rng_hash_double( rng_hash_double( rng_hash_double( h, v.x ), v.y ), v.z );
+}
+
+uint64_t
+scene_hash( const hittable_list * world, const material_table * materials )
+{
+    uint64_t h = rng_hash_u64( 0, world->count );
+    for( size_t i = 0; i < world->count; ++i )
+        {
+            const hittable * object = world->objects[i];
+            const material * mat    = material_table_get( materials, object->material_id );
+
+            h = hash_vec3( hash_vec3( h, object->bbox.min ), object->bbox.max );
+            if( NULL == mat ) continue;
+
+            h = rng_hash_u64( h, (uint64_t)mat->type );
+            switch( mat->type )
+                {
+                case MATERIAL_LAMBERTIAN: h = hash_vec3( h, ( (const lambertian *)mat )->albedo ); break;
+                case MATERIAL_METAL:
+                    h = hash_vec3( h, ( (const metal *)mat )->albedo );
+                    h = rng_hash_double( h, ( (const metal *)mat )->fuzz );
+                    break;
+                case MATERIAL_DIELECTRIC: h = rng_hash_double( h, ( (const dielectric *)mat )->ir ); break;
+                default: break; // Custom materials only contribute their type
+                }
+        }
+    return h;
+}
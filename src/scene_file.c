@@ -0,0 +1,1218 @@
+#define _POSIX_C_SOURCE 200809L /* fstat, mmap */
+
+#include "scene_file.h"
+#include "instance.h"
+#include "sphere.h"
+#include "triangle_mesh.h"
+#include <fcntl.h>    /* open */
+#include <math.h>     /* isfinite */
+#include <stdarg.h>   /* va_list */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>   /* malloc, realloc, free, strtod, strtol */
+#include <string.h>   /* memcmp, memcpy, memset, strcmp, strlen */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/stat.h> /* stat, fstat */
+#include <unistd.h>   /* close */
+
+#define SCENE_CACHE_MAGIC   "RTSCENE\n"
+#define SCENE_CACHE_VERSION 3
+#define NO_MATERIAL         UINT32_MAX // Material index of a sphere without material
+
+// Whether rt_real values are written to text with the digits of a float
+#ifdef RT_USE_FLOAT
+#    define REAL_IS_FLOAT true
+#else
+#    define REAL_IS_FLOAT false
+#endif
+
+// Binary file header, followed by `material_count` material records and `sphere_count` sphere records
+typedef struct
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t material_count;
+    uint64_t sphere_count;
+    uint64_t source_size;  // Size of the text file the cache was compiled from; 0 if none
+    int64_t  source_mtime; // Modification time of that file, in seconds since the epoch
+    double   position[3];
+    double   target[3];
+    double   up[3];
+    double   vertical_fov_deg;
+    double   aspect_ratio;
+    double   aperture;
+    double   focus_distance;
+    double   adaptive_threshold;
+    int32_t  image_width;
+    int32_t  samples_per_pixel;
+    int32_t  max_depth;
+    int32_t  packet_size;
+    uint32_t integrator; // camera_integrator
+    int32_t  roulette_min_depth;
+    int32_t  adaptive_min_samples;
+    uint32_t sampler; // sampler_type
+} scene_cache_header;
+
+// A material: lambertian and metal store their albedo then the metal's fuzz, dielectric its index of refraction
+typedef struct
+{
+    uint32_t type; // material_type
+    uint32_t reserved;
+    double   params[4];
+} scene_cache_material;
+
+typedef struct
+{
+    double   center[3];
+    double   radius;
+    uint32_t material; // Index of the material record, or NO_MATERIAL
+    uint32_t reserved;
+} scene_cache_sphere;
+
+// View and render settings of a scene, as passed to camera_init
+typedef struct
+{
+    point3            position;
+    point3            target;
+    vec3              up;
+    double            vertical_fov_deg;
+    double            aspect_ratio;
+    double            aperture;
+    double            focus_distance;
+    int               image_width;
+    int               samples_per_pixel;
+    int               max_depth;
+    int               packet_size;
+    camera_integrator integrator;
+    int               roulette_min_depth;
+    double            adaptive_threshold;
+    int               adaptive_min_samples;
+    sampler_type      sampler;
+} scene_view;
+
+static scene_view
+view_from_camera( const camera * cam )
+{
+    scene_view view;
+    view.position             = cam->position;
+    view.target               = cam->target;
+    view.up                   = cam->world_up;
+    view.vertical_fov_deg     = cam->vertical_fov_deg;
+    view.aspect_ratio         = cam->aspect_ratio;
+    view.aperture             = cam->aperture;
+    view.focus_distance       = cam->focal_distance;
+    view.image_width          = cam->image_width;
+    view.samples_per_pixel    = cam->samples_per_pixel;
+    view.max_depth            = cam->max_depth;
+    view.packet_size          = RT_MAX( cam->packet_size, 1 );
+    view.integrator           = cam->integrator;
+    view.roulette_min_depth   = RT_MAX( cam->roulette_min_depth, 0 );
+    view.adaptive_threshold   = RT_MAX( cam->adaptive_threshold, 0.0 );
+    view.adaptive_min_samples = cam->adaptive_min_samples;
+    view.sampler              = cam->sampler;
+    return view;
+}
+
+static void
+view_apply( const scene_view * view, camera * cam )
+{
+    camera_init( cam, view->aspect_ratio, view->vertical_fov_deg, view->position, view->target, view->up,
+                 view->aperture, view->focus_distance, view->image_width, view->samples_per_pixel, view->max_depth );
+    cam->packet_size          = view->packet_size;
+    cam->integrator           = view->integrator;
+    cam->roulette_min_depth   = view->roulette_min_depth;
+    cam->adaptive_threshold   = view->adaptive_threshold;
+    cam->adaptive_min_samples = view->adaptive_min_samples;
+    cam->sampler              = view->sampler;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Writing
+//----------------------------------------------------------------------------------------------------------------------
+// Index of material `id` among the materials a file lists: every lambertian, then every metal, then every dielectric
+// of the table.
+//
+// Returns:
+//   true on success, false for a custom material, which files cannot describe
+static bool
+file_material_index( const material_table * materials, material_id id, uint32_t * index )
+{
+    if( MATERIAL_ID_NONE == id )
+        {
+            *index = NO_MATERIAL;
+            return true;
+        }
+
+    const uint32_t i = material_id_index( id );
+    switch( material_id_type( id ) )
+        {
+        case MATERIAL_LAMBERTIAN: *index = i; return true;
+        case MATERIAL_METAL: *index = (uint32_t)materials->count[MATERIAL_LAMBERTIAN] + i; return true;
+        case MATERIAL_DIELECTRIC:
+            *index = (uint32_t)( materials->count[MATERIAL_LAMBERTIAN] + materials->count[MATERIAL_METAL] ) + i;
+            return true;
+        default: return false;
+        }
+}
+
+// Returns true if every object of `world` is a sphere, the only objects the saved forms hold
+static bool
+only_spheres( const hittable_list * world )
+{
+    for( size_t i = 0; i < world->count; ++i )
+        {
+            if( sphere_hit_function != world->objects[i]->hit ) return false;
+        }
+    return true;
+}
+
+// Checks that every object of `world` is a sphere with a built-in material or none
+static bool
+check_describable( const char * path, const hittable_list * world, const material_table * materials )
+{
+    for( size_t i = 0; i < world->count; ++i )
+        {
+            uint32_t index;
+            if( sphere_hit_function != world->objects[i]->hit )
+                {
+                    fprintf( stderr, "ERROR: Cannot save '%s': object %zu is not a sphere.\n", path, i );
+                    return false;
+                }
+            if( !file_material_index( materials, world->objects[i]->material_id, &index ) )
+                {
+                    fprintf( stderr, "ERROR: Cannot save '%s': sphere %zu has a custom material.\n", path, i );
+                    return false;
+                }
+        }
+    return true;
+}
+
+// Name of the material at file index `index` in a text scene: its type's initial and its index within the type
+static void
+text_material_name( const material_table * materials, uint32_t index, char * name, size_t size )
+{
+    const size_t lambertians = materials->count[MATERIAL_LAMBERTIAN];
+    const size_t metals      = materials->count[MATERIAL_METAL];
+    if( index < lambertians )
+        snprintf( name, size, "l%u", index );
+    else if( index < lambertians + metals )
+        snprintf( name, size, "m%zu", index - lambertians );
+    else
+        snprintf( name, size, "d%zu", index - lambertians - metals );
+}
+
+// Writes a space and `value` with the fewest significant digits that read back as the same double, or the same
+// float when `single`
+static void
+write_number( FILE * file, double value, bool single )
+{
+    // %g drops trailing zeros, so the first try already prints short values such as 0.1 in full
+    const int max_digits = single ? 9 : 17;
+    char      text[32];
+    for( int digits = max_digits - 2;; ++digits )
+        {
+            snprintf( text, sizeof( text ), "%.*g", digits, value );
+            const double back = strtod( text, NULL );
+            if( digits >= max_digits || ( single ? (float)back == (float)value : back == value ) ) break;
+        }
+    fputc( ' ', file );
+    fputs( text, file );
+}
+
+static void
+write_vec3( FILE * file, vec3 v )
+{
+    write_number( file, v.x, REAL_IS_FLOAT );
+    write_number( file, v.y, REAL_IS_FLOAT );
+    write_number( file, v.z, REAL_IS_FLOAT );
+}
+
+bool
+scene_file_save_text( const char * path, const hittable_list * world, const material_table * materials,
+                      const camera * cam )
+{
+    if( !check_describable( path, world, materials ) ) return false;
+
+    FILE * file = fopen( path, "w" );
+    if( NULL == file )
+        {
+            fprintf( stderr, "ERROR: Failed to open '%s' for writing.\n", path );
+            return false;
+        }
+
+    const scene_view view = view_from_camera( cam );
+    fprintf( file, "# Settings\n" );
+    fprintf( file, "image_width       %d\n", view.image_width );
+    fprintf( file, "aspect_ratio     " );
+    write_number( file, view.aspect_ratio, false );
+    fprintf( file, "\nsamples_per_pixel %d\n", view.samples_per_pixel );
+    fprintf( file, "max_depth         %d\n", view.max_depth );
+    fprintf( file, "packet_size       %d\n", view.packet_size );
+    fprintf( file, "integrator        %s\n", camera_integrator_name( view.integrator ) );
+    fprintf( file, "roulette_min_depth %d\n", view.roulette_min_depth );
+    fprintf( file, "adaptive_threshold" );
+    write_number( file, view.adaptive_threshold, false );
+    fprintf( file, "\nadaptive_min_samples %d\n", view.adaptive_min_samples );
+    fprintf( file, "sampler           %s\n", sampler_name( view.sampler ) );
+
+    fprintf( file, "\n# Camera: position, target, up, vertical fov, aperture, focus distance\ncamera" );
+    write_vec3( file, view.position );
+    write_vec3( file, view.target );
+    write_vec3( file, view.up );
+    write_number( file, view.vertical_fov_deg, false );
+    write_number( file, view.aperture, false );
+    write_number( file, view.focus_distance, false );
+
+    fprintf( file, "\n\n# Materials\n" );
+    for( size_t i = 0; i < materials->count[MATERIAL_LAMBERTIAN]; ++i )
+        {
+            fprintf( file, "material l%zu lambertian", i );
+            write_vec3( file, materials->lambertians[i].albedo );
+            fputc( '\n', file );
+        }
+    for( size_t i = 0; i < materials->count[MATERIAL_METAL]; ++i )
+        {
+            fprintf( file, "material m%zu metal", i );
+            write_vec3( file, materials->metals[i].albedo );
+            write_number( file, materials->metals[i].fuzz, REAL_IS_FLOAT );
+            fputc( '\n', file );
+        }
+    for( size_t i = 0; i < materials->count[MATERIAL_DIELECTRIC]; ++i )
+        {
+            fprintf( file, "material d%zu dielectric", i );
+            write_number( file, materials->dielectrics[i].ir, REAL_IS_FLOAT );
+            fputc( '\n', file );
+        }
+
+    fprintf( file, "\n# Spheres: center, radius, material\n" );
+    for( size_t i = 0; i < world->count; ++i )
+        {
+            const sphere * s = (const sphere *)world->objects[i];
+            uint32_t       index    = NO_MATERIAL;
+            char           name[16] = "none";
+            file_material_index( materials, s->base.material_id, &index );
+            if( NO_MATERIAL != index ) text_material_name( materials, index, name, sizeof( name ) );
+
+            fprintf( file, "sphere" );
+            write_vec3( file, s->center );
+            write_number( file, s->radius, REAL_IS_FLOAT );
+            fprintf( file, " %s\n", name );
+        }
+
+    bool ok = !ferror( file );
+    ok      = ( 0 == fclose( file ) ) && ok;
+    if( !ok ) fprintf( stderr, "ERROR: Failed to write scene '%s'.\n", path );
+    return ok;
+}
+
+bool
+scene_file_save_binary( const char * path, const hittable_list * world, const material_table * materials,
+                        const camera * cam, const char * source_path )
+{
+    if( !check_describable( path, world, materials ) ) return false;
+
+    const size_t material_count = materials->count[MATERIAL_LAMBERTIAN] + materials->count[MATERIAL_METAL]
+                                + materials->count[MATERIAL_DIELECTRIC];
+    if( material_count >= NO_MATERIAL )
+        {
+            fprintf( stderr, "ERROR: Cannot save '%s': too many materials.\n", path );
+            return false;
+        }
+
+    scene_cache_header header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, SCENE_CACHE_MAGIC, sizeof( header.magic ) );
+    header.version        = SCENE_CACHE_VERSION;
+    header.material_count = (uint32_t)material_count;
+    header.sphere_count   = world->count;
+
+    struct stat source;
+    if( NULL != source_path )
+        {
+            if( 0 != stat( source_path, &source ) )
+                {
+                    fprintf( stderr, "ERROR: Failed to read '%s'.\n", source_path );
+                    return false;
+                }
+            header.source_size  = (uint64_t)source.st_size;
+            header.source_mtime = (int64_t)source.st_mtime;
+        }
+
+    const scene_view view    = view_from_camera( cam );
+    const vec3       vecs[3] = { view.position, view.target, view.up };
+    double *         dsts[3] = { header.position, header.target, header.up };
+    for( int v = 0; v < 3; ++v )
+        {
+            dsts[v][0] = vecs[v].x;
+            dsts[v][1] = vecs[v].y;
+            dsts[v][2] = vecs[v].z;
+        }
+    header.vertical_fov_deg     = view.vertical_fov_deg;
+    header.aspect_ratio         = view.aspect_ratio;
+    header.aperture             = view.aperture;
+    header.focus_distance       = view.focus_distance;
+    header.image_width          = view.image_width;
+    header.samples_per_pixel    = view.samples_per_pixel;
+    header.max_depth            = view.max_depth;
+    header.packet_size          = view.packet_size;
+    header.integrator           = (uint32_t)view.integrator;
+    header.roulette_min_depth   = view.roulette_min_depth;
+    header.adaptive_threshold   = view.adaptive_threshold;
+    header.adaptive_min_samples = view.adaptive_min_samples;
+    header.sampler              = (uint32_t)view.sampler;
+
+    const size_t length = strlen( path );
+    char *       temp   = (char *)malloc( length + 5 );
+    if( NULL == temp )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the scene path.\n" );
+            return false;
+        }
+    memcpy( temp, path, length );
+    memcpy( temp + length, ".tmp", 5 );
+
+    FILE * file = fopen( temp, "wb" );
+    bool   ok   = ( NULL != file );
+    ok          = ok && 1 == fwrite( &header, sizeof( header ), 1, file );
+
+    for( int type = MATERIAL_LAMBERTIAN; ok && type <= MATERIAL_DIELECTRIC; ++type )
+        {
+            for( size_t i = 0; ok && i < materials->count[type]; ++i )
+                {
+                    scene_cache_material record;
+                    memset( &record, 0, sizeof( record ) );
+                    record.type = (uint32_t)type;
+                    if( MATERIAL_DIELECTRIC == type )
+                        {
+                            record.params[0] = materials->dielectrics[i].ir;
+                        }
+                    else
+                        {
+                            const color albedo = ( MATERIAL_METAL == type ) ? materials->metals[i].albedo
+                                                                            : materials->lambertians[i].albedo;
+                            record.params[0]   = albedo.x;
+                            record.params[1]   = albedo.y;
+                            record.params[2]   = albedo.z;
+                            record.params[3]   = ( MATERIAL_METAL == type ) ? materials->metals[i].fuzz : 0.0;
+                        }
+                    ok = 1 == fwrite( &record, sizeof( record ), 1, file );
+                }
+        }
+
+    for( size_t i = 0; ok && i < world->count; ++i )
+        {
+            const sphere *     s = (const sphere *)world->objects[i];
+            scene_cache_sphere record;
+            memset( &record, 0, sizeof( record ) );
+            record.center[0] = s->center.x;
+            record.center[1] = s->center.y;
+            record.center[2] = s->center.z;
+            record.radius    = s->radius;
+            file_material_index( materials, s->base.material_id, &record.material );
+            ok = 1 == fwrite( &record, sizeof( record ), 1, file );
+        }
+
+    if( NULL != file ) ok = ( 0 == fclose( file ) ) && ok;
+    ok = ok && 0 == rename( temp, path );
+
+    if( !ok )
+        {
+            fprintf( stderr, "ERROR: Failed to write scene '%s'.\n", path );
+            remove( temp );
+        }
+    free( temp );
+    return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Binary loading
+//----------------------------------------------------------------------------------------------------------------------
+// A file mapped read-only into memory
+typedef struct
+{
+    const void * data;
+    size_t       size;
+} file_map;
+
+// Maps the file at `path`.
+//
+// Returns:
+//   true on success, false if the file cannot be opened or mapped (silently)
+static bool
+map_file( const char * path, file_map * map )
+{
+    const int fd = open( path, O_RDONLY );
+    if( fd < 0 ) return false;
+
+    struct stat info;
+    bool        ok = ( 0 == fstat( fd, &info ) ) && info.st_size > 0;
+    if( ok )
+        {
+            void * data = mmap( NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            ok          = ( MAP_FAILED != data );
+            map->data   = data;
+            map->size   = (size_t)info.st_size;
+        }
+    close( fd ); // The mapping stays valid
+    return ok;
+}
+
+static void
+unmap_file( file_map * map )
+{
+    munmap( (void *)map->data, map->size );
+    map->data = NULL;
+    map->size = 0;
+}
+
+// Returns the header of a mapped binary scene, or NULL if the file is not one or is truncated
+static const scene_cache_header *
+cache_header( const file_map * map )
+{
+    const scene_cache_header * header = (const scene_cache_header *)map->data;
+    if( map->size < sizeof( *header ) || 0 != memcmp( header->magic, SCENE_CACHE_MAGIC, sizeof( header->magic ) )
+        || SCENE_CACHE_VERSION != header->version || header->packet_size < 1
+        || header->packet_size > CAMERA_MAX_PACKET_SIZE || header->integrator >= CAMERA_INTEGRATOR_COUNT
+        || header->roulette_min_depth < 0 || !( header->adaptive_threshold >= 0.0 )
+        || header->adaptive_min_samples < 1 || header->sampler >= SAMPLER_TYPE_COUNT )
+        return NULL;
+
+    const size_t records = map->size - sizeof( *header );
+    if( header->material_count > records / sizeof( scene_cache_material ) ) return NULL;
+    const size_t sphere_bytes = records - header->material_count * sizeof( scene_cache_material );
+    if( header->sphere_count != sphere_bytes / sizeof( scene_cache_sphere )
+        || 0 != sphere_bytes % sizeof( scene_cache_sphere ) )
+        return NULL;
+    return header;
+}
+
+// Builds the scene of a mapped binary scene, whose header `header` is valid
+static bool
+cache_load( const char * path, const scene_cache_header * header, hittable_list * world, arena * memory,
+            material_table * materials, camera * cam )
+{
+    const scene_cache_material * records = (const scene_cache_material *)( header + 1 );
+    const scene_cache_sphere *   spheres = (const scene_cache_sphere *)( records + header->material_count );
+
+    material_id * ids = (material_id *)malloc( ( header->material_count + 1 ) * sizeof( material_id ) );
+    if( NULL == ids )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the materials of '%s'.\n", path );
+            return false;
+        }
+
+    bool ok = true;
+    for( uint32_t i = 0; ok && i < header->material_count; ++i )
+        {
+            const double * p = records[i].params;
+            switch( records[i].type )
+                {
+                case MATERIAL_LAMBERTIAN:
+                    ids[i] = material_table_add_lambertian( materials, vec3_new( p[0], p[1], p[2] ) );
+                    break;
+                case MATERIAL_METAL:
+                    ids[i] = material_table_add_metal( materials, vec3_new( p[0], p[1], p[2] ), p[3] );
+                    break;
+                case MATERIAL_DIELECTRIC: ids[i] = material_table_add_dielectric( materials, p[0] ); break;
+                default:
+                    fprintf( stderr, "ERROR: Scene '%s' has an unknown material type %u.\n", path, records[i].type );
+                    ok = false;
+                    continue;
+                }
+            if( MATERIAL_ID_NONE == ids[i] )
+                {
+                    fprintf( stderr, "ERROR: Failed to add the materials of '%s'.\n", path );
+                    ok = false;
+                }
+        }
+
+    // Every sphere in one allocation
+    sphere * objects = NULL;
+    if( ok && header->sphere_count > 0 )
+        {
+            objects = (sphere *)arena_alloc( memory, header->sphere_count * sizeof( sphere ) );
+            ok      = ( NULL != objects );
+            if( !ok ) fprintf( stderr, "ERROR: Failed to allocate the spheres of '%s'.\n", path );
+        }
+
+    for( uint64_t i = 0; ok && i < header->sphere_count; ++i )
+        {
+            const scene_cache_sphere * record = &spheres[i];
+            if( NO_MATERIAL != record->material && record->material >= header->material_count )
+                {
+                    fprintf( stderr, "ERROR: Sphere %llu of '%s' has no material %u.\n", (unsigned long long)i, path,
+                             record->material );
+                    ok = false;
+                    break;
+                }
+
+            const material_id mat = ( NO_MATERIAL == record->material ) ? MATERIAL_ID_NONE : ids[record->material];
+            sphere_init( &objects[i], vec3_new( record->center[0], record->center[1], record->center[2] ),
+                         record->radius, mat );
+            ok = hittable_list_add( world, &objects[i].base );
+        }
+    free( ids );
+    if( !ok ) return false;
+
+    scene_view view;
+    view.position             = vec3_new( header->position[0], header->position[1], header->position[2] );
+    view.target               = vec3_new( header->target[0], header->target[1], header->target[2] );
+    view.up                   = vec3_new( header->up[0], header->up[1], header->up[2] );
+    view.vertical_fov_deg     = header->vertical_fov_deg;
+    view.aspect_ratio         = header->aspect_ratio;
+    view.aperture             = header->aperture;
+    view.focus_distance       = header->focus_distance;
+    view.image_width          = header->image_width;
+    view.samples_per_pixel    = header->samples_per_pixel;
+    view.max_depth            = header->max_depth;
+    view.packet_size          = header->packet_size;
+    view.integrator           = (camera_integrator)header->integrator;
+    view.roulette_min_depth   = header->roulette_min_depth;
+    view.adaptive_threshold   = header->adaptive_threshold;
+    view.adaptive_min_samples = header->adaptive_min_samples;
+    view.sampler              = (sampler_type)header->sampler;
+    view_apply( &view, cam );
+    return true;
+}
+
+bool
+scene_file_load_binary( const char * path, hittable_list * world, arena * memory, material_table * materials,
+                        camera * cam )
+{
+    file_map map;
+    if( !map_file( path, &map ) )
+        {
+            fprintf( stderr, "ERROR: Failed to open scene '%s'.\n", path );
+            return false;
+        }
+
+    const scene_cache_header * header = cache_header( &map );
+    bool                       ok     = ( NULL != header );
+    if( !ok ) fprintf( stderr, "ERROR: '%s' is not a binary scene of this version, or is truncated.\n", path );
+
+    ok = ok && cache_load( path, header, world, memory, materials, cam );
+    unmap_file( &map );
+    return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Text loading
+//----------------------------------------------------------------------------------------------------------------------
+// A named material of a text scene. Names point into the file's buffer.
+typedef struct
+{
+    const char * name;
+    material_id  id;
+} named_material;
+
+// A mesh instances place, by the resolved path of its OBJ file
+typedef struct
+{
+    char *          path;
+    triangle_mesh * mesh;
+} shared_mesh;
+
+typedef struct
+{
+    const char *     path;
+    int              line;
+    char *           cursor; // Rest of the current line, NUL-terminated
+
+    // Open-addressing hash set of the named materials
+    named_material * names;
+    size_t           name_slots; // Power of two, or 0 before the first name
+    size_t           name_count;
+
+    // Meshes placed by instances, loaded once per file
+    shared_mesh * meshes;
+    size_t        mesh_count;
+    size_t        mesh_capacity;
+} scene_parser;
+
+static void
+parse_error( const scene_parser * p, const char * format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    fprintf( stderr, "ERROR: %s:%d: ", p->path, p->line );
+    vfprintf( stderr, format, args );
+    fputc( '\n', stderr );
+    va_end( args );
+}
+
+static inline bool
+is_blank( char c )
+{
+    return ' ' == c || '\t' == c || '\r' == c;
+}
+
+// Returns the next token of the line, NUL-terminated in place, or NULL at the end of the line
+static char *
+next_token( scene_parser * p )
+{
+    while( is_blank( *p->cursor ) )
+        {
+            ++p->cursor;
+        }
+    if( '\0' == *p->cursor ) return NULL;
+
+    char * token = p->cursor;
+    while( '\0' != *p->cursor && !is_blank( *p->cursor ) )
+        {
+            ++p->cursor;
+        }
+    if( '\0' != *p->cursor ) *p->cursor++ = '\0';
+    return token;
+}
+
+static bool
+parse_real( scene_parser * p, const char * what, double * value )
+{
+    char * token = next_token( p );
+    char * end   = NULL;
+    if( NULL != token ) *value = strtod( token, &end );
+    if( NULL == token || '\0' != *end || end == token )
+        {
+            parse_error( p, "Expected a number for %s.", what );
+            return false;
+        }
+    return true;
+}
+
+static bool
+parse_vec3( scene_parser * p, const char * what, vec3 * v )
+{
+    double x, y, z;
+    if( !parse_real( p, what, &x ) || !parse_real( p, what, &y ) || !parse_real( p, what, &z ) ) return false;
+    *v = vec3_new( x, y, z );
+    return true;
+}
+
+// Parses an integer of at least `min`, 0 or 1
+static bool
+parse_integer( scene_parser * p, const char * what, int min, int * value )
+{
+    char * token = next_token( p );
+    char * end   = NULL;
+    long   n     = 0;
+    if( NULL != token ) n = strtol( token, &end, 10 );
+    if( NULL == token || '\0' != *end || end == token || n < min || n > INT32_MAX )
+        {
+            parse_error( p, "Expected a %s integer for %s.", ( min > 0 ) ? "positive" : "non-negative", what );
+            return false;
+        }
+    *value = (int)n;
+    return true;
+}
+
+// Parses a positive integer
+static bool
+parse_count( scene_parser * p, const char * what, int * value )
+{
+    return parse_integer( p, what, 1, value );
+}
+
+// Checks that the statement used the whole line
+static bool
+parse_end( scene_parser * p )
+{
+    const char * token = next_token( p );
+    if( NULL != token )
+        {
+            parse_error( p, "Unexpected '%s'.", token );
+            return false;
+        }
+    return true;
+}
+
+// FNV-1a
+static uint64_t
+hash_name( const char * name )
+{
+    uint64_t h = 14695981039346656037ull;
+    for( ; '\0' != *name; ++name )
+        {
+            h = ( h ^ (unsigned char)*name ) * 1099511628211ull;
+        }
+    return h;
+}
+
+// Returns the slot of `name`: the slot holding it, or the empty slot where it belongs
+static named_material *
+find_name( const scene_parser * p, const char * name )
+{
+    const size_t mask = p->name_slots - 1;
+    for( size_t slot = (size_t)hash_name( name ) & mask;; slot = ( slot + 1 ) & mask )
+        {
+            named_material * entry = &p->names[slot];
+            if( NULL == entry->name || 0 == strcmp( entry->name, name ) ) return entry;
+        }
+}
+
+// Keeps the hash set at most half full
+static bool
+reserve_names( scene_parser * p )
+{
+    if( 2 * ( p->name_count + 1 ) <= p->name_slots ) return true;
+
+    const size_t     old_slots = p->name_slots;
+    named_material * old_names = p->names;
+    p->name_slots              = ( 0 == old_slots ) ? 64 : old_slots * 2;
+    p->names                   = (named_material *)calloc( p->name_slots, sizeof( named_material ) );
+    if( NULL == p->names )
+        {
+            parse_error( p, "Out of memory for material names." );
+            p->names      = old_names;
+            p->name_slots = old_slots;
+            return false;
+        }
+
+    for( size_t i = 0; i < old_slots; ++i )
+        {
+            if( NULL != old_names[i].name ) *find_name( p, old_names[i].name ) = old_names[i];
+        }
+    free( old_names );
+    return true;
+}
+
+// Parses the parameters of a material of type `type` and adds it to `materials`
+static bool
+parse_material( scene_parser * p, const char * type, material_table * materials, material_id * id )
+{
+    vec3   albedo;
+    double value;
+    if( 0 == strcmp( type, "lambertian" ) )
+        {
+            if( !parse_vec3( p, "the albedo", &albedo ) ) return false;
+            *id = material_table_add_lambertian( materials, albedo );
+        }
+    else if( 0 == strcmp( type, "metal" ) )
+        {
+            if( !parse_vec3( p, "the albedo", &albedo ) || !parse_real( p, "the fuzz", &value ) ) return false;
+            *id = material_table_add_metal( materials, albedo, value );
+        }
+    else if( 0 == strcmp( type, "dielectric" ) )
+        {
+            if( !parse_real( p, "the index of refraction", &value ) ) return false;
+            *id = material_table_add_dielectric( materials, value );
+        }
+    else
+        {
+            parse_error( p, "Unknown material '%s'.", type );
+            return false;
+        }
+
+    if( MATERIAL_ID_NONE == *id )
+        {
+            parse_error( p, "Out of memory for materials." );
+            return false;
+        }
+    return true;
+}
+
+// Parses the material of an object: `none`, the name of a material defined above, or an unnamed one written in place
+static bool
+parse_object_material( scene_parser * p, material_table * materials, material_id * mat )
+{
+    const char * name = next_token( p );
+    if( NULL == name )
+        {
+            parse_error( p, "Expected a material." );
+            return false;
+        }
+    if( 0 == strcmp( name, "none" ) )
+        {
+            *mat = MATERIAL_ID_NONE;
+            return true;
+        }
+
+    const named_material * entry = ( p->name_count > 0 ) ? find_name( p, name ) : NULL;
+    if( NULL == entry || NULL == entry->name ) return parse_material( p, name, materials, mat );
+    *mat = entry->id;
+    return true;
+}
+
+// Returns `file` resolved against the directory of the scene file, as a string to free, or NULL if memory ran out.
+// Absolute paths are kept as they are.
+static char *
+resolve_scene_path( const scene_parser * p, const char * file )
+{
+    const char * slash  = strrchr( p->path, '/' );
+    const size_t prefix = ( '/' == file[0] || NULL == slash ) ? 0 : (size_t)( slash - p->path ) + 1;
+    const size_t length = strlen( file );
+    char *       path   = (char *)malloc( prefix + length + 1 );
+    if( NULL == path ) return NULL;
+    memcpy( path, p->path, prefix );
+    memcpy( path + prefix, file, length + 1 );
+    return path;
+}
+
+// Returns the mesh of the OBJ file `file` for instances to share, loading it with no material on first use
+static const triangle_mesh *
+find_shared_mesh( scene_parser * p, arena * memory, const char * file )
+{
+    char * path = resolve_scene_path( p, file );
+    if( NULL == path )
+        {
+            parse_error( p, "Out of memory for the mesh path." );
+            return NULL;
+        }
+    for( size_t i = 0; i < p->mesh_count; ++i )
+        {
+            if( 0 == strcmp( p->meshes[i].path, path ) )
+                {
+                    free( path );
+                    return p->meshes[i].mesh;
+                }
+        }
+
+    if( p->mesh_count == p->mesh_capacity )
+        {
+            const size_t  capacity = ( 0 == p->mesh_capacity ) ? 8 : 2 * p->mesh_capacity;
+            shared_mesh * meshes   = (shared_mesh *)realloc( p->meshes, capacity * sizeof( shared_mesh ) );
+            if( NULL == meshes )
+                {
+                    parse_error( p, "Out of memory for meshes." );
+                    free( path );
+                    return NULL;
+                }
+            p->meshes        = meshes;
+            p->mesh_capacity = capacity;
+        }
+
+    triangle_mesh * mesh = triangle_mesh_load_obj( path, memory, MATERIAL_ID_NONE );
+    if( NULL == mesh )
+        {
+            parse_error( p, "Failed to load mesh '%s'.", file );
+            free( path );
+            return NULL;
+        }
+    p->meshes[p->mesh_count].path = path;
+    p->meshes[p->mesh_count].mesh = mesh;
+    p->mesh_count++;
+    return mesh;
+}
+
+// Parses one statement, the current line
+static bool
+parse_statement( scene_parser * p, const char * keyword, hittable_list * world, arena * memory,
+                 material_table * materials, scene_view * view )
+{
+    if( 0 == strcmp( keyword, "sphere" ) )
+        {
+            vec3        center;
+            double      radius;
+            material_id mat;
+            if( !parse_vec3( p, "the center", &center ) || !parse_real( p, "the radius", &radius ) ) return false;
+
+            if( !parse_object_material( p, materials, &mat ) ) return false;
+
+            sphere * s = ARENA_NEW( memory, sphere );
+            if( NULL == s )
+                {
+                    parse_error( p, "Out of memory for spheres." );
+                    return false;
+                }
+            sphere_init( s, center, radius, mat );
+            return parse_end( p ) && hittable_list_add( world, &s->base );
+        }
+
+    if( 0 == strcmp( keyword, "mesh" ) )
+        {
+            const char * file = next_token( p );
+            material_id  mat;
+            if( NULL == file )
+                {
+                    parse_error( p, "Expected the path of an OBJ file." );
+                    return false;
+                }
+            if( !parse_object_material( p, materials, &mat ) || !parse_end( p ) ) return false;
+
+            char * path = resolve_scene_path( p, file );
+            if( NULL == path )
+                {
+                    parse_error( p, "Out of memory for the mesh path." );
+                    return false;
+                }
+            triangle_mesh * mesh = triangle_mesh_load_obj( path, memory, mat );
+            free( path );
+            if( NULL == mesh )
+                {
+                    parse_error( p, "Failed to load mesh '%s'.", file );
+                    return false;
+                }
+            return hittable_list_add( world, &mesh->base );
+        }
+
+    if( 0 == strcmp( keyword, "instance" ) )
+        {
+            const char * file = next_token( p );
+            vec3         position, axis;
+            double       angle, scale;
+            material_id  mat;
+            if( NULL == file )
+                {
+                    parse_error( p, "Expected the path of an OBJ file." );
+                    return false;
+                }
+            if( !parse_vec3( p, "the position", &position ) || !parse_vec3( p, "the rotation axis", &axis )
+                || !parse_real( p, "the rotation angle", &angle ) || !parse_real( p, "the scale", &scale )
+                || !parse_object_material( p, materials, &mat ) || !parse_end( p ) )
+                return false;
+            if( !( vec3_length_squared( axis ) > 0.0 ) || !( scale > 0.0 ) )
+                {
+                    parse_error( p, "The rotation axis must not be zero and the scale must be positive." );
+                    return false;
+                }
+
+            const triangle_mesh * mesh = find_shared_mesh( p, memory, file );
+            if( NULL == mesh ) return false;
+
+            // Scaled, then rotated, then moved into place
+            const transform scaling  = transform_scale( vec3_new( scale, scale, scale ) );
+            const transform rotation = transform_rotate( axis, angle );
+            const transform moving   = transform_translate( position );
+            transform       placed   = transform_compose( &rotation, &scaling );
+            placed                   = transform_compose( &moving, &placed );
+
+            instance * inst = ARENA_NEW( memory, instance );
+            if( NULL == inst )
+                {
+                    parse_error( p, "Out of memory for instances." );
+                    return false;
+                }
+            if( !instance_init( inst, &mesh->base, &placed, mat ) )
+                {
+                    parse_error( p, "The instance's transform is singular." );
+                    return false;
+                }
+            return hittable_list_add( world, &inst->base );
+        }
+
+    if( 0 == strcmp( keyword, "material" ) )
+        {
+            const char * name = next_token( p );
+            const char * type = next_token( p );
+            material_id  id;
+            if( NULL == name || NULL == type )
+                {
+                    parse_error( p, "Expected a material name and type." );
+                    return false;
+                }
+            if( 0 == strcmp( name, "none" ) )
+                {
+                    parse_error( p, "'none' is reserved for objects without material." );
+                    return false;
+                }
+            if( !reserve_names( p ) ) return false;
+
+            named_material * entry = find_name( p, name );
+            if( NULL != entry->name )
+                {
+                    parse_error( p, "Material '%s' is already defined.", name );
+                    return false;
+                }
+            if( !parse_material( p, type, materials, &id ) ) return false;
+
+            entry->name  = name;
+            entry->id    = id;
+            p->name_count++;
+            return parse_end( p );
+        }
+
+    if( 0 == strcmp( keyword, "camera" ) )
+        {
+            return parse_vec3( p, "the camera position", &view->position )
+                && parse_vec3( p, "the camera target", &view->target ) && parse_vec3( p, "the up vector", &view->up )
+                && parse_real( p, "the vertical fov", &view->vertical_fov_deg )
+                && parse_real( p, "the aperture", &view->aperture )
+                && parse_real( p, "the focus distance", &view->focus_distance ) && parse_end( p );
+        }
+
+    if( 0 == strcmp( keyword, "aspect_ratio" ) )
+        {
+            if( !parse_real( p, keyword, &view->aspect_ratio ) ) return false;
+            if( !( view->aspect_ratio > 0.0 ) )
+                {
+                    parse_error( p, "The aspect ratio must be positive." );
+                    return false;
+                }
+            return parse_end( p );
+        }
+    if( 0 == strcmp( keyword, "image_width" ) ) return parse_count( p, keyword, &view->image_width ) && parse_end( p );
+    if( 0 == strcmp( keyword, "samples_per_pixel" ) )
+        return parse_count( p, keyword, &view->samples_per_pixel ) && parse_end( p );
+    if( 0 == strcmp( keyword, "max_depth" ) ) return parse_count( p, keyword, &view->max_depth ) && parse_end( p );
+    if( 0 == strcmp( keyword, "packet_size" ) )
+        {
+            if( !parse_count( p, keyword, &view->packet_size ) ) return false;
+            if( view->packet_size > CAMERA_MAX_PACKET_SIZE )
+                {
+                    parse_error( p, "Packets are at most %d rays wide.", CAMERA_MAX_PACKET_SIZE );
+                    return false;
+                }
+            return parse_end( p );
+        }
+
+    if( 0 == strcmp( keyword, "integrator" ) )
+        {
+            const char * name = next_token( p );
+            if( NULL == name || !camera_integrator_parse( name, &view->integrator ) )
+                {
+                    parse_error( p, "Expected recursive or wavefront for the integrator." );
+                    return false;
+                }
+            return parse_end( p );
+        }
+
+    if( 0 == strcmp( keyword, "roulette_min_depth" ) )
+        return parse_integer( p, keyword, 0, &view->roulette_min_depth ) && parse_end( p );
+
+    if( 0 == strcmp( keyword, "adaptive_threshold" ) )
+        {
+            if( !parse_real( p, keyword, &view->adaptive_threshold ) ) return false;
+            if( !( view->adaptive_threshold >= 0.0 ) || !isfinite( view->adaptive_threshold ) )
+                {
+                    parse_error( p, "The adaptive threshold must be 0 or positive." );
+                    return false;
+                }
+            return parse_end( p );
+        }
+    if( 0 == strcmp( keyword, "adaptive_min_samples" ) )
+        return parse_count( p, keyword, &view->adaptive_min_samples ) && parse_end( p );
+
+    if( 0 == strcmp( keyword, "sampler" ) )
+        {
+            const char * name = next_token( p );
+            if( NULL == name || !sampler_parse( name, &view->sampler ) )
+                {
+                    parse_error( p, "Expected random, stratified, sobol or bluenoise for the sampler." );
+                    return false;
+                }
+            return parse_end( p );
+        }
+
+    parse_error( p, "Unknown statement '%s'.", keyword );
+    return false;
+}
+
+// Reads the whole file at `path` into a NUL-terminated buffer
+static char *
+read_file( const char * path )
+{
+    FILE * file = fopen( path, "rb" );
+    if( NULL == file ) return NULL;
+
+    char * text = NULL;
+    long   size = -1;
+    if( 0 == fseek( file, 0, SEEK_END ) ) size = ftell( file );
+    if( size >= 0 && 0 == fseek( file, 0, SEEK_SET ) ) text = (char *)malloc( (size_t)size + 1 );
+    if( NULL != text )
+        {
+            if( (size_t)size == fread( text, 1, (size_t)size, file ) )
+                {
+                    text[size] = '\0';
+                }
+            else
+                {
+                    free( text );
+                    text = NULL;
+                }
+        }
+    fclose( file );
+    return text;
+}
+
+bool
+scene_file_load_text( const char * path, hittable_list * world, arena * memory, material_table * materials,
+                      camera * cam )
+{
+    char * text = read_file( path );
+    if( NULL == text )
+        {
+            fprintf( stderr, "ERROR: Failed to read scene '%s'.\n", path );
+            return false;
+        }
+
+    scene_parser p;
+    memset( &p, 0, sizeof( p ) );
+    p.path = path;
+
+    scene_view view = view_from_camera( cam );
+    bool       ok   = true;
+    for( char * line = text; ok && NULL != line; )
+        {
+            // Cut the line and its comment off the rest of the file
+            char * next = strchr( line, '\n' );
+            if( NULL != next ) *next++ = '\0';
+            char * comment = strchr( line, '#' );
+            if( NULL != comment ) *comment = '\0';
+
+            p.line   += 1;
+            p.cursor  = line;
+
+            const char * keyword = next_token( &p );
+            if( NULL != keyword ) ok = parse_statement( &p, keyword, world, memory, materials, &view );
+            line = next;
+        }
+
+    if( ok ) view_apply( &view, cam );
+    for( size_t i = 0; i < p.mesh_count; ++i )
+        {
+            free( p.meshes[i].path );
+        }
+    free( p.meshes );
+    free( p.names );
+    free( text );
+    return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Cached loading
+//----------------------------------------------------------------------------------------------------------------------
+bool
+scene_file_load( const char * path, hittable_list * world, arena * memory, material_table * materials, camera * cam )
+{
+    struct stat source;
+    if( 0 != stat( path, &source ) )
+        {
+            fprintf( stderr, "ERROR: Failed to read scene '%s'.\n", path );
+            return false;
+        }
+
+    const size_t length     = strlen( path );
+    const size_t ext_length = strlen( SCENE_FILE_CACHE_EXTENSION );
+    char *       cache_path = (char *)malloc( length + ext_length + 1 );
+    if( NULL == cache_path )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the scene path.\n" );
+            return false;
+        }
+    memcpy( cache_path, path, length );
+    memcpy( cache_path + length, SCENE_FILE_CACHE_EXTENSION, ext_length + 1 );
+
+    // A cache compiled from the file as it is now
+    file_map map;
+    if( map_file( cache_path, &map ) )
+        {
+            const scene_cache_header * header = cache_header( &map );
+            if( NULL != header && header->source_size == (uint64_t)source.st_size
+                && header->source_mtime == (int64_t)source.st_mtime )
+                {
+                    const bool ok = cache_load( cache_path, header, world, memory, materials, cam );
+                    unmap_file( &map );
+                    free( cache_path );
+                    return ok;
+                }
+            unmap_file( &map );
+        }
+
+    // Meshes and instances are not cached, so scenes that hold any are parsed every time
+    bool ok = scene_file_load_text( path, world, memory, materials, cam );
+    if( ok && only_spheres( world ) && !scene_file_save_binary( cache_path, world, materials, cam, path ) )
+        {
+            fprintf( stderr, "WARN: Scene '%s' was loaded but its cache could not be written.\n", path );
+        }
+    free( cache_path );
+    return ok;
+}
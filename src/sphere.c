@@ -1,39 +1,44 @@
 #include "sphere.h"
 #include "material.h"
+#include "stats.h"
 
 void
-sphere_init( sphere * s, point3 center_val, double radius_val, material * mat )
+sphere_init( sphere * s, point3 center_val, rt_real radius_val, material_id mat )
 {
     if( !s ) return;
-    s->base.hit     = sphere_hit_function; // Assign the sphere's hit function
-    s->base.mat_ptr = mat;                 // Assign material
-    s->center       = center_val;
-    s->radius       = radius_val;
+    s->base.hit         = sphere_hit_function; // Assign the sphere's hit function
+    s->base.material_id = mat;                 // Assign material
+    s->center           = center_val;
+    s->radius           = radius_val;
+
+    vec3 rvec           = vec3_new( radius_val, radius_val, radius_val );
+    s->base.bbox        = aabb_from_points( vec3_sub( center_val, rvec ), vec3_add( center_val, rvec ) );
 }
 
 bool
-sphere_hit_function( const hittable * object, const ray * r, double ray_tmin, double ray_tmax, hit_record * rec )
+sphere_hit_function( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
 {
-    const sphere * s       = (const sphere *)object;
+    const sphere * s        = (const sphere *)object;
+    STATS_INC( STATS_SPHERE_TESTS );
 
     // Get ray properties
-    point3 r_origin_val    = ray_origin( r );
-    vec3   r_direction_val = ray_direction( r );
+    point3  r_origin_val    = ray_origin( r );
+    vec3    r_direction_val = ray_direction( r );
 
-    vec3   oc              = vec3_sub( r_origin_val, s->center );
-    double a               = vec3_length_squared( r_direction_val );
-    double h               = vec3_dot( oc, r_direction_val );
-    double c               = vec3_length_squared( oc ) - ( s->radius * s->radius );
+    vec3    oc              = vec3_sub( r_origin_val, s->center );
+    rt_real a               = vec3_length_squared( r_direction_val );
+    rt_real h               = vec3_dot( oc, r_direction_val );
+    rt_real c               = vec3_length_squared( oc ) - ( s->radius * s->radius );
 
-    double discriminant    = h * h - a * c;
-    if( discriminant < 0.0 )
+    rt_real discriminant    = h * h - a * c;
+    if( discriminant < RT_REAL( 0 ) )
         {
             return false;
         }
-    double sqrtd = sqrt( discriminant );
+    rt_real sqrtd = rt_sqrt( discriminant );
 
     // Find the nearest root that lies in the acceptable range [ray_tmin, ray_tmax]
-    double root  = ( -h - sqrtd ) / a;
+    rt_real root  = ( -h - sqrtd ) / a;
     if( root <= ray_tmin || ray_tmax <= root )
         {
             root = ( -h + sqrtd ) / a;
@@ -46,7 +51,7 @@ sphere_hit_function( const hittable * object, const ray * r, double ray_tmin, do
     // Intersection found, populate the hit_record
     rec->t              = root;
     rec->p              = ray_at( r, rec->t );
-    rec->mat_ptr        = s->base.mat_ptr; // Assign material
+    rec->material_id    = s->base.material_id; // Assign material
 
     // Calculate the normal
     vec3 outward_normal = vec3_div( vec3_sub( rec->p, s->center ), s->radius );
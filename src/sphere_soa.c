@@ -0,0 +1,496 @@
+#define _POSIX_C_SOURCE 200809L /* posix_memalign */
+
+#include "sphere_soa.h"
+#include "bvh.h"
+#include "sphere.h"
+#include "stats.h"
+#include <math.h>   /* sqrt, NAN */
+#include <stdio.h>
+#include <stdlib.h> /* posix_memalign, realloc, free */
+#include <string.h> /* memcpy */
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#    define SPHERE_SOA_X86 1
+#    include <immintrin.h>
+#else
+#    define SPHERE_SOA_X86 0
+#endif
+
+#if SPHERE_SOA_X86
+// The SIMD kernels are written once for rt_real: SSE( add ) is _mm_add_pd or _mm_add_ps, AVX( add ) is
+// _mm256_add_pd or _mm256_add_ps
+#    ifdef RT_USE_FLOAT
+#        define SSE( op ) _mm_##op##_ps
+#        define AVX( op ) _mm256_##op##_ps
+typedef __m128 sse_real;
+typedef __m256 avx_real;
+#    else
+#        define SSE( op ) _mm_##op##_pd
+#        define AVX( op ) _mm256_##op##_pd
+typedef __m128d sse_real;
+typedef __m256d avx_real;
+#    endif
+#    define SSE_LANES (int)( sizeof( sse_real ) / sizeof( rt_real ) )
+#    define AVX_LANES (int)( sizeof( avx_real ) / sizeof( rt_real ) )
+
+// Index of every lane, loaded as the first lane indices of a kernel
+static const rt_real lane_offsets[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+#endif
+
+// Closest-hit kernel: finds the nearest sphere hit in (ray_tmin, ray_tmax).
+// On a hit, `t_hit` receives the distance and `index` the sphere index.
+typedef bool ( *closest_fn )( const sphere_soa * set, const ray * r, rt_real ray_tmin, rt_real ray_tmax,
+                              rt_real * t_hit, size_t * index );
+
+//----------------------------------------------------------------------------------------------------------------------
+// Storage
+//----------------------------------------------------------------------------------------------------------------------
+// Grows `array` to `new_capacity` aligned entries, copying `count` entries and NaN-filling the rest.
+// NaN lanes fail every ordered comparison, so padding never produces a hit.
+static bool
+grow_lane_array( rt_real ** array, size_t count, size_t new_capacity )
+{
+    void * mem = NULL;
+    if( 0 != posix_memalign( &mem, 32, new_capacity * sizeof( rt_real ) ) ) return false;
+
+    rt_real * grown = (rt_real *)mem;
+    if( count > 0 ) memcpy( grown, *array, count * sizeof( rt_real ) );
+    for( size_t i = count; i < new_capacity; ++i )
+        {
+            grown[i] = NAN;
+        }
+
+    free( *array );
+    *array = grown;
+    return true;
+}
+
+static bool
+reserve( sphere_soa * set, size_t wanted )
+{
+    if( wanted <= set->capacity ) return true;
+
+    size_t new_capacity = ( set->capacity > 0 ) ? set->capacity * 2 : SPHERE_SOA_BLOCK;
+    if( new_capacity < wanted ) new_capacity = wanted;
+    new_capacity = ( new_capacity + SPHERE_SOA_BLOCK - 1 ) / SPHERE_SOA_BLOCK * SPHERE_SOA_BLOCK;
+
+    material_id * ids = (material_id *)realloc( set->material_id, new_capacity * sizeof( material_id ) );
+    if( NULL == ids ) return false;
+    set->material_id = ids;
+
+    if( !grow_lane_array( &set->center_x, set->count, new_capacity )
+        || !grow_lane_array( &set->center_y, set->count, new_capacity )
+        || !grow_lane_array( &set->center_z, set->count, new_capacity )
+        || !grow_lane_array( &set->radius, set->count, new_capacity ) )
+        {
+            // Arrays that did grow keep their old contents, so the set stays consistent at the old capacity
+            return false;
+        }
+
+    set->capacity = new_capacity;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Kernels
+//----------------------------------------------------------------------------------------------------------------------
+// Same arithmetic, in the same order, as sphere_hit_function, so every kernel returns identical hits
+static bool
+closest_scalar( const sphere_soa * set, const ray * r, rt_real ray_tmin, rt_real ray_tmax, rt_real * t_hit,
+                size_t * index )
+{
+    const vec3    o       = r->orig;
+    const vec3    d       = r->dir;
+    const rt_real a       = vec3_length_squared( d );
+    rt_real       closest = ray_tmax;
+    bool          hit     = false;
+
+    for( size_t i = 0; i < set->count; ++i )
+        {
+            rt_real ocx  = o.x - set->center_x[i];
+            rt_real ocy  = o.y - set->center_y[i];
+            rt_real ocz  = o.z - set->center_z[i];
+            rt_real h    = ocx * d.x + ocy * d.y + ocz * d.z;
+            rt_real c    = ( ocx * ocx + ocy * ocy + ocz * ocz ) - set->radius[i] * set->radius[i];
+            rt_real disc = h * h - a * c;
+            if( !( disc >= RT_REAL( 0 ) ) ) continue;
+
+            rt_real sqrtd = rt_sqrt( disc );
+            rt_real root  = ( -h - sqrtd ) / a;
+            if( !( root > ray_tmin && root < closest ) )
+                {
+                    root = ( -h + sqrtd ) / a;
+                    if( !( root > ray_tmin && root < closest ) ) continue;
+                }
+
+            closest = root;
+            *index  = i;
+            hit     = true;
+        }
+
+    *t_hit = closest;
+    return hit;
+}
+
+#if SPHERE_SOA_X86
+// Picks the closest of the per-lane candidates. Ties go to the lowest sphere index, like the scalar loop.
+static bool
+reduce_lanes( const rt_real * lane_t, const rt_real * lane_index, int lanes, rt_real * t_hit, size_t * index )
+{
+    bool    found  = false;
+    rt_real best_t = 0;
+    rt_real best_i = 0;
+
+    for( int l = 0; l < lanes; ++l )
+        {
+            if( lane_index[l] < 0 ) continue;
+            if( !found || lane_t[l] < best_t || ( lane_t[l] == best_t && lane_index[l] < best_i ) )
+                {
+                    found  = true;
+                    best_t = lane_t[l];
+                    best_i = lane_index[l];
+                }
+        }
+
+    if( found )
+        {
+            *t_hit = best_t;
+            *index = (size_t)best_i;
+        }
+    return found;
+}
+
+// SSE2 has no blend instruction
+__attribute__( ( target( "sse2" ) ) ) static inline sse_real
+sse2_select( sse_real mask, sse_real a, sse_real b )
+{
+    return SSE( or )( SSE( and )( mask, a ), SSE( andnot )( mask, b ) );
+}
+
+__attribute__( ( target( "sse2" ) ) ) static bool
+closest_sse2( const sphere_soa * set, const ray * r, rt_real ray_tmin, rt_real ray_tmax, rt_real * t_hit,
+              size_t * index )
+{
+    const sse_real ox     = SSE( set1 )( r->orig.x );
+    const sse_real oy     = SSE( set1 )( r->orig.y );
+    const sse_real oz     = SSE( set1 )( r->orig.z );
+    const sse_real dx     = SSE( set1 )( r->dir.x );
+    const sse_real dy     = SSE( set1 )( r->dir.y );
+    const sse_real dz     = SSE( set1 )( r->dir.z );
+    const sse_real a      = SSE( set1 )( vec3_length_squared( r->dir ) );
+    const sse_real tmin   = SSE( set1 )( ray_tmin );
+    const sse_real zero   = SSE( setzero )();
+    const sse_real sign   = SSE( set1 )( RT_REAL( -0.0 ) );
+    const sse_real step   = SSE( set1 )( RT_REAL( SSE_LANES ) );
+    sse_real       best_t = SSE( set1 )( ray_tmax );
+    sse_real       best_i = SSE( set1 )( RT_REAL( -1 ) );
+    sse_real       lane_i = SSE( loadu )( lane_offsets );
+
+    for( size_t i = 0; i < set->count; i += SSE_LANES, lane_i = SSE( add )( lane_i, step ) )
+        {
+            sse_real ocx  = SSE( sub )( ox, SSE( load )( set->center_x + i ) );
+            sse_real ocy  = SSE( sub )( oy, SSE( load )( set->center_y + i ) );
+            sse_real ocz  = SSE( sub )( oz, SSE( load )( set->center_z + i ) );
+            sse_real rad  = SSE( load )( set->radius + i );
+            sse_real h    = SSE( add )( SSE( add )( SSE( mul )( ocx, dx ), SSE( mul )( ocy, dy ) ),
+                                        SSE( mul )( ocz, dz ) );
+            sse_real len2 = SSE( add )( SSE( add )( SSE( mul )( ocx, ocx ), SSE( mul )( ocy, ocy ) ),
+                                        SSE( mul )( ocz, ocz ) );
+            sse_real c    = SSE( sub )( len2, SSE( mul )( rad, rad ) );
+            sse_real disc = SSE( sub )( SSE( mul )( h, h ), SSE( mul )( a, c ) );
+            sse_real real = SSE( cmpge )( disc, zero );
+            if( 0 == SSE( movemask )( real ) ) continue;
+
+            sse_real sqrtd = SSE( sqrt )( disc );
+            sse_real neg_h = SSE( xor )( h, sign );
+            sse_real t0    = SSE( div )( SSE( sub )( neg_h, sqrtd ), a );
+            sse_real t1    = SSE( div )( SSE( add )( neg_h, sqrtd ), a );
+            sse_real ok0   = SSE( and )( SSE( cmpgt )( t0, tmin ), SSE( cmplt )( t0, best_t ) );
+            sse_real ok1   = SSE( and )( SSE( cmpgt )( t1, tmin ), SSE( cmplt )( t1, best_t ) );
+            sse_real ok    = SSE( or )( ok0, ok1 );
+
+            best_t         = sse2_select( ok, sse2_select( ok0, t0, t1 ), best_t );
+            best_i         = sse2_select( ok, lane_i, best_i );
+        }
+
+    rt_real lane_t[SSE_LANES], lane_index[SSE_LANES];
+    SSE( storeu )( lane_t, best_t );
+    SSE( storeu )( lane_index, best_i );
+    return reduce_lanes( lane_t, lane_index, SSE_LANES, t_hit, index );
+}
+
+__attribute__( ( target( "avx2" ) ) ) static bool
+closest_avx2( const sphere_soa * set, const ray * r, rt_real ray_tmin, rt_real ray_tmax, rt_real * t_hit,
+              size_t * index )
+{
+    const avx_real ox     = AVX( set1 )( r->orig.x );
+    const avx_real oy     = AVX( set1 )( r->orig.y );
+    const avx_real oz     = AVX( set1 )( r->orig.z );
+    const avx_real dx     = AVX( set1 )( r->dir.x );
+    const avx_real dy     = AVX( set1 )( r->dir.y );
+    const avx_real dz     = AVX( set1 )( r->dir.z );
+    const avx_real a      = AVX( set1 )( vec3_length_squared( r->dir ) );
+    const avx_real tmin   = AVX( set1 )( ray_tmin );
+    const avx_real zero   = AVX( setzero )();
+    const avx_real sign   = AVX( set1 )( RT_REAL( -0.0 ) );
+    const avx_real step   = AVX( set1 )( RT_REAL( AVX_LANES ) );
+    avx_real       best_t = AVX( set1 )( ray_tmax );
+    avx_real       best_i = AVX( set1 )( RT_REAL( -1 ) );
+    avx_real       lane_i = AVX( loadu )( lane_offsets );
+
+    for( size_t i = 0; i < set->count; i += AVX_LANES, lane_i = AVX( add )( lane_i, step ) )
+        {
+            avx_real ocx  = AVX( sub )( ox, AVX( load )( set->center_x + i ) );
+            avx_real ocy  = AVX( sub )( oy, AVX( load )( set->center_y + i ) );
+            avx_real ocz  = AVX( sub )( oz, AVX( load )( set->center_z + i ) );
+            avx_real rad  = AVX( load )( set->radius + i );
+            avx_real h    = AVX( add )( AVX( add )( AVX( mul )( ocx, dx ), AVX( mul )( ocy, dy ) ),
+                                        AVX( mul )( ocz, dz ) );
+            avx_real len2 = AVX( add )( AVX( add )( AVX( mul )( ocx, ocx ), AVX( mul )( ocy, ocy ) ),
+                                        AVX( mul )( ocz, ocz ) );
+            avx_real c    = AVX( sub )( len2, AVX( mul )( rad, rad ) );
+            avx_real disc = AVX( sub )( AVX( mul )( h, h ), AVX( mul )( a, c ) );
+            avx_real real = AVX( cmp )( disc, zero, _CMP_GE_OQ );
+            if( 0 == AVX( movemask )( real ) ) continue;
+
+            avx_real sqrtd = AVX( sqrt )( disc );
+            avx_real neg_h = AVX( xor )( h, sign );
+            avx_real t0    = AVX( div )( AVX( sub )( neg_h, sqrtd ), a );
+            avx_real t1    = AVX( div )( AVX( add )( neg_h, sqrtd ), a );
+            avx_real ok0   = AVX( and )( AVX( cmp )( t0, tmin, _CMP_GT_OQ ), AVX( cmp )( t0, best_t, _CMP_LT_OQ ) );
+            avx_real ok1   = AVX( and )( AVX( cmp )( t1, tmin, _CMP_GT_OQ ), AVX( cmp )( t1, best_t, _CMP_LT_OQ ) );
+            avx_real ok    = AVX( or )( ok0, ok1 );
+
+            best_t         = AVX( blendv )( best_t, AVX( blendv )( t1, t0, ok0 ), ok );
+            best_i         = AVX( blendv )( best_i, lane_i, ok );
+        }
+
+    rt_real lane_t[AVX_LANES], lane_index[AVX_LANES];
+    AVX( storeu )( lane_t, best_t );
+    AVX( storeu )( lane_index, best_i );
+    return reduce_lanes( lane_t, lane_index, AVX_LANES, t_hit, index );
+}
+#endif // SPHERE_SOA_X86
+
+static const closest_fn kernels[SPHERE_SOA_KERNEL_COUNT] = {
+    closest_scalar,
+#if SPHERE_SOA_X86
+    closest_sse2,
+    closest_avx2,
+#else
+    closest_scalar,
+    closest_scalar,
+#endif
+};
+
+bool
+sphere_soa_kernel_supported( sphere_soa_kernel kernel )
+{
+    switch( kernel )
+        {
+        case SPHERE_SOA_KERNEL_SCALAR: return true;
+#if SPHERE_SOA_X86
+        case SPHERE_SOA_KERNEL_SSE2: __builtin_cpu_init(); return __builtin_cpu_supports( "sse2" );
+        case SPHERE_SOA_KERNEL_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports( "avx2" );
+#endif
+        default: return false;
+        }
+}
+
+sphere_soa_kernel
+sphere_soa_best_kernel( void )
+{
+    if( sphere_soa_kernel_supported( SPHERE_SOA_KERNEL_AVX2 ) ) return SPHERE_SOA_KERNEL_AVX2;
+    if( sphere_soa_kernel_supported( SPHERE_SOA_KERNEL_SSE2 ) ) return SPHERE_SOA_KERNEL_SSE2;
+    return SPHERE_SOA_KERNEL_SCALAR;
+}
+
+const char *
+sphere_soa_kernel_name( sphere_soa_kernel kernel )
+{
+    switch( kernel )
+        {
+        case SPHERE_SOA_KERNEL_SCALAR: return "scalar";
+        case SPHERE_SOA_KERNEL_SSE2: return "sse2";
+        case SPHERE_SOA_KERNEL_AVX2: return "avx2";
+        default: return "unknown";
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Public interface
+//----------------------------------------------------------------------------------------------------------------------
+void
+sphere_soa_init( sphere_soa * set, size_t initial_capacity )
+{
+    if( NULL == set ) return;
+
+    set->base.hit         = sphere_soa_hit;
+    set->base.material_id = MATERIAL_ID_NONE;
+    set->base.bbox        = aabb_empty();
+    set->center_x         = NULL;
+    set->center_y         = NULL;
+    set->center_z         = NULL;
+    set->radius           = NULL;
+    set->material_id      = NULL;
+    set->count            = 0;
+    set->capacity         = 0;
+    set->kernel           = sphere_soa_best_kernel();
+
+    if( initial_capacity > 0 && !reserve( set, initial_capacity ) )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for sphere_soa arrays.\n" );
+        }
+}
+
+void
+sphere_soa_clear( sphere_soa * set )
+{
+    if( NULL == set ) return;
+
+    free( set->center_x );
+    free( set->center_y );
+    free( set->center_z );
+    free( set->radius );
+    free( set->material_id );
+
+    sphere_soa_kernel kernel = set->kernel;
+    sphere_soa_init( set, 0 );
+    set->kernel = kernel;
+}
+
+bool
+sphere_soa_add( sphere_soa * set, point3 center, rt_real radius, material_id mat )
+{
+    if( NULL == set ) return false;
+
+    if( !reserve( set, set->count + 1 ) )
+        {
+            fprintf( stderr, "ERROR: Failed to reallocate memory for sphere_soa arrays.\n" );
+            return false;
+        }
+
+    size_t i            = set->count++;
+    set->center_x[i]    = center.x;
+    set->center_y[i]    = center.y;
+    set->center_z[i]    = center.z;
+    set->radius[i]      = radius;
+    set->material_id[i] = mat;
+
+    vec3 rvec           = vec3_new( radius, radius, radius );
+    aabb box            = aabb_from_points( vec3_sub( center, rvec ), vec3_add( center, rvec ) );
+    set->base.bbox      = aabb_union( set->base.bbox, box );
+    return true;
+}
+
+bool
+sphere_soa_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
+{
+    const sphere_soa * set = (const sphere_soa *)object;
+    rt_real            t;
+    size_t             i;
+
+    STATS_ADD( STATS_SPHERE_TESTS, set->count );
+    if( 0 == set->count || !kernels[set->kernel]( set, r, ray_tmin, ray_tmax, &t, &i ) ) return false;
+
+    // Only the winning sphere pays for the hit record
+    point3 center       = vec3_new( set->center_x[i], set->center_y[i], set->center_z[i] );
+    rec->t              = t;
+    rec->p              = ray_at( r, t );
+    rec->material_id    = set->material_id[i];
+
+    vec3 outward_normal = vec3_div( vec3_sub( rec->p, center ), set->radius[i] );
+    hit_record_set_face_normal( rec, r, &outward_normal );
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Clustering
+//----------------------------------------------------------------------------------------------------------------------
+static size_t
+subtree_size( const hittable * object )
+{
+    if( NULL == object ) return 0;
+    if( bvh_node_hit != object->hit ) return 1;
+
+    const bvh_node * node = (const bvh_node *)object;
+    return subtree_size( node->left ) + subtree_size( node->right );
+}
+
+// Appends the spheres below `object` to `group`; anything else goes to `groups` unchanged
+static bool
+collect_spheres( const hittable * object, sphere_soa * group, hittable_list * groups )
+{
+    if( NULL == object ) return true;
+
+    if( bvh_node_hit == object->hit )
+        {
+            const bvh_node * node = (const bvh_node *)object;
+            return collect_spheres( node->left, group, groups ) && collect_spheres( node->right, group, groups );
+        }
+
+    if( sphere_hit_function != object->hit ) return hittable_list_add( groups, (hittable *)object );
+
+    const sphere * s = (const sphere *)object;
+    return sphere_soa_add( group, s->center, s->radius, s->base.material_id );
+}
+
+// Emits one group for every maximal subtree holding at most `group_size` objects
+static bool
+cluster_subtree( const hittable * object, size_t group_size, hittable_list * groups )
+{
+    if( subtree_size( object ) > group_size )
+        {
+            const bvh_node * node = (const bvh_node *)object;
+            return cluster_subtree( node->left, group_size, groups )
+                && cluster_subtree( node->right, group_size, groups );
+        }
+
+    sphere_soa * group = (sphere_soa *)malloc( sizeof( sphere_soa ) );
+    if( NULL == group ) return false;
+    sphere_soa_init( group, group_size );
+
+    bool ok = collect_spheres( object, group, groups );
+    if( ok && group->count > 0 ) return hittable_list_add( groups, (hittable *)group );
+
+    sphere_soa_clear( group );
+    free( group );
+    return ok;
+}
+
+bool
+sphere_soa_cluster( const hittable_list * spheres, size_t group_size, hittable_list * groups )
+{
+    if( NULL == spheres || NULL == groups || 0 == group_size ) return false;
+    if( 0 == spheres->count ) return true;
+
+    hittable * tree = bvh_node_build( spheres );
+    if( NULL == tree ) return false;
+
+    bool ok = cluster_subtree( tree, group_size, groups );
+    bvh_node_free( tree );
+
+    if( !ok ) fprintf( stderr, "ERROR: Failed to allocate memory for sphere_soa groups.\n" );
+    return ok;
+}
+
+void
+sphere_soa_cluster_free( hittable_list * groups )
+{
+    if( NULL == groups ) return;
+
+    // Free the groups here; hittable_list_clear only releases the array
+    for( size_t i = 0; i < groups->count; ++i )
+        {
+            hittable * object = groups->objects[i];
+            if( NULL != object && sphere_soa_hit == object->hit )
+                {
+                    sphere_soa_clear( (sphere_soa *)object );
+                    free( object );
+                }
+            groups->objects[i] = NULL;
+        }
+
+    hittable_list_clear( groups );
+}
@@ -0,0 +1,157 @@
+#include "stats.h"
+
+#ifdef ENABLE_STATS
+
+#include "rtweekend.h"
+#include <pthread.h>
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* calloc, free */
+#include <string.h> /* memset */
+
+STATS_THREAD_LOCAL render_stats stats_local;
+STATS_THREAD_LOCAL uint32_t     stats_pixel;
+
+uint32_t * stats_heatmap      = NULL;
+uint32_t   stats_heatmap_size = 0;
+
+static render_stats    totals;
+static pthread_mutex_t totals_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char * counter_names[STATS_COUNTER_COUNT] = {
+    "Rays traced",         "hittable_list_hit calls", "Object hit calls",        "BVH nodes visited",
+    "Sphere tests",        "Triangle tests",          "Lambertian scatters",     "Metal scatters",
+    "Dielectric scatters", "Paths escaped",           "Paths absorbed",          "Paths ended by roulette",
+    "Paths at the bounce limit",
+};
+
+void
+stats_flush( void )
+{
+    pthread_mutex_lock( &totals_lock );
+    for( int c = 0; c < STATS_COUNTER_COUNT; ++c )
+        {
+            totals.counters[c] += stats_local.counters[c];
+        }
+    for( int d = 0; d < STATS_DEPTH_BINS; ++d )
+        {
+            totals.depth[d] += stats_local.depth[d];
+        }
+    pthread_mutex_unlock( &totals_lock );
+
+    memset( &stats_local, 0, sizeof( stats_local ) );
+}
+
+void
+stats_reset( void )
+{
+    pthread_mutex_lock( &totals_lock );
+    memset( &totals, 0, sizeof( totals ) );
+    pthread_mutex_unlock( &totals_lock );
+
+    memset( &stats_local, 0, sizeof( stats_local ) );
+}
+
+void
+stats_get( render_stats * out )
+{
+    stats_flush();
+
+    pthread_mutex_lock( &totals_lock );
+    *out = totals;
+    pthread_mutex_unlock( &totals_lock );
+}
+
+void
+stats_print( void )
+{
+    render_stats stats;
+    stats_get( &stats );
+
+    const uint64_t rays  = stats.counters[STATS_RAYS];
+    uint64_t       paths = 0;
+    int            last  = 0; // Last non-empty depth bin
+    for( int d = 0; d < STATS_DEPTH_BINS; ++d )
+        {
+            paths += stats.depth[d];
+            if( stats.depth[d] > 0 ) last = d;
+        }
+
+    printf( "Render statistics:\n" );
+    for( int c = 0; c < STATS_COUNTER_COUNT; ++c )
+        {
+            printf( "  %-26s %16llu", counter_names[c], (unsigned long long)stats.counters[c] );
+            if( c > STATS_RAYS && c < STATS_ESCAPED && rays > 0 )
+                {
+                    printf( "  (%.2f per ray)", (double)stats.counters[c] / (double)rays );
+                }
+            else if( c >= STATS_ESCAPED && paths > 0 )
+                {
+                    printf( "  (%.1f%%)", 100.0 * (double)stats.counters[c] / (double)paths );
+                }
+            printf( "\n" );
+        }
+
+    if( 0 == paths ) return;
+    printf( "  Path length histogram (bounces: paths):\n" );
+    for( int d = 0; d <= last; ++d )
+        {
+            printf( "  %4d%s %16llu  (%.1f%%)\n", d, d == STATS_DEPTH_BINS - 1 ? "+" : ":",
+                    (unsigned long long)stats.depth[d], 100.0 * (double)stats.depth[d] / (double)paths );
+        }
+}
+
+bool
+stats_heatmap_begin( int width, int height )
+{
+    stats_heatmap_end();
+    if( width <= 0 || height <= 0 ) return false;
+
+    stats_heatmap = (uint32_t *)calloc( (size_t)width * height, sizeof( uint32_t ) );
+    if( NULL == stats_heatmap )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the cost heatmap.\n" );
+            return false;
+        }
+    stats_heatmap_size = (uint32_t)width * (uint32_t)height;
+    return true;
+}
+
+void
+stats_heatmap_resolve( unsigned char * image_data )
+{
+    // Ramp stops, evenly spaced from the cheapest to the most expensive pixel
+    static const double ramp[][3] = {
+        { 0.0, 0.0, 0.0 }, { 0.5, 0.0, 0.5 }, { 1.0, 0.0, 0.0 }, { 1.0, 1.0, 0.0 }, { 1.0, 1.0, 1.0 },
+    };
+    const int stops = (int)( sizeof( ramp ) / sizeof( ramp[0] ) );
+
+    if( NULL == stats_heatmap ) return;
+
+    uint32_t max_cost = 1;
+    for( uint32_t p = 0; p < stats_heatmap_size; ++p )
+        {
+            max_cost = RT_MAX( max_cost, stats_heatmap[p] );
+        }
+
+    for( uint32_t p = 0; p < stats_heatmap_size; ++p )
+        {
+            const double x = (double)stats_heatmap[p] / max_cost * ( stops - 1 );
+            const int    k = RT_MIN( (int)x, stops - 2 );
+            const double f = x - k;
+            for( int c = 0; c < 3; ++c )
+                {
+                    const double v                          = ramp[k][c] + ( ramp[k + 1][c] - ramp[k][c] ) * f;
+                    image_data[p * RT_IMAGE_DATA_CHANNELS + c] = (unsigned char)( 255.999 * v );
+                }
+        }
+}
+
+void
+stats_heatmap_end( void )
+{
+    free( stats_heatmap );
+    stats_heatmap      = NULL;
+    stats_heatmap_size = 0;
+}
+
+#endif // ENABLE_STATS
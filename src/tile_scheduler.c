@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 200809L /* sysconf */
+
+#include "tile_scheduler.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h> /* malloc, free */
+#include <unistd.h> /* sysconf */
+
+// Per-worker double-ended queue over a contiguous range of tile indices.
+// The owner pops from the bottom, thieves steal from the top.
+typedef struct
+{
+    pthread_mutex_t lock;
+    int             top;    // Next tile to steal
+    int             bottom; // One past the next tile to pop
+} tile_deque;
+
+// State shared by every worker of a single tile_scheduler_run call
+typedef struct
+{
+    tile_deque *     deques;
+    int              thread_count;
+    int              tile_count;
+    tile_job_fn      job;
+    tile_progress_fn progress;
+    void *           user;
+
+    pthread_mutex_t progress_lock;
+    int             tiles_done;
+} tile_pool;
+
+typedef struct
+{
+    tile_pool * pool;
+    int         index;
+} tile_worker;
+
+static bool
+tile_deque_pop( tile_deque * dq, int * tile )
+{
+    bool found = false;
+    pthread_mutex_lock( &dq->lock );
+    if( dq->bottom > dq->top )
+        {
+            *tile = --dq->bottom;
+            found = true;
+        }
+    pthread_mutex_unlock( &dq->lock );
+    return found;
+}
+
+static bool
+tile_deque_steal( tile_deque * dq, int * tile )
+{
+    bool found = false;
+    pthread_mutex_lock( &dq->lock );
+    if( dq->bottom > dq->top )
+        {
+            *tile = dq->top++;
+            found = true;
+        }
+    pthread_mutex_unlock( &dq->lock );
+    return found;
+}
+
+// Fetches the next tile for `worker`: own deque first, then the other workers' in round-robin order.
+// No work is ever added after start-up, so a full unsuccessful sweep means the pool is drained.
+static bool
+tile_worker_next( const tile_worker * worker, int * tile )
+{
+    tile_pool * pool = worker->pool;
+
+    if( tile_deque_pop( &pool->deques[worker->index], tile ) ) return true;
+
+    for( int i = 1; i < pool->thread_count; ++i )
+        {
+            int victim = ( worker->index + i ) % pool->thread_count;
+            if( tile_deque_steal( &pool->deques[victim], tile ) ) return true;
+        }
+
+    return false;
+}
+
+static void *
+tile_worker_main( void * arg )
+{
+    const tile_worker * worker = (const tile_worker *)arg;
+    tile_pool *         pool   = worker->pool;
+    int                 tile;
+
+    while( tile_worker_next( worker, &tile ) )
+        {
+            pool->job( pool->user, tile, worker->index );
+
+            pthread_mutex_lock( &pool->progress_lock );
+            ++pool->tiles_done;
+            if( pool->progress ) pool->progress( pool->user, pool->tiles_done, pool->tile_count );
+            pthread_mutex_unlock( &pool->progress_lock );
+        }
+
+    return NULL;
+}
+
+int
+tile_scheduler_hardware_threads( void )
+{
+    long count = sysconf( _SC_NPROCESSORS_ONLN );
+    return ( count > 0 ) ? (int)count : 1;
+}
+
+bool
+tile_scheduler_run( int thread_count, int tile_count, tile_job_fn job, tile_progress_fn progress, void * user )
+{
+    if( NULL == job ) return false;
+    if( tile_count <= 0 ) return true;
+
+    if( thread_count <= 0 ) thread_count = tile_scheduler_hardware_threads();
+    if( thread_count > tile_count ) thread_count = tile_count;
+
+    tile_pool pool    = { 0 };
+    pool.thread_count = thread_count;
+    pool.tile_count   = tile_count;
+    pool.job          = job;
+    pool.progress     = progress;
+    pool.user         = user;
+
+    tile_worker * workers = (tile_worker *)malloc( thread_count * sizeof( tile_worker ) );
+    pthread_t *   threads = (pthread_t *)malloc( thread_count * sizeof( pthread_t ) );
+    pool.deques           = (tile_deque *)malloc( thread_count * sizeof( tile_deque ) );
+
+    if( NULL == workers || NULL == threads || NULL == pool.deques )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the tile scheduler.\n" );
+            free( workers );
+            free( threads );
+            free( pool.deques );
+            return false;
+        }
+
+    // Deal tiles out in contiguous blocks so neighbouring tiles stay on the same worker until stolen
+    for( int w = 0; w < thread_count; ++w )
+        {
+            tile_deque * dq = &pool.deques[w];
+            pthread_mutex_init( &dq->lock, NULL );
+            dq->top    = (int)( (long long)tile_count * w / thread_count );
+            dq->bottom = (int)( (long long)tile_count * ( w + 1 ) / thread_count );
+
+            workers[w].pool  = &pool;
+            workers[w].index = w;
+        }
+    pthread_mutex_init( &pool.progress_lock, NULL );
+
+    // The calling thread acts as worker 0. Workers that fail to spawn simply get their tiles stolen,
+    // since every running worker sweeps all deques before giving up.
+    int spawned = 1;
+    for( int w = 1; w < thread_count; ++w )
+        {
+            if( 0 != pthread_create( &threads[w], NULL, tile_worker_main, &workers[w] ) )
+                {
+                    fprintf( stderr, "WARN: Failed to spawn render worker %d, continuing with %d.\n", w, spawned );
+                    break;
+                }
+            ++spawned;
+        }
+
+    tile_worker_main( &workers[0] );
+
+    for( int w = 1; w < spawned; ++w )
+        {
+            pthread_join( threads[w], NULL );
+        }
+
+    for( int w = 0; w < thread_count; ++w )
+        {
+            pthread_mutex_destroy( &pool.deques[w].lock );
+        }
+    pthread_mutex_destroy( &pool.progress_lock );
+
+    free( workers );
+    free( threads );
+    free( pool.deques );
+
+    return true;
+}
@@ -0,0 +1,878 @@
+#include "triangle_mesh.h"
+#include "stats.h"
+#include <math.h>   /* INFINITY */
+#include <stdio.h>  /* FILE, fopen, fread, fprintf */
+#include <stdlib.h> /* malloc, realloc, free, strtod */
+#include <string.h> /* memcpy, memmove, memchr */
+
+// Number of centroid bins evaluated per axis by the surface area heuristic
+#define MESH_BIN_COUNT 16
+
+// Below this depth the BVH is split by the surface area heuristic; deeper nodes are halved by triangle count, which
+// bounds the depth of any mesh of up to 2^32 triangles by BVH_FLAT_STACK_SIZE
+#define MESH_MEDIAN_SPLIT_DEPTH ( BVH_FLAT_STACK_SIZE - 32 )
+
+// Size of the buffer OBJ files are streamed through, and so the longest line they may have
+#define OBJ_BUFFER_SIZE ( (size_t)1 << 20 )
+
+//----------------------------------------------------------------------------------------------------------------------
+// BVH build
+//----------------------------------------------------------------------------------------------------------------------
+typedef struct
+{
+    aabb   bounds;
+    size_t count;
+} mesh_bin;
+
+// A triangle being sorted into the BVH. The build partitions these in place rather than an index array, so every
+// pass reads them in order.
+typedef struct
+{
+    aabb     box;
+    point3   centroid;
+    uint32_t triangle; // Index in the input
+} mesh_build_ref;
+
+// State of a build: the triangles, in the order being produced, and the nodes emitted so far
+typedef struct
+{
+    mesh_build_ref * refs;
+    bvh_flat_node *  nodes;
+    size_t           node_count;
+} mesh_builder;
+
+// aabb_union with plain comparisons instead of fmin and fmax, which are library calls wherever NaN must be handled;
+// the build sees no NaN, and this is its innermost operation
+static inline aabb
+mesh_box_union( aabb a, aabb b )
+{
+    a.min.x = ( b.min.x < a.min.x ) ? b.min.x : a.min.x;
+    a.min.y = ( b.min.y < a.min.y ) ? b.min.y : a.min.y;
+    a.min.z = ( b.min.z < a.min.z ) ? b.min.z : a.min.z;
+    a.max.x = ( b.max.x > a.max.x ) ? b.max.x : a.max.x;
+    a.max.y = ( b.max.y > a.max.y ) ? b.max.y : a.max.y;
+    a.max.z = ( b.max.z > a.max.z ) ? b.max.z : a.max.z;
+    return a;
+}
+
+// Maps a centroid coordinate to its bin along an axis
+static inline int
+mesh_bin_index( double centroid, double axis_min, double bin_scale )
+{
+    int b = (int)( ( centroid - axis_min ) * bin_scale );
+    if( b < 0 ) return 0;
+    if( b >= MESH_BIN_COUNT ) return MESH_BIN_COUNT - 1;
+    return b;
+}
+
+// Picks the bin boundary with the lowest SAH cost over all three axes, binned in one pass, and partitions `refs`
+// around it, like bvh_partition_sah does for the objects of a scene.
+//
+// Returns:
+//   The number of triangles that go to the left child, in [1, count)
+static size_t
+mesh_partition_sah( mesh_build_ref * refs, size_t count, aabb centroid_bounds )
+{
+    mesh_bin bins[3][MESH_BIN_COUNT];
+    double   axis_min[3];
+    double   scale[3];
+    for( int axis = 0; axis < 3; ++axis )
+        {
+            const double extent = vec3_get( centroid_bounds.max, axis ) - vec3_get( centroid_bounds.min, axis );
+            axis_min[axis]      = vec3_get( centroid_bounds.min, axis );
+            scale[axis]         = ( extent > 0.0 ) ? MESH_BIN_COUNT / extent : 0.0;
+            for( int b = 0; b < MESH_BIN_COUNT; ++b )
+                {
+                    bins[axis][b].bounds = aabb_empty();
+                    bins[axis][b].count  = 0;
+                }
+        }
+
+    for( size_t i = 0; i < count; ++i )
+        {
+            for( int axis = 0; axis < 3; ++axis )
+                {
+                    const double c = vec3_get( refs[i].centroid, axis );
+                    mesh_bin *   b = &bins[axis][mesh_bin_index( c, axis_min[axis], scale[axis] )];
+                    b->bounds      = mesh_box_union( b->bounds, refs[i].box );
+                    b->count++;
+                }
+        }
+
+    double best_cost  = INFINITY;
+    int    best_axis  = -1;
+    int    best_split = 0; // Last bin of the left side
+
+    for( int axis = 0; axis < 3; ++axis )
+        {
+            if( 0.0 == scale[axis] ) continue;
+
+            // Sweep from the right to collect the cost terms of every right-hand side...
+            double right_area[MESH_BIN_COUNT];
+            size_t right_count[MESH_BIN_COUNT];
+            aabb   acc = aabb_empty();
+            size_t n   = 0;
+            for( int b = MESH_BIN_COUNT - 1; b > 0; --b )
+                {
+                    acc            = aabb_union( acc, bins[axis][b].bounds );
+                    n             += bins[axis][b].count;
+                    right_area[b]  = aabb_surface_area( acc );
+                    right_count[b] = n;
+                }
+
+            // ...then from the left, evaluating the split after each bin
+            acc = aabb_empty();
+            n   = 0;
+            for( int b = 0; b < MESH_BIN_COUNT - 1; ++b )
+                {
+                    acc  = aabb_union( acc, bins[axis][b].bounds );
+                    n   += bins[axis][b].count;
+                    if( 0 == n || 0 == right_count[b + 1] ) continue;
+
+                    double cost = n * aabb_surface_area( acc ) + right_count[b + 1] * right_area[b + 1];
+                    if( cost < best_cost )
+                        {
+                            best_cost  = cost;
+                            best_axis  = axis;
+                            best_split = b;
+                        }
+                }
+        }
+
+    if( best_axis < 0 ) return count / 2;
+
+    size_t mid = 0;
+    for( size_t i = 0; i < count; ++i )
+        {
+            const double c = vec3_get( refs[i].centroid, best_axis );
+            if( mesh_bin_index( c, axis_min[best_axis], scale[best_axis] ) <= best_split )
+                {
+                    const mesh_build_ref tmp = refs[i];
+                    refs[i]                  = refs[mid];
+                    refs[mid++]              = tmp;
+                }
+        }
+
+    return mid;
+}
+
+// Emits the subtree over refs[begin..end) in depth-first order, the first child right after its parent
+static void
+mesh_build_node( mesh_builder * b, size_t begin, size_t end, int depth )
+{
+    const size_t index = b->node_count++;
+    const size_t count = end - begin;
+
+    aabb box             = aabb_empty();
+    aabb centroid_bounds = aabb_empty();
+    for( size_t i = begin; i < end; ++i )
+        {
+            const point3 c  = b->refs[i].centroid;
+            box             = mesh_box_union( box, b->refs[i].box );
+            centroid_bounds = mesh_box_union( centroid_bounds, (aabb) { c, c } );
+        }
+    bvh_flat_node_set_bounds( &b->nodes[index], box );
+
+    if( count <= TRIANGLE_MESH_LEAF_SIZE )
+        {
+            b->nodes[index].offset = (uint32_t)begin;
+            b->nodes[index].count  = (uint32_t)count;
+            return;
+        }
+
+    const size_t left = ( depth < MESH_MEDIAN_SPLIT_DEPTH )
+                          ? mesh_partition_sah( b->refs + begin, count, centroid_bounds )
+                          : count / 2;
+    b->nodes[index].count = 0;
+    mesh_build_node( b, begin, begin + left, depth + 1 );
+    b->nodes[index].offset = (uint32_t)b->node_count;
+    mesh_build_node( b, begin + left, end, depth + 1 );
+}
+
+// Copies `size` bytes to a new allocation of `memory`
+static void *
+arena_copy( arena * memory, const void * data, size_t size )
+{
+    void * copy = arena_alloc( memory, size );
+    if( NULL != copy ) memcpy( copy, data, size );
+    return copy;
+}
+
+bool
+triangle_mesh_init( triangle_mesh * mesh, arena * memory, const point3 * positions, size_t position_count,
+                    const uint32_t * indices, size_t triangle_count, const vec3 * normals, size_t normal_count,
+                    const uint32_t * normal_indices, material_id mat )
+{
+    if( 0 == triangle_count || triangle_count > UINT32_MAX / 3 )
+        {
+            fprintf( stderr, "ERROR: A mesh needs between 1 and %u triangles, not %zu.\n", UINT32_MAX / 3,
+                     triangle_count );
+            return false;
+        }
+    if( NULL == normals ) normal_indices = NULL;
+
+    for( size_t i = 0; i < 3 * triangle_count; ++i )
+        {
+            const bool bad_normal = NULL != normal_indices && TRIANGLE_MESH_NO_NORMAL != normal_indices[i]
+                                 && normal_indices[i] >= normal_count;
+            if( indices[i] >= position_count || bad_normal )
+                {
+                    fprintf( stderr, "ERROR: Triangle %zu of the mesh references a vertex or normal out of range.\n",
+                             i / 3 );
+                    return false;
+                }
+        }
+
+    // Triangle bounds and the build's own arrays; a binary tree over leaves of one triangle or more has fewer than
+    // two nodes per triangle
+    mesh_build_ref * refs  = (mesh_build_ref *)malloc( triangle_count * sizeof( mesh_build_ref ) );
+    bvh_flat_node *  nodes = (bvh_flat_node *)malloc( 2 * triangle_count * sizeof( bvh_flat_node ) );
+    bool             ok    = ( NULL != refs && NULL != nodes );
+    if( ok )
+        {
+            for( size_t i = 0; i < triangle_count; ++i )
+                {
+                    const uint32_t * v = &indices[3 * i];
+                    refs[i].box        = aabb_from_points( positions[v[0]], positions[v[1]] );
+                    refs[i].box        = aabb_union_point( refs[i].box, positions[v[2]] );
+                    refs[i].centroid   = aabb_centroid( refs[i].box );
+                    refs[i].triangle   = (uint32_t)i;
+                }
+
+            mesh_builder builder = { refs, nodes, 0 };
+            mesh_build_node( &builder, 0, triangle_count, 0 );
+
+            // Nodes are aligned to 32 bytes like the flat BVH's, two per cache line
+            const size_t node_bytes = builder.node_count * sizeof( bvh_flat_node );
+            uintptr_t    node_mem   = (uintptr_t)arena_alloc( memory, node_bytes + 32 );
+            uint32_t *   sorted     = (uint32_t *)arena_alloc( memory, 3 * triangle_count * sizeof( uint32_t ) );
+            uint32_t *   sorted_n   = NULL;
+            if( NULL != normal_indices )
+                sorted_n = (uint32_t *)arena_alloc( memory, 3 * triangle_count * sizeof( uint32_t ) );
+
+            mesh->positions = (const point3 *)arena_copy( memory, positions, position_count * sizeof( point3 ) );
+            mesh->normals   = ( NULL != normal_indices )
+                                ? (const vec3 *)arena_copy( memory, normals, normal_count * sizeof( vec3 ) )
+                                : NULL;
+            ok              = 0 != node_mem && NULL != sorted && NULL != mesh->positions
+                && ( NULL == normal_indices || ( NULL != sorted_n && NULL != mesh->normals ) );
+            if( ok )
+                {
+                    bvh_flat_node * aligned = (bvh_flat_node *)( ( node_mem + 31 ) & ~(uintptr_t)31 );
+                    memcpy( aligned, nodes, node_bytes );
+
+                    // Triangles in leaf order, so leaves read their corners from one run of memory
+                    for( size_t i = 0; i < triangle_count; ++i )
+                        {
+                            const size_t from = 3 * (size_t)refs[i].triangle;
+                            memcpy( &sorted[3 * i], &indices[from], 3 * sizeof( uint32_t ) );
+                            if( NULL != sorted_n )
+                                memcpy( &sorted_n[3 * i], &normal_indices[from], 3 * sizeof( uint32_t ) );
+                        }
+
+                    mesh->base.hit         = triangle_mesh_hit;
+                    mesh->base.material_id = mat;
+                    mesh->base.bbox        = aabb_from_points( vec3_new( aligned[0].min[0], aligned[0].min[1],
+                                                                         aligned[0].min[2] ),
+                                                               vec3_new( aligned[0].max[0], aligned[0].max[1],
+                                                                         aligned[0].max[2] ) );
+                    mesh->indices          = sorted;
+                    mesh->normal_indices   = sorted_n;
+                    mesh->nodes            = aligned;
+                    mesh->position_count   = position_count;
+                    mesh->normal_count     = ( NULL != sorted_n ) ? normal_count : 0;
+                    mesh->triangle_count   = triangle_count;
+                    mesh->node_count       = builder.node_count;
+                }
+        }
+    if( !ok ) fprintf( stderr, "ERROR: Failed to allocate memory for a mesh of %zu triangles.\n", triangle_count );
+
+    free( nodes );
+    free( refs );
+    return ok;
+}
+
+size_t
+triangle_mesh_memory( const triangle_mesh * mesh )
+{
+    if( NULL == mesh ) return 0;
+    return sizeof( triangle_mesh ) + mesh->position_count * sizeof( point3 ) + mesh->normal_count * sizeof( vec3 )
+         + mesh->triangle_count * 3 * sizeof( uint32_t ) * ( NULL != mesh->normal_indices ? 2 : 1 )
+         + mesh->node_count * sizeof( bvh_flat_node );
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Intersection
+//----------------------------------------------------------------------------------------------------------------------
+// A ray prepared for the watertight ray-triangle test of Woop, Benthin and Wald (JCGT 2013). Vertices are moved
+// into a space where the ray starts at the origin and runs along +z, where the test reduces to the signs of three 2D
+// edge functions. Neighbouring triangles evaluate their shared edge from the same two transformed vertices, so a
+// ray through the edge can never miss both.
+typedef struct
+{
+    point3  origin;
+    int     kx, ky, kz; // kz is the axis of the largest direction component; kx, ky keep the winding
+    rt_real sx, sy, sz; // Shear that maps the direction onto +z, with unit length along z
+} watertight_ray;
+
+// Barycentric weights and distance of a ray-triangle hit
+typedef struct
+{
+    rt_real t;
+    rt_real u, v, w; // Weights of the triangle's first, second and third vertex
+} triangle_hit;
+
+static inline void
+watertight_ray_init( watertight_ray * wr, const ray * r )
+{
+    const vec3 d = vec3_abs( r->dir );
+    wr->kz       = ( d.x > d.y ) ? ( ( d.x > d.z ) ? 0 : 2 ) : ( ( d.y > d.z ) ? 1 : 2 );
+    wr->kx       = ( wr->kz + 1 ) % 3;
+    wr->ky       = ( wr->kx + 1 ) % 3;
+    if( vec3_get( r->dir, wr->kz ) < RT_REAL( 0 ) )
+        {
+            const int tmp = wr->kx;
+            wr->kx        = wr->ky;
+            wr->ky        = tmp;
+        }
+
+    const rt_real dz = vec3_get( r->dir, wr->kz );
+    wr->origin       = r->orig;
+    wr->sx           = vec3_get( r->dir, wr->kx ) / dz;
+    wr->sy           = vec3_get( r->dir, wr->ky ) / dz;
+    wr->sz           = RT_REAL( 1 ) / dz;
+}
+
+static inline bool
+triangle_intersect( const watertight_ray * wr, point3 p0, point3 p1, point3 p2, rt_real ray_tmin, rt_real ray_tmax,
+                    triangle_hit * hit )
+{
+    const vec3 a = vec3_sub( p0, wr->origin );
+    const vec3 b = vec3_sub( p1, wr->origin );
+    const vec3 c = vec3_sub( p2, wr->origin );
+
+    // Shear the vertices onto the ray's plane
+    const rt_real az = vec3_get( a, wr->kz ), bz = vec3_get( b, wr->kz ), cz = vec3_get( c, wr->kz );
+    const rt_real ax = vec3_get( a, wr->kx ) - wr->sx * az;
+    const rt_real ay = vec3_get( a, wr->ky ) - wr->sy * az;
+    const rt_real bx = vec3_get( b, wr->kx ) - wr->sx * bz;
+    const rt_real by = vec3_get( b, wr->ky ) - wr->sy * bz;
+    const rt_real cx = vec3_get( c, wr->kx ) - wr->sx * cz;
+    const rt_real cy = vec3_get( c, wr->ky ) - wr->sy * cz;
+
+    // Scaled barycentric coordinates: twice the signed areas of the triangles the ray forms with each edge
+    rt_real u = cx * by - cy * bx;
+    rt_real v = ax * cy - ay * cx;
+    rt_real w = bx * ay - by * ax;
+
+#ifdef RT_USE_FLOAT
+    // A ray exactly on an edge: settle the sign in double precision, so both neighbours agree
+    if( RT_REAL( 0 ) == u || RT_REAL( 0 ) == v || RT_REAL( 0 ) == w )
+        {
+            u = (rt_real)( (double)cx * by - (double)cy * bx );
+            v = (rt_real)( (double)ax * cy - (double)ay * cx );
+            w = (rt_real)( (double)bx * ay - (double)by * ax );
+        }
+#endif
+
+    if( ( u < RT_REAL( 0 ) || v < RT_REAL( 0 ) || w < RT_REAL( 0 ) )
+        && ( u > RT_REAL( 0 ) || v > RT_REAL( 0 ) || w > RT_REAL( 0 ) ) )
+        return false;
+
+    const rt_real det = u + v + w;
+    if( RT_REAL( 0 ) == det ) return false;
+
+    const rt_real inv_det = RT_REAL( 1 ) / det;
+    const rt_real t       = ( u * az + v * bz + w * cz ) * wr->sz * inv_det;
+    if( t <= ray_tmin || ray_tmax <= t ) return false;
+
+    hit->t = t;
+    hit->u = u * inv_det;
+    hit->v = v * inv_det;
+    hit->w = w * inv_det;
+    return true;
+}
+
+// Fills `rec` for a hit of triangle `tri`
+static void
+triangle_mesh_record( const triangle_mesh * mesh, const ray * r, size_t tri, const triangle_hit * hit,
+                      hit_record * rec )
+{
+    const uint32_t * v  = &mesh->indices[3 * tri];
+    const point3     p0 = mesh->positions[v[0]];
+    const vec3 geometric = vec3_normalize( vec3_cross( vec3_sub( mesh->positions[v[1]], p0 ),
+                                                       vec3_sub( mesh->positions[v[2]], p0 ) ) );
+
+    rec->t           = hit->t;
+    rec->p           = ray_at( r, hit->t );
+    rec->material_id = mesh->base.material_id;
+
+    // The side is decided by the geometric normal; an interpolated normal only bends the shading
+    hit_record_set_face_normal( rec, r, &geometric );
+    const uint32_t * n = ( NULL != mesh->normal_indices ) ? &mesh->normal_indices[3 * tri] : NULL;
+    if( NULL != n && TRIANGLE_MESH_NO_NORMAL != n[0] && TRIANGLE_MESH_NO_NORMAL != n[1]
+        && TRIANGLE_MESH_NO_NORMAL != n[2] )
+        {
+            vec3 shading = vec3_add( vec3_add( vec3_mul( mesh->normals[n[0]], hit->u ),
+                                               vec3_mul( mesh->normals[n[1]], hit->v ) ),
+                                     vec3_mul( mesh->normals[n[2]], hit->w ) );
+            shading      = vec3_normalize( shading );
+            if( vec3_dot( shading, rec->normal ) < RT_REAL( 0 ) ) shading = vec3_negate( shading );
+            if( !vec3_is_zero( shading, RT_REAL_ZERO_EPSILON ) ) rec->normal = shading;
+        }
+}
+
+bool
+triangle_mesh_hit( const hittable * object, const ray * r, rt_real ray_tmin, rt_real ray_tmax, hit_record * rec )
+{
+    const triangle_mesh * mesh  = (const triangle_mesh *)object;
+    const bvh_flat_node * nodes = mesh->nodes;
+
+    bvh_flat_ray fr;
+    bvh_flat_ray_init( &fr, r );
+
+    rt_real t_entry;
+    if( !bvh_flat_node_hit( &nodes[0], &fr, ray_tmin, ray_tmax, &t_entry ) ) return false;
+
+    watertight_ray wr;
+    watertight_ray_init( &wr, r );
+
+    // Deferred far children, with the distance at which the ray enters them
+    uint32_t stack_node[BVH_FLAT_STACK_SIZE];
+    rt_real  stack_t[BVH_FLAT_STACK_SIZE];
+    int      sp = 0;
+
+    triangle_hit closest     = { ray_tmax, RT_REAL( 0 ), RT_REAL( 0 ), RT_REAL( 0 ) };
+    size_t       closest_tri = SIZE_MAX;
+    uint32_t     index       = 0;
+
+    for( ;; )
+        {
+            const bvh_flat_node * node = &nodes[index];
+            STATS_INC( STATS_BVH_NODES );
+
+            if( node->count > 0 )
+                {
+                    STATS_ADD( STATS_TRIANGLE_TESTS, node->count );
+                    for( uint32_t i = node->offset; i < node->offset + node->count; ++i )
+                        {
+                            const uint32_t * v = &mesh->indices[3 * (size_t)i];
+                            triangle_hit     hit;
+                            if( triangle_intersect( &wr, mesh->positions[v[0]], mesh->positions[v[1]],
+                                                    mesh->positions[v[2]], ray_tmin, closest.t, &hit ) )
+                                {
+                                    closest     = hit;
+                                    closest_tri = i;
+                                }
+                        }
+                }
+            else
+                {
+                    uint32_t first  = index + 1;
+                    uint32_t second = node->offset;
+                    rt_real  t_first, t_second;
+                    bool     hit_first  = bvh_flat_node_hit( &nodes[first], &fr, ray_tmin, closest.t, &t_first );
+                    bool     hit_second = bvh_flat_node_hit( &nodes[second], &fr, ray_tmin, closest.t, &t_second );
+
+                    if( hit_first && hit_second )
+                        {
+                            // Continue with the nearer child, defer the farther one
+                            bool first_is_near = ( t_first <= t_second );
+                            stack_node[sp]     = first_is_near ? second : first;
+                            stack_t[sp]        = first_is_near ? t_second : t_first;
+                            ++sp;
+                            index = first_is_near ? first : second;
+                            continue;
+                        }
+                    if( hit_first || hit_second )
+                        {
+                            index = hit_first ? first : second;
+                            continue;
+                        }
+                }
+
+            // Pop the next deferred subtree that can still contain a closer hit
+            do
+                {
+                    if( 0 == sp )
+                        {
+                            if( SIZE_MAX == closest_tri ) return false;
+                            triangle_mesh_record( mesh, r, closest_tri, &closest, rec );
+                            return true;
+                        }
+                    --sp;
+                }
+            while( stack_t[sp] >= closest.t );
+            index = stack_node[sp];
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// OBJ loading
+//----------------------------------------------------------------------------------------------------------------------
+// Growable array
+typedef struct
+{
+    void * data;
+    size_t count;
+    size_t capacity;
+} obj_array;
+
+// Makes room for `extra` more elements of `size` bytes
+static bool
+obj_array_reserve( obj_array * a, size_t extra, size_t size )
+{
+    if( a->count + extra <= a->capacity ) return true;
+
+    size_t capacity = ( 0 == a->capacity ) ? 1024 : a->capacity * 2;
+    while( capacity < a->count + extra )
+        {
+            capacity *= 2;
+        }
+    void * data = realloc( a->data, capacity * size );
+    if( NULL == data ) return false;
+    a->data     = data;
+    a->capacity = capacity;
+    return true;
+}
+
+typedef struct
+{
+    const char * path;
+    size_t       line;
+    obj_array    positions;      // point3
+    obj_array    normals;        // vec3
+    obj_array    indices;        // uint32_t, three per triangle
+    obj_array    normal_indices; // uint32_t, three per triangle
+    bool         has_normals;    // Whether any face corner names a normal
+} obj_parser;
+
+static void
+obj_error( const obj_parser * p, const char * message )
+{
+    fprintf( stderr, "ERROR: %s:%zu: %s\n", p->path, p->line, message );
+}
+
+static inline bool
+obj_is_blank( char c )
+{
+    return ' ' == c || '\t' == c || '\r' == c;
+}
+
+static inline const char *
+obj_skip_blanks( const char * s )
+{
+    while( obj_is_blank( *s ) )
+        {
+            ++s;
+        }
+    return s;
+}
+
+// Parses the number at `*cursor` and advances past it. Plain decimals of up to 15 significant digits and small
+// exponents, which is what OBJ exporters write, are converted exactly without strtod (the one multiplication or
+// division by an exact power of ten rounds correctly); anything else goes through strtod.
+static bool
+obj_parse_real( const char ** cursor, double * value )
+{
+    static const double powers[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char * start    = obj_skip_blanks( *cursor );
+    const char * s        = start;
+    const bool   negative = ( '-' == *s );
+    if( '-' == *s || '+' == *s ) ++s;
+
+    uint64_t mantissa = 0;
+    int      digits   = 0; // Significant digits in `mantissa`
+    int      exponent = 0;
+    bool     any      = false;
+    for( ; *s >= '0' && *s <= '9'; ++s, any = true )
+        {
+            if( digits < 19 )
+                {
+                    mantissa = mantissa * 10 + (uint64_t)( *s - '0' );
+                    digits  += ( 0 != mantissa );
+                }
+            else
+                {
+                    ++exponent;
+                }
+        }
+    if( '.' == *s )
+        {
+            for( ++s; *s >= '0' && *s <= '9'; ++s, any = true )
+                {
+                    if( digits < 19 )
+                        {
+                            mantissa = mantissa * 10 + (uint64_t)( *s - '0' );
+                            digits  += ( 0 != mantissa );
+                            --exponent;
+                        }
+                }
+        }
+    if( any && ( 'e' == *s || 'E' == *s ) )
+        {
+            const char * e            = s + 1;
+            const bool   negative_exp = ( '-' == *e );
+            if( '-' == *e || '+' == *e ) ++e;
+            int n = 0;
+            for( ; *e >= '0' && *e <= '9' && n < 100000; ++e )
+                {
+                    n = n * 10 + ( *e - '0' );
+                }
+            if( e[-1] >= '0' && e[-1] <= '9' )
+                {
+                    exponent += negative_exp ? -n : n;
+                    s         = e;
+                }
+        }
+
+    if( any && digits <= 15 && exponent >= -22 && exponent <= 22 && ( '\0' == *s || obj_is_blank( *s ) ) )
+        {
+            const double m = (double)mantissa;
+            *value         = ( exponent < 0 ) ? m / powers[-exponent] : m * powers[exponent];
+            if( negative ) *value = -*value;
+            *cursor = s;
+            return true;
+        }
+
+    char * end = NULL;
+    *value     = strtod( start, &end );
+    if( end == start || !( '\0' == *end || obj_is_blank( *end ) ) ) return false;
+    *cursor = end;
+    return true;
+}
+
+// Parses a signed integer, without the sign check of the caller
+static bool
+obj_parse_index( const char ** cursor, long * value )
+{
+    const char * s        = *cursor;
+    const bool   negative = ( '-' == *s );
+    if( '-' == *s || '+' == *s ) ++s;
+    if( *s < '0' || *s > '9' ) return false;
+
+    long n = 0;
+    for( ; *s >= '0' && *s <= '9'; ++s )
+        {
+            if( n > ( (long)UINT32_MAX ) ) return false;
+            n = n * 10 + ( *s - '0' );
+        }
+    *value  = negative ? -n : n;
+    *cursor = s;
+    return true;
+}
+
+// Turns a one-based or negative, relative OBJ index into an array index
+static bool
+obj_resolve( long index, size_t count, uint32_t * resolved )
+{
+    const long i = ( index < 0 ) ? (long)count + index : index - 1;
+    if( 0 == index || i < 0 || (size_t)i >= count ) return false;
+    *resolved = (uint32_t)i;
+    return true;
+}
+
+static bool
+obj_parse_vec3( obj_parser * p, const char * s, obj_array * array )
+{
+    double x, y, z;
+    if( !obj_parse_real( &s, &x ) || !obj_parse_real( &s, &y ) || !obj_parse_real( &s, &z ) )
+        {
+            obj_error( p, "Expected three numbers." );
+            return false;
+        }
+    if( !obj_array_reserve( array, 1, sizeof( vec3 ) ) )
+        {
+            obj_error( p, "Out of memory." );
+            return false;
+        }
+    ( (vec3 *)array->data )[array->count++] = vec3_new( x, y, z );
+    return true;
+}
+
+// Parses a face into a fan of triangles around its first corner
+static bool
+obj_parse_face( obj_parser * p, const char * s )
+{
+    uint32_t first[2]    = { 0, TRIANGLE_MESH_NO_NORMAL }; // Position and normal index of the fan's first corner
+    uint32_t previous[2] = { 0, TRIANGLE_MESH_NO_NORMAL }; // ...and of its previous corner
+    int      corners = 0;
+
+    for( s = obj_skip_blanks( s ); '\0' != *s; s = obj_skip_blanks( s ) )
+        {
+            long     v  = 0;
+            long     vn = 0;
+            uint32_t corner[2];
+            if( !obj_parse_index( &s, &v ) )
+                {
+                    obj_error( p, "Expected a vertex index." );
+                    return false;
+                }
+            if( '/' == *s )
+                {
+                    long vt;
+                    ++s;
+                    if( '/' != *s && !obj_parse_index( &s, &vt ) )
+                        {
+                            obj_error( p, "Expected a texture coordinate index." );
+                            return false;
+                        }
+                    if( '/' == *s )
+                        {
+                            ++s;
+                            if( !obj_parse_index( &s, &vn ) )
+                                {
+                                    obj_error( p, "Expected a normal index." );
+                                    return false;
+                                }
+                        }
+                }
+            if( '\0' != *s && !obj_is_blank( *s ) )
+                {
+                    obj_error( p, "Malformed face corner." );
+                    return false;
+                }
+
+            if( !obj_resolve( v, p->positions.count, &corner[0] ) )
+                {
+                    obj_error( p, "Vertex index out of range." );
+                    return false;
+                }
+            corner[1] = TRIANGLE_MESH_NO_NORMAL;
+            if( 0 != vn && !obj_resolve( vn, p->normals.count, &corner[1] ) )
+                {
+                    obj_error( p, "Normal index out of range." );
+                    return false;
+                }
+            p->has_normals = p->has_normals || ( 0 != vn );
+
+            if( corners >= 2 )
+                {
+                    if( !obj_array_reserve( &p->indices, 3, sizeof( uint32_t ) )
+                        || !obj_array_reserve( &p->normal_indices, 3, sizeof( uint32_t ) ) )
+                        {
+                            obj_error( p, "Out of memory." );
+                            return false;
+                        }
+                    uint32_t * tri    = (uint32_t *)p->indices.data + p->indices.count;
+                    uint32_t * tri_n  = (uint32_t *)p->normal_indices.data + p->normal_indices.count;
+                    tri[0]            = first[0];
+                    tri[1]            = previous[0];
+                    tri[2]            = corner[0];
+                    tri_n[0]          = first[1];
+                    tri_n[1]          = previous[1];
+                    tri_n[2]          = corner[1];
+                    p->indices.count += 3;
+                    p->normal_indices.count += 3;
+                }
+            else if( 0 == corners )
+                {
+                    first[0] = corner[0];
+                    first[1] = corner[1];
+                }
+            previous[0] = corner[0];
+            previous[1] = corner[1];
+            ++corners;
+        }
+
+    if( corners < 3 )
+        {
+            obj_error( p, "A face needs at least three corners." );
+            return false;
+        }
+    return true;
+}
+
+// Parses one line, NUL-terminated
+static bool
+obj_parse_line( obj_parser * p, const char * s )
+{
+    s = obj_skip_blanks( s );
+    if( 'v' == s[0] && obj_is_blank( s[1] ) ) return obj_parse_vec3( p, s + 2, &p->positions );
+    if( 'v' == s[0] && 'n' == s[1] && obj_is_blank( s[2] ) ) return obj_parse_vec3( p, s + 3, &p->normals );
+    if( 'f' == s[0] && obj_is_blank( s[1] ) ) return obj_parse_face( p, s + 2 );
+    return true; // Comments, texture coordinates, groups, materials...
+}
+
+triangle_mesh *
+triangle_mesh_load_obj( const char * path, arena * memory, material_id mat )
+{
+    FILE * file = fopen( path, "rb" );
+    if( NULL == file )
+        {
+            fprintf( stderr, "ERROR: Failed to open '%s'.\n", path );
+            return NULL;
+        }
+
+    obj_parser p;
+    memset( &p, 0, sizeof( p ) );
+    p.path = path;
+
+    char * buffer = (char *)malloc( OBJ_BUFFER_SIZE + 1 );
+    bool   ok     = ( NULL != buffer );
+    if( !ok ) fprintf( stderr, "ERROR: Failed to allocate memory to read '%s'.\n", path );
+
+    // Lines are parsed in place; a line cut by the end of the buffer moves to its start before the next read
+    size_t pending = 0;
+    bool   eof     = false;
+    while( ok && !eof )
+        {
+            const size_t read = fread( buffer + pending, 1, OBJ_BUFFER_SIZE - pending, file );
+            const size_t size = pending + read;
+            eof               = ( size < OBJ_BUFFER_SIZE );
+            if( eof && ferror( file ) )
+                {
+                    fprintf( stderr, "ERROR: Failed to read '%s'.\n", path );
+                    ok = false;
+                    break;
+                }
+            buffer[size] = '\n'; // The last line of the file may lack its newline
+
+            char * line = buffer;
+            char * end  = buffer + size;
+            for( ;; )
+                {
+                    char * newline = (char *)memchr( line, '\n', (size_t)( end - line ) + ( eof ? 1 : 0 ) );
+                    if( NULL == newline ) break;
+                    *newline = '\0';
+                    ++p.line;
+                    ok   = obj_parse_line( &p, line );
+                    line = newline + 1;
+                    if( !ok || line > end ) break;
+                }
+
+            pending = (size_t)( end - line );
+            if( ok && !eof && pending == OBJ_BUFFER_SIZE )
+                {
+                    p.line += 1;
+                    obj_error( &p, "Line too long." );
+                    ok = false;
+                }
+            if( ok && !eof ) memmove( buffer, line, pending );
+        }
+    fclose( file );
+    free( buffer );
+
+    triangle_mesh * mesh = NULL;
+    if( ok && 0 == p.indices.count ) fprintf( stderr, "ERROR: '%s' has no faces.\n", path );
+    if( ok && p.indices.count > 0 )
+        {
+            mesh = ARENA_NEW( memory, triangle_mesh );
+            if( NULL == mesh
+                || !triangle_mesh_init( mesh, memory, (const point3 *)p.positions.data, p.positions.count,
+                                        (const uint32_t *)p.indices.data, p.indices.count / 3,
+                                        (const vec3 *)p.normals.data, p.normals.count,
+                                        p.has_normals ? (const uint32_t *)p.normal_indices.data : NULL, mat ) )
+                {
+                    mesh = NULL;
+                }
+        }
+
+    free( p.positions.data );
+    free( p.normals.data );
+    free( p.indices.data );
+    free( p.normal_indices.data );
+    return mesh;
+}
@@ -0,0 +1,400 @@
+#include "wavefront.h"
+#include "material_table.h"
+#include "rtweekend.h"
+#include "stats.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> /* malloc, calloc, realloc, free */
+
+typedef bool ( *scatter_fn )( const material * material, const ray * r_in, const struct hit_record_s * rec,
+                              color * attenuation, ray * scattered, rng * gen );
+
+struct wavefront_state
+{
+    // Current ray of every path
+    rt_real * origin_x;
+    rt_real * origin_y;
+    rt_real * origin_z;
+    rt_real * dir_x;
+    rt_real * dir_y;
+    rt_real * dir_z;
+
+    // Product of the attenuations met so far
+    rt_real * throughput_r;
+    rt_real * throughput_g;
+    rt_real * throughput_b;
+
+    color *      radiance;     // Contribution of the path once it has terminated
+    rng *        gen;          // Generator of the path, continuing its primary sample's stream
+    int *        depth;        // Bounces left
+    hit_record * rec;          // Closest hit of the current ray
+    uint32_t *   sample_pixel; // Pixel of the tile the path samples
+#ifdef ENABLE_STATS
+    uint32_t * pixel; // Image pixel of the path, for the cost heatmap
+#endif
+
+    // Queues of path indices
+    uint32_t * active;                              // Paths to intersect in the next stage
+    size_t     active_count;
+    uint32_t * next;                                // Paths that scattered and survive to the next bounce
+    size_t     next_count;
+    uint32_t * by_material[MATERIAL_TYPE_COUNT];    // Paths that hit a surface, per material type
+    size_t     material_count[MATERIAL_TYPE_COUNT];
+
+    // Per-pixel paths and sums of the tile being rendered
+    int64_t * offsets; // The paths of pixel k are numbered offsets[k] to offsets[k + 1] - 1
+    color *   sums;
+    double *  lum_sq;
+    size_t    sums_capacity;
+};
+
+wavefront_state *
+wavefront_create( void )
+{
+    wavefront_state * state = (wavefront_state *)calloc( 1, sizeof( wavefront_state ) );
+    if( NULL == state ) return NULL;
+
+    const size_t n      = WAVEFRONT_BATCH;
+    state->origin_x     = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->origin_y     = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->origin_z     = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->dir_x        = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->dir_y        = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->dir_z        = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->throughput_r = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->throughput_g = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->throughput_b = (rt_real *)malloc( n * sizeof( rt_real ) );
+    state->radiance     = (color *)malloc( n * sizeof( color ) );
+    state->gen          = (rng *)malloc( n * sizeof( rng ) );
+    state->depth        = (int *)malloc( n * sizeof( int ) );
+    state->rec          = (hit_record *)malloc( n * sizeof( hit_record ) );
+    state->sample_pixel = (uint32_t *)malloc( n * sizeof( uint32_t ) );
+    state->active       = (uint32_t *)malloc( n * sizeof( uint32_t ) );
+    state->next         = (uint32_t *)malloc( n * sizeof( uint32_t ) );
+
+    bool ok = state->origin_x && state->origin_y && state->origin_z && state->dir_x && state->dir_y && state->dir_z
+           && state->throughput_r && state->throughput_g && state->throughput_b && state->radiance && state->gen
+           && state->depth && state->rec && state->sample_pixel && state->active && state->next;
+#ifdef ENABLE_STATS
+    state->pixel  = (uint32_t *)malloc( n * sizeof( uint32_t ) );
+    ok           &= ( NULL != state->pixel );
+#endif
+
+    for( int t = 0; t < MATERIAL_TYPE_COUNT; ++t )
+        {
+            state->by_material[t]  = (uint32_t *)malloc( n * sizeof( uint32_t ) );
+            ok                    &= ( NULL != state->by_material[t] );
+        }
+
+    if( !ok )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the wavefront integrator.\n" );
+            wavefront_destroy( state );
+            return NULL;
+        }
+    return state;
+}
+
+void
+wavefront_destroy( wavefront_state * state )
+{
+    if( NULL == state ) return;
+
+    free( state->origin_x );
+    free( state->origin_y );
+    free( state->origin_z );
+    free( state->dir_x );
+    free( state->dir_y );
+    free( state->dir_z );
+    free( state->throughput_r );
+    free( state->throughput_g );
+    free( state->throughput_b );
+    free( state->radiance );
+    free( state->gen );
+    free( state->depth );
+    free( state->rec );
+    free( state->sample_pixel );
+    free( state->active );
+    free( state->next );
+#ifdef ENABLE_STATS
+    free( state->pixel );
+#endif
+    for( int t = 0; t < MATERIAL_TYPE_COUNT; ++t )
+        {
+            free( state->by_material[t] );
+        }
+    free( state->offsets );
+    free( state->sums );
+    free( state->lum_sq );
+    free( state );
+}
+
+static inline ray
+load_ray( const wavefront_state * state, uint32_t p )
+{
+    return ray_create( vec3_new( state->origin_x[p], state->origin_y[p], state->origin_z[p] ),
+                       vec3_new( state->dir_x[p], state->dir_y[p], state->dir_z[p] ) );
+}
+
+static inline void
+store_ray( wavefront_state * state, uint32_t p, const ray * r )
+{
+    state->origin_x[p] = r->orig.x;
+    state->origin_y[p] = r->orig.y;
+    state->origin_z[p] = r->orig.z;
+    state->dir_x[p]    = r->dir.x;
+    state->dir_y[p]    = r->dir.y;
+    state->dir_z[p]    = r->dir.z;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Stages
+//----------------------------------------------------------------------------------------------------------------------
+// Starts `count` paths: path k traces path first_path + k of the tile, `*pixel` being the tile pixel of the path
+// before it. Paths are numbered pixel by pixel, so consecutive paths start out along nearly the same ray and traverse
+// the same part of the scene.
+static void
+stage_generate( wavefront_state * state, const camera * cam, int x0, int y0, int tile_width, const int * first_sample,
+                int64_t first_path, int count, int * pixel )
+{
+    for( int k = 0; k < count; ++k )
+        {
+            const int64_t path = first_path + k;
+            while( state->offsets[*pixel + 1] <= path )
+                {
+                    ++*pixel;
+                }
+            const int sample = (int)( path - state->offsets[*pixel] ) + ( first_sample ? first_sample[*pixel] : 0 );
+            const int i      = x0 + *pixel % tile_width;
+            const int j      = y0 + *pixel / tile_width;
+            ray       r      = camera_sample_ray( cam, &state->gen[k], i, j, sample );
+
+            store_ray( state, (uint32_t)k, &r );
+            state->throughput_r[k] = 1.0;
+            state->throughput_g[k] = 1.0;
+            state->throughput_b[k] = 1.0;
+            state->radiance[k]     = vec3_new( 0, 0, 0 );
+            state->depth[k]        = cam->max_depth;
+            state->sample_pixel[k] = (uint32_t)*pixel;
+            state->active[k]       = (uint32_t)k;
+#ifdef ENABLE_STATS
+            state->pixel[k] = (uint32_t)( (size_t)j * cam->image_width + i );
+#endif
+        }
+    state->active_count = (size_t)count;
+}
+
+// Intersects every active path. Escaped paths collect the sky and terminate, paths out of bounces or hitting a
+// surface without material terminate dark, the rest are queued by material type.
+static void
+stage_intersect( wavefront_state * state, const camera * cam, const hittable * world )
+{
+    RT_UNUSED( cam ); // Only read by the statistics
+
+    for( int t = 0; t < MATERIAL_TYPE_COUNT; ++t )
+        {
+            state->material_count[t] = 0;
+        }
+
+    for( size_t n = 0; n < state->active_count; ++n )
+        {
+            const uint32_t p = state->active[n];
+            if( state->depth[p] <= 0 )
+                {
+                    STATS_PATH_END( STATS_BOUNCE_LIMIT, cam->max_depth );
+                    continue; // Ray bounce limit reached
+                }
+
+#ifdef ENABLE_STATS
+            stats_pixel = state->pixel[p];
+#endif
+            STATS_RAYS_TRACED( 1 );
+
+            ray r = load_ray( state, p );
+            if( !world->hit( world, &r, CAMERA_RAY_T_MIN, RT_INFINITY, &state->rec[p] ) )
+                {
+                    STATS_PATH_END( STATS_ESCAPED, cam->max_depth - state->depth[p] );
+                    color sky          = camera_background( &r );
+                    state->radiance[p] = vec3_new( state->throughput_r[p] * sky.x, state->throughput_g[p] * sky.y,
+                                                   state->throughput_b[p] * sky.z );
+                    continue;
+                }
+
+            const material_id id = state->rec[p].material_id;
+            if( MATERIAL_ID_NONE == id )
+                {
+                    STATS_PATH_END( STATS_ABSORBED, cam->max_depth - state->depth[p] );
+                    continue;
+                }
+
+            const material_type type                                = material_id_type( id );
+            state->by_material[type][state->material_count[type]++] = p;
+        }
+}
+
+// Scatters every path of one material queue, then plays Russian roulette on the survivors. Inlined once per material
+// with a constant `scatter`, so each loop calls the concrete function directly.
+static inline void
+shade_queue( wavefront_state * state, const camera * cam, const uint32_t * queue, size_t count, scatter_fn scatter )
+{
+    for( size_t n = 0; n < count; ++n )
+        {
+            const uint32_t     p    = queue[n];
+            const hit_record * rec  = &state->rec[p];
+            const material *   mat  = material_table_get( cam->materials, rec->material_id );
+            ray                r_in = load_ray( state, p );
+            ray                scattered;
+            color              attenuation;
+
+            sampler_begin_bounce( &state->gen[p] );
+            if( !scatter( mat, &r_in, rec, &attenuation, &scattered, &state->gen[p] ) )
+                {
+                    STATS_PATH_END( STATS_ABSORBED, cam->max_depth - state->depth[p] );
+                    continue; // Absorbed
+                }
+
+            state->throughput_r[p] *= attenuation.x;
+            state->throughput_g[p] *= attenuation.y;
+            state->throughput_b[p] *= attenuation.z;
+            state->depth[p]        -= 1;
+
+            const color throughput = vec3_new( state->throughput_r[p], state->throughput_g[p], state->throughput_b[p] );
+            const double survival
+                = camera_roulette( cam, cam->max_depth - state->depth[p], throughput, &state->gen[p] );
+            if( survival <= 0.0 )
+                {
+                    STATS_PATH_END( STATS_ROULETTE, cam->max_depth - state->depth[p] );
+                    continue; // Ended by Russian roulette
+                }
+
+            // Scaled like vec3_div so survivors follow the recursive integrator's paths exactly
+            const rt_real inv_survival = RT_REAL( 1 ) / (rt_real)survival;
+            store_ray( state, p, &scattered );
+            state->throughput_r[p]           *= inv_survival;
+            state->throughput_g[p]           *= inv_survival;
+            state->throughput_b[p]           *= inv_survival;
+            state->next[state->next_count++]  = p;
+        }
+}
+
+static void
+custom_scatter_loop( wavefront_state * state, const camera * cam )
+{
+    const uint32_t * queue = state->by_material[MATERIAL_CUSTOM];
+    for( size_t n = 0; n < state->material_count[MATERIAL_CUSTOM]; ++n )
+        {
+            const uint32_t   p   = queue[n];
+            const material * mat = material_table_get( cam->materials, state->rec[p].material_id );
+            shade_queue( state, cam, &queue[n], 1, mat->scatter );
+        }
+}
+
+// Shades the hits one material type at a time, then compacts the surviving paths into the active queue
+static void
+stage_shade( wavefront_state * state, const camera * cam )
+{
+    state->next_count = 0;
+
+    shade_queue( state, cam, state->by_material[MATERIAL_LAMBERTIAN], state->material_count[MATERIAL_LAMBERTIAN],
+                 lambertian_scatter );
+    shade_queue( state, cam, state->by_material[MATERIAL_METAL], state->material_count[MATERIAL_METAL],
+                 metal_scatter );
+    shade_queue( state, cam, state->by_material[MATERIAL_DIELECTRIC], state->material_count[MATERIAL_DIELECTRIC],
+                 dielectric_scatter );
+    custom_scatter_loop( state, cam );
+
+    uint32_t * swap     = state->active;
+    state->active       = state->next;
+    state->next         = swap;
+    state->active_count = state->next_count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Public interface
+//----------------------------------------------------------------------------------------------------------------------
+// Grows the per-pixel arrays of the state to `tile_pixels` pixels.
+//
+// Returns:
+//   false if memory ran out (reported)
+static bool
+reserve_tile( wavefront_state * state, size_t tile_pixels )
+{
+    if( state->sums_capacity >= tile_pixels ) return true;
+
+    int64_t * offsets = (int64_t *)realloc( state->offsets, ( tile_pixels + 1 ) * sizeof( int64_t ) );
+    if( NULL != offsets ) state->offsets = offsets;
+    color * sums = (color *)realloc( state->sums, tile_pixels * sizeof( color ) );
+    if( NULL != sums ) state->sums = sums;
+    double * lum_sq = (double *)realloc( state->lum_sq, tile_pixels * sizeof( double ) );
+    if( NULL != lum_sq ) state->lum_sq = lum_sq;
+    if( NULL == offsets || NULL == sums || NULL == lum_sq )
+        {
+            fprintf( stderr, "ERROR: Failed to allocate memory for the wavefront integrator.\n" );
+            return false;
+        }
+    state->sums_capacity = tile_pixels;
+    return true;
+}
+
+bool
+wavefront_render_tile( wavefront_state * state, const camera * cam, const hittable * world, int x0, int y0, int x1,
+                       int y1 )
+{
+    return wavefront_render_samples( state, cam, world, x0, y0, x1, y1, NULL, NULL );
+}
+
+bool
+wavefront_render_samples( wavefront_state * state, const camera * cam, const hittable * world, int x0, int y0, int x1,
+                          int y1, const int * first_sample, const int * end_sample )
+{
+    const int tile_width  = x1 - x0;
+    const int tile_pixels = tile_width * ( y1 - y0 );
+    if( tile_pixels <= 0 ) return true;
+    if( !reserve_tile( state, (size_t)tile_pixels ) ) return false;
+
+    state->offsets[0] = 0;
+    for( int k = 0; k < tile_pixels; ++k )
+        {
+            const int first       = first_sample ? first_sample[k] : 0;
+            const int end         = end_sample ? end_sample[k] : cam->samples_per_pixel;
+            state->offsets[k + 1] = state->offsets[k] + RT_MAX( end - first, 0 );
+            state->sums[k]        = vec3_new( 0, 0, 0 );
+            state->lum_sq[k]      = 0.0;
+        }
+
+    const int64_t total_paths = state->offsets[tile_pixels];
+    int           pixel       = 0;
+    for( int64_t first = 0; first < total_paths; first += WAVEFRONT_BATCH )
+        {
+            const int count = (int)RT_MIN( (int64_t)WAVEFRONT_BATCH, total_paths - first );
+
+            stage_generate( state, cam, x0, y0, tile_width, first_sample, first, count, &pixel );
+            while( state->active_count > 0 )
+                {
+                    stage_intersect( state, cam, world );
+                    stage_shade( state, cam );
+                }
+
+            // Every pixel adds its samples in increasing order, like the recursive integrator
+            for( int k = 0; k < count; ++k )
+                {
+                    const uint32_t q  = state->sample_pixel[k];
+                    const double   y  = color_luminance( state->radiance[k] );
+                    state->sums[q]    = vec3_add( state->sums[q], state->radiance[k] );
+                    state->lum_sq[q] += y * y;
+                }
+        }
+    return true;
+}
+
+const color *
+wavefront_tile_sums( const wavefront_state * state )
+{
+    return state->sums;
+}
+
+const double *
+wavefront_tile_lum_sq( const wavefront_state * state )
+{
+    return state->lum_sq;
+}